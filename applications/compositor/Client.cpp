@@ -147,33 +147,8 @@ void client_handle_set_wallpaper(Client *client, CompositorSetWallaper set_wallp
     }
 }
 
-void client_request_callback(Client *client, Connection *connection, SelectEvent events)
+void client_handle_message(Client *client, CompositorMessage &message)
 {
-    assert(events & SELECT_READ);
-
-    CompositorMessage message = {};
-    size_t message_size = connection_receive(connection, &message, sizeof(CompositorMessage));
-
-    if (handle_has_error(connection))
-    {
-        logger_error("Client handle has error: %s!", handle_error_string(connection));
-
-        client->disconnected = true;
-        client_destroy_disconnected();
-        return;
-    }
-
-    if (message_size != sizeof(CompositorMessage))
-    {
-        logger_error("Got a message with an invalid size from client %u != %u!", sizeof(CompositorMessage), message_size);
-        hexdump(&message, message_size);
-
-        client->disconnected = true;
-        client_destroy_disconnected();
-
-        return;
-    }
-
     switch (message.type)
     {
     case COMPOSITOR_MESSAGE_CREATE_WINDOW:
@@ -209,23 +184,54 @@ void client_request_callback(Client *client, Connection *connection, SelectEvent
 
     default:
         logger_error("Invalid message for client %08x", client);
-        hexdump(&message, message_size);
+        hexdump(&message, sizeof(CompositorMessage));
 
         client->disconnected = true;
-        client_destroy_disconnected();
 
         break;
     }
 }
 
+void client_request_callback(Client *client, Connection *connection, SelectEvent events)
+{
+    __unused(connection);
+    assert(events & SELECT_READ);
+
+    bool was_attached = client->peer.is_attached();
+
+    Result result = client->peer.receive([&](CompositorMessage &message) {
+        client_handle_message(client, message);
+
+        return client->disconnected ? Iteration::STOP : Iteration::CONTINUE;
+    });
+
+    if (result != SUCCESS)
+    {
+        logger_error("Client handle has error: %s!", result_to_string(result));
+        client->disconnected = true;
+    }
+
+    if (!was_attached && !client->disconnected)
+    {
+        client->send_message((CompositorMessage){
+            .type = COMPOSITOR_MESSAGE_GREETINGS,
+            .greetings = {
+                .screen_bound = renderer_bound(),
+            },
+        });
+    }
+
+    client_destroy_disconnected();
+}
+
 Client::Client(Connection *connection)
+    : peer(connection)
 {
     if (!_connected_client)
     {
         _connected_client = list_create();
     }
 
-    this->connection = connection;
     this->notifier = notifier_create(
         this,
         HANDLE(connection),
@@ -235,13 +241,6 @@ Client::Client(Connection *connection)
     list_pushback(_connected_client, this);
 
     logger_info("Client %08x connected", this);
-
-    this->send_message((CompositorMessage){
-        .type = COMPOSITOR_MESSAGE_GREETINGS,
-        .greetings = {
-            .screen_bound = renderer_bound(),
-        },
-    });
 }
 
 Iteration destroy_window_if_client_match(Client *client, Window *window)
@@ -266,7 +265,6 @@ Client::~Client()
     client_close_all_windows(this);
     list_remove(_connected_client, this);
     notifier_destroy(notifier);
-    connection_close(connection);
 }
 
 void client_broadcast(CompositorMessage message)
@@ -284,16 +282,46 @@ Result Client::send_message(CompositorMessage message)
         return ERR_STREAM_CLOSED;
     }
 
-    connection_send(connection, &message, sizeof(CompositorMessage));
+    Result result = peer.send(message);
 
-    if (handle_has_error(connection))
+    if (result != SUCCESS)
     {
-        logger_error("Failed to send message to %08x: %s", this, handle_error_string(connection));
+        logger_error("Failed to send message to %08x: %s", this, result_to_string(result));
         disconnected = true;
-        return handle_get_error(connection);
     }
 
-    return SUCCESS;
+    return result;
+}
+
+Result Client::flush()
+{
+    if (disconnected)
+    {
+        return ERR_STREAM_CLOSED;
+    }
+
+    Result result = peer.flush();
+
+    if (result != SUCCESS)
+    {
+        logger_error("Failed to flush messages to %08x: %s", this, result_to_string(result));
+        disconnected = true;
+    }
+
+    return result;
+}
+
+void client_flush_all()
+{
+    if (!_connected_client)
+    {
+        return;
+    }
+
+    list_foreach(Client, client, _connected_client)
+    {
+        client->flush();
+    }
 }
 
 Iteration client_destroy_if_disconnected(void *target, Client *client)
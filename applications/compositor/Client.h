@@ -1,5 +1,6 @@
 #pragma once
 
+#include <libprotocol/ServerConnection.h>
 #include <libsystem/eventloop/Notifier.h>
 #include <libsystem/io/Connection.h>
 
@@ -8,7 +9,7 @@
 struct Client
 {
     Notifier *notifier = nullptr;
-    Connection *connection = nullptr;
+    protocol::ServerConnection<CompositorProtocol> peer;
     bool disconnected = false;
 
     Client(Connection *connection);
@@ -16,8 +17,12 @@ struct Client
     ~Client();
 
     Result send_message(CompositorMessage message);
+
+    Result flush();
 };
 
 void client_broadcast(CompositorMessage message);
 
+void client_flush_all();
+
 void client_destroy_disconnected();
@@ -147,3 +147,28 @@ struct CompositorMessage
         CompositorChangedResolution changed_resolution;
     };
 };
+
+struct CompositorProtocol
+{
+    using Message = CompositorMessage;
+
+    // Only the last position of the mouse matters to a window.
+    static bool coalesce(CompositorMessage &previous, const CompositorMessage &next)
+    {
+        if (previous.type != COMPOSITOR_MESSAGE_EVENT_WINDOW ||
+            next.type != COMPOSITOR_MESSAGE_EVENT_WINDOW ||
+            previous.event_window.id != next.event_window.id ||
+            previous.event_window.event.type != Event::MOUSE_MOVE ||
+            next.event_window.event.type != Event::MOUSE_MOVE)
+        {
+            return false;
+        }
+
+        Vec2i old_position = previous.event_window.event.mouse.old_position;
+
+        previous.event_window = next.event_window;
+        previous.event_window.event.mouse.old_position = old_position;
+
+        return true;
+    }
+};
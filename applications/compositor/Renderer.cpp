@@ -1,4 +1,5 @@
 #include <libgraphic/Framebuffer.h>
+#include <libgraphic/Region.h>
 #include <libutils/Vector.h>
 
 #include "compositor/Cursor.h"
@@ -9,7 +10,9 @@
 static OwnPtr<Framebuffer> _framebuffer;
 static RefPtr<Bitmap> _wallpaper;
 
-static Vector<Rectangle> _dirty_regions;
+static Region _dirty_region;
+
+static RendererStatistics _statistics = {};
 
 void renderer_initialize()
 {
@@ -26,37 +29,7 @@ void renderer_region_dirty(Rectangle new_region)
         return;
     }
 
-    bool merged = false;
-
-    _dirty_regions.foreach ([&](Rectangle &region) {
-        if (region.colide_with(new_region))
-        {
-            Rectangle top;
-            Rectangle botton;
-            Rectangle left;
-            Rectangle right;
-
-            new_region.substract(region, top, botton, left, right);
-
-            renderer_region_dirty(top);
-            renderer_region_dirty(botton);
-            renderer_region_dirty(left);
-            renderer_region_dirty(right);
-
-            merged = true;
-
-            return Iteration::STOP;
-        }
-        else
-        {
-            return Iteration::CONTINUE;
-        }
-    });
-
-    if (!merged)
-    {
-        _dirty_regions.push_back(new_region);
-    }
+    _dirty_region.add(new_region);
 }
 
 void renderer_composite_wallpaper(Rectangle region)
@@ -71,90 +44,78 @@ void renderer_composite_wallpaper(Rectangle region)
         region.height() * scale_y);
 
     _framebuffer->painter().blit_bitmap_no_alpha(*_wallpaper, source, region);
-    _framebuffer->mark_dirty(region);
+    _statistics.pixels_painted += region.area();
 }
 
-void renderer_composite_region(Rectangle region, Window *window_transparent)
+void renderer_composite_window(Window *window, Rectangle region)
 {
-    renderer_composite_wallpaper(region);
-
-    manager_iterate_back_to_front([&](Window *window) {
-        if (window == window_transparent)
-        {
-            return Iteration::STOP;
-        }
-
-        if (window->bound().colide_with(region))
-        {
-            Rectangle destination = window->bound().clipped_with(region);
-
-            Rectangle source(
-                destination.position() - window->bound().position(),
-                destination.size());
-
-            _framebuffer->painter().blit_bitmap(window->frontbuffer(), source, destination);
-        }
+    Rectangle source(
+        region.position() - window->bound().position(),
+        region.size());
 
-        return Iteration::CONTINUE;
-    });
+    if (window->flags() & WINDOW_TRANSPARENT)
+    {
+        _framebuffer->painter().blit_bitmap(window->frontbuffer(), source, region);
+    }
+    else
+    {
+        _framebuffer->painter().blit_bitmap_no_alpha(window->frontbuffer(), source, region);
+    }
 
-    _framebuffer->mark_dirty(region);
+    _statistics.pixels_painted += region.area();
 }
 
-void renderer_region(Rectangle region)
+struct VisibleWindow
 {
-    bool should_paint_wallpaper = true;
-
-    if (region.is_empty())
-    {
-        return;
-    }
+    Window *window;
+    Region region;
+};
+
+// Walks the windows front to back to find what is left visible of each one
+// by the opaque windows above it, then paints back to front. Without
+// transparent windows every damaged pixel is painted exactly once.
+void renderer_region(Region &damaged)
+{
+    Vector<VisibleWindow> visible_windows;
+    Region covered;
 
     manager_iterate_front_to_back([&](Window *window) {
-        if (window->bound().colide_with(region))
+        if (!damaged.colide_with(window->bound()))
         {
-            Rectangle destination = window->bound().clipped_with(region);
-
-            Rectangle source(
-                destination.position() - window->bound().position(),
-                destination.size());
-
-            if (window->flags() & WINDOW_TRANSPARENT)
-            {
-                renderer_composite_region(destination, window);
-                //_framebuffer->painter().blur_rectangle(destination, 48);
-                _framebuffer->painter().blit_bitmap(window->frontbuffer(), source, destination);
-            }
-            else
-            {
-                _framebuffer->painter().blit_bitmap_no_alpha(window->frontbuffer(), source, destination);
-            }
-
-            _framebuffer->mark_dirty(destination);
+            return Iteration::CONTINUE;
+        }
 
-            Rectangle top;
-            Rectangle botton;
-            Rectangle left;
-            Rectangle right;
+        Region visible = damaged.subtracted(covered);
+        visible.clip(window->bound());
 
-            region.substract(destination, top, botton, left, right);
+        if (!visible.is_empty())
+        {
+            visible_windows.push_back({window, move(visible)});
+        }
 
-            renderer_region(top);
-            renderer_region(botton);
-            renderer_region(left);
-            renderer_region(right);
+        if (!(window->flags() & WINDOW_TRANSPARENT))
+        {
+            covered.add(window->bound());
+        }
 
-            should_paint_wallpaper = false;
+        return Iteration::CONTINUE;
+    });
 
-            return Iteration::STOP;
-        }
+    Region wallpaper = damaged.subtracted(covered);
 
+    wallpaper.foreach ([](Rectangle &rectangle) {
+        renderer_composite_wallpaper(rectangle);
         return Iteration::CONTINUE;
     });
 
-    if (should_paint_wallpaper)
+    for (size_t i = visible_windows.count(); i > 0; i--)
     {
-        renderer_composite_wallpaper(region);
+        VisibleWindow &visible_window = visible_windows[i - 1];
+
+        visible_window.region.foreach ([&](Rectangle &rectangle) {
+            renderer_composite_window(visible_window.window, rectangle);
+            return Iteration::CONTINUE;
+        });
     }
 }
 
@@ -165,22 +126,44 @@ Rectangle renderer_bound()
 
 void renderer_repaint_dirty()
 {
-    _dirty_regions.foreach ([](Rectangle region) {
-        renderer_region(region);
+    if (_dirty_region.is_empty())
+    {
+        return;
+    }
 
-        if (region.colide_with(cursor_bound()))
-        {
-            renderer_region(cursor_bound());
+    _dirty_region.clip(renderer_bound());
 
-            cursor_render(_framebuffer->painter());
-        }
+    // The cursor is drawn over everything, so what's under it is repainted too.
+    bool should_render_cursor = _dirty_region.colide_with(cursor_bound());
+
+    if (should_render_cursor)
+    {
+        _dirty_region.add(cursor_bound());
+    }
 
+    _statistics.frames++;
+    _statistics.pixels_damaged += _dirty_region.area();
+
+    renderer_region(_dirty_region);
+
+    if (should_render_cursor)
+    {
+        cursor_render(_framebuffer->painter());
+    }
+
+    _dirty_region.foreach ([](Rectangle &rectangle) {
+        _framebuffer->mark_dirty(rectangle);
         return Iteration::CONTINUE;
     });
 
     _framebuffer->blit();
 
-    _dirty_regions.clear();
+    _dirty_region.clear();
+}
+
+RendererStatistics renderer_statistics()
+{
+    return _statistics;
 }
 
 bool renderer_set_resolution(int width, int height)
@@ -3,6 +3,16 @@
 #include <libgraphic/Bitmap.h>
 #include <libgraphic/Shape.h>
 
+struct RendererStatistics
+{
+    size_t frames;
+
+    // Pixels that changed on screen, and pixels the renderer had to write to
+    // update them, they only differ when there are transparent windows.
+    size_t pixels_damaged;
+    size_t pixels_painted;
+};
+
 void renderer_initialize();
 
 Rectangle renderer_bound();
@@ -14,3 +24,5 @@ void renderer_repaint_dirty();
 bool renderer_set_resolution(int width, int height);
 
 void renderer_set_wallaper(RefPtr<Bitmap> wallaper);
+
+RendererStatistics renderer_statistics();
@@ -140,6 +140,7 @@ int main(int argc, char const *argv[])
 
     auto repaint_timer = own<Timer>(1000 / 60, []() {
         renderer_repaint_dirty();
+        client_flush_all();
         client_destroy_disconnected();
     });
 
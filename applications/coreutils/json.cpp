@@ -10,6 +10,13 @@ int main(int argc, char const *argv[])
     }
 
     auto json_object = json::parse_file(argv[1]);
+
+    if (json_object == nullptr)
+    {
+        stream_format(err_stream, "%s: %s is missing or malformed\n", argv[0], argv[1]);
+        return PROCESS_FAILURE;
+    }
+
     auto json_string = json::prettify(json_object);
 
     printf("%s", json_string);
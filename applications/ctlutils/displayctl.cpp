@@ -1,11 +1,10 @@
 #include <abi/Paths.h>
 
+#include <libprotocol/ClientConnection.h>
 #include <libsystem/Result.h>
 #include <libsystem/cmdline/CMDLine.h>
 #include <libsystem/core/CString.h>
-#include <libsystem/io/Connection.h>
 #include <libsystem/io/File.h>
-#include <libsystem/io/Socket.h>
 #include <libsystem/io/Stream.h>
 
 #include "compositor/Protocol.h"
@@ -91,14 +90,16 @@ int gfxmode_get(Stream *framebuffer_device)
 
 int gfxmode_set_compositor(IOCallDisplayModeArgs *mode)
 {
-    Connection *compositor_connection = socket_connect("/Session/compositor.ipc");
+    auto compositor_or_result = protocol::ClientConnection<CompositorProtocol>::connect("/Session/compositor.ipc");
 
-    if (handle_has_error(compositor_connection))
+    if (!compositor_or_result.success())
     {
-        handle_printf_error(compositor_connection, "Failed to connect to the compositor (Failling back on iocall)");
+        stream_format(err_stream, "Failed to connect to the compositor (Failling back on iocall): %s\n", result_to_string(compositor_or_result.result()));
         return -1;
     }
 
+    auto compositor = compositor_or_result.take_value();
+
     CompositorMessage message = (CompositorMessage){
         .type = COMPOSITOR_MESSAGE_SET_RESOLUTION,
         .set_resolution = {
@@ -107,7 +108,7 @@ int gfxmode_set_compositor(IOCallDisplayModeArgs *mode)
         },
     };
 
-    connection_send(compositor_connection, &message, sizeof(message));
+    compositor->send(message);
 
     return 0;
 }
@@ -1,21 +1,21 @@
 #include <libgraphic/Bitmap.h>
-#include <libsystem/io/Connection.h>
-#include <libsystem/io/Handle.h>
-#include <libsystem/io/Socket.h>
+#include <libprotocol/ClientConnection.h>
 #include <libsystem/io/Stream.h>
 
 #include "compositor/Protocol.h"
 
 int set_wallpaper(const char *path)
 {
-    Connection *compositor_connection = socket_connect("/Session/compositor.ipc");
+    auto compositor_or_result = protocol::ClientConnection<CompositorProtocol>::connect("/Session/compositor.ipc");
 
-    if (handle_has_error(compositor_connection))
+    if (!compositor_or_result.success())
     {
-        handle_printf_error(compositor_connection, "Failed to connect to the compositor.");
+        stream_format(err_stream, "wallpaperctl: failed to connect to the compositor: %s\n", result_to_string(compositor_or_result.result()));
         return -1;
     }
 
+    auto compositor = compositor_or_result.take_value();
+
     auto wallaper_or_result = Bitmap::load_from(path);
 
     if (!wallaper_or_result.success())
@@ -34,7 +34,7 @@ int set_wallpaper(const char *path)
         },
     };
 
-    connection_send(compositor_connection, &message, sizeof(message));
+    compositor->send(message);
     __plug_process_sleep(1000); // FIXME: Find a better way to wait for the server...
 
     return 0;
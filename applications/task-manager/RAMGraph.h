@@ -14,6 +14,7 @@ private:
 
     Label *_label_usage;
     Label *_label_available;
+    Label *_label_heap;
     Label *_label_greedy;
 
     OwnPtr<Timer> _graph_timer{};
@@ -38,6 +39,7 @@ public:
 
         _label_usage = new Label(this, "Usage: nil Mio", Position::RIGHT);
         _label_available = new Label(this, "Available: nil Mio", Position::RIGHT);
+        _label_heap = new Label(this, "Kernel heap: nil Kio", Position::RIGHT);
         _label_greedy = new Label(this, "Most greedy: nil", Position::RIGHT);
 
         _graph_timer = own<Timer>(500, [&]() {
@@ -60,6 +62,10 @@ public:
             snprintf(buffer_avaliable, 50, "Avaliable: %u Mio", avaliable);
             _label_available->text(buffer_avaliable);
 
+            char buffer_heap[50];
+            snprintf(buffer_heap, 50, "Kernel heap: %u/%u Kio", status.kernel_heap_used / 1024, status.kernel_heap_reserved / 1024);
+            _label_heap->text(buffer_heap);
+
             const char *greedy = task_model_get_greedy_process(_model, 0);
             _label_greedy->text(StringBuilder().append("Most greedy: ").append(greedy).finalize());
         });
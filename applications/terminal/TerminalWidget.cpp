@@ -9,21 +9,46 @@
 
 #define TERMINAL_IO_BUFFER_SIZE 4096
 
+// Output is parsed as long as there is more of it, up to this many reads,
+// before painting, so a burst only scrolls and repaints once.
+#define TERMINAL_IO_COALESCE 16
+
+static bool terminal_widget_has_output(Stream *master)
+{
+    Handle *handle = HANDLE(master);
+    SelectEvent events = SELECT_READ;
+
+    Handle *selected = nullptr;
+    SelectEvent selected_events = 0;
+
+    return handle_select(&handle, &events, 1, &selected, &selected_events, 0) == SUCCESS;
+}
+
 void terminal_widget_master_callback(TerminalWidget *widget, Stream *master, SelectEvent events)
 {
     __unused(events);
 
     char buffer[TERMINAL_IO_BUFFER_SIZE];
-    size_t size = stream_read(master, buffer, TERMINAL_IO_BUFFER_SIZE);
 
-    if (handle_has_error(master))
+    for (int i = 0; i < TERMINAL_IO_COALESCE; i++)
     {
-        handle_printf_error(master, "Terminal: read from master failed");
-        return;
+        size_t size = stream_read(master, buffer, TERMINAL_IO_BUFFER_SIZE);
+
+        if (handle_has_error(master))
+        {
+            handle_printf_error(master, "Terminal: read from master failed");
+            break;
+        }
+
+        terminal_write(widget->terminal(), buffer, size);
+
+        if (size == 0 || !terminal_widget_has_output(master))
+        {
+            break;
+        }
     }
 
-    terminal_write(widget->terminal(), buffer, size);
-    widget->should_repaint();
+    widget->should_repaint_damage();
 }
 
 Terminal *terminal_widget_renderer_create(TerminalWidget *terminal_widget)
@@ -78,6 +103,65 @@ TerminalWidget::~TerminalWidget()
     stream_close(_slave_stream);
 }
 
+void TerminalWidget::should_repaint_damage()
+{
+    Terminal *terminal = _terminal;
+
+    int scrolled = terminal->scrolled;
+    terminal->scrolled = 0;
+
+    // New output brings the screen back.
+    if (_scrollback != 0)
+    {
+        _scrollback = 0;
+        should_repaint();
+        return;
+    }
+
+    if (scrolled != 0)
+    {
+        if (scrolled >= terminal->height || -scrolled >= terminal->height)
+        {
+            should_repaint();
+            return;
+        }
+
+        Rectangle screen = terminal::cell_bound(0, 0)
+                               .merged_with(terminal::cell_bound(terminal->width - 1, terminal->height - 1))
+                               .offset(bound().position())
+                               .clipped_with(bound());
+
+        window()->should_shift(screen, -scrolled * terminal::cell_size().y());
+        _painted_cursor = _painted_cursor - Vec2i(0, scrolled);
+    }
+
+    for (int y = 0; y < terminal->height; y++)
+    {
+        TerminalDamage damage = terminal_line_damage(terminal, y);
+
+        if (damage.from < damage.to)
+        {
+            Rectangle line = terminal::cell_bound(damage.from, y)
+                                 .merged_with(terminal::cell_bound(damage.to - 1, y));
+
+            should_repaint(line.offset(bound().position()));
+        }
+    }
+
+    if (_painted_cursor.y() >= 0 && _painted_cursor.y() < terminal->height)
+    {
+        should_repaint(terminal::cell_bound(_painted_cursor.x(), _painted_cursor.y()).offset(bound().position()));
+    }
+
+    should_repaint(terminal::cell_bound(terminal->cursor.x, terminal->cursor.y).offset(bound().position()));
+}
+
+void TerminalWidget::scroll_back(int how_many_line)
+{
+    _scrollback = clamp(_scrollback + how_many_line, 0, _terminal->history);
+    should_repaint();
+}
+
 void TerminalWidget::paint(Painter &painter, Rectangle rectangle)
 {
     painter.clear_rectangle(rectangle, color(THEME_ANSI_BACKGROUND).with_alpha(0.90));
@@ -89,20 +173,34 @@ void TerminalWidget::paint(Painter &painter, Rectangle rectangle)
 
     Terminal *terminal = _terminal;
 
-    for (int y = 0; y < terminal->height; y++)
+    // Only the cells in the rectangle are painted, the window repaints what
+    // was damaged.
+    int from_x = MAX(rectangle.x() / terminal::cell_size().x(), 0);
+    int from_y = MAX(rectangle.y() / terminal::cell_size().y(), 0);
+    int to_x = MIN((rectangle.x() + rectangle.width() + terminal::cell_size().x() - 1) / terminal::cell_size().x(), terminal->width);
+    int to_y = MIN((rectangle.y() + rectangle.height() + terminal::cell_size().y() - 1) / terminal::cell_size().y(), terminal->height);
+
+    for (int y = from_y; y < to_y; y++)
     {
-        for (int x = 0; x < terminal->width; x++)
+        for (int x = from_x; x < to_x; x++)
         {
-            TerminalCell cell = terminal_cell_at(terminal, x, y);
+            TerminalCell cell = terminal_cell_at(terminal, x, y - _scrollback);
             terminal::render_cell(painter, x, y, cell);
-            terminal_cell_undirty(terminal, x, y);
+            terminal_cell_undirty(terminal, x, y - _scrollback);
+        }
+
+        TerminalDamage damage = terminal_line_damage(terminal, y);
+
+        if (from_x <= damage.from && damage.to <= to_x)
+        {
+            terminal_line_undamage(terminal, y);
         }
     }
 
     int cx = terminal->cursor.x;
     int cy = terminal->cursor.y;
 
-    if (terminal::cell_bound(cx, cy).colide_with(rectangle))
+    if (_scrollback == 0 && terminal::cell_bound(cx, cy).colide_with(rectangle))
     {
         TerminalCell cell = terminal_cell_at(terminal, cx, cy);
 
@@ -133,6 +231,8 @@ void TerminalWidget::paint(Painter &painter, Rectangle rectangle)
             terminal::render_cell(painter, cx, cy, cell);
             painter.draw_rectangle(terminal::cell_bound(cx, cy), color(THEME_ANSI_CURSOR));
         }
+
+        _painted_cursor = Vec2i(cx, cy);
     }
 
     painter.pop();
@@ -145,7 +245,24 @@ void TerminalWidget::event(Event *event)
         event->accepted = true;
     };
 
-    if (event->type == Event::KEYBOARD_KEY_TYPED)
+    if (event->type == Event::KEYBOARD_KEY_TYPED &&
+        (event->keyboard.modifiers & KEY_MODIFIER_SHIFT) &&
+        (event->keyboard.key == KEYBOARD_KEY_PGUP || event->keyboard.key == KEYBOARD_KEY_PGDOWN))
+    {
+        int how_many_line = MAX(_terminal->height / 2, 1);
+
+        if (event->keyboard.key == KEYBOARD_KEY_PGUP)
+        {
+            scroll_back(how_many_line);
+        }
+        else
+        {
+            scroll_back(-how_many_line);
+        }
+
+        event->accepted = true;
+    }
+    else if (event->type == Event::KEYBOARD_KEY_TYPED)
     {
         switch (event->keyboard.key)
         {
@@ -22,6 +22,12 @@ private:
     Terminal *_terminal;
     bool _cursor_blink;
 
+    // Where the cursor was last painted, it is erased from there.
+    Vec2i _painted_cursor = Vec2i::zero();
+
+    // How many lines of the scrollback are shown above the screen.
+    int _scrollback = 0;
+
     Stream *_master_stream;
     Stream *_slave_stream;
 
@@ -33,6 +39,10 @@ public:
 
     void blink() { _cursor_blink = !_cursor_blink; };
 
+    void should_repaint_damage();
+
+    void scroll_back(int how_many_line);
+
     TerminalWidget(Widget *parent);
 
     ~TerminalWidget();
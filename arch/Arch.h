@@ -4,14 +4,44 @@
 
 struct Task;
 
+#define ARCH_MAX_CPU_COUNT (16)
+
 void arch_disable_interrupts();
 
 void arch_enable_interrupts();
 
 void arch_halt();
 
+// Disables interrupts and tells if they were enabled, for short sections
+// which shouldn't take the kernel lock.
+bool arch_save_interrupts();
+
+void arch_restore_interrupts(bool enabled);
+
 void arch_yield();
 
+// Index of the CPU running the caller, the boot CPU is 0. It only stays true
+// with interrupts disabled, otherwise the task might move to another CPU.
+int arch_cpu_current();
+
+int arch_cpu_count();
+
+// Called by loops spinning with interrupts disabled, so the requests other
+// CPUs are waiting on are still served.
+void arch_cpu_relax();
+
+// Asks another CPU to go through schedule() as soon as possible.
+void arch_cpu_reschedule(int cpu);
+
+// Starts the other CPUs, they pick up tasks once they are online.
+void arch_cpu_start_others();
+
+// Halts every other CPU, for panics.
+void arch_cpu_stop_others();
+
+// Sets up the registers of a new task which aren't on its stack.
+void arch_initialize_context(Task *task);
+
 void arch_save_context(Task *task);
 
 void arch_load_context(Task *task);
@@ -20,6 +50,23 @@ size_t arch_debug_write(const void *buffer, size_t size);
 
 TimeStamp arch_get_time();
 
+#define ARCH_NO_DEADLINE ((uint64_t)-1)
+
+// Microseconds since boot.
+uint64_t arch_get_clock();
+
+// Moves from the periodic tick of the boot timer to one-shot deadlines, if
+// the hardware can.
+void arch_timer_initialize();
+
+// Interrupts the calling CPU through schedule() once the clock reaches the
+// deadline, or never for ARCH_NO_DEADLINE. Does nothing while the timer is
+// still ticking.
+void arch_timer_deadline(uint64_t deadline);
+
+// The SYSTEM_PAGE_* flags telling userspace what the CPU supports.
+uint32_t arch_system_page_flags();
+
 __no_return void arch_reboot();
 
 __no_return void arch_shutdown();
@@ -18,8 +18,19 @@ Result arch_virtual_map(void *address_space, MemoryRange physical_range, uintptr
 
 MemoryRange arch_virtual_alloc(void *address_space, MemoryRange physical_range, MemoryFlags flags);
 
+// Sets virtual memory aside without mapping anything, for demand paging.
+MemoryRange arch_virtual_reserve(void *address_space, size_t size, MemoryFlags flags);
+
+void arch_virtual_reserve_at(void *address_space, MemoryRange virtual_range);
+
 void arch_virtual_free(void *address_space, MemoryRange virtual_range);
 
+// Defers TLB invalidation until the matching arch_virtual_gather_end(), so
+// mapping or unmapping many pages one at a time flushes once.
+void arch_virtual_gather_begin();
+
+void arch_virtual_gather_end();
+
 void *arch_address_space_create();
 
 void arch_address_space_destroy(void *address_space);
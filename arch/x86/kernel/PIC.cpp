@@ -71,3 +71,10 @@ void pic_disable()
     out8(PIC2_DATA, 0xff);
     out8(PIC1_DATA, 0xff);
 }
+
+void pic_mask(int irq)
+{
+    uint16_t port = irq < 8 ? PIC1_DATA : PIC2_DATA;
+
+    out8(port, in8(port) | (1 << (irq % 8)));
+}
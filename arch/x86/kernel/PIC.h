@@ -5,3 +5,5 @@ void pic_initialize();
 void pic_ack(int intno);
 
 void pic_disable();
+
+void pic_mask(int irq);
@@ -7,3 +7,14 @@ static inline void cli() { asm volatile("cli"); }
 static inline void sti() { asm volatile("sti"); }
 
 static inline void hlt() { asm volatile("hlt"); }
+
+static inline uint64_t rdtsc()
+{
+    uint32_t low;
+    uint32_t high;
+
+    asm volatile("rdtsc"
+                 : "=a"(low), "=d"(high));
+
+    return ((uint64_t)high << 32) | low;
+}
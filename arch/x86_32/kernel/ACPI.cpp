@@ -3,6 +3,7 @@
 #include "arch/x86_32/kernel/ACPI.h"
 #include "arch/x86_32/kernel/IOAPIC.h"
 #include "arch/x86_32/kernel/LAPIC.h"
+#include "arch/x86_32/kernel/SMP.h"
 
 #include "kernel/firmware/ACPI.h"
 
@@ -19,6 +20,12 @@ void acpi_madt_initialize(MADT *madt)
         {
             auto local_apic = reinterpret_cast<MADTLocalApicRecord *>(record);
             logger_info("Local APIC (cpu_id=%d, apic_id=%d, flags=%08x)", local_apic->processor_id, local_apic->apic_id, local_apic->flags);
+
+            // Bit 0 tells if the CPU can be used.
+            if (local_apic->flags & 1)
+            {
+                smp_found_cpu(local_apic->apic_id);
+            }
         }
         break;
 
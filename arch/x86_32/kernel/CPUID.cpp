@@ -24,6 +24,17 @@ CPUID cpuid()
     return cid;
 }
 
+CPUIDLeaf cpuid_leaf(uint32_t leaf, uint32_t subleaf)
+{
+    CPUIDLeaf result;
+
+    asm volatile("cpuid"
+                 : "=a"(result.eax), "=b"(result.ebx), "=c"(result.ecx), "=d"(result.edx)
+                 : "a"(leaf), "c"(subleaf));
+
+    return result;
+}
+
 void cpuid_dump()
 {
     CPUID cid = cpuid();
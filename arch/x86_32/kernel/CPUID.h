@@ -139,6 +139,16 @@ struct __packed CPUID
 
 CPUID cpuid();
 
+struct CPUIDLeaf
+{
+    uint32_t eax;
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+};
+
+CPUIDLeaf cpuid_leaf(uint32_t leaf, uint32_t subleaf);
+
 #ifdef __cplusplus
 extern "C" uint32_t cpuid_get_feature_EDX();
 extern "C" uint32_t cpuid_get_feature_ECX();
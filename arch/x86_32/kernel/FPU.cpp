@@ -1,36 +1,203 @@
+#include <libsystem/Assert.h>
+#include <libsystem/Logger.h>
 #include <libsystem/core/CString.h>
 
+#include "arch/Arch.h"
+#include "arch/x86_32/kernel/CPUID.h"
 #include "arch/x86_32/kernel/FPU.h"
 
-void fpu_initialize()
+#define CR0_MP (1 << 1)
+#define CR0_EM (1 << 2)
+#define CR0_TS (1 << 3)
+
+#define CR4_OSFXSR (1 << 9)
+#define CR4_OSXMMEXCPT (1 << 10)
+#define CR4_OSXSAVE (1 << 18)
+
+#define XCR0_X87 (1 << 0)
+#define XCR0_SSE (1 << 1)
+#define XCR0_AVX (1 << 2)
+
+enum FPUSaveMethod
 {
-    asm volatile("clts");
-    size_t t;
+    FPU_FXSAVE,
+    FPU_XSAVE,
+    FPU_XSAVEOPT,
+};
+
+static FPUSaveMethod _method = FPU_FXSAVE;
+static uint32_t _xcr0 = 0;
+static size_t _state_size = 512;
+
+// The state new tasks start with, saved right after fninit.
+static char _initial_state[ARCH_PAGE_SIZE] __aligned(64);
+
+// The task whose registers are in the FPU of each CPU. They stay there after
+// it is switched out, in case it comes back before anyone else uses the FPU.
+static Task *_owner[ARCH_MAX_CPU_COUNT] = {};
+
+static inline uint32_t fpu_read_cr0()
+{
+    uint32_t cr0;
     asm volatile("mov %%cr0, %0"
-                 : "=r"(t));
-    t &= ~(1 << 2);
-    t |= (1 << 1);
-    asm volatile("mov %0, %%cr0" ::"r"(t));
+                 : "=r"(cr0));
+    return cr0;
+}
+
+static inline void fpu_write_cr0(uint32_t cr0)
+{
+    asm volatile("mov %0, %%cr0" ::"r"(cr0));
+}
+
+static void fpu_save(void *state)
+{
+    switch (_method)
+    {
+    case FPU_XSAVEOPT:
+        asm volatile("xsaveopt (%0)" ::"r"(state), "a"(_xcr0), "d"(0)
+                     : "memory");
+        break;
+
+    case FPU_XSAVE:
+        asm volatile("xsave (%0)" ::"r"(state), "a"(_xcr0), "d"(0)
+                     : "memory");
+        break;
+
+    default:
+        asm volatile("fxsave (%0)" ::"r"(state)
+                     : "memory");
+        break;
+    }
+}
+
+static void fpu_restore(void *state)
+{
+    if (_method == FPU_FXSAVE)
+    {
+        asm volatile("fxrstor (%0)" ::"r"(state)
+                     : "memory");
+    }
+    else
+    {
+        asm volatile("xrstor (%0)" ::"r"(state), "a"(_xcr0), "d"(0)
+                     : "memory");
+    }
+}
+
+// Called on every CPU, the boot CPU decides how the state is saved.
+void fpu_initialize()
+{
+    uint32_t cr0 = fpu_read_cr0();
+    cr0 &= ~(CR0_EM | CR0_TS);
+    cr0 |= CR0_MP;
+    fpu_write_cr0(cr0);
 
+    uint32_t cr4;
     asm volatile("mov %%cr4, %0"
-                 : "=r"(t));
-    t |= 3 << 9;
-    asm volatile("mov %0, %%cr4" ::"r"(t));
+                 : "=r"(cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+
+    bool xsave = cpuid_get_feature_ECX() & CPUID_FEAT_ECX_XSAVE;
+
+    if (xsave)
+    {
+        cr4 |= CR4_OSXSAVE;
+    }
+
+    asm volatile("mov %0, %%cr4" ::"r"(cr4));
+
+    if (xsave)
+    {
+        // AVX-512 is left off, its state wouldn't fit in the page of a task.
+        uint32_t xcr0 = XCR0_X87 | XCR0_SSE;
+
+        if (cpuid_get_feature_ECX() & CPUID_FEAT_ECX_AVX)
+        {
+            xcr0 |= XCR0_AVX;
+        }
+
+        asm volatile("xsetbv" ::"a"(xcr0), "d"(0), "c"(0));
+
+        if (arch_cpu_current() == 0)
+        {
+            _xcr0 = xcr0;
+            _state_size = cpuid_leaf(0xd, 0).ebx;
+            _method = (cpuid_leaf(0xd, 1).eax & 1) ? FPU_XSAVEOPT : FPU_XSAVE;
+
+            assert(_state_size <= ARCH_PAGE_SIZE);
+        }
+    }
 
-    // Initialize the FPU
     asm volatile("fninit");
+
+    if (arch_cpu_current() == 0)
+    {
+        fpu_save(_initial_state);
+
+        logger_info("FPU state is %u bytes, saved with %s", _state_size,
+                    _method == FPU_XSAVEOPT ? "xsaveopt" : (_method == FPU_XSAVE ? "xsave" : "fxsave"));
+    }
+
+    _owner[arch_cpu_current()] = nullptr;
 }
 
-char fpu_registers[512] __aligned(16);
+void fpu_initialize_context(Task *task)
+{
+    memcpy(task->fpu_state, _initial_state, _state_size);
 
+    // A destroyed task might have had the same address.
+    for (int cpu = 0; cpu < ARCH_MAX_CPU_COUNT; cpu++)
+    {
+        if (_owner[cpu] == task)
+        {
+            _owner[cpu] = nullptr;
+        }
+    }
+}
+
+// Only tasks which used the FPU since they were switched in have anything
+// to save, the others still trap on their first FPU instruction.
 void fpu_save_context(Task *task)
 {
-    asm volatile("fxsave (%0)" ::"r"(fpu_registers));
-    memcpy(&task->fpu_registers, &fpu_registers, 512);
+    if (!(fpu_read_cr0() & CR0_TS))
+    {
+        fpu_save(task->fpu_state);
+    }
 }
 
 void fpu_load_context(Task *task)
 {
-    memcpy(&fpu_registers, &task->fpu_registers, 512);
-    asm volatile("fxrstor (%0)" ::"r"(fpu_registers));
+    __unused(task);
+
+    uint32_t cr0 = fpu_read_cr0();
+
+    if (!(cr0 & CR0_TS))
+    {
+        fpu_write_cr0(cr0 | CR0_TS);
+    }
+}
+
+void fpu_handle_not_available(Task *task)
+{
+    asm volatile("clts");
+
+    int cpu = arch_cpu_current();
+
+    if (_owner[cpu] == task)
+    {
+        return;
+    }
+
+    fpu_restore(task->fpu_state);
+
+    // Its registers on the CPU it last ran on are stale now.
+    for (int i = 0; i < ARCH_MAX_CPU_COUNT; i++)
+    {
+        if (_owner[i] == task)
+        {
+            _owner[i] = nullptr;
+        }
+    }
+
+    _owner[cpu] = task;
 }
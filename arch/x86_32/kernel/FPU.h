@@ -4,6 +4,14 @@
 
 void fpu_initialize();
 
+// Gives a new task the state the FPU has after fninit.
+void fpu_initialize_context(Task *task);
+
 void fpu_save_context(Task *task);
 
+// Doesn't restore anything, the FPU traps until the task uses it.
 void fpu_load_context(Task *task);
+
+// The #NM trap of the first FPU instruction of the task since it was
+// switched in.
+void fpu_handle_not_available(Task *task);
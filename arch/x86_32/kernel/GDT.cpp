@@ -1,34 +1,7 @@
 #include "arch/x86_32/kernel/GDT.h"
 
-static TSS tss = {
-    .prev_tss = 0,
-    .esp0 = 0,
-    .ss0 = 0x10,
-    .esp1 = 0,
-    .ss1 = 0,
-    .esp2 = 0,
-    .ss2 = 0,
-    .cr3 = 0,
-    .eip = 0,
-    .eflags = 0x0202,
-    .eax = 0,
-    .ecx = 0,
-    .edx = 0,
-    .ebx = 0,
-    .esp = 0,
-    .ebp = 0,
-    .esi = 0,
-    .edi = 0,
-    .es = 0,
-    .cs = 0,
-    .ss = 0,
-    .ds = 0,
-    .fs = 0,
-    .gs = 0,
-    .ldt = 0,
-    .trap = 0,
-    .iomap_base = 0,
-};
+// One TSS per CPU, they only hold the stack used when coming from userspace.
+static TSS tss[ARCH_MAX_CPU_COUNT] = {};
 
 static GDTEntry gdt[GDT_ENTRY_COUNT] = {};
 
@@ -44,12 +17,30 @@ void gdt_initialize()
     gdt[2] = {0, 0xffffffff, GDT_PRESENT | GDT_READWRITE, GDT_FLAGS};
     gdt[3] = {0, 0xffffffff, GDT_PRESENT | GDT_READWRITE | GDT_USER | GDT_EXECUTABLE, GDT_FLAGS};
     gdt[4] = {0, 0xffffffff, GDT_PRESENT | GDT_READWRITE | GDT_USER, GDT_FLAGS};
-    gdt[5] = {&tss, GDT_TSS_PRESENT | GDT_ACCESSED | GDT_EXECUTABLE | GDT_USER, TSS_FLAGS};
 
+    for (int cpu = 0; cpu < ARCH_MAX_CPU_COUNT; cpu++)
+    {
+        tss[cpu].ss0 = 0x10;
+        tss[cpu].eflags = 0x0202;
+
+        gdt[GDT_TSS_ENTRY(cpu)] = {&tss[cpu], GDT_TSS_PRESENT | GDT_ACCESSED | GDT_EXECUTABLE | GDT_USER, TSS_FLAGS};
+    }
+
+    gdt_load(0);
+}
+
+void gdt_load(int cpu)
+{
     gdt_flush((uint32_t)&gdt_descriptor);
+    tss_flush(GDT_TSS_ENTRY(cpu) * sizeof(GDTEntry));
 }
 
 void set_kernel_stack(uint32_t stack)
 {
-    tss.esp0 = stack;
+    tss[arch_cpu_current()].esp0 = stack;
+}
+
+uintptr_t tss_kernel_stack()
+{
+    return (uintptr_t)&tss[arch_cpu_current()] + __builtin_offsetof(TSS, esp0);
 }
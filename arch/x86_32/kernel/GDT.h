@@ -3,7 +3,11 @@
 #include <libsystem/Common.h>
 #include <libsystem/Logger.h>
 
-#define GDT_ENTRY_COUNT 6
+#include "arch/Arch.h"
+
+// Null, kernel code and data, user code and data, then a TSS per CPU.
+#define GDT_TSS_ENTRY(__cpu) (5 + (__cpu))
+#define GDT_ENTRY_COUNT GDT_TSS_ENTRY(ARCH_MAX_CPU_COUNT)
 
 #define GDT_PRESENT 0b10010000     // Present bit. This must be 1 for all valid selectors.
 #define GDT_TSS_PRESENT 0b10000000 // Present bit. This must be 1 for all valid selectors.
@@ -99,8 +103,15 @@ struct __packed GDTEntry
 
 void gdt_initialize();
 
+// Loads the GDT and the TSS of the calling CPU.
+void gdt_load(int cpu);
+
 extern "C" void gdt_flush(uint32_t);
 
 extern "C" void tss_flush(uint32_t);
 
+// Both are about the TSS of the calling CPU.
 void set_kernel_stack(uint32_t stack);
+
+// Address of the kernel stack slot of the TSS.
+uintptr_t tss_kernel_stack();
@@ -38,3 +38,6 @@ struct __packed IDTEntry
 extern "C" void idt_flush(uint32_t);
 
 void idt_initialize();
+
+// The other CPUs share the table of the boot CPU.
+void idt_load();
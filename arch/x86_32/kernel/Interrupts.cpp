@@ -4,13 +4,18 @@
 #include <libsystem/thread/Atomic.h>
 
 #include "arch/x86/kernel/PIC.h"
+#include "arch/x86_32/kernel/FPU.h"
 #include "arch/x86_32/kernel/Interrupts.h"
+#include "arch/x86_32/kernel/LAPIC.h"
+#include "arch/x86_32/kernel/SMP.h"
+#include "arch/x86_32/kernel/Timer.h"
 #include "arch/x86_32/kernel/x86_32.h"
 
 #include "kernel/interrupts/Dispatcher.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
 #include "kernel/tasking/Syscalls.h"
+#include "kernel/tasking/Task-Memory.h"
 
 static const char *_exception_messages[32] = {
     "Division by zero",
@@ -47,11 +52,62 @@ static const char *_exception_messages[32] = {
     "Reserved",
 };
 
+// Whether the handler took the kernel lock, it is released once the CPU is
+// done with the stack of the task it interrupted.
+static bool _interrupts_entered[ARCH_MAX_CPU_COUNT] = {};
+
+static void interrupts_enter()
+{
+    atomic_disable();
+    _interrupts_entered[arch_cpu_current()] = true;
+}
+
+static bool interrupts_handle_page_fault(InterruptStackFrame &stackframe)
+{
+    uintptr_t address = CR2();
+
+    bool present = stackframe.err & 1;
+    bool write = stackframe.err & 2;
+
+    // Pages that aren't present yet can be demand paged, and writes to
+    // present pages might be copy-on-write.
+    if ((present && !write) || address < 0x40000000 || scheduler_running() == nullptr)
+    {
+        return false;
+    }
+
+    // Bringing in a file backed page might block, unless we faulted in an
+    // atomic section.
+    bool interruptible = !is_atomic();
+
+    if (interruptible)
+    {
+        sti();
+    }
+
+    bool handled = task_memory_page_fault(scheduler_running(), address, write);
+
+    if (interruptible)
+    {
+        cli();
+    }
+
+    return handled;
+}
+
 extern "C" uint32_t interrupts_handler(uintptr_t esp, InterruptStackFrame stackframe)
 {
     if (stackframe.intno < 32)
     {
-        if (stackframe.eip >= 0x40000000)
+        if (stackframe.intno == 14 && interrupts_handle_page_fault(stackframe))
+        {
+            // The page is here now, the faulting instruction will be retried.
+        }
+        else if (stackframe.intno == 7 && scheduler_running())
+        {
+            fpu_handle_not_available(scheduler_running());
+        }
+        else if (stackframe.eip >= 0x40000000)
         {
             sti();
 
@@ -81,12 +137,13 @@ extern "C" uint32_t interrupts_handler(uintptr_t esp, InterruptStackFrame stackf
     }
     else if (stackframe.intno < 48)
     {
-        atomic_disable();
+        interrupts_enter();
 
         int irq = stackframe.intno - 32;
 
         if (irq == 0)
         {
+            timer_pit_tick();
             system_tick();
             esp = schedule(esp);
         }
@@ -95,15 +152,31 @@ extern "C" uint32_t interrupts_handler(uintptr_t esp, InterruptStackFrame stackf
             dispatcher_dispatch(irq);
         }
 
-        atomic_enable();
+        pic_ack(stackframe.intno);
     }
-    else if (stackframe.intno == 127)
+    else if (stackframe.intno == INTERRUPT_LAPIC_TIMER || stackframe.intno == INTERRUPT_RESCHEDULE)
     {
-        atomic_disable();
+        interrupts_enter();
 
         esp = schedule(esp);
 
-        atomic_enable();
+        lapic_ack();
+    }
+    else if (stackframe.intno == INTERRUPT_TLB_SHOOTDOWN)
+    {
+        // The CPU asking for it holds the kernel lock and waits for us.
+        smp_handle_tlb_shootdown();
+        lapic_ack();
+    }
+    else if (stackframe.intno == INTERRUPT_STOP)
+    {
+        smp_handle_stop();
+    }
+    else if (stackframe.intno == 127)
+    {
+        interrupts_enter();
+
+        esp = schedule(esp);
     }
     else if (stackframe.intno == 128)
     {
@@ -112,7 +185,18 @@ extern "C" uint32_t interrupts_handler(uintptr_t esp, InterruptStackFrame stackf
         cli();
     }
 
-    pic_ack(stackframe.intno);
+    // Spurious interrupts of the LAPIC don't get an EOI.
 
     return esp;
 }
+
+extern "C" void interrupts_leave()
+{
+    int cpu = arch_cpu_current();
+
+    if (_interrupts_entered[cpu])
+    {
+        _interrupts_entered[cpu] = false;
+        atomic_enable();
+    }
+}
@@ -2,6 +2,12 @@
 
 #include <libsystem/Common.h>
 
+// Vectors of the interrupts coming from the LAPICs.
+#define INTERRUPT_LAPIC_TIMER 48
+#define INTERRUPT_RESCHEDULE 49
+#define INTERRUPT_TLB_SHOOTDOWN 50
+#define INTERRUPT_STOP 51
+
 struct __packed InterruptStackFrame
 {
     uint32_t gs, fs, es, ds;
@@ -23,6 +23,7 @@ __interrupt%1:
 %endmacro
 
 extern interrupts_handler
+extern interrupts_leave
 
 __interrupt_common:
     cld
@@ -47,6 +48,10 @@ __interrupt_common:
 
     mov esp, eax
 
+    ; Now that we are off the stack of the previous task, another CPU can
+    ; pick it up.
+    call interrupts_leave
+
     pop gs
     pop fs
     pop es
@@ -108,8 +113,14 @@ INTERRUPT_NOERR 45
 INTERRUPT_NOERR 46
 INTERRUPT_NOERR 47
 
+INTERRUPT_NOERR 48
+INTERRUPT_NOERR 49
+INTERRUPT_NOERR 50
+INTERRUPT_NOERR 51
+
 INTERRUPT_NOERR 127
 INTERRUPT_SYSCALL 128
+INTERRUPT_NOERR 255
 
 global __interrupt_vector
 
@@ -164,5 +175,63 @@ __interrupt_vector:
     INTERRUPT_NAME 46
     INTERRUPT_NAME 47
 
+    INTERRUPT_NAME 48
+    INTERRUPT_NAME 49
+    INTERRUPT_NAME 50
+    INTERRUPT_NAME 51
+
     INTERRUPT_NAME 127
     INTERRUPT_NAME 128
+    INTERRUPT_NAME 255
+
+extern sysenter_handler
+
+global __sysenter_entry
+
+; Interrupts are disabled and esp points to the kernel stack slot of the TSS.
+__sysenter_entry:
+    mov esp, [esp]
+
+    push ebp
+    push edi
+    push esi
+    push edx
+    push ecx
+    push ebx
+    push eax
+
+    push ds
+    push es
+    push fs
+    push gs
+
+    mov ax, 0x10
+
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+
+    push esp
+
+    call sysenter_handler
+
+    add esp, 4
+
+    pop gs
+    pop fs
+    pop es
+    pop ds
+
+    pop eax
+    pop ebx
+    pop ecx
+    pop edx
+    pop esi
+    pop edi
+    pop ebp
+
+    ; sti only takes effect after the next instruction, no interrupt can come
+    ; in before we are back in userspace.
+    sti
+    sysexit
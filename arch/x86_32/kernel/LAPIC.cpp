@@ -1,18 +1,38 @@
 #include <libsystem/Logger.h>
+#include <libsystem/thread/Atomic.h>
 
-#include "arch/x86/kernel/PIC.h"
+#include "arch/VirtualMemory.h"
 #include "arch/x86_32/kernel/LAPIC.h"
 
-constexpr int LAPIC_EOI = 0x00B0;
-
-static volatile uint32_t *lapic = nullptr;
+static uintptr_t _lapic_physical = 0;
+static volatile uint8_t *lapic = nullptr;
 
 void lapic_found(uintptr_t address)
 {
-    lapic = reinterpret_cast<uint32_t *>(address);
-    logger_info("LAPIC found at %08x", lapic);
+    _lapic_physical = address;
+    logger_info("LAPIC found at %08x", address);
+}
+
+bool lapic_present()
+{
+    return lapic != nullptr;
+}
+
+void lapic_map()
+{
+    if (!_lapic_physical || lapic)
+    {
+        return;
+    }
+
+    AtomicHolder holder;
+
+    MemoryRange physical_range{_lapic_physical & ~(ARCH_PAGE_SIZE - 1), ARCH_PAGE_SIZE};
+    MemoryRange range = arch_virtual_alloc(arch_kernel_address_space(), physical_range, MEMORY_NONE);
+    lapic = reinterpret_cast<volatile uint8_t *>(range.base() + (_lapic_physical & 0xfff));
 }
 
+// The registers are 16 bytes apart, reg is a byte offset.
 uint32_t lapic_read(uint32_t reg)
 {
     return *((volatile uint32_t *)(lapic + reg));
@@ -23,6 +43,22 @@ void lapic_write(uint32_t reg, uint32_t data)
     *((volatile uint32_t *)(lapic + reg)) = data;
 }
 
+uint8_t lapic_id()
+{
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+void lapic_send_ipi(uint8_t apic_id, uint32_t command)
+{
+    lapic_write(LAPIC_ICR_HIGH, (uint32_t)apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, command);
+
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING)
+    {
+        asm volatile("pause");
+    }
+}
+
 void lapic_ack()
 {
     lapic_write(LAPIC_EOI, 0);
@@ -30,7 +66,5 @@ void lapic_ack()
 
 void lapic_initialize()
 {
-    pic_disable();
-
-    lapic_write(0xF0, lapic_read(0xF0) | 0x100);
+    lapic_write(LAPIC_SPURIOUS, LAPIC_SPURIOUS_VECTOR | 0x100);
 }
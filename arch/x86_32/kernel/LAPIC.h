@@ -2,10 +2,45 @@
 
 #include <libsystem/Common.h>
 
+#define LAPIC_ID 0x0020
+#define LAPIC_EOI 0x00B0
+#define LAPIC_SPURIOUS 0x00F0
+#define LAPIC_ICR_LOW 0x0300
+#define LAPIC_ICR_HIGH 0x0310
+#define LAPIC_TIMER 0x0320
+#define LAPIC_TIMER_INITIAL 0x0380
+#define LAPIC_TIMER_CURRENT 0x0390
+#define LAPIC_TIMER_DIVIDE 0x03E0
 
+#define LAPIC_SPURIOUS_VECTOR 0xFF
+
+#define LAPIC_ICR_INIT 0x00000500
+#define LAPIC_ICR_STARTUP 0x00000600
+#define LAPIC_ICR_PENDING 0x00001000
+#define LAPIC_ICR_ASSERT 0x00004000
+
+#define LAPIC_TIMER_MASKED 0x00010000
+#define LAPIC_TIMER_PERIODIC 0x00020000
+
+#define LAPIC_TIMER_DIVIDE_16 0x3
 
 void lapic_found(uintptr_t address);
 
+bool lapic_present();
+
+// Maps the registers, they are outside of the identity mapped memory.
+void lapic_map();
+
+// Enables the LAPIC of the calling CPU. Device IRQs still go through the
+// PIC, in virtual wire mode.
 void lapic_initialize();
 
+uint32_t lapic_read(uint32_t reg);
+
+void lapic_write(uint32_t reg, uint32_t data);
+
+uint8_t lapic_id();
+
+void lapic_send_ipi(uint8_t apic_id, uint32_t command);
+
 void lapic_ack();
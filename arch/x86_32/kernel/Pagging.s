@@ -25,3 +25,9 @@ paging_invalidate_tlb:
     mov eax, cr3
     mov cr3, eax
     ret
+
+global paging_invalidate_page
+paging_invalidate_page:
+    mov eax, [esp + 4]
+    invlpg [eax]
+    ret
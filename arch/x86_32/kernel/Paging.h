@@ -22,7 +22,8 @@ union __packed PageTableEntry
         bool Accessed : 1;
         bool Dirty : 1;
         bool Pat : 1;
-        uint32_t Ignored : 4;
+        bool Global : 1;
+        uint32_t Ignored : 3;
         uint32_t PageFrameNumber : 20;
     };
 
@@ -57,6 +58,11 @@ struct __packed PageDirectory
     PageDirectoryEntry entries[PAGE_DIRECTORY_ENTRY_COUNT];
 };
 
+extern PageDirectory _kernel_page_directory;
+
+// Invalidates the pages from first to last in the TLB of the calling CPU.
+void paging_flush(uintptr_t first, uintptr_t last, bool global);
+
 extern "C" void paging_enable();
 
 extern "C" void paging_disable();
@@ -64,3 +70,5 @@ extern "C" void paging_disable();
 extern "C" void paging_load_directory(uintptr_t directory);
 
 extern "C" void paging_invalidate_tlb();
+
+extern "C" void paging_invalidate_page(uintptr_t address);
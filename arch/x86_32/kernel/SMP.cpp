@@ -0,0 +1,328 @@
+#include <libsystem/Logger.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "arch/Arch.h"
+#include "arch/VirtualMemory.h"
+#include "arch/x86_32/kernel/FPU.h"
+#include "arch/x86_32/kernel/GDT.h"
+#include "arch/x86_32/kernel/IDT.h"
+#include "arch/x86_32/kernel/Interrupts.h"
+#include "arch/x86_32/kernel/LAPIC.h"
+#include "arch/x86_32/kernel/Paging.h"
+#include "arch/x86_32/kernel/SMP.h"
+#include "arch/x86_32/kernel/SYSENTER.h"
+#include "arch/x86_32/kernel/Timer.h"
+#include "arch/x86_32/kernel/x86_32.h"
+
+#include "kernel/memory/Memory.h"
+#include "kernel/memory/Physical.h"
+#include "kernel/scheduling/Scheduler.h"
+#include "kernel/system/System.h"
+
+extern "C" char smp_trampoline_start[];
+extern "C" char smp_trampoline_parameters[];
+extern "C" char smp_trampoline_end[];
+
+struct SMPCPU
+{
+    uint8_t apic_id;
+    volatile bool online;
+
+    // Created by the boot CPU, the CPU starts on its stack.
+    Task *idle;
+};
+
+struct TLBShootdown
+{
+    uintptr_t first;
+    uintptr_t last;
+    bool global;
+};
+
+static uint8_t _found_apic_ids[256] = {};
+static size_t _found_count = 0;
+
+static SMPCPU _cpus[ARCH_MAX_CPU_COUNT] = {};
+static volatile int _cpu_count = 1;
+
+static uintptr_t _trampoline = 0;
+
+static TLBShootdown _tlb_shootdown = {};
+static volatile uint32_t _tlb_shootdown_pending = 0;
+
+static volatile int _stopped_by = -1;
+
+void smp_found_cpu(uint8_t apic_id)
+{
+    if (_found_count < __array_length(_found_apic_ids))
+    {
+        _found_apic_ids[_found_count] = apic_id;
+        _found_count++;
+    }
+}
+
+int arch_cpu_current()
+{
+    // Every CPU loads its own TSS, the task register tells them apart. There
+    // is none before the GDT is loaded, only the boot CPU runs by then.
+    uint16_t selector;
+    asm volatile("str %0"
+                 : "=r"(selector));
+
+    if (selector < GDT_TSS_ENTRY(0) * sizeof(GDTEntry))
+    {
+        return 0;
+    }
+
+    return selector / sizeof(GDTEntry) - GDT_TSS_ENTRY(0);
+}
+
+int arch_cpu_count()
+{
+    return _cpu_count;
+}
+
+uint32_t smp_other_cpus()
+{
+    uint32_t cpus = 0;
+
+    for (int cpu = 0; cpu < ARCH_MAX_CPU_COUNT; cpu++)
+    {
+        if (_cpus[cpu].online && cpu != arch_cpu_current())
+        {
+            cpus |= 1 << cpu;
+        }
+    }
+
+    return cpus;
+}
+
+void arch_cpu_relax()
+{
+    asm volatile("pause");
+
+    if (_tlb_shootdown_pending & (1 << arch_cpu_current()))
+    {
+        smp_handle_tlb_shootdown();
+    }
+
+    if (_stopped_by != -1 && _stopped_by != arch_cpu_current())
+    {
+        smp_handle_stop();
+    }
+}
+
+void arch_cpu_reschedule(int cpu)
+{
+    if (_cpus[cpu].online && cpu != arch_cpu_current())
+    {
+        lapic_send_ipi(_cpus[cpu].apic_id, INTERRUPT_RESCHEDULE);
+    }
+}
+
+void arch_cpu_stop_others()
+{
+    int expected = -1;
+
+    if (!__atomic_compare_exchange_n(&_stopped_by, &expected, arch_cpu_current(), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+    {
+        return;
+    }
+
+    uint32_t cpus = smp_other_cpus();
+
+    for (int cpu = 0; cpu < ARCH_MAX_CPU_COUNT; cpu++)
+    {
+        if (cpus & (1 << cpu))
+        {
+            lapic_send_ipi(_cpus[cpu].apic_id, INTERRUPT_STOP);
+        }
+    }
+}
+
+void smp_handle_stop()
+{
+    _cpus[arch_cpu_current()].online = false;
+
+    while (true)
+    {
+        cli();
+        hlt();
+    }
+}
+
+void smp_tlb_shootdown(uint32_t cpus, uintptr_t first, uintptr_t last, bool global)
+{
+    if (cpus == 0)
+    {
+        return;
+    }
+
+    _tlb_shootdown = {first, last, global};
+    __atomic_store_n(&_tlb_shootdown_pending, cpus, __ATOMIC_SEQ_CST);
+
+    for (int cpu = 0; cpu < ARCH_MAX_CPU_COUNT; cpu++)
+    {
+        if (cpus & (1 << cpu))
+        {
+            lapic_send_ipi(_cpus[cpu].apic_id, INTERRUPT_TLB_SHOOTDOWN);
+        }
+    }
+
+    while (_tlb_shootdown_pending)
+    {
+        arch_cpu_relax();
+    }
+}
+
+void smp_handle_tlb_shootdown()
+{
+    uint32_t cpu = 1 << arch_cpu_current();
+
+    if (_tlb_shootdown_pending & cpu)
+    {
+        paging_flush(_tlb_shootdown.first, _tlb_shootdown.last, _tlb_shootdown.global);
+        __atomic_and_fetch(&_tlb_shootdown_pending, ~cpu, __ATOMIC_SEQ_CST);
+    }
+}
+
+extern "C" void smp_application_processor_main(int cpu)
+{
+    gdt_load(cpu);
+    idt_load();
+
+    arch_virtual_memory_enable();
+    fpu_initialize();
+    sysenter_initialize();
+    lapic_initialize();
+
+    // Interrupts are still disabled, the boot CPU did the same in
+    // interrupts_initialize().
+    atomic_enable();
+
+    atomic_begin();
+
+    Task *idle = _cpus[cpu].idle;
+    idle->state(TASK_STATE_HANG);
+
+    scheduler_did_create_idle_task(idle);
+    scheduler_did_create_running_task(idle);
+
+    arch_address_space_switch(arch_kernel_address_space());
+    arch_load_context(idle);
+
+    timer_initialize_cpu();
+
+    _cpus[cpu].online = true;
+    __atomic_add_fetch(&_cpu_count, 1, __ATOMIC_SEQ_CST);
+
+    logger_info("CPU %d is online", cpu);
+
+    atomic_end();
+
+    system_hang();
+}
+
+// The trampoline goes in a page of low memory nobody uses, identity mapped
+// so it survives turning paging on.
+static bool smp_trampoline_setup()
+{
+    AtomicHolder holder;
+
+    for (uintptr_t address = SMP_TRAMPOLINE_START; address < SMP_TRAMPOLINE_END; address += ARCH_PAGE_SIZE)
+    {
+        MemoryRange trampoline{address, ARCH_PAGE_SIZE};
+
+        if (physical_is_used(trampoline) || arch_virtual_present(arch_kernel_address_space(), address))
+        {
+            continue;
+        }
+
+        memory_map_identity(arch_kernel_address_space(), trampoline, MEMORY_NONE);
+        memcpy((void *)address, smp_trampoline_start, smp_trampoline_end - smp_trampoline_start);
+
+        _trampoline = address;
+
+        return true;
+    }
+
+    return false;
+}
+
+static bool smp_start_cpu(int cpu, uint8_t apic_id)
+{
+    atomic_begin();
+    Task *idle = task_create(nullptr, "Idle", false);
+    idle->cpu = cpu;
+    atomic_end();
+
+    _cpus[cpu].apic_id = apic_id;
+    _cpus[cpu].idle = idle;
+
+    auto parameters = reinterpret_cast<SMPTrampolineParameters *>(_trampoline + (smp_trampoline_parameters - smp_trampoline_start));
+
+    asm volatile("sgdt %0"
+                 : "=m"(parameters->gdt));
+
+    parameters->directory = (uintptr_t)&_kernel_page_directory;
+    parameters->stack = (uintptr_t)idle->kernel_stack + PROCESS_STACK_SIZE;
+    parameters->cpu = cpu;
+    parameters->entry = (uintptr_t)smp_application_processor_main;
+
+    lapic_send_ipi(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT);
+    task_sleep(scheduler_running(), 10);
+
+    for (int i = 0; i < 2 && !_cpus[cpu].online; i++)
+    {
+        lapic_send_ipi(apic_id, LAPIC_ICR_STARTUP | (_trampoline / ARCH_PAGE_SIZE));
+        task_sleep(scheduler_running(), 1);
+    }
+
+    for (int i = 0; i < 100 && !_cpus[cpu].online; i++)
+    {
+        task_sleep(scheduler_running(), 10);
+    }
+
+    return _cpus[cpu].online;
+}
+
+void arch_cpu_start_others()
+{
+    // arch_timer_initialize() already mapped and enabled the LAPIC.
+    if (!lapic_present() || _found_count <= 1)
+    {
+        logger_info("Running on a single CPU");
+        return;
+    }
+
+    _cpus[0].apic_id = lapic_id();
+    _cpus[0].online = true;
+
+    if (!smp_trampoline_setup())
+    {
+        logger_warn("No room for the SMP trampoline, running on a single CPU");
+        return;
+    }
+
+    int cpu = 1;
+
+    for (size_t i = 0; i < _found_count && cpu < ARCH_MAX_CPU_COUNT; i++)
+    {
+        if (_found_apic_ids[i] == _cpus[0].apic_id)
+        {
+            continue;
+        }
+
+        // A CPU which didn't answer might still start later, so it keeps
+        // its index and its idle task.
+        if (!smp_start_cpu(cpu, _found_apic_ids[i]))
+        {
+            logger_warn("CPU with LAPIC %d didn't start", _found_apic_ids[i]);
+        }
+
+        cpu++;
+    }
+
+    logger_info("%d CPUs online", arch_cpu_count());
+}
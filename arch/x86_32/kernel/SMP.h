@@ -0,0 +1,32 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+#include "arch/x86_32/kernel/GDT.h"
+
+// Where the other CPUs start, in a free page of conventional memory.
+#define SMP_TRAMPOLINE_START (0x1000)
+#define SMP_TRAMPOLINE_END (0x9f000)
+
+struct __packed SMPTrampolineParameters
+{
+    GDTDescriptor gdt;
+    uint32_t directory;
+    uint32_t stack;
+    uint32_t cpu;
+    uint32_t entry;
+};
+
+// For every enabled LAPIC of the MADT, the boot CPU included.
+void smp_found_cpu(uint8_t apic_id);
+
+// Invalidates the pages from first to last in the TLB of the given CPUs and
+// waits for them to be done. The caller holds the kernel lock.
+void smp_tlb_shootdown(uint32_t cpus, uintptr_t first, uintptr_t last, bool global);
+
+// A mask of the CPUs which are online, but the calling one.
+uint32_t smp_other_cpus();
+
+void smp_handle_tlb_shootdown();
+
+void __no_return smp_handle_stop();
@@ -0,0 +1,88 @@
+;; SMP.s: where the other CPUs start, copied to a page under 1Mio.          ;;
+
+section .text
+
+;; --- Real mode ------------------------------------------------------------ ;;
+
+bits 16
+
+global smp_trampoline_start
+smp_trampoline_start:
+    cli
+    cld
+
+    mov ax, cs
+    mov ds, ax
+
+    ; The linear address of the trampoline, its code and data are only
+    ; reachable relative to it once in protected mode.
+    xor ebx, ebx
+    mov bx, ax
+    shl ebx, 4
+
+    lea eax, [ebx + smp_trampoline_protected - smp_trampoline_start]
+    mov [smp_trampoline_jump - smp_trampoline_start], eax
+
+    o32 lgdt [smp_trampoline_parameters.gdt - smp_trampoline_start]
+
+    mov eax, cr0
+    or eax, 1
+    mov cr0, eax
+
+    o32 jmp far [smp_trampoline_jump - smp_trampoline_start]
+
+;; --- Protected mode ------------------------------------------------------- ;;
+
+bits 32
+
+smp_trampoline_protected:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    mov eax, [ebx + smp_trampoline_parameters.directory - smp_trampoline_start]
+    mov cr3, eax
+
+    ; Turn the caches back on, and paging with write protection.
+    mov eax, cr0
+    and eax, 0x9fffffff
+    or eax, 0x80010000
+    mov cr0, eax
+
+    mov esp, [ebx + smp_trampoline_parameters.stack - smp_trampoline_start]
+    push dword [ebx + smp_trampoline_parameters.cpu - smp_trampoline_start]
+
+    mov eax, [ebx + smp_trampoline_parameters.entry - smp_trampoline_start]
+    call eax
+
+.hang:
+    cli
+    hlt
+    jmp .hang
+
+align 4
+smp_trampoline_jump:
+    dd 0
+    dw 0x08
+
+;; Filled by smp_start_cpu(), matches SMPTrampolineParameters.
+align 4
+global smp_trampoline_parameters
+smp_trampoline_parameters:
+.gdt:
+    dw 0
+    dd 0
+.directory:
+    dd 0
+.stack:
+    dd 0
+.cpu:
+    dd 0
+.entry:
+    dd 0
+
+global smp_trampoline_end
+smp_trampoline_end:
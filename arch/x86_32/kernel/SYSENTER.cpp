@@ -0,0 +1,94 @@
+#include <libsystem/Assert.h>
+#include <libsystem/Logger.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "arch/VirtualMemory.h"
+
+#include "arch/x86_32/kernel/CPUID.h"
+#include "arch/x86_32/kernel/GDT.h"
+#include "arch/x86_32/kernel/SYSENTER.h"
+#include "arch/x86_32/kernel/x86_32.h"
+
+#include "kernel/scheduling/Scheduler.h"
+#include "kernel/tasking/Syscalls.h"
+
+extern "C" void __sysenter_entry();
+
+static bool _sysenter_enabled = false;
+
+bool sysenter_initialize()
+{
+    if (!(cpuid_get_feature_EDX() & CPUID_FEAT_EDX_SEP))
+    {
+        logger_warn("No sysenter, falling back to int $0x80 for syscalls.");
+        return false;
+    }
+
+    // sysenter loads the stack pointer with the address of the kernel stack
+    // slot of the TSS, the entry reads the actual stack from there. This way
+    // switching tasks doesn't have to touch the MSR.
+    wrmsr(MSR_SYSENTER_CS, 0x08, 0);
+    wrmsr(MSR_SYSENTER_ESP, (uint32_t)tss_kernel_stack(), 0);
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t)__sysenter_entry, 0);
+
+    _sysenter_enabled = true;
+
+    return true;
+}
+
+bool sysenter_enabled()
+{
+    return _sysenter_enabled;
+}
+
+// The return address is read from the user stack, faulting on it would
+// take the kernel down with the task.
+static bool sysenter_stack_readable(Task *task, uintptr_t user_stack)
+{
+    if (user_stack < 0x40000000 || user_stack > 0xfffffffb ||
+        !syscall_validate_ptr(user_stack, sizeof(uint32_t)))
+    {
+        return false;
+    }
+
+    AtomicHolder holder;
+
+    // The word might straddle two pages. Either they are already there, or
+    // they belong to a mapping which can demand page them.
+    uintptr_t addresses[] = {user_stack, user_stack + sizeof(uint32_t) - 1};
+
+    for (uintptr_t address : addresses)
+    {
+        if (!arch_virtual_present(task->address_space, address) &&
+            !region_tree_lookup(&task->memory_mapping, address))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+extern "C" void sysenter_handler(SysenterStackFrame *stackframe)
+{
+    uintptr_t user_stack = stackframe->ebp;
+
+    if (!sysenter_stack_readable(scheduler_running(), user_stack))
+    {
+        logger_error("Task %s(%d) did a sysenter with a bad stack %08x!", scheduler_running()->name, scheduler_running_id(), user_stack);
+        scheduler_running()->cancel(-1);
+        ASSERT_NOT_REACHED();
+    }
+
+    sti();
+
+    uint32_t return_address = *reinterpret_cast<uint32_t *>(user_stack);
+
+    stackframe->eax = task_do_syscall((Syscall)stackframe->eax, stackframe->ebx, stackframe->ecx, stackframe->edx, stackframe->esi, stackframe->edi);
+
+    cli();
+
+    // sysexit jumps to edx with ecx as the stack.
+    stackframe->ecx = user_stack + sizeof(uint32_t);
+    stackframe->edx = return_address;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+#define MSR_SYSENTER_CS (0x174)
+#define MSR_SYSENTER_ESP (0x175)
+#define MSR_SYSENTER_EIP (0x176)
+
+// Pushed on the kernel stack by __sysenter_entry. ebp is the user stack,
+// with the return address on top.
+struct __packed SysenterStackFrame
+{
+    uint32_t gs, fs, es, ds;
+    uint32_t eax, ebx, ecx, edx, esi, edi, ebp;
+};
+
+// Returns false if the CPU doesn't have sysenter, userspace keeps using
+// int $0x80 then.
+bool sysenter_initialize();
+
+bool sysenter_enabled();
@@ -0,0 +1,151 @@
+#include <libsystem/Logger.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "arch/x86/kernel/PIC.h"
+#include "arch/x86_32/kernel/CPUID.h"
+#include "arch/x86_32/kernel/Interrupts.h"
+#include "arch/x86_32/kernel/LAPIC.h"
+#include "arch/x86_32/kernel/Timer.h"
+#include "arch/x86_32/kernel/x86_32.h"
+
+#include "kernel/system/System.h"
+#include "kernel/system/SystemPage.h"
+
+// PIT ticks the LAPIC timer and the TSC are measured against.
+#define TIMER_CALIBRATION_TICKS (50)
+
+// Longest the LAPIC timer is programmed for, later deadlines are reached in
+// several steps.
+#define TIMER_MAX_DELAY (1000000)
+
+// The PIT ticks every millisecond until the LAPIC is mapped. Then, if there
+// is a TSC, it keeps the time and every CPU programs its LAPIC timer for the
+// next thing it has to do instead of ticking.
+static volatile uint32_t _pit_ticks = 0;
+
+static bool _tickless = false;
+static uint32_t _lapic_counts_per_tick = 0;
+
+static uint64_t _tsc_base = 0;
+static uint64_t _clock_base = 0;
+static uint32_t _tsc_mult = 0;
+
+void timer_pit_tick()
+{
+    _pit_ticks = _pit_ticks + 1;
+}
+
+uint64_t arch_get_clock()
+{
+    if (!_tickless)
+    {
+        return (uint64_t)_pit_ticks * 1000;
+    }
+
+    return _clock_base + system_page_scale(rdtsc() - _tsc_base, _tsc_mult);
+}
+
+void arch_timer_deadline(uint64_t deadline)
+{
+    if (!_tickless)
+    {
+        return;
+    }
+
+    if (deadline == ARCH_NO_DEADLINE)
+    {
+        lapic_write(LAPIC_TIMER_INITIAL, 0);
+        return;
+    }
+
+    uint64_t now = arch_get_clock();
+    uint64_t delay = deadline > now ? MIN(deadline - now, TIMER_MAX_DELAY) : 0;
+
+    // A count of zero stops the timer, a passed deadline fires right away.
+    uint64_t count = delay * _lapic_counts_per_tick / 1000 + 1;
+
+    lapic_write(LAPIC_TIMER_INITIAL, MIN(count, 0xffffffff));
+}
+
+void timer_initialize_cpu()
+{
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+
+    if (_tickless)
+    {
+        lapic_write(LAPIC_TIMER, INTERRUPT_LAPIC_TIMER);
+        lapic_write(LAPIC_TIMER_INITIAL, 0);
+    }
+    else
+    {
+        lapic_write(LAPIC_TIMER, INTERRUPT_LAPIC_TIMER | LAPIC_TIMER_PERIODIC);
+        lapic_write(LAPIC_TIMER_INITIAL, _lapic_counts_per_tick);
+    }
+}
+
+static void timer_wait_pit_ticks(uint32_t ticks)
+{
+    uint32_t start = _pit_ticks;
+
+    while (_pit_ticks - start < ticks)
+    {
+        arch_halt();
+    }
+}
+
+void arch_timer_initialize()
+{
+    lapic_map();
+
+    if (!lapic_present())
+    {
+        logger_info("No LAPIC, the PIT keeps ticking");
+        return;
+    }
+
+    lapic_initialize();
+
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_TIMER, LAPIC_TIMER_MASKED);
+
+    timer_wait_pit_ticks(1);
+
+    lapic_write(LAPIC_TIMER_INITIAL, 0xffffffff);
+    uint64_t tsc_start = rdtsc();
+
+    timer_wait_pit_ticks(TIMER_CALIBRATION_TICKS);
+
+    uint64_t tsc_elapsed = rdtsc() - tsc_start;
+    _lapic_counts_per_tick = (0xffffffff - lapic_read(LAPIC_TIMER_CURRENT)) / TIMER_CALIBRATION_TICKS;
+
+    lapic_write(LAPIC_TIMER_INITIAL, 0);
+
+    logger_info("The LAPIC timer does %u counts per tick", _lapic_counts_per_tick);
+
+    if (!(cpuid_get_feature_EDX() & CPUID_FEAT_EDX_TSC))
+    {
+        logger_info("No TSC, the PIT keeps ticking");
+        return;
+    }
+
+    uint64_t tsc_per_second = tsc_elapsed * SYSTEM_TICKS_PER_SECOND / TIMER_CALIBRATION_TICKS;
+
+    AtomicHolder holder;
+
+    // The TSC clock starts where the PIT one stopped, so it never goes back.
+    _tsc_mult = (1000000ull << 32) / tsc_per_second;
+    _clock_base = arch_get_clock();
+    _tsc_base = rdtsc();
+    _tickless = true;
+
+    pic_mask(0);
+    timer_initialize_cpu();
+
+    system_page_set_cycles(_tsc_base, _clock_base, _tsc_mult);
+
+    // The next pass of the scheduler knows when to program the timer for.
+    arch_timer_deadline(arch_get_clock());
+
+    logger_info("Tickless, the TSC runs at %u kHz", (uint32_t)(tsc_per_second / 1000));
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+// Counts the PIT interrupts, the clock until the TSC takes over.
+void timer_pit_tick();
+
+// Sets up the LAPIC timer of a CPU brought up after arch_timer_initialize().
+void timer_initialize_cpu();
@@ -1,18 +1,111 @@
 #include <libsystem/io/Stream.h>
+#include <libsystem/math/MinMax.h>
 #include <libsystem/thread/Atomic.h>
 
+#include "arch/Arch.h"
 #include "arch/VirtualMemory.h"
+#include "arch/x86_32/kernel/CPUID.h"
 #include "arch/x86_32/kernel/Paging.h"
+#include "arch/x86_32/kernel/SMP.h"
+#include "arch/x86_32/kernel/x86_32.h"
 
 #include "kernel/memory/Memory.h"
 #include "kernel/memory/Physical.h"
+#include "kernel/memory/RegionTree.h"
 #include "kernel/system/System.h"
 
+// We skip the first page to make null deref trigger a page fault.
+#define KERNEL_REGION_BASE (ARCH_PAGE_SIZE)
+#define USER_REGION_BASE (0x40000000)
+
+// The last page is never handed out so the end of a region doesn't overflow.
+#define USER_REGION_END (0xfffff000)
+
+// Past this many pages, flushing the whole TLB is cheaper than invlpg.
+#define TLB_GATHER_LIMIT (32)
+
+#define CR0_WP (1 << 16)
+#define CR4_PGE (1 << 7)
+
+struct TLBGather
+{
+    int depth;
+
+    size_t pages;
+    uintptr_t first;
+    uintptr_t last;
+
+    // Kernel pages are global and survive a CR3 reload.
+    bool global;
+
+    // The other CPUs which might have the pages in their TLB.
+    uint32_t cpus;
+};
+
+struct AddressSpace
+{
+    PageDirectory *directory;
+
+    // Free virtual memory above the first gigabyte.
+    RegionTree user_regions;
+};
+
 PageDirectory _kernel_page_directory __aligned(ARCH_PAGE_SIZE) = {};
 PageTable _kernel_page_tables[256] __aligned(ARCH_PAGE_SIZE) = {};
 
+// The kernel page tables are shared, so is the free kernel memory.
+static RegionTree _kernel_regions = {};
+
+static AddressSpace _kernel_address_space = {&_kernel_page_directory, {}};
+
+static AddressSpace *_current_address_space[ARCH_MAX_CPU_COUNT] = {};
+
+static bool _global_pages = false;
+
+static TLBGather _gather = {};
+
+static PageDirectory *virtual_page_directory(void *address_space)
+{
+    return reinterpret_cast<AddressSpace *>(address_space)->directory;
+}
+
+static void virtual_regions_update(RegionTree *tree, uintptr_t region_base, uintptr_t region_end, MemoryRange range, bool used)
+{
+    uintptr_t base = MAX(range.base(), region_base);
+    uintptr_t end = MIN(range.end(), region_end - 1);
+
+    if (range.empty() || base > end)
+    {
+        return;
+    }
+
+    MemoryRange clipped{base, end - base + 1};
+
+    if (used)
+    {
+        region_tree_reserve(tree, clipped);
+    }
+    else
+    {
+        region_tree_release(tree, clipped);
+    }
+}
+
+static void virtual_regions_set_used(void *address_space, MemoryRange range, bool used)
+{
+    auto space = reinterpret_cast<AddressSpace *>(address_space);
+
+    virtual_regions_update(&_kernel_regions, KERNEL_REGION_BASE, USER_REGION_BASE, range, used);
+    virtual_regions_update(&space->user_regions, USER_REGION_BASE, USER_REGION_END, range, used);
+}
+
 void arch_virtual_initialize()
 {
+    AtomicHolder holder;
+
+    region_tree_release(&_kernel_regions, MemoryRange{KERNEL_REGION_BASE, USER_REGION_BASE - KERNEL_REGION_BASE});
+    region_tree_release(&_kernel_address_space.user_regions, MemoryRange{USER_REGION_BASE, USER_REGION_END - USER_REGION_BASE});
+
     // Setup the kernel pagedirectory.
     for (size_t i = 0; i < 256; i++)
     {
@@ -27,18 +120,141 @@ void arch_virtual_initialize()
 void arch_virtual_memory_enable()
 {
     paging_enable();
+
+    // Make the kernel fault on read-only pages too, or it would write
+    // through copy-on-write pages.
+    asm volatile("mov %0, %%cr0" ::"r"(CR0() | CR0_WP));
+
+    if (cpuid_get_feature_EDX() & CPUID_FEAT_EDX_PGE)
+    {
+        asm volatile("mov %0, %%cr4" ::"r"(CR4() | CR4_PGE));
+        _global_pages = true;
+    }
+}
+
+// The other CPUs with the address space loaded, or all of them for the
+// kernel half which is shared by every address space.
+static uint32_t virtual_cpus_using(void *address_space, bool kernel_page)
+{
+    uint32_t cpus = smp_other_cpus();
+
+    if (kernel_page)
+    {
+        return cpus;
+    }
+
+    for (int cpu = 0; cpu < ARCH_MAX_CPU_COUNT; cpu++)
+    {
+        if (_current_address_space[cpu] != address_space)
+        {
+            cpus &= ~(1 << cpu);
+        }
+    }
+
+    return cpus;
+}
+
+static void virtual_gather_page(void *address_space, uintptr_t virtual_address)
+{
+    bool kernel_page = virtual_address < USER_REGION_BASE;
+    bool current = address_space == _current_address_space[arch_cpu_current()];
+
+    uint32_t cpus = virtual_cpus_using(address_space, kernel_page);
+
+    // Other address spaces have nothing of their user half in the TLB.
+    if (!kernel_page && !current && cpus == 0)
+    {
+        return;
+    }
+
+    if (_gather.pages == 0)
+    {
+        _gather.first = virtual_address;
+        _gather.last = virtual_address;
+    }
+    else
+    {
+        _gather.first = MIN(_gather.first, virtual_address);
+        _gather.last = MAX(_gather.last, virtual_address);
+    }
+
+    _gather.pages++;
+    _gather.global |= kernel_page;
+    _gather.cpus |= cpus;
+}
+
+void paging_flush(uintptr_t first, uintptr_t last, bool global)
+{
+    size_t span = (last - first) / ARCH_PAGE_SIZE + 1;
+
+    if (span <= TLB_GATHER_LIMIT)
+    {
+        for (size_t i = 0; i < span; i++)
+        {
+            paging_invalidate_page(first + i * ARCH_PAGE_SIZE);
+        }
+    }
+    else if (global && _global_pages)
+    {
+        // Toggling PGE flushes global pages too.
+        uint32_t cr4 = CR4();
+        asm volatile("mov %0, %%cr4" ::"r"(cr4 & ~CR4_PGE));
+        asm volatile("mov %0, %%cr4" ::"r"(cr4));
+    }
+    else
+    {
+        paging_invalidate_tlb();
+    }
+}
+
+static void virtual_gather_flush()
+{
+    if (_gather.pages == 0)
+    {
+        return;
+    }
+
+    // The local flush is useless when only other CPUs had the pages, but
+    // harmless.
+    paging_flush(_gather.first, _gather.last, _gather.global);
+    smp_tlb_shootdown(_gather.cpus, _gather.first, _gather.last, _gather.global);
+
+    _gather.pages = 0;
+    _gather.global = false;
+    _gather.cpus = 0;
+}
+
+void arch_virtual_gather_begin()
+{
+    ASSERT_ATOMIC;
+
+    _gather.depth++;
+}
+
+void arch_virtual_gather_end()
+{
+    ASSERT_ATOMIC;
+
+    assert(_gather.depth > 0);
+
+    _gather.depth--;
+
+    if (_gather.depth == 0)
+    {
+        virtual_gather_flush();
+    }
 }
 
 void *arch_kernel_address_space()
 {
-    return &_kernel_page_directory;
+    return &_kernel_address_space;
 }
 
 bool arch_virtual_present(void *address_space, uintptr_t virtual_address)
 {
     ASSERT_ATOMIC;
 
-    auto page_directory = reinterpret_cast<PageDirectory *>(address_space);
+    auto page_directory = virtual_page_directory(address_space);
 
     int page_directory_index = PAGE_DIRECTORY_INDEX(virtual_address);
     PageDirectoryEntry &page_directory_entry = page_directory->entries[page_directory_index];
@@ -60,7 +276,7 @@ uintptr_t arch_virtual_to_physical(void *address_space, uintptr_t virtual_addres
 {
     ASSERT_ATOMIC;
 
-    auto page_directory = reinterpret_cast<PageDirectory *>(address_space);
+    auto page_directory = virtual_page_directory(address_space);
 
     int page_directory_index = PAGE_DIRECTORY_INDEX(virtual_address);
     PageDirectoryEntry &page_directory_entry = page_directory->entries[page_directory_index];
@@ -87,7 +303,7 @@ Result arch_virtual_map(void *address_space, MemoryRange physical_range, uintptr
 {
     ASSERT_ATOMIC;
 
-    auto page_directory = reinterpret_cast<PageDirectory *>(address_space);
+    auto page_directory = virtual_page_directory(address_space);
 
     for (size_t i = 0; i < physical_range.size() / ARCH_PAGE_SIZE; i++)
     {
@@ -99,7 +315,7 @@ Result arch_virtual_map(void *address_space, MemoryRange physical_range, uintptr
 
         if (!page_directory_entry.Present)
         {
-            Result alloc_result = memory_alloc_identity(page_directory, MEMORY_CLEAR, (uintptr_t *)&page_table);
+            Result alloc_result = memory_alloc_identity(address_space, MEMORY_CLEAR, (uintptr_t *)&page_table);
 
             if (alloc_result != SUCCESS)
             {
@@ -115,13 +331,25 @@ Result arch_virtual_map(void *address_space, MemoryRange physical_range, uintptr
         int page_table_index = PAGE_TABLE_INDEX(virtual_address + offset);
         PageTableEntry &page_table_entry = page_table->entries[page_table_index];
 
+        // Not present entries are never cached, only remapping needs a flush.
+        if (page_table_entry.Present)
+        {
+            virtual_gather_page(address_space, virtual_address + offset);
+        }
+
         page_table_entry.Present = 1;
-        page_table_entry.Write = 1;
+        page_table_entry.Write = !(flags & MEMORY_READONLY);
         page_table_entry.User = flags & MEMORY_USER;
+        page_table_entry.Global = !(flags & MEMORY_USER) && virtual_address + offset < USER_REGION_BASE;
         page_table_entry.PageFrameNumber = (physical_range.base() + offset) >> 12;
     }
 
-    paging_invalidate_tlb();
+    virtual_regions_set_used(address_space, MemoryRange{virtual_address, physical_range.size()}, true);
+
+    if (_gather.depth == 0)
+    {
+        virtual_gather_flush();
+    }
 
     return SUCCESS;
 }
@@ -130,46 +358,48 @@ MemoryRange arch_virtual_alloc(void *address_space, MemoryRange physical_range,
 {
     ASSERT_ATOMIC;
 
-    bool is_user_memory = flags & MEMORY_USER;
+    MemoryRange virtual_range = arch_virtual_reserve(address_space, physical_range.size(), flags);
 
-    uintptr_t virtual_address = 0;
-    size_t current_size = 0;
+    arch_virtual_map(address_space, physical_range, virtual_range.base(), flags);
 
-    // we skip the first page to make null deref trigger a page fault
-    for (size_t i = (is_user_memory ? 256 : 1) * 1024; i < (is_user_memory ? 1024 : 256) * 1024; i++)
-    {
-        uintptr_t current_address = i * ARCH_PAGE_SIZE;
+    return virtual_range;
+}
 
-        if (!arch_virtual_present(address_space, current_address))
-        {
-            if (current_size == 0)
-            {
-                virtual_address = current_address;
-            }
+MemoryRange arch_virtual_reserve(void *address_space, size_t size, MemoryFlags flags)
+{
+    ASSERT_ATOMIC;
 
-            current_size += ARCH_PAGE_SIZE;
+    RegionTree *regions = &_kernel_regions;
 
-            if (current_size == physical_range.size())
-            {
-                arch_virtual_map(address_space, physical_range, virtual_address, flags);
+    if (flags & MEMORY_USER)
+    {
+        regions = &reinterpret_cast<AddressSpace *>(address_space)->user_regions;
+    }
 
-                return (MemoryRange){virtual_address, current_size};
-            }
-        }
-        else
-        {
-            current_size = 0;
-        }
+    MemoryRange virtual_range = region_tree_find(regions, size);
+
+    if (virtual_range.empty())
+    {
+        system_panic("Out of virtual memory!");
     }
 
-    system_panic("Out of virtual memory!");
+    virtual_regions_set_used(address_space, virtual_range, true);
+
+    return virtual_range;
+}
+
+void arch_virtual_reserve_at(void *address_space, MemoryRange virtual_range)
+{
+    ASSERT_ATOMIC;
+
+    virtual_regions_set_used(address_space, virtual_range, true);
 }
 
 void arch_virtual_free(void *address_space, MemoryRange virtual_range)
 {
     ASSERT_ATOMIC;
 
-    auto page_directory = reinterpret_cast<PageDirectory *>(address_space);
+    auto page_directory = virtual_page_directory(address_space);
 
     for (size_t i = 0; i < virtual_range.size() / ARCH_PAGE_SIZE; i++)
     {
@@ -191,8 +421,16 @@ void arch_virtual_free(void *address_space, MemoryRange virtual_range)
         if (page_table_entry->Present)
         {
             page_table_entry->as_uint = 0;
+            virtual_gather_page(address_space, virtual_range.base() + offset);
         }
     }
+
+    virtual_regions_set_used(address_space, virtual_range, false);
+
+    if (_gather.depth == 0)
+    {
+        virtual_gather_flush();
+    }
 }
 
 void *arch_address_space_create()
@@ -221,7 +459,12 @@ void *arch_address_space_create()
         page_directory_entry->PageFrameNumber = (uint)&_kernel_page_tables[i] / ARCH_PAGE_SIZE;
     }
 
-    return page_directory;
+    AddressSpace *address_space = __create(AddressSpace);
+
+    address_space->directory = page_directory;
+    region_tree_release(&address_space->user_regions, MemoryRange{USER_REGION_BASE, USER_REGION_END - USER_REGION_BASE});
+
+    return address_space;
 }
 
 void arch_address_space_destroy(void *address_space)
@@ -230,7 +473,7 @@ void arch_address_space_destroy(void *address_space)
 
     assert(address_space != arch_kernel_address_space());
 
-    auto page_directory = reinterpret_cast<PageDirectory *>(address_space);
+    auto page_directory = virtual_page_directory(address_space);
 
     for (size_t i = 256; i < 1024; i++)
     {
@@ -259,12 +502,35 @@ void arch_address_space_destroy(void *address_space)
     }
 
     memory_free(arch_kernel_address_space(), (MemoryRange){(uintptr_t)page_directory, sizeof(PageDirectory)});
+
+    auto space = reinterpret_cast<AddressSpace *>(address_space);
+
+    for (int cpu = 0; cpu < ARCH_MAX_CPU_COUNT; cpu++)
+    {
+        if (_current_address_space[cpu] == space)
+        {
+            _current_address_space[cpu] = nullptr;
+        }
+    }
+
+    region_tree_clear(&space->user_regions);
+    free(space);
 }
 
 void arch_address_space_switch(void *address_space)
 {
     AtomicHolder holder;
-    paging_load_directory(arch_virtual_to_physical(arch_kernel_address_space(), (uintptr_t)address_space));
+
+    int cpu = arch_cpu_current();
+
+    // Reloading CR3 flushes the TLB, don't do it for nothing.
+    if (address_space == _current_address_space[cpu])
+    {
+        return;
+    }
+
+    _current_address_space[cpu] = reinterpret_cast<AddressSpace *>(address_space);
+    paging_load_directory(arch_virtual_to_physical(arch_kernel_address_space(), (uintptr_t)virtual_page_directory(address_space)));
 }
 
 #define MEMORY_DUMP_REGION_START(__pdir, __addr)                     \
@@ -283,7 +549,7 @@ void arch_address_space_switch(void *address_space)
 
 void arch_address_space_dump(void *address_space, bool user)
 {
-    auto page_directory = reinterpret_cast<PageDirectory *>(address_space);
+    auto page_directory = virtual_page_directory(address_space);
 
     bool memory_used = false;
     bool memory_empty = true;
@@ -1,3 +1,5 @@
+#include <abi/SystemPage.h>
+
 #include <libsystem/Assert.h>
 #include <libsystem/core/Plugs.h>
 
@@ -12,6 +14,7 @@
 #include "arch/x86_32/kernel/IDT.h"
 #include "arch/x86_32/kernel/Interrupts.h"
 #include "arch/x86_32/kernel/LAPIC.h"
+#include "arch/x86_32/kernel/SYSENTER.h"
 #include "arch/x86_32/kernel/x86_32.h"
 
 #include "kernel/firmware/SMBIOS.h"
@@ -25,8 +28,32 @@ void arch_enable_interrupts() { sti(); }
 
 void arch_halt() { hlt(); }
 
+bool arch_save_interrupts()
+{
+    uint32_t flags;
+    asm volatile("pushf\n"
+                 "pop %0\n"
+                 "cli"
+                 : "=r"(flags)::"memory");
+
+    return flags & 0x200;
+}
+
+void arch_restore_interrupts(bool enabled)
+{
+    if (enabled)
+    {
+        sti();
+    }
+}
+
 void arch_yield() { asm("int $127"); }
 
+void arch_initialize_context(Task *task)
+{
+    fpu_initialize_context(task);
+}
+
 void arch_save_context(Task *task)
 {
     fpu_save_context(task);
@@ -42,6 +69,8 @@ size_t arch_debug_write(const void *buffer, size_t size) { return com_write(COM1
 
 TimeStamp arch_get_time() { return rtc_now(); }
 
+uint32_t arch_system_page_flags() { return sysenter_enabled() ? SYSTEM_PAGE_SYSENTER : 0; }
+
 extern "C" void arch_main(void *info, uint32_t magic)
 {
     __plug_init();
@@ -62,12 +91,12 @@ extern "C" void arch_main(void *info, uint32_t magic)
 
     gdt_initialize();
     idt_initialize();
+    sysenter_initialize();
     pic_initialize();
     fpu_initialize();
-    pit_initialize(1000);
+    pit_initialize(SYSTEM_TICKS_PER_SECOND);
 
     acpi_initialize(handover);
-    //lapic_initialize();
     smbios::EntryPoint *smbios_entrypoint = smbios::find({0xF0000, 65536});
 
     if (smbios_entrypoint)
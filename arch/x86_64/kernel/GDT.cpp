@@ -33,8 +33,9 @@ void gdt_initialize()
     gdt.entries[1] = {0, 0, GDT_PRESENT | GDT_READWRITE | GDT_EXECUTABLE, 0};
     gdt.entries[2] = {0, 0, GDT_PRESENT | GDT_READWRITE, 0};
 
-    gdt.entries[3] = {0, 0, GDT_USER | GDT_PRESENT | GDT_READWRITE | GDT_EXECUTABLE, 0};
-    gdt.entries[4] = {0, 0, GDT_USER | GDT_PRESENT | GDT_READWRITE, 0};
+    // sysret expects the user data segment right before the user code.
+    gdt.entries[3] = {0, 0, GDT_USER | GDT_PRESENT | GDT_READWRITE, 0};
+    gdt.entries[4] = {0, 0, GDT_USER | GDT_PRESENT | GDT_READWRITE | GDT_EXECUTABLE, 0};
 
     gdt_flush((uint64_t)&gdt_descriptor);
 }
@@ -43,3 +44,8 @@ void set_kernel_stack(uint64_t stack)
 {
     tss.rsp0 = stack;
 }
+
+uintptr_t tss_kernel_stack()
+{
+    return (uintptr_t)&tss + __builtin_offsetof(TSS64, rsp0);
+}
@@ -136,3 +136,6 @@ extern "C" void gdt_flush(uint64_t);
 extern "C" void tss_flush(uint64_t);
 
 void set_kernel_stack(uint32_t stack);
+
+// Address of the kernel stack slot of the TSS.
+uintptr_t tss_kernel_stack();
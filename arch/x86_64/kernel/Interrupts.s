@@ -176,3 +176,35 @@ __interrupt_vector:
     INTERRUPT_NAME 47
 
     INTERRUPT_NAME 127
+
+extern syscall_handler
+extern __syscall_kernel_stack_slot
+
+global __syscall_entry
+
+section .bss
+
+__syscall_user_stack:
+    resq 1
+
+section .text
+
+; Interrupts are disabled and rsp is still the user stack.
+__syscall_entry:
+    mov [rel __syscall_user_stack], rsp
+    mov rsp, [rel __syscall_kernel_stack_slot]
+    mov rsp, [rsp]
+
+    push qword [rel __syscall_user_stack]
+
+    __pusha
+
+    mov rdi, rsp
+
+    call syscall_handler
+
+    __popa
+
+    pop rsp
+
+    o64 sysret
@@ -0,0 +1,41 @@
+#include "arch/x86_64/kernel/GDT.h"
+#include "arch/x86_64/kernel/SYSCALL.h"
+#include "arch/x86_64/kernel/x86_64.h"
+
+#include "kernel/tasking/Syscalls.h"
+
+extern "C" void __syscall_entry();
+
+// syscall doesn't switch stacks, the entry finds the kernel stack through
+// this, single-CPU like the rest of the port.
+extern "C" uintptr_t __syscall_kernel_stack_slot;
+uintptr_t __syscall_kernel_stack_slot = 0;
+
+void syscall_initialize()
+{
+    __syscall_kernel_stack_slot = tss_kernel_stack();
+
+    uint32_t efer_low = 0;
+    uint32_t efer_high = 0;
+    rdmsr(MSR_EFER, &efer_low, &efer_high);
+    wrmsr(MSR_EFER, efer_low | EFER_SCE, efer_high);
+
+    // syscall loads the kernel code segment from STAR[47:32], sysret loads
+    // the user code from STAR[63:48] + 16 and the user stack from + 8.
+    wrmsr(MSR_STAR, 0, (0x10 << 16) | 0x08);
+
+    uint64_t entry = (uint64_t)__syscall_entry;
+    wrmsr(MSR_LSTAR, entry & 0xffffffff, entry >> 32);
+
+    // Interrupts stay off until we are on the kernel stack.
+    wrmsr(MSR_SFMASK, RFLAGS_IF | RFLAGS_DF, 0);
+}
+
+extern "C" void syscall_handler(SyscallStackFrame *stackframe)
+{
+    sti();
+
+    stackframe->rax = task_do_syscall((Syscall)stackframe->rax, stackframe->rdi, stackframe->rsi, stackframe->rdx, stackframe->r10, stackframe->r8);
+
+    cli();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+#define MSR_EFER (0xc0000080)
+#define MSR_STAR (0xc0000081)
+#define MSR_LSTAR (0xc0000082)
+#define MSR_SFMASK (0xc0000084)
+
+#define EFER_SCE (1 << 0)
+
+#define RFLAGS_IF (1 << 9)
+#define RFLAGS_DF (1 << 10)
+
+// Pushed on the kernel stack by __syscall_entry, rcx and r11 are the user
+// rip and rflags.
+struct __packed SyscallStackFrame
+{
+    uint64_t r15, r14, r13, r12, r11, r10, r9, r8;
+    uint64_t rbp, rdi, rsi, rdx, rcx, rbx, rax;
+    uint64_t user_rsp;
+};
+
+void syscall_initialize();
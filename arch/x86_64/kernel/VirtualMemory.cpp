@@ -58,6 +58,33 @@ void arch_virtual_free(void *address_space, MemoryRange virtual_range)
     ASSERT_NOT_REACHED();
 }
 
+MemoryRange arch_virtual_reserve(void *address_space, size_t size, MemoryFlags flags)
+{
+    __unused(address_space);
+    __unused(size);
+    __unused(flags);
+
+    ASSERT_NOT_REACHED();
+}
+
+void arch_virtual_reserve_at(void *address_space, MemoryRange virtual_range)
+{
+    __unused(address_space);
+    __unused(virtual_range);
+
+    ASSERT_NOT_REACHED();
+}
+
+void arch_virtual_gather_begin()
+{
+    ASSERT_NOT_REACHED();
+}
+
+void arch_virtual_gather_end()
+{
+    ASSERT_NOT_REACHED();
+}
+
 void *arch_address_space_create()
 {
     ASSERT_NOT_REACHED();
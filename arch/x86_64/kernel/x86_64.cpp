@@ -9,6 +9,7 @@
 #include "arch/x86/kernel/RTC.h"
 #include "arch/x86_64/kernel/GDT.h"
 #include "arch/x86_64/kernel/IDT.h"
+#include "arch/x86_64/kernel/SYSCALL.h"
 #include "arch/x86_64/kernel/x86_64.h"
 
 #include "thirdparty/limine/stivale/stivale.h"
@@ -37,6 +38,7 @@ extern "C" void _start(void *info)
     logger_info("Hello, world!");
     gdt_initialize();
     idt_initialize();
+    syscall_initialize();
     pic_initialize();
     pit_initialize(1);
     logger_info("Hello, world!");
@@ -64,11 +66,64 @@ void arch_halt()
     hlt();
 }
 
+bool arch_save_interrupts()
+{
+    uint64_t flags;
+    asm volatile("pushf\n"
+                 "pop %0\n"
+                 "cli"
+                 : "=r"(flags)::"memory");
+
+    return flags & 0x200;
+}
+
+void arch_restore_interrupts(bool enabled)
+{
+    if (enabled)
+    {
+        sti();
+    }
+}
+
 void arch_yield()
 {
     ASSERT_NOT_REACHED();
 }
 
+int arch_cpu_current()
+{
+    return 0;
+}
+
+int arch_cpu_count()
+{
+    return 1;
+}
+
+void arch_cpu_relax()
+{
+    asm volatile("pause");
+}
+
+void arch_cpu_reschedule(int cpu)
+{
+    __unused(cpu);
+}
+
+void arch_cpu_start_others()
+{
+    logger_warn("STUB %s", __func__);
+}
+
+void arch_cpu_stop_others()
+{
+}
+
+void arch_initialize_context(Task *task)
+{
+    __unused(task);
+}
+
 void arch_save_context(Task *task)
 {
     __unused(task);
@@ -93,6 +148,27 @@ TimeStamp arch_get_time()
     return rtc_now();
 }
 
+uint64_t arch_get_clock()
+{
+    return 0;
+}
+
+void arch_timer_initialize()
+{
+    logger_warn("STUB %s", __func__);
+}
+
+void arch_timer_deadline(uint64_t deadline)
+{
+    __unused(deadline);
+}
+
+uint32_t arch_system_page_flags()
+{
+    // syscall is always there in long mode.
+    return 0;
+}
+
 __no_return void arch_reboot()
 {
     logger_warn("STUB %s", __func__);
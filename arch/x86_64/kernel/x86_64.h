@@ -1,3 +1,17 @@
 #pragma once
 
 #include "arch/x86/kernel/x86.h"
+
+static inline void rdmsr(uint32_t msr, uint32_t *lo, uint32_t *hi)
+{
+    asm volatile("rdmsr"
+                 : "=a"(*lo), "=d"(*hi)
+                 : "c"(msr));
+}
+
+static inline void wrmsr(uint32_t msr, uint32_t lo, uint32_t hi)
+{
+    asm volatile("wrmsr"
+                 :
+                 : "a"(lo), "d"(hi), "c"(msr));
+}
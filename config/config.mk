@@ -7,6 +7,7 @@ CONFIGS = \
 	CONFIG \
 	CONFIG_ARCH \
 	CONFIG_BUILD_DIRECTORY \
+	CONFIG_CPUS \
 	CONFIG_NOREBOOT \
 	CONFIG_NOSHUTDOWN \
 	CONFIG_DISPLAY \
@@ -29,6 +30,9 @@ CONFIG_ARCH           ?=x86_32
 # Set the directory where output file will be generated.
 CONFIG_BUILD_DIRECTORY?=$(shell pwd)/build
 
+# How many CPUs the virtual machine has.
+CONFIG_CPUS           ?=4
+
 # Prevent the virtual machine to reboot (if supported).
 CONFIG_NOREBOOT       ?=false
 
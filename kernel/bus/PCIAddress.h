@@ -5,6 +5,7 @@
 #define PCI_VENDOR_ID 0x00
 #define PCI_DEVICE_ID 0x02
 #define PCI_COMMAND 0x04
+#define PCI_COMMAND_BUS_MASTER (1 << 2)
 #define PCI_STATUS 0x06
 #define PCI_REVISION_ID 0x08
 #define PCI_SUBSYSTEM_ID 0x2E
@@ -19,3 +19,9 @@
 #define VIRTIO_REGISTER_QUEUE_NOTIFY (0x10)
 #define VIRTIO_REGISTER_DEVICE_STATUS (0x12)
 #define VIRTIO_REGISTER_ISR_STATUS (0x13)
+
+// Without MSI-X, the device specific configuration follows the registers.
+#define VIRTIO_REGISTER_DEVICE_CONFIG (0x14)
+
+#define VIRTIO_ISR_QUEUE (1)
+#define VIRTIO_ISR_CONFIG (2)
@@ -0,0 +1,130 @@
+#include <libsystem/Assert.h>
+#include <libsystem/core/CString.h>
+
+#include "kernel/bus/VirtioQueue.h"
+
+static size_t virtio_queue_available_offset(uint16_t size)
+{
+    return sizeof(VirtqDescriptor) * size;
+}
+
+static size_t virtio_queue_used_offset(uint16_t size)
+{
+    // Flags, index, the ring and the used event.
+    return __align_up(virtio_queue_available_offset(size) + sizeof(uint16_t) * (3 + size), VIRTQ_ALIGN);
+}
+
+static size_t virtio_queue_size(uint16_t size)
+{
+    // Flags, index, the ring and the available event.
+    return virtio_queue_used_offset(size) + __align_up(sizeof(uint16_t) * 3 + sizeof(VirtqUsedElement) * size, VIRTQ_ALIGN);
+}
+
+VirtioQueue::VirtioQueue(uint16_t size) : _size(size)
+{
+    _range = make<MMIORange>(virtio_queue_size(size));
+    memset((void *)_range->base(), 0, _range->size());
+
+    uintptr_t available = _range->base() + virtio_queue_available_offset(size);
+    uintptr_t used = _range->base() + virtio_queue_used_offset(size);
+
+    _descriptors = reinterpret_cast<VirtqDescriptor *>(_range->base());
+
+    _available_index = reinterpret_cast<volatile uint16_t *>(available + 2);
+    _available_ring = reinterpret_cast<volatile uint16_t *>(available + 4);
+
+    _used_index = reinterpret_cast<volatile uint16_t *>(used + 2);
+    _used_ring = reinterpret_cast<volatile VirtqUsedElement *>(used + 4);
+
+    for (uint16_t i = 0; i < size; i++)
+    {
+        _descriptors[i].next = i + 1;
+    }
+
+    _free_head = 0;
+    _free_count = size;
+
+    _cookies = new void *[size];
+
+    for (uint16_t i = 0; i < size; i++)
+    {
+        _cookies[i] = nullptr;
+    }
+}
+
+VirtioQueue::~VirtioQueue()
+{
+    delete[] _cookies;
+}
+
+bool VirtioQueue::push(const VirtioBuffer *buffers, size_t count, void *cookie)
+{
+    assert(count > 0);
+
+    if (count > _free_count)
+    {
+        return false;
+    }
+
+    uint16_t head = _free_head;
+
+    // The free list already chains the descriptors in the order we take them.
+    for (size_t i = 0; i < count; i++)
+    {
+        VirtqDescriptor &descriptor = _descriptors[_free_head];
+        _free_head = descriptor.next;
+
+        descriptor.address = buffers[i].address;
+        descriptor.length = buffers[i].size;
+        descriptor.flags = (buffers[i].writable ? VIRTQ_DESC_F_WRITE : 0) |
+                           (i + 1 < count ? VIRTQ_DESC_F_NEXT : 0);
+    }
+
+    _free_count -= count;
+
+    _cookies[head] = cookie;
+
+    _available_ring[*_available_index % _size] = head;
+
+    // The device must see the ring entry before the new index.
+    __sync_synchronize();
+    *_available_index = *_available_index + 1;
+    __sync_synchronize();
+
+    return true;
+}
+
+void *VirtioQueue::pop(uint32_t *length)
+{
+    if (_last_used == *_used_index)
+    {
+        return nullptr;
+    }
+
+    // Don't read the element before seeing the index which covers it.
+    __sync_synchronize();
+
+    volatile VirtqUsedElement &element = _used_ring[_last_used % _size];
+    _last_used++;
+
+    uint16_t head = element.id;
+    *length = element.length;
+
+    void *cookie = _cookies[head];
+    _cookies[head] = nullptr;
+
+    // Give the chain back to the free list.
+    uint16_t last = head;
+    _free_count++;
+
+    while (_descriptors[last].flags & VIRTQ_DESC_F_NEXT)
+    {
+        last = _descriptors[last].next;
+        _free_count++;
+    }
+
+    _descriptors[last].next = _free_head;
+    _free_head = head;
+
+    return cookie;
+}
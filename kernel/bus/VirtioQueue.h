@@ -0,0 +1,82 @@
+#pragma once
+
+#include <libutils/RefPtr.h>
+
+#include "kernel/memory/MMIO.h"
+
+// 2.6 Split Virtqueues, laid out as legacy devices expect them: the
+// descriptors, the available ring, then the used ring on the next page.
+
+#define VIRTQ_DESC_F_NEXT (1)
+#define VIRTQ_DESC_F_WRITE (2)
+
+#define VIRTQ_ALIGN (4096)
+
+struct __packed VirtqDescriptor
+{
+    uint64_t address;
+    uint32_t length;
+    uint16_t flags;
+    uint16_t next;
+};
+
+struct __packed VirtqUsedElement
+{
+    uint32_t id;
+    uint32_t length;
+};
+
+struct VirtioBuffer
+{
+    uintptr_t address;
+    size_t size;
+
+    // Written by the device rather than read.
+    bool writable;
+};
+
+class VirtioQueue
+{
+private:
+    RefPtr<MMIORange> _range;
+    uint16_t _size;
+
+    VirtqDescriptor *_descriptors;
+
+    volatile uint16_t *_available_index;
+    volatile uint16_t *_available_ring;
+
+    volatile uint16_t *_used_index;
+    volatile VirtqUsedElement *_used_ring;
+
+    // Unused descriptors are chained through their next field.
+    uint16_t _free_head = 0;
+    uint16_t _free_count = 0;
+
+    uint16_t _last_used = 0;
+
+    // Handed back by pop() for each chain.
+    void **_cookies;
+
+    __noncopyable(VirtioQueue);
+    __nonmovable(VirtioQueue);
+
+public:
+    uint16_t size() { return _size; }
+
+    uint16_t free_count() { return _free_count; }
+
+    uintptr_t physical_base() { return _range->physical_base(); }
+
+    VirtioQueue(uint16_t size);
+
+    ~VirtioQueue();
+
+    // Chain the buffers and make them available to the device, return false
+    // if there aren't enough free descriptors. The device still has to be
+    // notified.
+    bool push(const VirtioBuffer *buffers, size_t count, void *cookie);
+
+    // The cookie of the next chain the device is done with, or null.
+    void *pop(uint32_t *length);
+};
@@ -9,6 +9,7 @@
 #include "kernel/devices/DeviceAddress.h"
 #include "kernel/devices/DeviceClass.h"
 #include "kernel/node/Handle.h"
+#include "kernel/tasking/Task.h"
 
 class Device : public RefCounted<Device>
 {
@@ -50,6 +51,12 @@ public:
 
     virtual void handle_interrupt() {}
 
+    // Devices which can't wait behind the handlers of the others get a task
+    // of their own for their interrupts, at that priority.
+    virtual bool interrupt_threaded() { return false; }
+
+    virtual TaskPriority interrupt_priority() { return TASK_PRIORITY_HIGH; }
+
     virtual bool can_read(FsHandle &handle)
     {
         __unused(handle);
@@ -9,6 +9,7 @@
 #include "kernel/bus/UNIX.h"
 #include "kernel/devices/Devices.h"
 #include "kernel/devices/Driver.h"
+#include "kernel/interrupts/Dispatcher.h"
 
 static Vector<RefPtr<Device>> *_devices = nullptr;
 
@@ -103,7 +104,14 @@ void device_initialize()
 
         logger_info("Found a driver: %s", driver->name());
 
-        _devices->push_back(driver->instance(address));
+        auto device = driver->instance(address);
+
+        if (device->interrupt_threaded() && device->interrupt() != -1)
+        {
+            dispatcher_thread(device->interrupt(), device->interrupt_priority());
+        }
+
+        _devices->push_back(device);
 
         return Iteration::CONTINUE;
     });
@@ -79,6 +79,13 @@ public:
         _interrupt = pci_get_interrupt(pci_address());
     }
 
+    // Let the device access memory by itself, needed for DMA.
+    void enable_bus_mastering()
+    {
+        uint16_t command = pci_address().read16(PCI_COMMAND);
+        pci_address().write16(PCI_COMMAND, command | PCI_COMMAND_BUS_MASTER);
+    }
+
     PCIBar bar(int index)
     {
         assert(index >= 0 && index <= 5);
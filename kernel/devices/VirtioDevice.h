@@ -1,19 +1,103 @@
 #pragma once
 
+#include "arch/x86/kernel/IOPort.h"
+
 #include "kernel/bus/Virtio.h"
+#include "kernel/bus/VirtioQueue.h"
 #include "kernel/devices/PCIDevice.h"
 
+// Drives the legacy interface, through the I/O ports of the first BAR, which
+// transitional devices like QEMU's still offer.
 class VirtioDevice : public PCIDevice
 {
 private:
+    uint16_t _io_base = 0;
+
 public:
+    bool legacy() { return _io_base != 0; }
+
     VirtioDevice(DeviceAddress address, DeviceClass klass) : PCIDevice(address, klass)
     {
+        uint32_t bar0 = pci_address().read32(PCI_BAR0);
+
+        if (bar0 & 0b1)
+        {
+            _io_base = bar0 & 0xFFFC;
+        }
     }
 
     ~VirtioDevice()
     {
     }
+
+    uint8_t read_register8(uint16_t offset) { return in8(_io_base + offset); }
+
+    uint16_t read_register16(uint16_t offset) { return in16(_io_base + offset); }
+
+    uint32_t read_register32(uint16_t offset) { return in32(_io_base + offset); }
+
+    void write_register8(uint16_t offset, uint8_t value) { out8(_io_base + offset, value); }
+
+    void write_register16(uint16_t offset, uint16_t value) { out16(_io_base + offset, value); }
+
+    void write_register32(uint16_t offset, uint32_t value) { out32(_io_base + offset, value); }
+
+    uint32_t read_config32(uint16_t offset) { return read_register32(VIRTIO_REGISTER_DEVICE_CONFIG + offset); }
+
+    uint64_t read_config64(uint16_t offset)
+    {
+        return read_config32(offset) | ((uint64_t)read_config32(offset + 4) << 32);
+    }
+
+    // 3.1.1 Driver Requirements: Device Initialization, up to telling the
+    // device which of its features we use. Return them.
+    uint32_t negotiate_features(uint32_t supported)
+    {
+        enable_bus_mastering();
+
+        write_register8(VIRTIO_REGISTER_DEVICE_STATUS, 0);
+        write_register8(VIRTIO_REGISTER_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+        write_register8(VIRTIO_REGISTER_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+        uint32_t features = read_register32(VIRTIO_REGISTER_DEVICE_FEATURES) & supported;
+        write_register32(VIRTIO_REGISTER_GUEST_FEATURES, features);
+
+        return features;
+    }
+
+    // Legacy devices choose the size of their queues, 0 if there is none.
+    uint16_t queue_size(uint16_t index)
+    {
+        write_register16(VIRTIO_REGISTER_QUEUE_SELECT, index);
+        return read_register16(VIRTIO_REGISTER_QUEUE_SIZE);
+    }
+
+    void queue_attach(uint16_t index, VirtioQueue &queue)
+    {
+        write_register16(VIRTIO_REGISTER_QUEUE_SELECT, index);
+        write_register32(VIRTIO_REGISTER_QUEUE_ADDRESS, queue.physical_base() / VIRTQ_ALIGN);
+    }
+
+    void queue_notify(uint16_t index)
+    {
+        write_register16(VIRTIO_REGISTER_QUEUE_NOTIFY, index);
+    }
+
+    void driver_ok()
+    {
+        write_register8(VIRTIO_REGISTER_DEVICE_STATUS, read_register8(VIRTIO_REGISTER_DEVICE_STATUS) | VIRTIO_STATUS_DRIVER_OK);
+    }
+
+    void failed()
+    {
+        write_register8(VIRTIO_REGISTER_DEVICE_STATUS, read_register8(VIRTIO_REGISTER_DEVICE_STATUS) | VIRTIO_STATUS_FAILED);
+    }
+
+    // Reading it acknowledges the interrupt.
+    uint8_t interrupt_status()
+    {
+        return read_register8(VIRTIO_REGISTER_ISR_STATUS);
+    }
 };
 
 template <typename VirtioDeviceType>
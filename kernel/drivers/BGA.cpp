@@ -36,12 +36,118 @@ Result BGA::set_resolution(int width, int height)
         _width = width;
         _height = height;
 
+        // The compositor has to flip again to get back to double buffering.
+        _double_buffered = false;
+        _back_page = 0;
+        _last_blit = {};
+        _damages_count = 0;
+
         logger_info("Resolution set to %dx%d.", width, height);
 
         return SUCCESS;
     }
 }
 
+uintptr_t BGA::page(int index)
+{
+    return _framebuffer->base() + index * _width * _height * sizeof(uint32_t);
+}
+
+void BGA::wait_vertical_retrace()
+{
+    // Bounded, some emulators never report the retrace.
+    for (int i = 0; i < 100000 && (in8(VGA_INPUT_STATUS) & VGA_VERTICAL_RETRACE); i++)
+    {
+    }
+
+    for (int i = 0; i < 100000 && !(in8(VGA_INPUT_STATUS) & VGA_VERTICAL_RETRACE); i++)
+    {
+    }
+}
+
+void BGA::damage(IOCallDisplayBlitArgs *blit)
+{
+    _last_blit = *blit;
+
+    if (_damages_count < BGA_DAMAGE_COUNT)
+    {
+        _damages[_damages_count] = *blit;
+        _damages_count++;
+        return;
+    }
+
+    // Too many rectangles, replay their bounding box instead.
+    IOCallDisplayBlitArgs &bound = _damages[0];
+
+    for (size_t i = 1; i < _damages_count; i++)
+    {
+        int right = MAX(bound.blit_x + bound.blit_width, _damages[i].blit_x + _damages[i].blit_width);
+        int bottom = MAX(bound.blit_y + bound.blit_height, _damages[i].blit_y + _damages[i].blit_height);
+
+        bound.blit_x = MIN(bound.blit_x, _damages[i].blit_x);
+        bound.blit_y = MIN(bound.blit_y, _damages[i].blit_y);
+        bound.blit_width = right - bound.blit_x;
+        bound.blit_height = bottom - bound.blit_y;
+    }
+
+    _damages_count = 1;
+
+    damage(blit);
+}
+
+Result BGA::flip()
+{
+    if (_last_blit.buffer == nullptr)
+    {
+        return SUCCESS;
+    }
+
+    if (!_double_buffered)
+    {
+        if (2 * _width * _height * sizeof(uint32_t) > _framebuffer->size())
+        {
+            return ERR_INAPPROPRIATE_CALL_FOR_DEVICE;
+        }
+
+        // The displayed page is up to date, the other one has to be filled
+        // from the last buffer the compositor gave us before showing it.
+        IOCallDisplayBlitArgs full = _last_blit;
+        full.blit_x = 0;
+        full.blit_y = 0;
+        full.blit_width = _width;
+        full.blit_height = _height;
+
+        Result result = graphic_blit(page(1), _width * sizeof(uint32_t), _width, _height, &full);
+
+        if (result != SUCCESS)
+        {
+            return result;
+        }
+
+        write_register(BGA_REG_VIRT_HEIGHT, _height * 2);
+
+        _double_buffered = true;
+        _back_page = 1;
+        _damages_count = 0;
+    }
+
+    wait_vertical_retrace();
+
+    write_register(BGA_REG_Y_OFFSET, _back_page * _height);
+
+    _back_page = !_back_page;
+
+    // Bring the new back page up to date with what we just displayed.
+    for (size_t i = 0; i < _damages_count; i++)
+    {
+        graphic_blit(page(_back_page), _width * sizeof(uint32_t), _width, _height, &_damages[i]);
+    }
+
+    _damages_count = 0;
+
+    return SUCCESS;
+}
+
 BGA::BGA(DeviceAddress address) : PCIDevice(address, DeviceClass::FRAMEBUFFER)
 {
     _framebuffer = make<MMIORange>(bar(0).range());
@@ -96,21 +202,18 @@ Result BGA::call(FsHandle &handle, IOCall request, void *args)
     {
         IOCallDisplayBlitArgs *blit = (IOCallDisplayBlitArgs *)args;
 
-        for (int y = MAX(0, blit->blit_y); y < MIN(_height, blit->blit_y + blit->blit_height); y++)
-        {
-            for (int x = MAX(0, blit->blit_x); x < MIN(_width, blit->blit_x + blit->blit_width); x++)
-            {
-                uint32_t pixel = blit->buffer[y * blit->buffer_width + x];
-
-                uint32_t converted_pixel = ((pixel >> 16) & 0x000000ff) |
-                                           ((pixel)&0xff00ff00) |
-                                           ((pixel << 16) & 0x00ff0000);
+        Result result = graphic_blit(page(_back_page), _width * sizeof(uint32_t), _width, _height, blit);
 
-                _framebuffer->write32((y * _width + x) * sizeof(uint32_t), converted_pixel);
-            }
+        if (result == SUCCESS)
+        {
+            damage(blit);
         }
 
-        return SUCCESS;
+        return result;
+    }
+    else if (request == IOCALL_DISPLAY_FLIP)
+    {
+        return flip();
     }
     else
     {
@@ -10,11 +10,21 @@
 #define BGA_REG_YRES 0x2
 #define BGA_REG_BPP 0x3
 #define BGA_REG_ENABLE 0x4
+#define BGA_REG_VIRT_WIDTH 0x6
+#define BGA_REG_VIRT_HEIGHT 0x7
+#define BGA_REG_X_OFFSET 0x8
+#define BGA_REG_Y_OFFSET 0x9
 
 #define BGA_DISABLED 0x00
 #define BGA_ENABLED 0x01
 #define BGA_LINEAR_FRAMEBUFFER 0x40
 
+#define VGA_INPUT_STATUS 0x3DA
+#define VGA_VERTICAL_RETRACE 0x08
+
+// Rectangles blitted since the last flip, replayed in the other page after it.
+#define BGA_DAMAGE_COUNT 16
+
 class BGA : public PCIDevice
 {
 private:
@@ -23,11 +33,28 @@ private:
 
     RefPtr<MMIORange> _framebuffer;
 
+    // Once the compositor starts flipping, the framebuffer is split in two
+    // pages and blits go to the one that isn't displayed.
+    bool _double_buffered = false;
+    int _back_page = 0;
+
+    IOCallDisplayBlitArgs _last_blit = {};
+    IOCallDisplayBlitArgs _damages[BGA_DAMAGE_COUNT] = {};
+    size_t _damages_count = 0;
+
     void write_register(uint16_t address, uint16_t data);
     uint16_t read_register(uint16_t address);
 
     Result set_resolution(int width, int height);
 
+    uintptr_t page(int index);
+
+    void wait_vertical_retrace();
+
+    void damage(IOCallDisplayBlitArgs *blit);
+
+    Result flip();
+
 public:
     BGA(DeviceAddress address);
 
@@ -147,6 +147,10 @@ public:
 
     void handle_interrupt() override;
 
+    bool interrupt_threaded() override { return true; }
+
+    TaskPriority interrupt_priority() override { return TASK_PRIORITY_NORMAL; }
+
     bool can_write(FsHandle &handle) override;
 
     bool can_read(FsHandle &handle) override;
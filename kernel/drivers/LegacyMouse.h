@@ -29,6 +29,8 @@ public:
 
     void handle_interrupt() override;
 
+    bool interrupt_threaded() override { return true; }
+
     bool can_read(FsHandle &handle) override;
 
     ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size);
@@ -1 +1,511 @@
+#include <libsystem/Logger.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/thread/Atomic.h>
+
 #include "kernel/drivers/VirtioBlock.h"
+#include "kernel/scheduling/Blocker.h"
+#include "kernel/scheduling/Scheduler.h"
+
+// Woken up by VirtioBlock::reap(), never polled.
+class BlockerVirtioBlock : public Blocker
+{
+private:
+    VirtioBlockOperation &_operation;
+
+public:
+    BlockerVirtioBlock(VirtioBlockOperation &operation) : _operation(operation) {}
+
+    bool can_unblock(struct Task *task)
+    {
+        __unused(task);
+
+        return _operation.done;
+    }
+
+    bool subscribe(struct Task *task)
+    {
+        __unused(task);
+
+        return true;
+    }
+};
+
+// Only when other tasks hold every slot, this one is polled.
+class BlockerVirtioSlot : public Blocker
+{
+private:
+    uint32_t &_free_slots;
+
+public:
+    BlockerVirtioSlot(uint32_t &free_slots) : _free_slots(free_slots) {}
+
+    bool can_unblock(struct Task *task)
+    {
+        __unused(task);
+
+        return _free_slots != 0;
+    }
+};
+
+VirtioBlock::VirtioBlock(DeviceAddress address) : VirtioDevice(address, DeviceClass::DISK)
+{
+    if (!legacy())
+    {
+        logger_warn("The block device has no legacy interface, leaving it offline");
+        return;
+    }
+
+    uint32_t features = negotiate_features(VIRTIO_BLOCK_FEATURE_SEG_MAX | VIRTIO_BLOCK_FEATURE_READ_ONLY);
+
+    _capacity = read_config64(VIRTIO_BLOCK_CONFIG_CAPACITY);
+    _read_only = features & VIRTIO_BLOCK_FEATURE_READ_ONLY;
+
+    // Without it, the device might take a single data segment per request.
+    if (features & VIRTIO_BLOCK_FEATURE_SEG_MAX)
+    {
+        _merge_max = MIN(MAX(read_config32(VIRTIO_BLOCK_CONFIG_SEG_MAX), 1u), (uint32_t)VIRTIO_BLOCK_MERGE_MAX);
+    }
+
+    uint16_t size = queue_size(0);
+
+    if (size == 0)
+    {
+        logger_error("The block device has no request queue");
+        failed();
+        return;
+    }
+
+    _queue = own<VirtioQueue>(size);
+    queue_attach(0, *_queue);
+
+    _commands = make<MMIORange>(sizeof(VirtioBlockCommand) * VIRTIO_BLOCK_SLOT_COUNT);
+    _buffers = make<MMIORange>(VIRTIO_BLOCK_SLOT_SIZE * VIRTIO_BLOCK_SLOT_COUNT);
+    _free_slots = (1u << VIRTIO_BLOCK_SLOT_COUNT) - 1;
+
+    driver_ok();
+
+    logger_info("Block device of %d sectors, %d deep queue", (int)_capacity, size);
+}
+
+VirtioBlockCommand &VirtioBlock::command(int slot)
+{
+    return reinterpret_cast<VirtioBlockCommand *>(_commands->base())[slot];
+}
+
+uintptr_t VirtioBlock::command_physical(int slot)
+{
+    return _commands->physical_base() + sizeof(VirtioBlockCommand) * slot;
+}
+
+int VirtioBlock::acquire_slot(bool wait)
+{
+    while (true)
+    {
+        atomic_begin();
+
+        if (!_free_slots)
+        {
+            release_abandoned_slots();
+        }
+
+        if (_free_slots)
+        {
+            int slot = __builtin_ctz(_free_slots);
+            _free_slots &= ~(1u << slot);
+
+            // Don't let release_abandoned_slots() take it back from us.
+            _operations[slot].task = scheduler_running_id();
+            _operations[slot].done = false;
+
+            atomic_end();
+
+            return slot;
+        }
+
+        atomic_end();
+
+        if (!wait)
+        {
+            return -1;
+        }
+
+        BlockerVirtioSlot blocker{_free_slots};
+        task_block(scheduler_running(), blocker, -1);
+    }
+}
+
+void VirtioBlock::release_slot(int slot)
+{
+    AtomicHolder holder;
+
+    _free_slots |= 1u << slot;
+}
+
+static Task *virtio_block_waiter(VirtioBlockOperation &operation)
+{
+    ASSERT_ATOMIC;
+
+    Task *task = task_by_id(operation.task);
+
+    if (task == nullptr || task->state() == TASK_STATE_CANCELED)
+    {
+        return nullptr;
+    }
+
+    return task;
+}
+
+void VirtioBlock::release_abandoned_slots()
+{
+    ASSERT_ATOMIC;
+
+    // Nobody is left to copy the data and give these back. Operations still
+    // pending or in flight are released once the device is done with them.
+    for (int slot = 0; slot < VIRTIO_BLOCK_SLOT_COUNT; slot++)
+    {
+        if (!(_free_slots & (1u << slot)) &&
+            _operations[slot].done &&
+            virtio_block_waiter(_operations[slot]) == nullptr)
+        {
+            _free_slots |= 1u << slot;
+        }
+    }
+}
+
+void VirtioBlock::enqueue(VirtioBlockOperation &operation)
+{
+    ASSERT_ATOMIC;
+
+    // Every operation holds a slot, so there is always room.
+    size_t index = _pending_count;
+
+    while (index > 0 && _pending[index - 1]->sector > operation.sector)
+    {
+        _pending[index] = _pending[index - 1];
+        index--;
+    }
+
+    _pending[index] = &operation;
+    _pending_count++;
+}
+
+bool VirtioBlock::submit(VirtioBlockOperation **operations, size_t count)
+{
+    VirtioBlockOperation *first = operations[0];
+
+    VirtioBlockCommand &request_command = command(first->slot);
+    request_command.header = {first->type, 0, first->sector};
+    request_command.status = 0xFF;
+
+    VirtioBuffer buffers[VIRTIO_BLOCK_MERGE_MAX + 2];
+
+    buffers[0] = {command_physical(first->slot), sizeof(VirtioBlockHeader), false};
+
+    for (size_t i = 0; i < count; i++)
+    {
+        buffers[i + 1] = {
+            _buffers->physical_base() + VIRTIO_BLOCK_SLOT_SIZE * operations[i]->slot,
+            operations[i]->count * VIRTIO_BLOCK_SECTOR_SIZE,
+            first->type == VIRTIO_BLOCK_REQUEST_IN,
+        };
+    }
+
+    buffers[count + 1] = {command_physical(first->slot) + sizeof(VirtioBlockHeader), 1, true};
+
+    VirtioBlockRequest &request = _requests[first->slot];
+
+    for (size_t i = 0; i < count; i++)
+    {
+        request.operations[i] = operations[i];
+    }
+
+    request.count = count;
+
+    return _queue->push(buffers, count + 2, &request);
+}
+
+void VirtioBlock::dispatch()
+{
+    ASSERT_ATOMIC;
+
+    size_t submitted = 0;
+
+    while (submitted < _pending_count)
+    {
+        // The pending operations are sorted, so runs of adjacent ones going
+        // the same way are next to each other.
+        size_t count = 1;
+
+        while (submitted + count < _pending_count && count < _merge_max)
+        {
+            VirtioBlockOperation *previous = _pending[submitted + count - 1];
+            VirtioBlockOperation *next = _pending[submitted + count];
+
+            if (next->type != previous->type || next->sector != previous->sector + previous->count)
+            {
+                break;
+            }
+
+            count++;
+        }
+
+        if (!submit(&_pending[submitted], count))
+        {
+            break;
+        }
+
+        submitted += count;
+    }
+
+    if (submitted == 0)
+    {
+        return;
+    }
+
+    for (size_t i = submitted; i < _pending_count; i++)
+    {
+        _pending[i - submitted] = _pending[i];
+    }
+
+    _pending_count -= submitted;
+
+    // A single notification for everything we just made available.
+    queue_notify(0);
+}
+
+void VirtioBlock::reap()
+{
+    ASSERT_ATOMIC;
+
+    uint32_t length;
+    VirtioBlockRequest *request;
+
+    while ((request = reinterpret_cast<VirtioBlockRequest *>(_queue->pop(&length))))
+    {
+        bool failed = command(request->operations[0]->slot).status != VIRTIO_BLOCK_STATUS_OK;
+
+        for (size_t i = 0; i < request->count; i++)
+        {
+            VirtioBlockOperation *operation = request->operations[i];
+
+            operation->failed = failed;
+            operation->done = true;
+
+            Task *task = virtio_block_waiter(*operation);
+
+            if (task && task->state() == TASK_STATE_BLOCKED)
+            {
+                scheduler_try_unblock(task);
+            }
+        }
+    }
+
+    release_abandoned_slots();
+
+    // The descriptors we got back might be enough for what is still pending.
+    dispatch();
+}
+
+void VirtioBlock::wait(VirtioBlockOperation &operation)
+{
+    BlockerVirtioBlock blocker{operation};
+
+    while (task_block(scheduler_running(), blocker, VIRTIO_BLOCK_TIMEOUT) == BLOCKER_TIMEOUT)
+    {
+        AtomicHolder holder;
+
+        reap();
+    }
+}
+
+void VirtioBlock::handle_interrupt()
+{
+    if (!_queue)
+    {
+        return;
+    }
+
+    AtomicHolder holder;
+
+    // The line might be shared, the queue is looked at anyway.
+    interrupt_status();
+
+    reap();
+}
+
+ResultOr<size_t> VirtioBlock::transfer(uint32_t type, size_t offset, void *buffer, size_t size)
+{
+    uint64_t disk_size = _capacity * VIRTIO_BLOCK_SECTOR_SIZE;
+
+    if (offset >= disk_size)
+    {
+        return 0;
+    }
+
+    size = MIN(size, disk_size - offset);
+
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    uint64_t first_sector = offset / VIRTIO_BLOCK_SECTOR_SIZE;
+    uint64_t end_sector = ((uint64_t)offset + size + VIRTIO_BLOCK_SECTOR_SIZE - 1) / VIRTIO_BLOCK_SECTOR_SIZE;
+
+    size_t chunk_count = (end_sector - first_sector + VIRTIO_BLOCK_SLOT_SECTORS - 1) / VIRTIO_BLOCK_SLOT_SECTORS;
+
+    // A window over the slots of our chunks, as many as there are slots
+    // are in flight. The operations themselves stay with the device, which
+    // still needs them if we get cancelled.
+    int slots[VIRTIO_BLOCK_SLOT_COUNT];
+
+    size_t submitted = 0;
+    size_t completed = 0;
+    bool failed = false;
+
+    while (completed < chunk_count)
+    {
+        while (submitted < chunk_count && !failed)
+        {
+            // Only wait for a slot when none of our chunks is in flight.
+            int slot = acquire_slot(submitted == completed);
+
+            if (slot == -1)
+            {
+                break;
+            }
+
+            slots[submitted % VIRTIO_BLOCK_SLOT_COUNT] = slot;
+
+            VirtioBlockOperation &operation = _operations[slot];
+
+            operation.type = type;
+            operation.sector = first_sector + submitted * VIRTIO_BLOCK_SLOT_SECTORS;
+            operation.count = MIN((uint64_t)VIRTIO_BLOCK_SLOT_SECTORS, end_sector - operation.sector);
+            operation.slot = slot;
+            operation.failed = false;
+
+            if (type == VIRTIO_BLOCK_REQUEST_OUT)
+            {
+                uint64_t chunk_start = operation.sector * VIRTIO_BLOCK_SECTOR_SIZE;
+                uint64_t chunk_end = chunk_start + operation.count * VIRTIO_BLOCK_SECTOR_SIZE;
+
+                uint64_t copy_start = MAX((uint64_t)offset, chunk_start);
+                uint64_t copy_end = MIN((uint64_t)offset + size, chunk_end);
+
+                // Partial sectors at the edges keep what is on the disk.
+                if (copy_start != chunk_start || copy_end != chunk_end)
+                {
+                    operation.type = VIRTIO_BLOCK_REQUEST_IN;
+
+                    atomic_begin();
+                    enqueue(operation);
+                    dispatch();
+                    atomic_end();
+
+                    wait(operation);
+
+                    operation.type = VIRTIO_BLOCK_REQUEST_OUT;
+                    operation.done = false;
+
+                    if (operation.failed)
+                    {
+                        release_slot(slot);
+                        failed = true;
+                        break;
+                    }
+                }
+
+                memcpy((void *)(_buffers->base() + VIRTIO_BLOCK_SLOT_SIZE * slot + (copy_start - chunk_start)),
+                       (char *)buffer + (copy_start - offset),
+                       copy_end - copy_start);
+            }
+
+            atomic_begin();
+            enqueue(operation);
+            atomic_end();
+
+            submitted++;
+        }
+
+        atomic_begin();
+        dispatch();
+        atomic_end();
+
+        if (completed == submitted)
+        {
+            // Failed before anything else got in flight.
+            break;
+        }
+
+        VirtioBlockOperation &operation = _operations[slots[completed % VIRTIO_BLOCK_SLOT_COUNT]];
+
+        wait(operation);
+
+        if (operation.failed)
+        {
+            failed = true;
+        }
+        else if (type == VIRTIO_BLOCK_REQUEST_IN)
+        {
+            uint64_t chunk_start = operation.sector * VIRTIO_BLOCK_SECTOR_SIZE;
+            uint64_t chunk_end = chunk_start + operation.count * VIRTIO_BLOCK_SECTOR_SIZE;
+
+            uint64_t copy_start = MAX((uint64_t)offset, chunk_start);
+            uint64_t copy_end = MIN((uint64_t)offset + size, chunk_end);
+
+            memcpy((char *)buffer + (copy_start - offset),
+                   (void *)(_buffers->base() + VIRTIO_BLOCK_SLOT_SIZE * operation.slot + (copy_start - chunk_start)),
+                   copy_end - copy_start);
+        }
+
+        release_slot(operation.slot);
+        completed++;
+
+        // Don't start anything new, but let what is in flight land.
+        if (failed)
+        {
+            chunk_count = submitted;
+        }
+    }
+
+    if (failed)
+    {
+        return type == VIRTIO_BLOCK_REQUEST_IN ? ERR_NOT_READABLE : ERR_NOT_WRITABLE;
+    }
+
+    return size;
+}
+
+size_t VirtioBlock::size(FsHandle &handle)
+{
+    __unused(handle);
+
+    return MIN(_capacity * VIRTIO_BLOCK_SECTOR_SIZE, (uint64_t)(size_t)-1);
+}
+
+ResultOr<size_t> VirtioBlock::read(FsHandle &handle, void *buffer, size_t size)
+{
+    if (!_queue)
+    {
+        return ERR_NOT_READABLE;
+    }
+
+    return transfer(VIRTIO_BLOCK_REQUEST_IN, handle.offset, buffer, size);
+}
+
+ResultOr<size_t> VirtioBlock::write(FsHandle &handle, const void *buffer, size_t size)
+{
+    if (!_queue)
+    {
+        return ERR_NOT_WRITABLE;
+    }
+
+    if (_read_only)
+    {
+        return ERR_READ_ONLY_STREAM;
+    }
+
+    return transfer(VIRTIO_BLOCK_REQUEST_OUT, handle.offset, const_cast<void *>(buffer), size);
+}
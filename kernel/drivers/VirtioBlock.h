@@ -1,16 +1,129 @@
 #pragma once
 
+#include <libutils/OwnPtr.h>
+
 #include "kernel/devices/VirtioDevice.h"
 
+// 5.2 Block Device
+
+#define VIRTIO_BLOCK_FEATURE_SEG_MAX (1 << 2)
+#define VIRTIO_BLOCK_FEATURE_READ_ONLY (1 << 5)
+
+#define VIRTIO_BLOCK_CONFIG_CAPACITY (0x00)
+#define VIRTIO_BLOCK_CONFIG_SEG_MAX (0x0C)
+
+#define VIRTIO_BLOCK_REQUEST_IN (0)
+#define VIRTIO_BLOCK_REQUEST_OUT (1)
+
+#define VIRTIO_BLOCK_STATUS_OK (0)
+
+#define VIRTIO_BLOCK_SECTOR_SIZE (512)
+
+// Operations in flight at once, each one with a DMA buffer of its own.
+#define VIRTIO_BLOCK_SLOT_COUNT (16)
+#define VIRTIO_BLOCK_SLOT_SIZE (64 * 1024)
+#define VIRTIO_BLOCK_SLOT_SECTORS (VIRTIO_BLOCK_SLOT_SIZE / VIRTIO_BLOCK_SECTOR_SIZE)
+
+// Adjacent operations going out as one request, a data descriptor each.
+#define VIRTIO_BLOCK_MERGE_MAX (8)
+
+// In milliseconds, in case an interrupt got lost waiters look at the queue
+// themselves.
+#define VIRTIO_BLOCK_TIMEOUT (100)
+
+struct __packed VirtioBlockHeader
+{
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+};
+
+// Where the device reads the header and writes the status of a request,
+// there is one per slot.
+struct __packed VirtioBlockCommand
+{
+    VirtioBlockHeader header;
+    uint8_t status;
+    uint8_t padding[15];
+};
+
+struct VirtioBlockOperation
+{
+    uint32_t type;
+    uint64_t sector;
+    size_t count;
+    int slot;
+
+    // Woken up when the device is done with it. By id, the task might be
+    // cancelled while it waits.
+    int task;
+    bool done;
+    bool failed;
+};
+
+// Keyed by the slot of its first operation.
+struct VirtioBlockRequest
+{
+    VirtioBlockOperation *operations[VIRTIO_BLOCK_MERGE_MAX];
+    size_t count;
+};
+
 class VirtioBlock : public VirtioDevice
 {
 private:
+    uint64_t _capacity = 0;
+    bool _read_only = false;
+    size_t _merge_max = 1;
+
+    OwnPtr<VirtioQueue> _queue{};
+
+    RefPtr<MMIORange> _commands{};
+    RefPtr<MMIORange> _buffers{};
+
+    uint32_t _free_slots = 0;
+    VirtioBlockOperation _operations[VIRTIO_BLOCK_SLOT_COUNT] = {};
+    VirtioBlockRequest _requests[VIRTIO_BLOCK_SLOT_COUNT] = {};
+
+    // Waiting for room in the queue, sorted by sector.
+    VirtioBlockOperation *_pending[VIRTIO_BLOCK_SLOT_COUNT] = {};
+    size_t _pending_count = 0;
+
+    VirtioBlockCommand &command(int slot);
+
+    uintptr_t command_physical(int slot);
+
+    int acquire_slot(bool wait);
+
+    void release_slot(int slot);
+
+    void release_abandoned_slots();
+
+    void enqueue(VirtioBlockOperation &operation);
+
+    bool submit(VirtioBlockOperation **operations, size_t count);
+
+    void dispatch();
+
+    void reap();
+
+    void wait(VirtioBlockOperation &operation);
+
+    ResultOr<size_t> transfer(uint32_t type, size_t offset, void *buffer, size_t size);
+
 public:
-    VirtioBlock(DeviceAddress address) : VirtioDevice(address, DeviceClass::DISK)
-    {
-    }
+    VirtioBlock(DeviceAddress address);
 
     ~VirtioBlock()
     {
     }
+
+    void handle_interrupt() override;
+
+    bool interrupt_threaded() override { return true; }
+
+    size_t size(FsHandle &handle) override;
+
+    ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size) override;
+
+    ResultOr<size_t> write(FsHandle &handle, const void *buffer, size_t size) override;
 };
@@ -22,6 +22,13 @@ public:
     {
     }
 
+    bool is_polled() override
+    {
+        // Devices change state from their interrupt handlers or straight
+        // from the hardware, so we can't know when to wake up waiters.
+        return true;
+    }
+
     bool can_read(FsHandle *handle) override
     {
         return _device->can_read(*handle);
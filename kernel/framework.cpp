@@ -18,6 +18,7 @@
 #include "kernel/system/System.h"
 #include "kernel/tasking/Task-Directory.h"
 #include "kernel/tasking/Task-Handles.h"
+#include "kernel/tasking/Task-IORing.h"
 #include "kernel/tasking/Task-Lanchpad.h"
 #include "kernel/tasking/Task-Memory.h"
 
@@ -273,6 +274,11 @@ void __plug_handle_accept(Handle *handle, Handle *connection_handle)
     handle->result = task_fshandle_accept(scheduler_running(), handle->id, &connection_handle->id);
 }
 
+Result __plug_handle_submit(IORing *ring, size_t wait_for, Timeout timeout)
+{
+    return task_io_ring_submit(scheduler_running(), ring, wait_for, timeout);
+}
+
 Result __plug_create_pipe(int *reader_handle, int *writer_handle)
 {
     return task_create_pipe(scheduler_running(), reader_handle, writer_handle);
@@ -282,3 +288,23 @@ Result __plug_create_term(int *master_handle, int *slave_handle)
 {
     return task_create_term(scheduler_running(), master_handle, slave_handle);
 }
+
+Result __plug_create_poll(int *poll_handle)
+{
+    return task_create_poll(scheduler_running(), poll_handle);
+}
+
+Result __plug_poll_add(int poll_handle, int handle, SelectEvent events, uintptr_t user_data)
+{
+    return task_poll_add(scheduler_running(), poll_handle, handle, events, user_data);
+}
+
+Result __plug_poll_remove(int poll_handle, int handle)
+{
+    return task_poll_remove(scheduler_running(), poll_handle, handle);
+}
+
+Result __plug_poll_wait(int poll_handle, PollEvent *events, size_t count, size_t *ready, Timeout timeout)
+{
+    return task_poll_wait(scheduler_running(), poll_handle, events, count, ready, timeout);
+}
@@ -1,7 +1,6 @@
 #include <abi/Paths.h>
 
 #include <libsystem/Logger.h>
-#include <libsystem/math/MinMax.h>
 #include <libsystem/thread/Atomic.h>
 
 #include "arch/VirtualMemory.h"
@@ -45,23 +44,7 @@ public:
         {
             IOCallDisplayBlitArgs *blit = (IOCallDisplayBlitArgs *)args;
 
-            AtomicHolder holder;
-
-            for (int y = MAX(0, blit->blit_y); y < MIN(_framebuffer_height, blit->blit_y + blit->blit_height); y++)
-            {
-                for (int x = MAX(0, blit->blit_x); x < MIN(_framebuffer_width, blit->blit_x + blit->blit_width); x++)
-                {
-                    uint32_t pixel = blit->buffer[y * blit->buffer_width + x];
-
-                    uint32_t converted_pixel = ((pixel >> 16) & 0x000000ff) |
-                                               ((pixel)&0xff00ff00) |
-                                               ((pixel << 16) & 0x00ff0000);
-
-                    ((uint32_t *)_framebuffer_virtual)[y * (_framebuffer_pitch / 4) + x] = converted_pixel;
-                }
-            }
-
-            return SUCCESS;
+            return graphic_blit(_framebuffer_virtual, _framebuffer_pitch, _framebuffer_width, _framebuffer_height, blit);
         }
         else
         {
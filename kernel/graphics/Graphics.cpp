@@ -1,7 +1,9 @@
 #include <libsystem/Logger.h>
+#include <libsystem/math/MinMax.h>
 #include <libsystem/thread/Atomic.h>
 
 #include "kernel/graphics/Graphics.h"
+#include "kernel/tasking/Syscalls.h"
 
 static uintptr_t _framebuffer_address = 0;
 static int _framebuffer_width = 0;
@@ -52,3 +54,73 @@ int graphic_framebuffer_height()
 {
     return _framebuffer_height;
 }
+
+// RGBA to BGRA is a byte swap followed by a rotation, both single instructions.
+static inline uint32_t graphic_convert_pixel(uint32_t pixel)
+{
+    pixel = __builtin_bswap32(pixel);
+
+    return (pixel >> 8) | (pixel << 24);
+}
+
+static void graphic_convert_row(uint32_t *destination, const uint32_t *source, int count)
+{
+    int x = 0;
+
+    // Writes to video memory are much cheaper when they are grouped.
+    for (; x + 4 <= count; x += 4)
+    {
+        uint32_t p0 = graphic_convert_pixel(source[x + 0]);
+        uint32_t p1 = graphic_convert_pixel(source[x + 1]);
+        uint32_t p2 = graphic_convert_pixel(source[x + 2]);
+        uint32_t p3 = graphic_convert_pixel(source[x + 3]);
+
+        destination[x + 0] = p0;
+        destination[x + 1] = p1;
+        destination[x + 2] = p2;
+        destination[x + 3] = p3;
+    }
+
+    for (; x < count; x++)
+    {
+        destination[x] = graphic_convert_pixel(source[x]);
+    }
+}
+
+Result graphic_blit(uintptr_t framebuffer, int pitch, int width, int height, IOCallDisplayBlitArgs *blit)
+{
+    if (blit->buffer_width <= 0 || blit->buffer_height <= 0)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    // Both dimensions come from userspace, a product wrapping around in 32
+    // bits would validate a much smaller buffer than the copy reads.
+    uint64_t buffer_size = (uint64_t)blit->buffer_width * (uint64_t)blit->buffer_height * sizeof(uint32_t);
+
+    if (buffer_size > (size_t)-1 ||
+        !syscall_validate_ptr((uintptr_t)blit->buffer, (size_t)buffer_size))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    int64_t blit_right = (int64_t)blit->blit_x + blit->blit_width;
+    int64_t blit_bottom = (int64_t)blit->blit_y + blit->blit_height;
+
+    int left = MAX(0, blit->blit_x);
+    int top = MAX(0, blit->blit_y);
+    int right = MIN((int64_t)MIN(width, blit->buffer_width), blit_right);
+    int bottom = MIN((int64_t)MIN(height, blit->buffer_height), blit_bottom);
+
+    // The source is user memory, so we might page fault, and a full screen
+    // copy is too long to keep interrupts off anyway.
+    for (int y = top; y < bottom; y++)
+    {
+        graphic_convert_row(
+            reinterpret_cast<uint32_t *>(framebuffer + y * pitch) + left,
+            blit->buffer + y * blit->buffer_width + left,
+            right - left);
+    }
+
+    return SUCCESS;
+}
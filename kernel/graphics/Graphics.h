@@ -1,5 +1,7 @@
 #pragma once
 
+#include <abi/IOCall.h>
+
 #include "kernel/handover/Handover.h"
 
 void graphic_early_initialize(Handover *handover);
@@ -19,3 +21,7 @@ uint32_t *graphic_framebuffer();
 int graphic_framebuffer_width();
 
 int graphic_framebuffer_height();
+
+// Copies the rectangle of the blit from the user buffer to a 32bpp BGRA
+// framebuffer, this doesn't hold interrupts off.
+Result graphic_blit(uintptr_t framebuffer, int pitch, int width, int height, IOCallDisplayBlitArgs *blit);
@@ -1,83 +1,234 @@
-
-#include <libsystem/Assert.h>
 #include <libsystem/Logger.h>
+#include <libsystem/math/MinMax.h>
 #include <libsystem/thread/Atomic.h>
-#include <libutils/RingBuffer.h>
+#include <libsystem/utils/NumberFormatter.h>
+#include <libutils/StringBuilder.h>
 
 #include "kernel/devices/Devices.h"
 #include "kernel/interrupts/Dispatcher.h"
 #include "kernel/scheduling/Blocker.h"
 #include "kernel/scheduling/Scheduler.h"
+#include "kernel/system/System.h"
 
-static bool _pending_interrupts[256] = {};
+#define DISPATCHER_WORDS (DISPATCHER_INTERRUPT_COUNT / 32)
 
-void dispatcher_initialize()
+struct DispatcherInterrupt
+{
+    // Low bits of the clock when the interrupt was raised, the latencies are
+    // short enough for them.
+    volatile uint32_t raised_at;
+
+    // The task handling this interrupt, or null for the shared dispatcher.
+    Task *thread;
+
+    DispatcherStatistics statistics;
+};
+
+static DispatcherInterrupt _interrupts[DISPATCHER_INTERRUPT_COUNT] = {};
+
+// Set by the IRQ handlers and cleared by the tasks handling them, without
+// taking the kernel lock.
+static volatile uint32_t _pending[DISPATCHER_WORDS] = {};
+
+// Interrupts with a task of their own, the shared dispatcher leaves them.
+static uint32_t _threaded[DISPATCHER_WORDS] = {};
+
+static Task *_dispatcher = nullptr;
+
+static const uint32_t _latency_bounds[] = DISPATCHER_LATENCY_BOUNDS;
+
+static_assert(__array_length(_latency_bounds) + 1 == DISPATCHER_LATENCY_BUCKETS);
+
+static uint32_t dispatcher_bit(int interrupt)
 {
-    Task *interrupts_dispatcher_task = task_spawn(nullptr, "InterruptsDispatcher", dispatcher_service, nullptr, false);
-    task_go(interrupts_dispatcher_task);
+    return 1u << (interrupt % 32);
 }
 
 void dispatcher_dispatch(int interrupt)
 {
-    _pending_interrupts[interrupt] = true;
+    DispatcherInterrupt &target = _interrupts[interrupt];
+
+    uint32_t raised_at = (uint32_t)system_get_clock();
+    uint32_t pending = __atomic_fetch_or(&_pending[interrupt / 32], dispatcher_bit(interrupt), __ATOMIC_SEQ_CST);
+
+    // Only the first IRQ counts for the latency until it is handled, the
+    // others are coalesced with it.
+    if (!(pending & dispatcher_bit(interrupt)))
+    {
+        target.raised_at = raised_at;
+    }
+
+    target.statistics.raised++;
+
+    Task *task = target.thread ? target.thread : _dispatcher;
+
+    if (task && task->state() == TASK_STATE_BLOCKED)
+    {
+        scheduler_try_unblock(task);
+    }
 }
 
-static bool dispatcher_has_interrupt()
+static void dispatcher_handle(int interrupt)
 {
-    AtomicHolder holder;
+    DispatcherInterrupt &target = _interrupts[interrupt];
+
+    uint32_t latency = (uint32_t)system_get_clock() - target.raised_at;
+
+    devices_handle_interrupt(interrupt);
 
-    int result = 0;
+    size_t bucket = 0;
 
-    for (size_t i = 0; i < 256; i++)
+    while (bucket < __array_length(_latency_bounds) && latency >= _latency_bounds[bucket])
     {
-        if (_pending_interrupts[i])
-        {
-            result++;
-        }
+        bucket++;
     }
 
-    return result > 0;
+    target.statistics.handled++;
+    target.statistics.latencies[bucket]++;
+    target.statistics.worst_latency = MAX(target.statistics.worst_latency, latency);
 }
 
-static void dispatcher_snapshot(bool *destination)
+// The pending interrupts of the word which aren't threaded, cleared.
+static uint32_t dispatcher_take_shared(int word)
 {
-    AtomicHolder holder;
-    memcpy(destination, _pending_interrupts, sizeof(_pending_interrupts));
-    memset(_pending_interrupts, 0, sizeof(_pending_interrupts));
+    return __atomic_fetch_and(&_pending[word], _threaded[word], __ATOMIC_SEQ_CST) & ~_threaded[word];
 }
 
+static bool dispatcher_take_threaded(int interrupt)
+{
+    uint32_t bit = dispatcher_bit(interrupt);
+
+    return __atomic_fetch_and(&_pending[interrupt / 32], ~bit, __ATOMIC_SEQ_CST) & bit;
+}
+
+// Woken up by dispatcher_dispatch(), never polled.
 class BlockerDispatcher : public Blocker
 {
 private:
+    int _interrupt;
+
 public:
-    BlockerDispatcher() {}
+    BlockerDispatcher(int interrupt) : _interrupt(interrupt) {}
 
     bool can_unblock(struct Task *task)
     {
         __unused(task);
 
-        return dispatcher_has_interrupt();
+        if (_interrupt != -1)
+        {
+            return _pending[_interrupt / 32] & dispatcher_bit(_interrupt);
+        }
+
+        for (int i = 0; i < DISPATCHER_WORDS; i++)
+        {
+            if (_pending[i] & ~_threaded[i])
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool subscribe(struct Task *task)
+    {
+        // The task is blocked by now, so dispatcher_dispatch() wakes it up
+        // for any IRQ from here on. One which came in since can_unblock()
+        // would be lost, leave it to the scheduler instead.
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        return !can_unblock(task);
     }
 };
 
-void dispatcher_service()
+static void dispatcher_service()
 {
     while (true)
     {
-        task_block(scheduler_running(), new BlockerDispatcher(), -1);
+        BlockerDispatcher blocker{-1};
+        task_block(scheduler_running(), blocker, -1);
 
-        while (dispatcher_has_interrupt())
+        for (int word = 0; word < DISPATCHER_WORDS; word++)
         {
-            bool snapshot[256];
-            dispatcher_snapshot(snapshot);
+            uint32_t pending = dispatcher_take_shared(word);
 
-            for (size_t i = 0; i < 256; i++)
+            while (pending)
             {
-                if (snapshot[i])
-                {
-                    devices_handle_interrupt(i);
-                }
+                // Compiles to a bsf, lowest interrupt first.
+                int bit = __builtin_ctz(pending);
+                pending &= pending - 1;
+
+                dispatcher_handle(word * 32 + bit);
             }
         }
     }
 }
+
+static void dispatcher_thread_service()
+{
+    int interrupt = -1;
+
+    atomic_begin();
+
+    for (int i = 0; i < DISPATCHER_INTERRUPT_COUNT; i++)
+    {
+        if (_interrupts[i].thread == scheduler_running())
+        {
+            interrupt = i;
+        }
+    }
+
+    atomic_end();
+
+    while (true)
+    {
+        BlockerDispatcher blocker{interrupt};
+        task_block(scheduler_running(), blocker, -1);
+
+        while (dispatcher_take_threaded(interrupt))
+        {
+            dispatcher_handle(interrupt);
+        }
+    }
+}
+
+void dispatcher_initialize()
+{
+    _dispatcher = task_spawn(nullptr, "InterruptsDispatcher", dispatcher_service, nullptr, false);
+    _dispatcher->priority = TASK_PRIORITY_HIGH;
+    task_go(_dispatcher);
+}
+
+void dispatcher_thread(int interrupt, TaskPriority priority)
+{
+    AtomicHolder holder;
+
+    DispatcherInterrupt &target = _interrupts[interrupt];
+
+    if (target.thread)
+    {
+        scheduler_set_task_priority(target.thread, MAX(target.thread->priority, priority));
+        return;
+    }
+
+    char number[12] = {};
+    format_int(FORMAT_DECIMAL, interrupt, number, 12);
+    String name = StringBuilder().append("Interrupt").append(number).finalize();
+
+    target.thread = task_spawn(nullptr, name.cstring(), dispatcher_thread_service, nullptr, false);
+    // Not in a run queue before task_go(), it can be set directly.
+    target.thread->priority = priority;
+
+    _threaded[interrupt / 32] |= dispatcher_bit(interrupt);
+
+    task_go(target.thread);
+
+    logger_info("Interrupt %d is handled by a task of its own", interrupt);
+}
+
+DispatcherStatistics dispatcher_get_statistics(int interrupt)
+{
+    AtomicHolder holder;
+
+    return _interrupts[interrupt].statistics;
+}
@@ -1,11 +1,32 @@
 #pragma once
 
-#include "kernel/node/Node.h"
+#include "kernel/tasking/Task.h"
 
-typedef void (*DispatcherInteruptHandler)();
+#define DISPATCHER_INTERRUPT_COUNT (256)
+
+// Time from the IRQ to its handler, in microseconds. The last bucket is
+// everything slower than DISPATCHER_LATENCY_BOUNDS.
+#define DISPATCHER_LATENCY_BOUNDS {10, 50, 100, 500, 1000, 5000, 10000}
+#define DISPATCHER_LATENCY_BUCKETS (8)
+
+struct DispatcherStatistics
+{
+    // IRQs raised again before the previous one was handled are counted
+    // once in handled.
+    size_t raised;
+    size_t handled;
+
+    uint32_t worst_latency;
+    size_t latencies[DISPATCHER_LATENCY_BUCKETS];
+};
 
 void dispatcher_initialize();
 
+// Called by the IRQ handler, wakes up the task handling the interrupt.
 void dispatcher_dispatch(int interrupt);
 
-void dispatcher_service();
+// The interrupt gets a task of its own, so its handlers don't wait behind
+// the ones of other devices.
+void dispatcher_thread(int interrupt, TaskPriority priority);
+
+DispatcherStatistics dispatcher_get_statistics(int interrupt);
@@ -17,9 +17,12 @@
 #include "kernel/interrupts/Interupts.h"
 #include "kernel/modules/Modules.h"
 #include "kernel/node/DevicesInfo.h"
+#include "kernel/node/ObjectCacheInfo.h"
 #include "kernel/node/ProcessInfo.h"
+#include "kernel/node/SchedulerInfo.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
+#include "kernel/system/SystemPage.h"
 #include "kernel/tasking/Tasking.h"
 #include "kernel/tasking/Userspace.h"
 
@@ -43,15 +46,20 @@ void system_main(Handover *handover)
 
     system_initialize();
     memory_initialize(handover);
+    system_page_initialize();
     scheduler_initialize();
     tasking_initialize();
     interrupts_initialize();
+    arch_timer_initialize();
+    arch_cpu_start_others();
     filesystem_initialize();
     modules_initialize(handover);
     driver_initialize();
     device_initialize();
     process_info_initialize();
     device_info_initialize();
+    scheduler_info_initialize();
+    object_cache_info_initialize();
     devices_filesystem_initialize();
     graphic_initialize(handover);
     userspace_initialize();
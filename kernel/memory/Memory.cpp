@@ -26,29 +26,18 @@ void memory_initialize(Handover *handover)
 {
     logger_info("Initializing memory management...");
 
-    for (size_t i = 0; i < 1024 * 1024 / 8; i++)
-    {
-        MEMORY[i] = 0xff;
-    }
-
-    for (size_t i = 0; i < handover->memory_map_size; i++)
-    {
-        MemoryMapEntry *entry = &handover->memory_map[i];
-
-        if (entry->type == MEMORY_MAP_ENTRY_AVAILABLE)
-        {
-            physical_set_free(entry->range);
-        }
-    }
+    physical_initialize(handover, kernel_memory_range());
 
     arch_virtual_initialize();
 
-    USED_MEMORY = 0;
     TOTAL_MEMORY = handover->memory_usable;
 
     logger_info("Mapping kernel...");
     memory_map_identity(arch_kernel_address_space(), kernel_memory_range(), MEMORY_NONE);
 
+    logger_info("Mapping physical memory bitmap...");
+    memory_map_identity(arch_kernel_address_space(), physical_bitmap_range(), MEMORY_NONE);
+
     logger_info("Mapping modules...");
     for (size_t i = 0; i < handover->modules_size; i++)
     {
@@ -80,6 +69,9 @@ void memory_dump()
     printf("\n\tMemory status:");
     printf("\n\t - Used  physical Memory: %12dkib", USED_MEMORY / 1024);
     printf("\n\t - Total physical Memory: %12dkib", TOTAL_MEMORY / 1024);
+
+    auto statistics = physical_get_statistics();
+    printf("\n\t - Free physical blocks:  %12d (largest %dkib)", statistics.free_blocks, statistics.largest_free_block * ARCH_PAGE_SIZE / 1024);
 }
 
 size_t memory_get_used()
@@ -102,6 +94,8 @@ Result memory_map(void *address_space, MemoryRange virtual_range, MemoryFlags fl
 
     AtomicHolder holder;
 
+    arch_virtual_gather_begin();
+
     for (size_t i = 0; i < virtual_range.size() / ARCH_PAGE_SIZE; i++)
     {
         uintptr_t virtual_address = virtual_range.base() + i * ARCH_PAGE_SIZE;
@@ -113,11 +107,14 @@ Result memory_map(void *address_space, MemoryRange virtual_range, MemoryFlags fl
 
             if (virtual_map_result != SUCCESS)
             {
+                arch_virtual_gather_end();
                 return virtual_map_result;
             }
         }
     }
 
+    arch_virtual_gather_end();
+
     if (flags & MEMORY_CLEAR)
     {
         memset((void *)virtual_range.base(), 0, virtual_range.size());
@@ -224,6 +221,8 @@ Result memory_free(void *address_space, MemoryRange virtual_range)
 
     AtomicHolder holder;
 
+    arch_virtual_gather_begin();
+
     for (size_t i = 0; i < virtual_range.size() / ARCH_PAGE_SIZE; i++)
     {
         uintptr_t virtual_address = virtual_range.base() + i * ARCH_PAGE_SIZE;
@@ -238,5 +237,7 @@ Result memory_free(void *address_space, MemoryRange virtual_range)
         }
     }
 
+    arch_virtual_gather_end();
+
     return SUCCESS;
 }
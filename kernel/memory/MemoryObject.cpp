@@ -1,17 +1,36 @@
 #include <libsystem/Logger.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/math/MinMax.h>
 #include <libsystem/thread/Atomic.h>
 #include <libsystem/utils/List.h>
 
+#include "arch/VirtualMemory.h"
+
 #include "kernel/memory/Memory.h"
 #include "kernel/memory/MemoryObject.h"
+#include "kernel/memory/ObjectCache.h"
 #include "kernel/memory/Physical.h"
+#include "kernel/node/Handle.h"
+
+static void memory_object_construct(void *object)
+{
+    MemoryObject *memory_object = (MemoryObject *)object;
+
+    lock_init(memory_object->_lock);
+}
+
+static ObjectCache _memory_object_cache = OBJECT_CACHE(MemoryObject, 128, memory_object_construct);
 
 static int _memory_object_id = 0;
 static List *_memory_objects;
 
+// File backed objects, so tasks running the same executable share its pages.
+static List *_file_objects;
+
 void memory_object_initialize()
 {
     _memory_objects = list_create();
+    _file_objects = list_create();
 }
 
 MemoryObject *memory_object_create(size_t size)
@@ -20,23 +39,150 @@ MemoryObject *memory_object_create(size_t size)
 
     size = PAGE_ALIGN_UP(size);
 
-    MemoryObject *memory_object = __create(MemoryObject);
+    MemoryObject *memory_object = object_cache_create(MemoryObject, &_memory_object_cache);
 
     memory_object->id = _memory_object_id++;
     memory_object->refcount = 1;
-    memory_object->_range = physical_alloc(size);
+    memory_object->_size = size;
+    memory_object->_pages = (uintptr_t *)calloc(size / ARCH_PAGE_SIZE, sizeof(uintptr_t));
 
     list_pushback(_memory_objects, memory_object);
 
     return memory_object;
 }
 
+MemoryObject *memory_object_create_from_file(FsHandle *file, size_t offset, size_t file_size, size_t size)
+{
+    {
+        AtomicHolder holder;
+
+        list_foreach(MemoryObject, memory_object, _file_objects)
+        {
+            if (memory_object->_file->node == file->node &&
+                memory_object->_file_offset == offset &&
+                memory_object->_file_size == file_size &&
+                memory_object->_size == PAGE_ALIGN_UP(size))
+            {
+                return memory_object_ref(memory_object);
+            }
+        }
+    }
+
+    MemoryObject *memory_object = memory_object_create(size);
+
+    memory_object->_file = fshandle_clone(file);
+    memory_object->_file_offset = offset;
+    memory_object->_file_size = file_size;
+
+    AtomicHolder holder;
+
+    memory_object->_cached = true;
+    list_pushback(_file_objects, memory_object);
+
+    return memory_object;
+}
+
+MemoryObject *memory_object_create_copy_on_write(MemoryObject *parent)
+{
+    MemoryObject *memory_object = memory_object_create(parent->size());
+
+    memory_object->_parent = memory_object_ref(parent);
+
+    return memory_object;
+}
+
+// Reads every page still missing from what the file contains right now, so
+// the object doesn't depend on the file anymore.
+static void memory_object_snapshot(MemoryObject *memory_object, const void *contents, size_t size)
+{
+    ASSERT_ATOMIC;
+
+    for (size_t page = 0; page < memory_object->_size / ARCH_PAGE_SIZE; page++)
+    {
+        if (memory_object->_pages[page])
+        {
+            continue;
+        }
+
+        MemoryRange physical_range = physical_alloc(ARCH_PAGE_SIZE);
+        MemoryRange copy_range = arch_virtual_alloc(arch_kernel_address_space(), physical_range, MEMORY_NONE);
+
+        size_t offset = page * ARCH_PAGE_SIZE;
+        size_t file_offset = memory_object->_file_offset + offset;
+        size_t copied = 0;
+
+        if (offset < memory_object->_file_size && file_offset < size)
+        {
+            copied = MIN(MIN(ARCH_PAGE_SIZE, memory_object->_file_size - offset), size - file_offset);
+            memcpy((void *)copy_range.base(), (const char *)contents + file_offset, copied);
+        }
+
+        memset((void *)(copy_range.base() + copied), 0, ARCH_PAGE_SIZE - copied);
+
+        arch_virtual_free(arch_kernel_address_space(), copy_range);
+
+        memory_object->_pages[page] = physical_range.base();
+        memory_object->_resident++;
+    }
+}
+
+void memory_object_invalidate_file(FsNode *node, const void *contents, size_t size)
+{
+    AtomicHolder holder;
+
+    MemoryObject *stale = nullptr;
+
+    do
+    {
+        stale = nullptr;
+
+        list_foreach(MemoryObject, memory_object, _file_objects)
+        {
+            if (memory_object->_file->node == node)
+            {
+                stale = memory_object;
+                break;
+            }
+        }
+
+        if (stale)
+        {
+            // A task running it would otherwise fault in pages of the new
+            // file next to the ones it already has from the old one.
+            memory_object_snapshot(stale, contents, size);
+
+            stale->_cached = false;
+            list_remove(_file_objects, stale);
+        }
+    } while (stale);
+}
+
 void memory_object_destroy(MemoryObject *memory_object)
 {
-    list_remove(_memory_objects, memory_object);
+    {
+        AtomicHolder holder;
 
-    physical_free(memory_object->range());
-    free(memory_object);
+        for (size_t i = 0; i < memory_object->_size / ARCH_PAGE_SIZE; i++)
+        {
+            if (memory_object->_pages[i])
+            {
+                physical_free(MemoryRange{memory_object->_pages[i], ARCH_PAGE_SIZE});
+            }
+        }
+    }
+
+    if (memory_object->_file)
+    {
+        fshandle_destroy(memory_object->_file);
+    }
+
+    if (memory_object->_parent)
+    {
+        memory_object_deref(memory_object->_parent);
+    }
+
+    free(memory_object->_pages);
+    object_cache_free(&_memory_object_cache, memory_object);
 }
 
 MemoryObject *memory_object_ref(MemoryObject *memory_object)
@@ -48,12 +194,25 @@ MemoryObject *memory_object_ref(MemoryObject *memory_object)
 
 void memory_object_deref(MemoryObject *memory_object)
 {
-    AtomicHolder holder;
-
-    if (__atomic_sub_fetch(&memory_object->refcount, 1, __ATOMIC_SEQ_CST) == 0)
     {
-        memory_object_destroy(memory_object);
+        AtomicHolder holder;
+
+        if (__atomic_sub_fetch(&memory_object->refcount, 1, __ATOMIC_SEQ_CST) != 0)
+        {
+            return;
+        }
+
+        // Nobody can look the object up once it's off the lists.
+        list_remove(_memory_objects, memory_object);
+
+        if (memory_object->_cached)
+        {
+            list_remove(_file_objects, memory_object);
+        }
     }
+
+    // Closing the file can't be done atomically.
+    memory_object_destroy(memory_object);
 }
 
 MemoryObject *memory_object_by_id(int id)
@@ -71,3 +230,162 @@ MemoryObject *memory_object_by_id(int id)
 
     return nullptr;
 }
+
+static void memory_object_fill_from_file(MemoryObject *memory_object, size_t page, uintptr_t address)
+{
+    size_t offset = page * ARCH_PAGE_SIZE;
+    size_t read = 0;
+
+    if (offset < memory_object->_file_size)
+    {
+        fshandle_seek(memory_object->_file, memory_object->_file_offset + offset, WHENCE_START);
+        fshandle_read(memory_object->_file, (void *)address, MIN(ARCH_PAGE_SIZE, memory_object->_file_size - offset), &read);
+    }
+
+    memset((void *)(address + read), 0, ARCH_PAGE_SIZE - read);
+}
+
+static Result memory_object_map_page(MemoryObject *memory_object, size_t page, void *address_space, uintptr_t address, MemoryFlags flags)
+{
+    AtomicHolder holder;
+
+    return arch_virtual_map(address_space, MemoryRange{memory_object->_pages[page], ARCH_PAGE_SIZE}, address, flags);
+}
+
+static Result memory_object_fault_anonymous(MemoryObject *memory_object, size_t page, void *address_space, uintptr_t address)
+{
+    AtomicHolder holder;
+
+    if (memory_object->_pages[page])
+    {
+        return memory_object_map_page(memory_object, page, address_space, address, MEMORY_USER);
+    }
+
+    MemoryRange physical_range = physical_alloc(ARCH_PAGE_SIZE);
+
+    Result result = arch_virtual_map(address_space, physical_range, address, MEMORY_USER);
+
+    if (result != SUCCESS)
+    {
+        physical_free(physical_range);
+        return result;
+    }
+
+    memset((void *)address, 0, ARCH_PAGE_SIZE);
+
+    memory_object->_pages[page] = physical_range.base();
+    memory_object->_resident++;
+
+    return SUCCESS;
+}
+
+static Result memory_object_fault_file(MemoryObject *memory_object, size_t page, void *address_space, uintptr_t address)
+{
+    // Pages are only published once they are filled.
+    if (memory_object->_pages[page])
+    {
+        return memory_object_map_page(memory_object, page, address_space, address, MEMORY_USER | MEMORY_READONLY);
+    }
+
+    // Reading the file might block.
+    if (is_atomic())
+    {
+        return ERR_OPERATION_NOT_SUPPORTED;
+    }
+
+    LockHolder holder(memory_object->_lock);
+
+    if (memory_object->_pages[page])
+    {
+        return memory_object_map_page(memory_object, page, address_space, address, MEMORY_USER | MEMORY_READONLY);
+    }
+
+    MemoryRange physical_range;
+
+    {
+        AtomicHolder holder;
+
+        physical_range = physical_alloc(ARCH_PAGE_SIZE);
+
+        Result result = arch_virtual_map(address_space, physical_range, address, MEMORY_USER);
+
+        if (result != SUCCESS)
+        {
+            physical_free(physical_range);
+            return result;
+        }
+    }
+
+    memory_object_fill_from_file(memory_object, page, address);
+
+    AtomicHolder atomic_holder;
+
+    if (memory_object->_pages[page])
+    {
+        // The file changed while we were reading it, and the page was
+        // already taken from what it was before.
+        Result result = memory_object_map_page(memory_object, page, address_space, address, MEMORY_USER | MEMORY_READONLY);
+        physical_free(physical_range);
+
+        return result;
+    }
+
+    memory_object->_pages[page] = physical_range.base();
+    memory_object->_resident++;
+
+    // The page is shared with every task running this file.
+    return memory_object_map_page(memory_object, page, address_space, address, MEMORY_USER | MEMORY_READONLY);
+}
+
+static Result memory_object_fault_copy_on_write(MemoryObject *memory_object, size_t page, void *address_space, uintptr_t address, bool write)
+{
+    if (memory_object->_pages[page])
+    {
+        return memory_object_map_page(memory_object, page, address_space, address, MEMORY_USER);
+    }
+
+    // Reads are served straight from the parent, read-only.
+    Result result = memory_object_fault(memory_object->_parent, page, address_space, address, false);
+
+    if (result != SUCCESS || !write)
+    {
+        return result;
+    }
+
+    AtomicHolder holder;
+
+    MemoryRange physical_range = physical_alloc(ARCH_PAGE_SIZE);
+    MemoryRange copy_range = arch_virtual_alloc(arch_kernel_address_space(), physical_range, MEMORY_NONE);
+
+    memcpy((void *)copy_range.base(), (void *)address, ARCH_PAGE_SIZE);
+
+    arch_virtual_free(arch_kernel_address_space(), copy_range);
+
+    memory_object->_pages[page] = physical_range.base();
+    memory_object->_resident++;
+
+    return memory_object_map_page(memory_object, page, address_space, address, MEMORY_USER);
+}
+
+Result memory_object_fault(MemoryObject *memory_object, size_t page, void *address_space, uintptr_t address, bool write)
+{
+    assert(page < memory_object->_size / ARCH_PAGE_SIZE);
+
+    if (memory_object->_parent)
+    {
+        return memory_object_fault_copy_on_write(memory_object, page, address_space, address, write);
+    }
+    else if (memory_object->_file)
+    {
+        if (write)
+        {
+            return ERR_READ_ONLY_STREAM;
+        }
+
+        return memory_object_fault_file(memory_object, page, address_space, address);
+    }
+    else
+    {
+        return memory_object_fault_anonymous(memory_object, page, address_space, address);
+    }
+}
@@ -1,21 +1,54 @@
 #pragma once
 
 #include <libsystem/Common.h>
+#include <libsystem/thread/Lock.h>
+
+#include "kernel/memory/MemoryRange.h"
+
+struct FsHandle;
+struct FsNode;
 
 struct MemoryObject
 {
     int id;
-    MemoryRange _range;
+    size_t _size;
+
+    // Physical address of each page, zero until the page is first touched.
+    uintptr_t *_pages;
+    size_t _resident;
+
+    // Pages are read from the file, the part past _file_size is zero filled.
+    // File backed objects are shared between tasks and always read-only.
+    Lock _lock;
+    FsHandle *_file;
+    size_t _file_offset;
+    size_t _file_size;
+    bool _cached;
+
+    // Pages are shared with the parent until they are written to.
+    MemoryObject *_parent;
 
     int refcount;
 
-    auto range() { return _range; }
+    auto size() { return _size; }
+
+    auto resident() { return _resident * ARCH_PAGE_SIZE; }
 };
 
 void memory_object_initialize();
 
 MemoryObject *memory_object_create(size_t size);
 
+// Returns the cached object for this part of the file, if there is one.
+MemoryObject *memory_object_create_from_file(FsHandle *file, size_t offset, size_t file_size, size_t size);
+
+MemoryObject *memory_object_create_copy_on_write(MemoryObject *parent);
+
+// The file is about to change. The objects already mapped read the pages
+// they still miss from its current contents, so they keep seeing the old
+// file, and new mappings will read the new one.
+void memory_object_invalidate_file(FsNode *node, const void *contents, size_t size);
+
 void memory_object_destroy(MemoryObject *memory_object);
 
 MemoryObject *memory_object_ref(MemoryObject *memory_object);
@@ -23,3 +56,7 @@ MemoryObject *memory_object_ref(MemoryObject *memory_object);
 void memory_object_deref(MemoryObject *memory_object);
 
 MemoryObject *memory_object_by_id(int id);
+
+// Maps one page of the object at the given address of the current address
+// space, materializing it if this is the first time it's touched.
+Result memory_object_fault(MemoryObject *memory_object, size_t page, void *address_space, uintptr_t address, bool write);
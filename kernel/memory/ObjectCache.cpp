@@ -0,0 +1,121 @@
+#include <libsystem/Assert.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "kernel/memory/ObjectCache.h"
+
+static ObjectCache *_caches = nullptr;
+
+void *object_cache_alloc(ObjectCache *cache)
+{
+    AtomicHolder holder;
+
+    if (!cache->registered)
+    {
+        cache->next = _caches;
+        cache->registered = true;
+        _caches = cache;
+    }
+
+    void *object = cache->free_list;
+
+    if (object)
+    {
+        cache->free_list = *(void **)object;
+        cache->statistics.cached--;
+        cache->statistics.hits++;
+    }
+    else
+    {
+        object = malloc(cache->size);
+
+        if (!object)
+        {
+            return nullptr;
+        }
+    }
+
+    cache->statistics.allocations++;
+    cache->statistics.in_use++;
+
+    memset(object, 0, cache->size);
+
+    if (cache->constructor)
+    {
+        cache->constructor(object);
+    }
+
+    return object;
+}
+
+void object_cache_free(ObjectCache *cache, void *object)
+{
+    if (!object)
+    {
+        return;
+    }
+
+    AtomicHolder holder;
+
+    assert(cache->statistics.in_use > 0);
+    cache->statistics.in_use--;
+
+    if (cache->statistics.cached < cache->limit)
+    {
+        *(void **)object = cache->free_list;
+        cache->free_list = object;
+        cache->statistics.cached++;
+    }
+    else
+    {
+        free(object);
+    }
+}
+
+size_t object_cache_reclaim(ObjectCache *cache)
+{
+    AtomicHolder holder;
+
+    size_t reclaimed = 0;
+
+    while (cache->free_list)
+    {
+        void *object = cache->free_list;
+        cache->free_list = *(void **)object;
+
+        free(object);
+        reclaimed++;
+    }
+
+    cache->statistics.cached = 0;
+    cache->statistics.reclaimed += reclaimed;
+
+    return reclaimed * cache->size;
+}
+
+size_t object_cache_reclaim_all()
+{
+    AtomicHolder holder;
+
+    size_t reclaimed = 0;
+
+    for (ObjectCache *cache = _caches; cache; cache = cache->next)
+    {
+        reclaimed += object_cache_reclaim(cache);
+    }
+
+    return reclaimed;
+}
+
+void object_cache_iterate(void *target, ObjectCacheIterateCallback callback)
+{
+    AtomicHolder holder;
+
+    for (ObjectCache *cache = _caches; cache; cache = cache->next)
+    {
+        if (callback(target, cache) == Iteration::STOP)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <libsystem/Common.h>
+#include <libsystem/math/MinMax.h>
+#include <libutils/Iteration.h>
+
+struct ObjectCacheStatistics
+{
+    size_t allocations;
+    size_t hits;
+    size_t in_use;
+    size_t cached;
+    size_t reclaimed;
+};
+
+typedef void (*ObjectCacheConstructor)(void *object);
+
+// Keeps freed objects of one type around, so the hot paths creating and
+// destroying them don't go through the heap. Caches are statically
+// initialized with OBJECT_CACHE() and register themselves on first use.
+struct ObjectCache
+{
+    const char *name;
+    size_t size;
+
+    // How many free objects are kept before they go back to the heap.
+    size_t limit;
+
+    // Called on the cleared object every time it's handed out.
+    ObjectCacheConstructor constructor;
+
+    void *free_list;
+    ObjectCache *next;
+    bool registered;
+
+    ObjectCacheStatistics statistics;
+};
+
+#define OBJECT_CACHE(__type, __limit, __constructor) \
+    {#__type, MAX(sizeof(__type), sizeof(void *)), __limit, __constructor, nullptr, nullptr, false, {}}
+
+void *object_cache_alloc(ObjectCache *cache);
+
+#define object_cache_create(__type, __cache) ((__type *)object_cache_alloc(__cache))
+
+void object_cache_free(ObjectCache *cache, void *object);
+
+// Gives the free objects of the cache back to the heap.
+size_t object_cache_reclaim(ObjectCache *cache);
+
+size_t object_cache_reclaim_all();
+
+typedef Iteration (*ObjectCacheIterateCallback)(void *target, ObjectCache *cache);
+void object_cache_iterate(void *target, ObjectCacheIterateCallback callback);
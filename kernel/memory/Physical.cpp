@@ -1,3 +1,6 @@
+#include <libsystem/Logger.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/math/MinMax.h>
 #include <libsystem/thread/Atomic.h>
 
 #include "arch/Memory.h"
@@ -5,41 +8,350 @@
 #include "kernel/memory/Physical.h"
 #include "kernel/system/System.h"
 
+// The bitmap stays out of low memory, which is kept for real mode code, and
+// has to be reachable once paging is enabled, but only the first gigabyte of
+// the kernel address space is identity mapped.
+#define PHYSICAL_BOOTSTRAP_START (0x100000)
+#define PHYSICAL_BOOTSTRAP_LIMIT (0x40000000)
+
+#define PAGES_PER_WORD (32)
+
 size_t TOTAL_MEMORY = 0;
 size_t USED_MEMORY = 0;
 
-size_t best_bet = 0;
-uint8_t MEMORY[1024 * 1024 / 8] = {};
+static MemoryRange _bitmap_range = {};
+
+// One bit per page, set if the page is used or isn't backed by memory.
+static uint32_t *_pages = nullptr;
+static size_t _pages_count = 0;
+static size_t _pages_words = 0;
+
+// One bit per word of _pages, set if the word has at least one free page.
+static uint32_t *_free_words = nullptr;
+static size_t _free_words_count = 0;
+
+// Number of free pages in each word of _pages.
+static uint8_t *_free_count = nullptr;
+
+// Every word before this one is full.
+static size_t _best_bet = 0;
+
+static bool physical_page_is_used(size_t page)
+{
+    if (page >= _pages_count)
+    {
+        return true;
+    }
+
+    return _pages[page / PAGES_PER_WORD] & (1u << (page % PAGES_PER_WORD));
+}
+
+static void physical_page_set_used(size_t page)
+{
+    size_t word = page / PAGES_PER_WORD;
+
+    _pages[word] |= 1u << (page % PAGES_PER_WORD);
+    _free_count[word]--;
+
+    if (_free_count[word] == 0)
+    {
+        _free_words[word / 32] &= ~(1u << (word % 32));
+    }
+}
+
+static void physical_page_set_free(size_t page)
+{
+    size_t word = page / PAGES_PER_WORD;
+
+    _pages[word] &= ~(1u << (page % PAGES_PER_WORD));
+    _free_count[word]++;
+    _free_words[word / 32] |= 1u << (word % 32);
+
+    if (word < _best_bet)
+    {
+        _best_bet = word;
+    }
+}
+
+static size_t physical_find_free_word(size_t from)
+{
+    size_t index = from / 32;
+
+    if (index >= _free_words_count)
+    {
+        return _pages_words;
+    }
+
+    uint32_t bits = _free_words[index] & (0xffffffff << (from % 32));
+
+    while (!bits)
+    {
+        index++;
+
+        if (index >= _free_words_count)
+        {
+            return _pages_words;
+        }
+
+        bits = _free_words[index];
+    }
+
+    return index * 32 + __builtin_ctz(bits);
+}
+
+static size_t physical_find_free_page()
+{
+    size_t word = physical_find_free_word(_best_bet);
+
+    if (word >= _pages_words)
+    {
+        return _pages_count;
+    }
+
+    _best_bet = word;
+
+    return word * PAGES_PER_WORD + __builtin_ctz(~_pages[word]);
+}
+
+static int physical_find_run_in_word(uint32_t used, size_t count)
+{
+    uint32_t free = ~used;
+    uint32_t run = free;
+
+    for (size_t i = 1; i < count && run; i++)
+    {
+        run &= free >> i;
+    }
+
+    if (!run)
+    {
+        return -1;
+    }
+
+    return __builtin_ctz(run);
+}
+
+static size_t physical_find_free_range(size_t count)
+{
+    size_t run_start = 0;
+    size_t run_length = 0;
+
+    for (size_t word = physical_find_free_word(_best_bet); word < _pages_words; word++)
+    {
+        uint32_t used = _pages[word];
+
+        if (used == 0)
+        {
+            if (run_length == 0)
+            {
+                run_start = word * PAGES_PER_WORD;
+            }
+
+            run_length += PAGES_PER_WORD;
+        }
+        else if (_free_count[word] == 0)
+        {
+            run_length = 0;
+
+            // Skip all the full words at once.
+            word = physical_find_free_word(word + 1) - 1;
+            continue;
+        }
+        else
+        {
+            size_t low_free = __builtin_ctz(used);
+
+            if (run_length > 0 && run_length + low_free >= count)
+            {
+                return run_start;
+            }
+
+            if (count < PAGES_PER_WORD)
+            {
+                int offset = physical_find_run_in_word(used, count);
+
+                if (offset >= 0)
+                {
+                    return word * PAGES_PER_WORD + offset;
+                }
+            }
+
+            size_t high_free = __builtin_clz(used);
 
-bool physical_page_is_used(uintptr_t address)
+            run_start = (word + 1) * PAGES_PER_WORD - high_free;
+            run_length = high_free;
+        }
+
+        if (run_length >= count)
+        {
+            return run_start;
+        }
+    }
+
+    return _pages_count;
+}
+
+static bool physical_range_overlaps(MemoryRange left, MemoryRange right)
 {
-    uintptr_t page = address / ARCH_PAGE_SIZE;
+    return !left.empty() && !right.empty() &&
+           left.base() <= right.end() && right.base() <= left.end();
+}
+
+static uintptr_t physical_skip_range(uintptr_t base, size_t size, MemoryRange reserved)
+{
+    if (physical_range_overlaps(MemoryRange{base, size}, reserved))
+    {
+        return __align_up(reserved.end() + 1, ARCH_PAGE_SIZE);
+    }
+
+    return base;
+}
+
+static MemoryRange physical_find_bootstrap_range(Handover *handover, MemoryRange kernel_range, size_t size)
+{
+    for (size_t i = 0; i < handover->memory_map_size; i++)
+    {
+        MemoryMapEntry *entry = &handover->memory_map[i];
+
+        if (entry->type != MEMORY_MAP_ENTRY_AVAILABLE || entry->range.empty())
+        {
+            continue;
+        }
+
+        uintptr_t base = MAX(entry->range.base(), PHYSICAL_BOOTSTRAP_START);
+        uintptr_t last_base = 0;
+
+        // Move past the kernel and the modules until nothing overlaps.
+        while (base != last_base)
+        {
+            last_base = base;
 
-    return MEMORY[page / 8] & (1 << (page % 8));
+            base = physical_skip_range(base, size, kernel_range);
+
+            for (size_t j = 0; j < handover->modules_size; j++)
+            {
+                base = physical_skip_range(base, size, handover->modules[j].range);
+            }
+        }
+
+        if (base < PHYSICAL_BOOTSTRAP_LIMIT &&
+            size <= PHYSICAL_BOOTSTRAP_LIMIT - base &&
+            base + size - 1 <= entry->range.end())
+        {
+            return MemoryRange{base, size};
+        }
+    }
+
+    return MemoryRange{};
 }
 
-void physical_page_set_used(uintptr_t address)
+void physical_initialize(Handover *handover, MemoryRange kernel_range)
 {
-    uintptr_t page = address / ARCH_PAGE_SIZE;
+    uintptr_t memory_end = 0;
 
-    if (page == best_bet)
+    for (size_t i = 0; i < handover->memory_map_size; i++)
     {
-        best_bet++;
+        MemoryMapEntry *entry = &handover->memory_map[i];
+
+        if (entry->type == MEMORY_MAP_ENTRY_AVAILABLE && !entry->range.empty())
+        {
+            memory_end = MAX(memory_end, entry->range.end());
+        }
     }
 
-    MEMORY[page / 8] |= 1 << (page % 8);
+    _pages_count = memory_end / ARCH_PAGE_SIZE + 1;
+    _pages_words = __align_up(_pages_count, PAGES_PER_WORD) / PAGES_PER_WORD;
+    _free_words_count = __align_up(_pages_words, 32) / 32;
+
+    size_t bitmap_size = _pages_words * sizeof(uint32_t) +
+                         _free_words_count * sizeof(uint32_t) +
+                         _pages_words * sizeof(uint8_t);
+
+    bitmap_size = __align_up(bitmap_size, ARCH_PAGE_SIZE);
+
+    _bitmap_range = physical_find_bootstrap_range(handover, kernel_range, bitmap_size);
+
+    if (_bitmap_range.empty())
+    {
+        system_panic("No room for the physical memory bitmap (%uKio)!", bitmap_size / 1024);
+    }
+
+    _pages = reinterpret_cast<uint32_t *>(_bitmap_range.base());
+    _free_words = _pages + _pages_words;
+    _free_count = reinterpret_cast<uint8_t *>(_free_words + _free_words_count);
+
+    memset(_pages, 0xff, _pages_words * sizeof(uint32_t));
+    memset(_free_words, 0, _free_words_count * sizeof(uint32_t));
+    memset(_free_count, 0, _pages_words * sizeof(uint8_t));
+
+    for (size_t i = 0; i < handover->memory_map_size; i++)
+    {
+        MemoryMapEntry *entry = &handover->memory_map[i];
+
+        if (entry->type == MEMORY_MAP_ENTRY_AVAILABLE)
+        {
+            physical_set_free(entry->range);
+        }
+    }
+
+    USED_MEMORY = 0;
+    physical_set_used(_bitmap_range);
+
+    logger_info("Physical memory bitmap: %u pages at %08x (%uKio)", _pages_count, _bitmap_range.base(), bitmap_size / 1024);
+}
+
+MemoryRange physical_bitmap_range()
+{
+    return _bitmap_range;
 }
 
-void phyisical_page_set_used(uintptr_t address)
+PhysicalStatistics physical_get_statistics()
 {
-    uintptr_t page = address / ARCH_PAGE_SIZE;
+    AtomicHolder holder;
+
+    PhysicalStatistics statistics = {};
+    size_t block = 0;
+
+    auto end_block = [&]() {
+        if (block > 0)
+        {
+            statistics.free_blocks++;
+            statistics.largest_free_block = MAX(statistics.largest_free_block, block);
+            block = 0;
+        }
+    };
 
-    if (page < best_bet)
+    for (size_t word = 0; word < _pages_words; word++)
     {
-        best_bet = page;
+        statistics.free_pages += _free_count[word];
+
+        if (_free_count[word] == PAGES_PER_WORD)
+        {
+            block += PAGES_PER_WORD;
+        }
+        else if (_free_count[word] == 0)
+        {
+            end_block();
+        }
+        else
+        {
+            for (size_t bit = 0; bit < PAGES_PER_WORD; bit++)
+            {
+                if (_pages[word] & (1u << bit))
+                {
+                    end_block();
+                }
+                else
+                {
+                    block++;
+                }
+            }
+        }
     }
 
-    MEMORY[page / 8] &= ~(1 << (page % 8));
+    end_block();
+
+    return statistics;
 }
 
 MemoryRange physical_alloc(size_t size)
@@ -48,15 +360,16 @@ MemoryRange physical_alloc(size_t size)
 
     assert(IS_PAGE_ALIGN(size));
 
-    for (size_t i = best_bet; i < ((TOTAL_MEMORY - size) / ARCH_PAGE_SIZE); i++)
+    size_t count = size / ARCH_PAGE_SIZE;
+    size_t page = count == 1 ? physical_find_free_page() : physical_find_free_range(count);
+
+    if (page < _pages_count)
     {
-        MemoryRange range(i * ARCH_PAGE_SIZE, size);
+        MemoryRange range{page * ARCH_PAGE_SIZE, size};
 
-        if (!physical_is_used(range))
-        {
-            physical_set_used(range);
-            return range;
-        }
+        physical_set_used(range);
+
+        return range;
     }
 
     system_panic("Out of physical memory!\tTrying to allocat %dkio but free memory is %dkio !", size / 1024, (TOTAL_MEMORY - USED_MEMORY) / 1024);
@@ -78,11 +391,11 @@ bool physical_is_used(MemoryRange range)
 
     assert(range.is_page_aligned());
 
-    for (size_t i = 0; i < range.page_count(); i++)
-    {
-        uintptr_t address = range.base() + i * ARCH_PAGE_SIZE;
+    size_t first_page = range.base() / ARCH_PAGE_SIZE;
 
-        if (physical_page_is_used(address))
+    for (size_t page = first_page; page < first_page + range.page_count(); page++)
+    {
+        if (physical_page_is_used(page))
         {
             return true;
         }
@@ -97,14 +410,14 @@ void physical_set_used(MemoryRange range)
 
     assert(range.is_page_aligned());
 
-    for (size_t i = 0; i < range.page_count(); i++)
-    {
-        uintptr_t address = range.base() + i * ARCH_PAGE_SIZE;
+    size_t first_page = range.base() / ARCH_PAGE_SIZE;
 
-        if (!physical_page_is_used(address))
+    for (size_t page = first_page; page < first_page + range.page_count(); page++)
+    {
+        if (!physical_page_is_used(page))
         {
             USED_MEMORY += ARCH_PAGE_SIZE;
-            physical_page_set_used(address);
+            physical_page_set_used(page);
         }
     }
 }
@@ -115,14 +428,14 @@ void physical_set_free(MemoryRange range)
 
     assert(range.is_page_aligned());
 
-    for (size_t i = 0; i < range.page_count(); i++)
-    {
-        uintptr_t address = range.base() + i * ARCH_PAGE_SIZE;
+    size_t first_page = range.base() / ARCH_PAGE_SIZE;
 
-        if (physical_page_is_used(address))
+    for (size_t page = first_page; page < first_page + range.page_count(); page++)
+    {
+        if (page < _pages_count && physical_page_is_used(page))
         {
             USED_MEMORY -= ARCH_PAGE_SIZE;
-            phyisical_page_set_used(address);
+            physical_page_set_free(page);
         }
     }
 }
@@ -2,11 +2,24 @@
 
 #include <libsystem/Common.h>
 
+#include "kernel/handover/Handover.h"
 #include "kernel/memory/MemoryRange.h"
 
 extern size_t TOTAL_MEMORY;
 extern size_t USED_MEMORY;
-extern uint8_t MEMORY[1024 * 1024 / 8];
+
+struct PhysicalStatistics
+{
+    size_t free_pages;
+    size_t free_blocks;
+    size_t largest_free_block;
+};
+
+void physical_initialize(Handover *handover, MemoryRange kernel_range);
+
+MemoryRange physical_bitmap_range();
+
+PhysicalStatistics physical_get_statistics();
 
 MemoryRange physical_alloc(size_t size);
 
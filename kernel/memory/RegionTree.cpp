@@ -0,0 +1,477 @@
+#include <libsystem/Assert.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "arch/VirtualMemory.h"
+
+#include "kernel/memory/Memory.h"
+#include "kernel/memory/RegionTree.h"
+#include "kernel/system/System.h"
+
+// Regions can't come from the heap since the heap itself allocates virtual
+// memory. They are carved out of identity mapped pages instead, and a few of
+// them are kept in reserve for the mapping of the next page.
+#define REGION_SEED_COUNT (64)
+#define REGION_RESERVE (8)
+
+static Region _seed_regions[REGION_SEED_COUNT] = {};
+static bool _seeded = false;
+
+static Region *_free_regions = nullptr;
+static size_t _free_regions_count = 0;
+static bool _refilling = false;
+
+static uint32_t _priority_seed = 0x2545f491;
+
+static void region_free(Region *region)
+{
+    region->right = _free_regions;
+    _free_regions = region;
+    _free_regions_count++;
+}
+
+static void region_refill()
+{
+    if (!_seeded)
+    {
+        for (size_t i = 0; i < REGION_SEED_COUNT; i++)
+        {
+            region_free(&_seed_regions[i]);
+        }
+
+        _seeded = true;
+    }
+
+    if (_refilling || _free_regions_count >= REGION_RESERVE)
+    {
+        return;
+    }
+
+    _refilling = true;
+
+    uintptr_t page = 0;
+
+    if (memory_alloc_identity(arch_kernel_address_space(), MEMORY_NONE, &page) != SUCCESS)
+    {
+        system_panic("Out of memory for virtual regions!");
+    }
+
+    Region *regions = reinterpret_cast<Region *>(page);
+
+    for (size_t i = 0; i < ARCH_PAGE_SIZE / sizeof(Region); i++)
+    {
+        region_free(&regions[i]);
+    }
+
+    _refilling = false;
+}
+
+static Region *region_alloc(uintptr_t base, size_t size, void *data)
+{
+    assert(_free_regions);
+
+    Region *region = _free_regions;
+    _free_regions = region->right;
+    _free_regions_count--;
+
+    _priority_seed ^= _priority_seed << 13;
+    _priority_seed ^= _priority_seed >> 17;
+    _priority_seed ^= _priority_seed << 5;
+
+    *region = (Region){
+        .base = base,
+        .size = size,
+        .data = data,
+        .largest = size,
+        .priority = _priority_seed,
+        .left = nullptr,
+        .right = nullptr,
+    };
+
+    return region;
+}
+
+static size_t region_largest(Region *region)
+{
+    return region ? region->largest : 0;
+}
+
+static void region_update(Region *region)
+{
+    region->largest = MAX(region->size, MAX(region_largest(region->left), region_largest(region->right)));
+}
+
+// Everything before key goes left, the rest goes right.
+static void region_split(Region *region, uintptr_t key, Region **left, Region **right)
+{
+    if (!region)
+    {
+        *left = nullptr;
+        *right = nullptr;
+        return;
+    }
+
+    if (region->base < key)
+    {
+        region_split(region->right, key, &region->right, right);
+        *left = region;
+    }
+    else
+    {
+        region_split(region->left, key, left, &region->left);
+        *right = region;
+    }
+
+    region_update(region);
+}
+
+// Every region of left must be before every region of right.
+static Region *region_merge(Region *left, Region *right)
+{
+    if (!left)
+    {
+        return right;
+    }
+
+    if (!right)
+    {
+        return left;
+    }
+
+    if (left->priority > right->priority)
+    {
+        left->right = region_merge(left->right, right);
+        region_update(left);
+
+        return left;
+    }
+    else
+    {
+        right->left = region_merge(left, right->left);
+        region_update(right);
+
+        return right;
+    }
+}
+
+static Region *region_pop_first(Region **tree)
+{
+    if (!*tree)
+    {
+        return nullptr;
+    }
+
+    Region *first = *tree;
+
+    while (first->left)
+    {
+        first = first->left;
+    }
+
+    Region *single = nullptr;
+    region_split(*tree, first->base + 1, &single, tree);
+
+    return single;
+}
+
+static Region *region_pop_last(Region **tree)
+{
+    if (!*tree)
+    {
+        return nullptr;
+    }
+
+    Region *last = *tree;
+
+    while (last->right)
+    {
+        last = last->right;
+    }
+
+    Region *single = nullptr;
+    region_split(*tree, last->base, tree, &single);
+
+    return single;
+}
+
+static void region_destroy(Region *region)
+{
+    if (!region)
+    {
+        return;
+    }
+
+    region_destroy(region->left);
+    region_destroy(region->right);
+    region_free(region);
+}
+
+/* --- Free space ----------------------------------------------------------- */
+
+void region_tree_release(RegionTree *tree, MemoryRange range)
+{
+    ASSERT_ATOMIC;
+
+    if (range.empty())
+    {
+        return;
+    }
+
+    // Makes releasing a partially free range behave.
+    region_tree_reserve(tree, range);
+
+    uintptr_t base = range.base();
+    uintptr_t end = range.end() + 1;
+
+    Region *left = nullptr;
+    Region *right = nullptr;
+    region_split(tree->root, base, &left, &right);
+
+    Region *region = region_alloc(base, range.size(), nullptr);
+
+    Region *before = region_pop_last(&left);
+
+    if (before && before->base + before->size == base)
+    {
+        region->base = before->base;
+        region->size += before->size;
+        region_free(before);
+    }
+    else
+    {
+        left = region_merge(left, before);
+    }
+
+    Region *after = region_pop_first(&right);
+
+    if (after && after->base == end)
+    {
+        region->size += after->size;
+        region_free(after);
+    }
+    else
+    {
+        right = region_merge(after, right);
+    }
+
+    region_update(region);
+
+    tree->root = region_merge(region_merge(left, region), right);
+}
+
+void region_tree_reserve(RegionTree *tree, MemoryRange range)
+{
+    ASSERT_ATOMIC;
+
+    if (range.empty())
+    {
+        return;
+    }
+
+    region_refill();
+
+    uintptr_t base = range.base();
+    uintptr_t end = range.end() + 1;
+
+    Region *left = nullptr;
+    Region *middle = nullptr;
+    Region *right = nullptr;
+
+    region_split(tree->root, base, &left, &middle);
+    region_split(middle, end, &middle, &right);
+
+    // The region right before the range might run into it, or past it.
+    Region *before = region_pop_last(&left);
+
+    if (before)
+    {
+        uintptr_t before_end = before->base + before->size;
+
+        if (before_end > base)
+        {
+            before->size = base - before->base;
+            region_update(before);
+
+            if (before_end > end)
+            {
+                right = region_merge(region_alloc(end, before_end - end, nullptr), right);
+            }
+        }
+
+        left = region_merge(left, before);
+    }
+
+    // Regions starting inside the range are gone, only the tail of the last
+    // one might survive.
+    Region *last = region_pop_last(&middle);
+    region_destroy(middle);
+
+    if (last)
+    {
+        uintptr_t last_end = last->base + last->size;
+
+        if (last_end > end)
+        {
+            last->base = end;
+            last->size = last_end - end;
+            region_update(last);
+
+            right = region_merge(last, right);
+        }
+        else
+        {
+            region_free(last);
+        }
+    }
+
+    tree->root = region_merge(left, right);
+}
+
+MemoryRange region_tree_find(RegionTree *tree, size_t size)
+{
+    ASSERT_ATOMIC;
+
+    Region *region = tree->root;
+
+    while (region && region->largest >= size)
+    {
+        if (region_largest(region->left) >= size)
+        {
+            region = region->left;
+        }
+        else if (region->size >= size)
+        {
+            return MemoryRange{region->base, size};
+        }
+        else
+        {
+            region = region->right;
+        }
+    }
+
+    return MemoryRange{};
+}
+
+/* --- Objects -------------------------------------------------------------- */
+
+void region_tree_insert(RegionTree *tree, MemoryRange range, void *data)
+{
+    ASSERT_ATOMIC;
+
+    region_refill();
+
+    Region *left = nullptr;
+    Region *right = nullptr;
+    region_split(tree->root, range.base(), &left, &right);
+
+    Region *region = region_alloc(range.base(), range.size(), data);
+
+    tree->root = region_merge(region_merge(left, region), right);
+}
+
+void *region_tree_remove(RegionTree *tree, uintptr_t base)
+{
+    ASSERT_ATOMIC;
+
+    Region *left = nullptr;
+    Region *middle = nullptr;
+    Region *right = nullptr;
+
+    region_split(tree->root, base, &left, &middle);
+    region_split(middle, base + 1, &middle, &right);
+
+    void *data = middle ? middle->data : nullptr;
+    region_destroy(middle);
+
+    tree->root = region_merge(left, right);
+
+    return data;
+}
+
+/* --- Queries -------------------------------------------------------------- */
+
+// The last region starting at or before the address.
+static Region *region_tree_floor(RegionTree *tree, uintptr_t address)
+{
+    Region *region = tree->root;
+    Region *candidate = nullptr;
+
+    while (region)
+    {
+        if (region->base <= address)
+        {
+            candidate = region;
+            region = region->right;
+        }
+        else
+        {
+            region = region->left;
+        }
+    }
+
+    return candidate;
+}
+
+Region *region_tree_lookup(RegionTree *tree, uintptr_t address)
+{
+    ASSERT_ATOMIC;
+
+    Region *region = region_tree_floor(tree, address);
+
+    if (region && address - region->base < region->size)
+    {
+        return region;
+    }
+
+    return nullptr;
+}
+
+bool region_tree_contains(RegionTree *tree, MemoryRange range)
+{
+    ASSERT_ATOMIC;
+
+    Region *region = region_tree_lookup(tree, range.base());
+
+    return region && range.end() - region->base < region->size;
+}
+
+bool region_tree_overlaps(RegionTree *tree, MemoryRange range)
+{
+    ASSERT_ATOMIC;
+
+    if (range.empty())
+    {
+        return false;
+    }
+
+    Region *region = region_tree_floor(tree, range.end());
+
+    return region && region->base + region->size - 1 >= range.base();
+}
+
+static bool region_iterate(Region *region, void *target, RegionIterationCallback callback)
+{
+    if (!region)
+    {
+        return true;
+    }
+
+    return region_iterate(region->left, target, callback) &&
+           callback(target, region) == Iteration::CONTINUE &&
+           region_iterate(region->right, target, callback);
+}
+
+bool region_tree_iterate(RegionTree *tree, void *target, RegionIterationCallback callback)
+{
+    ASSERT_ATOMIC;
+
+    return region_iterate(tree->root, target, callback);
+}
+
+void region_tree_clear(RegionTree *tree)
+{
+    ASSERT_ATOMIC;
+
+    region_destroy(tree->root);
+    tree->root = nullptr;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <libsystem/Common.h>
+#include <libutils/Iteration.h>
+
+#include "kernel/memory/MemoryRange.h"
+
+// A treap of disjoint address ranges sorted by base address. Each node keeps
+// the size of the largest range of its subtree, so the first range large
+// enough for an allocation is found in O(log n).
+struct Region
+{
+    uintptr_t base;
+    size_t size;
+    void *data;
+
+    size_t largest;
+    uint32_t priority;
+
+    Region *left;
+    Region *right;
+};
+
+struct RegionTree
+{
+    Region *root;
+};
+
+typedef Iteration (*RegionIterationCallback)(void *target, Region *region);
+
+/* --- Free space ----------------------------------------------------------- */
+
+// Adds the range to the tree, merging it with its neighbours.
+void region_tree_release(RegionTree *tree, MemoryRange range);
+
+// Removes the range from the tree, splitting the ranges around it.
+void region_tree_reserve(RegionTree *tree, MemoryRange range);
+
+// Returns the lowest range of the given size, or an empty range.
+MemoryRange region_tree_find(RegionTree *tree, size_t size);
+
+/* --- Objects -------------------------------------------------------------- */
+
+void region_tree_insert(RegionTree *tree, MemoryRange range, void *data);
+
+void *region_tree_remove(RegionTree *tree, uintptr_t base);
+
+/* --- Queries -------------------------------------------------------------- */
+
+Region *region_tree_lookup(RegionTree *tree, uintptr_t address);
+
+bool region_tree_contains(RegionTree *tree, MemoryRange range);
+
+bool region_tree_overlaps(RegionTree *tree, MemoryRange range);
+
+bool region_tree_iterate(RegionTree *tree, void *target, RegionIterationCallback callback);
+
+void region_tree_clear(RegionTree *tree);
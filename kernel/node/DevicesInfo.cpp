@@ -8,6 +8,7 @@
 
 #include "kernel/devices/Devices.h"
 #include "kernel/filesystem/Filesystem.h"
+#include "kernel/interrupts/Dispatcher.h"
 #include "kernel/node/DevicesInfo.h"
 #include "kernel/node/Handle.h"
 
@@ -33,6 +34,23 @@ Result FsDeviceInfo::open(FsHandle *handle)
         json::object_put(device_object, "refcount", json::create_integer(device->refcount()));
         json::object_put(device_object, "description", json::create_string(driver->name()));
 
+        if (device->interrupt() != -1)
+        {
+            auto statistics = dispatcher_get_statistics(device->interrupt());
+            auto latencies = json::create_array();
+
+            for (size_t i = 0; i < DISPATCHER_LATENCY_BUCKETS; i++)
+            {
+                json::array_append(latencies, json::create_integer(statistics.latencies[i]));
+            }
+
+            json::object_put(device_object, "threaded", json::create_boolean(device->interrupt_threaded()));
+            json::object_put(device_object, "interrupts", json::create_integer(statistics.handled));
+            json::object_put(device_object, "raised", json::create_integer(statistics.raised));
+            json::object_put(device_object, "worst_latency", json::create_integer(statistics.worst_latency));
+            json::object_put(device_object, "latencies", latencies);
+        }
+
         json::array_append(root, device_object);
 
         return Iteration::CONTINUE;
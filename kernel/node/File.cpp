@@ -4,6 +4,7 @@
 #include <libsystem/core/CString.h>
 #include <libsystem/math/MinMax.h>
 
+#include "kernel/memory/MemoryObject.h"
 #include "kernel/node/File.h"
 #include "kernel/node/Handle.h"
 
@@ -23,6 +24,8 @@ Result FsFile::open(FsHandle *handle)
 {
     if (handle->has_flag(OPEN_TRUNC))
     {
+        memory_object_invalidate_file(this, _buffer, _buffer_size);
+
         free(_buffer);
         _buffer = (char *)malloc(512);
         _buffer_allocated = 512;
@@ -52,6 +55,8 @@ ResultOr<size_t> FsFile::read(FsHandle &handle, void *buffer, size_t size)
 
 ResultOr<size_t> FsFile::write(FsHandle &handle, const void *buffer, size_t size)
 {
+    memory_object_invalidate_file(this, _buffer, _buffer_size);
+
     if ((handle.offset + size) > _buffer_allocated)
     {
         _buffer = (char *)realloc(_buffer, handle.offset + size);
@@ -5,16 +5,25 @@
 #include <libsystem/core/CString.h>
 #include <libsystem/math/MinMax.h>
 
+#include "kernel/memory/ObjectCache.h"
 #include "kernel/node/Connection.h"
 #include "kernel/node/Handle.h"
+#include "kernel/node/Poll.h"
 #include "kernel/scheduling/Blocker.h"
 #include "kernel/scheduling/Scheduler.h"
 
-FsHandle *fshandle_create(FsNode *node, OpenFlag flags)
+static void fshandle_construct(void *object)
 {
-    FsHandle *handle = __create(FsHandle);
+    FsHandle *handle = (FsHandle *)object;
 
     lock_init(handle->lock);
+}
+
+static ObjectCache _fshandle_cache = OBJECT_CACHE(FsHandle, 64, fshandle_construct);
+
+FsHandle *fshandle_create(FsNode *node, OpenFlag flags)
+{
+    FsHandle *handle = object_cache_create(FsHandle, &_fshandle_cache);
 
     handle->offset = 0;
     handle->flags = flags;
@@ -30,11 +39,9 @@ FsHandle *fshandle_create(FsNode *node, OpenFlag flags)
 
 FsHandle *fshandle_clone(FsHandle *handle)
 {
-    FsHandle *clone = __create(FsHandle);
+    FsHandle *clone = object_cache_create(FsHandle, &_fshandle_cache);
     FsNode *node = handle->node;
 
-    lock_init(clone->lock);
-
     clone->offset = handle->offset;
     clone->flags = handle->flags;
     node->ref_handle(*handle);
@@ -51,12 +58,20 @@ void fshandle_destroy(FsHandle *handle)
 {
     FsNode *node = handle->node;
 
+    fspoll_forget_handle(handle);
+
+    // The handle might hold the last reference, but release() still wakes
+    // up whoever is waiting on the node, keep it alive until then.
+    node->ref();
+
     node->acquire(scheduler_running_id());
     node->close(handle);
     node->deref_handle(*handle);
     node->release(scheduler_running_id());
 
-    free(handle);
+    object_cache_free(&_fshandle_cache, handle);
+
+    node->deref();
 }
 
 SelectEvent fshandle_select(FsHandle *handle, SelectEvent events)
@@ -114,7 +129,8 @@ Result fshandle_read(FsHandle *handle, void *buffer, size_t size, size_t *read)
 
     FsNode *node = handle->node;
 
-    task_block(scheduler_running(), new BlockerRead(handle), -1);
+    BlockerRead blocker{handle};
+    task_block(scheduler_running(), blocker, -1);
 
     auto result_or_read = node->read(*handle, buffer, size);
 
@@ -137,7 +153,8 @@ static Result fshandle_write_internal(FsHandle *handle, const void *buffer, size
 {
     FsNode *node = handle->node;
 
-    task_block(scheduler_running(), new BlockerWrite(handle), -1);
+    BlockerWrite blocker{handle};
+    task_block(scheduler_running(), blocker, -1);
 
     if (handle->has_flag(OPEN_APPEND))
     {
@@ -308,7 +325,8 @@ Result fshandle_connect(FsNode *node, FsHandle **connection_handle)
 
     *connection_handle = fshandle_create(connection, OPEN_CLIENT);
 
-    task_block(scheduler_running(), new BlockerConnect(connection), -1);
+    BlockerConnect blocker{connection};
+    task_block(scheduler_running(), blocker, -1);
 
     connection->deref();
 
@@ -319,7 +337,8 @@ Result fshandle_accept(FsHandle *handle, FsHandle **connection_handle)
 {
     FsNode *node = handle->node;
 
-    task_block(scheduler_running(), new BlockerAccept(node), -1);
+    BlockerAccept blocker{node};
+    task_block(scheduler_running(), blocker, -1);
 
     auto connection_or_result = node->accept();
 
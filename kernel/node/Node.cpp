@@ -1,17 +1,23 @@
 
+#include <libsystem/Assert.h>
 #include <libsystem/Logger.h>
 #include <libsystem/core/CString.h>
+#include <libsystem/thread/Atomic.h>
 
 #include "kernel/filesystem/Filesystem.h"
+#include "kernel/node/Poll.h"
+#include "kernel/scheduling/Scheduler.h"
 
 FsNode::FsNode(FileType type)
 {
     lock_init(_lock);
     this->type = type;
+    _watches = list_create();
 }
 
 FsNode::~FsNode()
 {
+    list_destroy(_watches);
 }
 
 void FsNode::ref_handle(FsHandle &handle)
@@ -67,4 +73,80 @@ void FsNode::acquire(int who_acquire)
 void FsNode::release(int who_release)
 {
     lock_release_by(_lock, who_release);
+
+    // Every change to the state of a node happen while it's acquired, so
+    // this is the right time to check if someone can make progress.
+    wakeup();
+}
+
+bool FsNode::subscribe(FsSubscription &subscription, Task *task)
+{
+    ASSERT_ATOMIC;
+
+    if (is_polled())
+    {
+        return false;
+    }
+
+    subscription.task = task;
+    subscription.previous = nullptr;
+    subscription.next = _subscribers;
+
+    if (_subscribers)
+    {
+        _subscribers->previous = &subscription;
+    }
+
+    _subscribers = &subscription;
+
+    return true;
+}
+
+void FsNode::unsubscribe(FsSubscription &subscription)
+{
+    ASSERT_ATOMIC;
+
+    if (!subscription.task)
+    {
+        return;
+    }
+
+    if (subscription.previous)
+    {
+        subscription.previous->next = subscription.next;
+    }
+    else
+    {
+        _subscribers = subscription.next;
+    }
+
+    if (subscription.next)
+    {
+        subscription.next->previous = subscription.previous;
+    }
+
+    subscription = {};
+}
+
+void FsNode::wakeup()
+{
+    AtomicHolder holder;
+
+    FsSubscription *subscription = _subscribers;
+
+    while (subscription)
+    {
+        // Unblocked tasks unsubscribe themselves, from every node they were
+        // waiting on, so the next subscription might be gone too.
+        if (scheduler_try_unblock(subscription->task))
+        {
+            subscription = _subscribers;
+        }
+        else
+        {
+            subscription = subscription->next;
+        }
+    }
+
+    fspoll_notify(this);
 }
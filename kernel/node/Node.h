@@ -3,11 +3,22 @@
 #include <libsystem/Result.h>
 #include <libsystem/io/Stream.h>
 #include <libsystem/thread/Lock.h>
+#include <libsystem/utils/List.h>
 #include <libutils/RefCounted.h>
 #include <libutils/ResultOr.h>
 
 struct FsNode;
 struct FsHandle;
+struct Task;
+
+// A task waiting on a node. Blockers own them, so blocking doesn't allocate.
+struct FsSubscription
+{
+    Task *task;
+
+    FsSubscription *previous;
+    FsSubscription *next;
+};
 
 struct FsNode : public RefCounted<FsNode>
 {
@@ -20,6 +31,12 @@ struct FsNode : public RefCounted<FsNode>
     uint server = 0;
     uint master = 0;
 
+    // Tasks blocked on this node, woken up by wakeup().
+    FsSubscription *_subscribers = nullptr;
+
+    // Polls watching this node, notified by wakeup().
+    List *_watches;
+
 public:
     FsNode(FileType type);
 
@@ -125,4 +142,15 @@ public:
     void acquire(int who_acquire);
 
     void release(int who_release);
+
+    // Nodes whose state can change outside of acquire()/release(), like
+    // hardware backed devices, can't wake up their subscribers and
+    // should be polled by the scheduler instead.
+    virtual bool is_polled() { return false; }
+
+    bool subscribe(FsSubscription &subscription, Task *task);
+
+    void unsubscribe(FsSubscription &subscription);
+
+    void wakeup();
 };
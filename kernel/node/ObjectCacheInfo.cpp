@@ -0,0 +1,71 @@
+#include <libjson/Json.h>
+#include <libsystem/Result.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/math/MinMax.h>
+
+#include "kernel/filesystem/Filesystem.h"
+#include "kernel/memory/ObjectCache.h"
+#include "kernel/node/Handle.h"
+#include "kernel/node/ObjectCacheInfo.h"
+
+FsObjectCacheInfo::FsObjectCacheInfo() : FsNode(FILE_TYPE_DEVICE)
+{
+}
+
+static Iteration serialize_cache(json::Value *root, ObjectCache *cache)
+{
+    auto cache_object = json::create_object();
+
+    json::object_put(cache_object, "name", json::create_string(cache->name));
+    json::object_put(cache_object, "size", json::create_integer(cache->size));
+    json::object_put(cache_object, "allocations", json::create_integer(cache->statistics.allocations));
+    json::object_put(cache_object, "hits", json::create_integer(cache->statistics.hits));
+    json::object_put(cache_object, "in_use", json::create_integer(cache->statistics.in_use));
+    json::object_put(cache_object, "cached", json::create_integer(cache->statistics.cached));
+    json::object_put(cache_object, "reclaimed", json::create_integer(cache->statistics.reclaimed));
+
+    json::array_append(root, cache_object);
+
+    return Iteration::CONTINUE;
+}
+
+Result FsObjectCacheInfo::open(FsHandle *handle)
+{
+    auto root = json::create_array();
+
+    object_cache_iterate(root, (ObjectCacheIterateCallback)serialize_cache);
+
+    handle->attached = json::stringify(root);
+    handle->attached_size = strlen((const char *)handle->attached);
+
+    json::destroy(root);
+
+    return SUCCESS;
+}
+
+void FsObjectCacheInfo::close(FsHandle *handle)
+{
+    if (handle->attached)
+    {
+        free(handle->attached);
+    }
+}
+
+ResultOr<size_t> FsObjectCacheInfo::read(FsHandle &handle, void *buffer, size_t size)
+{
+    size_t read = 0;
+
+    if (handle.offset <= handle.attached_size)
+    {
+        read = MIN(handle.attached_size - handle.offset, size);
+        memcpy(buffer, (char *)handle.attached + handle.offset, read);
+    }
+
+    return read;
+}
+
+void object_cache_info_initialize()
+{
+    auto info_device = new FsObjectCacheInfo();
+    filesystem_link_and_take_ref_cstring("/System/caches", info_device);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "kernel/node/Node.h"
+
+class FsObjectCacheInfo : public FsNode
+{
+private:
+public:
+    FsObjectCacheInfo();
+
+    Result open(FsHandle *handle) override;
+
+    void close(FsHandle *handle) override;
+
+    ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size) override;
+};
+
+void object_cache_info_initialize();
@@ -0,0 +1,238 @@
+#include <libsystem/Assert.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "kernel/node/Handle.h"
+#include "kernel/node/Poll.h"
+
+FsPoll::FsPoll() : FsNode(FILE_TYPE_POLL)
+{
+    _watches = list_create();
+    _ready = list_create();
+    _polled = list_create();
+}
+
+FsPoll::~FsPoll()
+{
+    AtomicHolder holder;
+
+    FsPollWatch *watch = nullptr;
+
+    while ((watch = (FsPollWatch *)list_peek(_watches)))
+    {
+        forget(watch);
+    }
+
+    list_destroy(_watches);
+    list_destroy(_ready);
+    list_destroy(_polled);
+}
+
+FsPollWatch *FsPoll::find(FsHandle *handle)
+{
+    list_foreach(FsPollWatch, watch, _watches)
+    {
+        if (watch->handle == handle)
+        {
+            return watch;
+        }
+    }
+
+    return nullptr;
+}
+
+void FsPoll::refresh_polled()
+{
+    list_foreach(FsPollWatch, watch, _polled)
+    {
+        if (!watch->queued && fshandle_select(watch->handle, watch->events))
+        {
+            enqueue(watch);
+        }
+    }
+}
+
+bool FsPoll::can_read(FsHandle *handle)
+{
+    __unused(handle);
+
+    AtomicHolder holder;
+
+    refresh_polled();
+
+    return _ready->any();
+}
+
+bool FsPoll::can_write(FsHandle *handle)
+{
+    __unused(handle);
+
+    return false;
+}
+
+bool FsPoll::is_polled()
+{
+    return _polled->any();
+}
+
+Result FsPoll::add(FsHandle *handle, SelectEvent events, uintptr_t user_data)
+{
+    if (handle->node == this)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    AtomicHolder holder;
+
+    FsPollWatch *watch = find(handle);
+
+    if (watch == nullptr)
+    {
+        watch = __create(FsPollWatch);
+
+        watch->poll = this;
+        watch->handle = handle;
+
+        list_pushback(_watches, watch);
+        list_pushback(handle->node->_watches, watch);
+
+        if (handle->node->is_polled())
+        {
+            list_pushback(_polled, watch);
+        }
+    }
+
+    watch->events = events;
+    watch->user_data = user_data;
+
+    // Nodes only tell us when they change, it might already be ready.
+    if (!watch->queued && fshandle_select(handle, events))
+    {
+        enqueue(watch);
+    }
+
+    return SUCCESS;
+}
+
+Result FsPoll::remove(FsHandle *handle)
+{
+    AtomicHolder holder;
+
+    FsPollWatch *watch = find(handle);
+
+    if (watch == nullptr)
+    {
+        return ERR_NO_SUCH_FILE_OR_DIRECTORY;
+    }
+
+    forget(watch);
+
+    return SUCCESS;
+}
+
+struct PollCollect
+{
+    PollEvent *events;
+    size_t count;
+    size_t collected;
+    List *ready;
+};
+
+static Iteration collect_watch(PollCollect *collect, FsPollWatch *watch)
+{
+    SelectEvent selected = fshandle_select(watch->handle, watch->events);
+
+    if (selected == 0)
+    {
+        list_remove(collect->ready, watch);
+        watch->queued = false;
+
+        return Iteration::CONTINUE;
+    }
+
+    collect->events[collect->collected] = {watch->user_data, selected};
+    collect->collected++;
+
+    if (collect->collected == collect->count)
+    {
+        return Iteration::STOP;
+    }
+
+    return Iteration::CONTINUE;
+}
+
+size_t FsPoll::collect(PollEvent *events, size_t count)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    AtomicHolder holder;
+
+    refresh_polled();
+
+    PollCollect collect{events, count, 0, _ready};
+
+    // Watches which aren't ready anymore remove themselves,
+    // list_iterate() is fine with that.
+    list_iterate(_ready, &collect, (ListIterationCallback)collect_watch);
+
+    return collect.collected;
+}
+
+void FsPoll::enqueue(FsPollWatch *watch)
+{
+    ASSERT_ATOMIC;
+
+    list_pushback(_ready, watch);
+    watch->queued = true;
+
+    // Tasks waiting on us, and the polls watching us.
+    wakeup();
+}
+
+void FsPoll::forget(FsPollWatch *watch)
+{
+    ASSERT_ATOMIC;
+
+    list_remove(_watches, watch);
+    list_remove(_polled, watch);
+    list_remove(watch->handle->node->_watches, watch);
+
+    if (watch->queued)
+    {
+        list_remove(_ready, watch);
+    }
+
+    free(watch);
+}
+
+void fspoll_notify(FsNode *node)
+{
+    ASSERT_ATOMIC;
+
+    list_foreach(FsPollWatch, watch, node->_watches)
+    {
+        if (!watch->queued && fshandle_select(watch->handle, watch->events))
+        {
+            watch->poll->enqueue(watch);
+        }
+    }
+}
+
+static Iteration forget_watch(FsHandle *handle, FsPollWatch *watch)
+{
+    if (watch->handle == handle)
+    {
+        watch->poll->forget(watch);
+    }
+
+    return Iteration::CONTINUE;
+}
+
+void fspoll_forget_handle(FsHandle *handle)
+{
+    AtomicHolder holder;
+
+    list_iterate(handle->node->_watches, handle, (ListIterationCallback)forget_watch);
+}
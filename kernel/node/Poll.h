@@ -0,0 +1,69 @@
+#pragma once
+
+#include <abi/Poll.h>
+
+#include "kernel/node/Node.h"
+
+class FsPoll;
+
+// Handles reported by a single wait, the others stay ready for the next one.
+#define POLL_COLLECT_MAX (64)
+
+struct FsPollWatch
+{
+    FsPoll *poll;
+    FsHandle *handle;
+    SelectEvent events;
+    uintptr_t user_data;
+
+    // In the ready list of the poll, until a wait finds out it isn't
+    // ready anymore.
+    bool queued;
+};
+
+// A persistent set of handles to wait on. Handles are registered once, and
+// the nodes they point to queue their watches on the ready list when their
+// state changes, so a wait only looks at handles which are, or just were,
+// ready instead of every registered one.
+class FsPoll : public FsNode
+{
+private:
+    List *_watches;
+    List *_ready;
+
+    // Watches on nodes which can't wake us up, checked on every wait.
+    List *_polled;
+
+    FsPollWatch *find(FsHandle *handle);
+
+    void refresh_polled();
+
+public:
+    FsPoll();
+
+    ~FsPoll();
+
+    bool can_read(FsHandle *handle) override;
+
+    bool can_write(FsHandle *handle) override;
+
+    bool is_polled() override;
+
+    Result add(FsHandle *handle, SelectEvent events, uintptr_t user_data);
+
+    Result remove(FsHandle *handle);
+
+    // Fills events with the handles still ready, level-triggered: a handle
+    // is reported again until it's not ready anymore.
+    size_t collect(PollEvent *events, size_t count);
+
+    void enqueue(FsPollWatch *watch);
+
+    void forget(FsPollWatch *watch);
+};
+
+// Called by FsNode::wakeup().
+void fspoll_notify(FsNode *node);
+
+// Called when a handle is destroyed, drops every watch on it.
+void fspoll_forget_handle(FsHandle *handle);
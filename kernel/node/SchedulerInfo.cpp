@@ -0,0 +1,64 @@
+#include <libjson/Json.h>
+#include <libsystem/Result.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/math/MinMax.h>
+
+#include "kernel/filesystem/Filesystem.h"
+#include "kernel/node/Handle.h"
+#include "kernel/node/SchedulerInfo.h"
+#include "kernel/scheduling/Scheduler.h"
+
+FsSchedulerInfo::FsSchedulerInfo() : FsNode(FILE_TYPE_DEVICE)
+{
+}
+
+Result FsSchedulerInfo::open(FsHandle *handle)
+{
+    auto statistics = scheduler_get_statistics();
+
+    auto root = json::create_object();
+
+    json::object_put(root, "schedules", json::create_integer(statistics.schedules));
+    json::object_put(root, "schedule_checks", json::create_integer(statistics.schedule_checks));
+    json::object_put(root, "blocker_checks", json::create_integer(statistics.blocker_checks));
+    json::object_put(root, "wakeups", json::create_integer(statistics.wakeups));
+    json::object_put(root, "timeouts", json::create_integer(statistics.timeouts));
+    json::object_put(root, "polled_tasks", json::create_integer(statistics.polled_tasks));
+    json::object_put(root, "timeout_tasks", json::create_integer(statistics.timeout_tasks));
+    json::object_put(root, "steals", json::create_integer(statistics.steals));
+    json::object_put(root, "cpus", json::create_integer(statistics.cpus));
+
+    handle->attached = json::stringify(root);
+    handle->attached_size = strlen((const char *)handle->attached);
+
+    json::destroy(root);
+
+    return SUCCESS;
+}
+
+void FsSchedulerInfo::close(FsHandle *handle)
+{
+    if (handle->attached)
+    {
+        free(handle->attached);
+    }
+}
+
+ResultOr<size_t> FsSchedulerInfo::read(FsHandle &handle, void *buffer, size_t size)
+{
+    size_t read = 0;
+
+    if (handle.offset <= handle.attached_size)
+    {
+        read = MIN(handle.attached_size - handle.offset, size);
+        memcpy(buffer, (char *)handle.attached + handle.offset, read);
+    }
+
+    return read;
+}
+
+void scheduler_info_initialize()
+{
+    auto info_device = new FsSchedulerInfo();
+    filesystem_link_and_take_ref_cstring("/System/scheduler", info_device);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "kernel/node/Node.h"
+
+class FsSchedulerInfo : public FsNode
+{
+private:
+public:
+    FsSchedulerInfo();
+
+    Result open(FsHandle *handle) override;
+
+    void close(FsHandle *handle) override;
+
+    ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size) override;
+};
+
+void scheduler_info_initialize();
@@ -15,6 +15,18 @@ void BlockerAccept::on_unblock(struct Task *task)
     _node->acquire(task->id);
 }
 
+bool BlockerAccept::subscribe(struct Task *task)
+{
+    return _node->subscribe(_subscription, task);
+}
+
+void BlockerAccept::unsubscribe(struct Task *task)
+{
+    __unused(task);
+
+    _node->unsubscribe(_subscription);
+}
+
 /* --- BlockerConnect ------------------------------------------------------- */
 
 bool BlockerConnect::can_unblock(struct Task *task)
@@ -23,6 +35,18 @@ bool BlockerConnect::can_unblock(struct Task *task)
     return _connection->is_accepted();
 }
 
+bool BlockerConnect::subscribe(struct Task *task)
+{
+    return _connection->subscribe(_subscription, task);
+}
+
+void BlockerConnect::unsubscribe(struct Task *task)
+{
+    __unused(task);
+
+    _connection->unsubscribe(_subscription);
+}
+
 /* --- BlockerRead ---------------------------------------------------------- */
 
 bool BlockerRead::can_unblock(Task *task)
@@ -37,6 +61,18 @@ void BlockerRead::on_unblock(Task *task)
     _handle->node->acquire(task->id);
 }
 
+bool BlockerRead::subscribe(Task *task)
+{
+    return _handle->node->subscribe(_subscription, task);
+}
+
+void BlockerRead::unsubscribe(Task *task)
+{
+    __unused(task);
+
+    _handle->node->unsubscribe(_subscription);
+}
+
 /* --- BlockerSelect -------------------------------------------------------- */
 
 bool BlockerSelect::can_unblock(Task *task)
@@ -72,13 +108,49 @@ void BlockerSelect::on_unblock(Task *task)
     }
 }
 
+bool BlockerSelect::subscribe(Task *task)
+{
+    for (size_t i = 0; i < _count; i++)
+    {
+        if (_handles[i]->node->is_polled())
+        {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < _count; i++)
+    {
+        _handles[i]->node->subscribe(_subscriptions[i], task);
+    }
+
+    return true;
+}
+
+void BlockerSelect::unsubscribe(Task *task)
+{
+    __unused(task);
+
+    for (size_t i = 0; i < _count; i++)
+    {
+        _handles[i]->node->unsubscribe(_subscriptions[i]);
+    }
+}
+
 /* --- BlockerTime ---------------------------------------------------------- */
 
 bool BlockerTime::can_unblock(Task *task)
 {
     __unused(task);
 
-    return system_get_tick() >= _wakeup_tick;
+    return system_get_clock() >= _wakeup;
+}
+
+bool BlockerTime::subscribe(Task *task)
+{
+    __unused(task);
+
+    // There is nothing to wait for but the deadline queue of the scheduler.
+    return true;
 }
 
 /* --- BlockerWait ---------------------------------------------------------- */
@@ -111,3 +183,15 @@ void BlockerWrite::on_unblock(Task *task)
 {
     _handle->node->acquire(task->id);
 }
+
+bool BlockerWrite::subscribe(Task *task)
+{
+    return _handle->node->subscribe(_subscription, task);
+}
+
+void BlockerWrite::unsubscribe(Task *task)
+{
+    __unused(task);
+
+    _handle->node->unsubscribe(_subscription);
+}
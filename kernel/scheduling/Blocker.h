@@ -16,7 +16,9 @@ enum BlockerResult
 struct Blocker
 {
     BlockerResult _result;
-    TimeStamp _timeout;
+    // Microseconds since boot, or ARCH_NO_DEADLINE.
+    uint64_t _timeout;
+    bool _subscribed = false;
 
     virtual ~Blocker() {}
 
@@ -35,12 +37,28 @@ struct Blocker
     {
         __unused(task);
     }
+
+    // Register the task on the nodes this blocker is waiting for, so it is
+    // woken up by FsNode::wakeup() instead of being polled by the scheduler
+    // on every tick. Return false if the task must be polled.
+    virtual bool subscribe(struct Task *task)
+    {
+        __unused(task);
+
+        return false;
+    }
+
+    virtual void unsubscribe(struct Task *task)
+    {
+        __unused(task);
+    }
 };
 
 class BlockerAccept : public Blocker
 {
 private:
     FsNode *_node;
+    FsSubscription _subscription{};
 
 public:
     BlockerAccept(FsNode *node) : _node(node)
@@ -50,12 +68,17 @@ public:
     bool can_unblock(struct Task *task);
 
     void on_unblock(struct Task *task);
+
+    bool subscribe(Task *task);
+
+    void unsubscribe(Task *task);
 };
 
 class BlockerConnect : public Blocker
 {
 private:
     FsNode *_connection;
+    FsSubscription _subscription{};
 
 public:
     BlockerConnect(FsNode *connection)
@@ -64,12 +87,17 @@ public:
     }
 
     bool can_unblock(struct Task *task);
+
+    bool subscribe(Task *task);
+
+    void unsubscribe(Task *task);
 };
 
 class BlockerRead : public Blocker
 {
 private:
     FsHandle *_handle;
+    FsSubscription _subscription{};
 
 public:
     BlockerRead(FsHandle *handle)
@@ -80,8 +108,15 @@ public:
     bool can_unblock(Task *task);
 
     void on_unblock(Task *task);
+
+    bool subscribe(Task *task);
+
+    void unsubscribe(Task *task);
 };
 
+// Selects on more handles than that allocate their subscriptions.
+#define BLOCKER_SELECT_INLINE_SUBSCRIPTIONS (8)
+
 class BlockerSelect : public Blocker
 {
 private:
@@ -92,6 +127,9 @@ private:
     FsHandle **_selected;
     SelectEvent *_selected_events;
 
+    FsSubscription *_subscriptions;
+    FsSubscription _inline_subscriptions[BLOCKER_SELECT_INLINE_SUBSCRIPTIONS] = {};
+
 public:
     BlockerSelect(FsHandle **handles,
                   SelectEvent *events,
@@ -102,27 +140,46 @@ public:
           _events(events),
           _count(count),
           _selected(selected),
-          _selected_events(selected_events)
+          _selected_events(selected_events),
+          _subscriptions(_inline_subscriptions)
+    {
+        if (count > BLOCKER_SELECT_INLINE_SUBSCRIPTIONS)
+        {
+            _subscriptions = (FsSubscription *)calloc(count, sizeof(FsSubscription));
+        }
+    }
+
+    ~BlockerSelect()
     {
+        if (_subscriptions != _inline_subscriptions)
+        {
+            free(_subscriptions);
+        }
     }
 
     bool can_unblock(Task *task);
 
     void on_unblock(Task *task);
+
+    bool subscribe(Task *task);
+
+    void unsubscribe(Task *task);
 };
 
 class BlockerTime : public Blocker
 {
 private:
-    uint _wakeup_tick;
+    uint64_t _wakeup;
 
 public:
-    BlockerTime(uint wakeup_tick)
-        : _wakeup_tick(wakeup_tick)
+    BlockerTime(uint64_t wakeup)
+        : _wakeup(wakeup)
     {
     }
 
     bool can_unblock(Task *task);
+
+    bool subscribe(Task *task);
 };
 
 class BlockerWait : public Blocker
@@ -146,6 +203,7 @@ class BlockerWrite : public Blocker
 {
 private:
     FsHandle *_handle;
+    FsSubscription _subscription{};
 
 public:
     BlockerWrite(FsHandle *handle)
@@ -156,4 +214,8 @@ public:
     bool can_unblock(Task *task);
 
     void on_unblock(Task *task);
+
+    bool subscribe(Task *task);
+
+    void unsubscribe(Task *task);
 };
@@ -1,3 +1,4 @@
+#include <libsystem/math/MinMax.h>
 #include <libsystem/thread/Atomic.h>
 
 #include "arch/Arch.h"
@@ -6,29 +7,278 @@
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
 
-static bool scheduler_context_switch = false;
-static int scheduler_record[SCHEDULER_RECORD_COUNT] = {};
+// Every CPU runs the tasks of its own run queues, tasks only move to another
+// CPU while they aren't running.
+struct SchedulerCPU
+{
+    bool context_switch;
+    int record[SCHEDULER_RECORD_COUNT];
+    uint32_t recorded_until;
+
+    Task *running;
+    Task *idle;
+
+    List *running_tasks[__TASK_PRIORITY_COUNT];
+    size_t running_count;
+
+    // Tasks blocked on this CPU with a blocker that can't subscribe to a
+    // node, and the ones with a timeout, sorted by deadline and linked
+    // through the tasks themselves.
+    List *blocked_tasks;
+    Task *timeout_tasks;
+    size_t timeout_count;
 
-static Task *running = nullptr;
-static Task *idle = nullptr;
+    // The CPU only gets a timer interrupt when it has something to do: the
+    // end of the time slice if other tasks are waiting, the next timeout, or
+    // polling blockers.
+    uint64_t slice_end;
+    uint64_t deadline;
+};
 
-static List *blocked_tasks;
-static List *running_tasks;
+static SchedulerCPU _cpus[ARCH_MAX_CPU_COUNT] = {};
+
+static SchedulerStatistics statistics = {};
 
 void scheduler_initialize()
 {
-    blocked_tasks = list_create();
-    running_tasks = list_create();
+    for (int cpu = 0; cpu < ARCH_MAX_CPU_COUNT; cpu++)
+    {
+        for (size_t i = 0; i < __TASK_PRIORITY_COUNT; i++)
+        {
+            _cpus[cpu].running_tasks[i] = list_create();
+        }
+
+        _cpus[cpu].blocked_tasks = list_create();
+        _cpus[cpu].deadline = ARCH_NO_DEADLINE;
+    }
 }
 
 void scheduler_did_create_idle_task(Task *task)
 {
-    idle = task;
+    ASSERT_ATOMIC;
+
+    task->cpu = arch_cpu_current();
+    _cpus[task->cpu].idle = task;
 }
 
 void scheduler_did_create_running_task(Task *task)
 {
-    running = task;
+    ASSERT_ATOMIC;
+
+    task->cpu = arch_cpu_current();
+    _cpus[task->cpu].running = task;
+}
+
+static bool scheduler_cpu_is_idle(int cpu)
+{
+    return _cpus[cpu].idle && _cpus[cpu].running == _cpus[cpu].idle;
+}
+
+bool scheduler_is_running(Task *task)
+{
+    ASSERT_ATOMIC;
+
+    return _cpus[task->cpu].running == task;
+}
+
+// Tasks waking up on a busy CPU go to an idle one instead, if they can.
+static void scheduler_place_task(Task *task)
+{
+    if (scheduler_is_running(task) || !_cpus[task->cpu].idle || scheduler_cpu_is_idle(task->cpu))
+    {
+        return;
+    }
+
+    for (int cpu = 0; cpu < ARCH_MAX_CPU_COUNT; cpu++)
+    {
+        if (scheduler_cpu_is_idle(cpu))
+        {
+            task->cpu = cpu;
+            return;
+        }
+    }
+}
+
+static void scheduler_enqueue(Task *task)
+{
+    SchedulerCPU &cpu = _cpus[task->cpu];
+
+    list_push(cpu.running_tasks[task->priority], task);
+    cpu.running_count++;
+}
+
+static void scheduler_dequeue(Task *task)
+{
+    SchedulerCPU &cpu = _cpus[task->cpu];
+
+    list_remove(cpu.running_tasks[task->priority], task);
+    cpu.running_count--;
+}
+
+// Tasks in the run queues of the CPU, but the one running on it.
+static size_t scheduler_waiting_count(int cpu)
+{
+    size_t waiting = _cpus[cpu].running_count;
+
+    if (_cpus[cpu].running && _cpus[cpu].running->state() == TASK_STATE_RUNNING)
+    {
+        waiting--;
+    }
+
+    return waiting;
+}
+
+static uint64_t scheduler_next_deadline(int cpu)
+{
+    SchedulerCPU &current = _cpus[cpu];
+    uint64_t deadline = ARCH_NO_DEADLINE;
+
+    if (scheduler_waiting_count(cpu) > 0)
+    {
+        deadline = current.slice_end;
+    }
+
+    Task *task = current.timeout_tasks;
+
+    if (task)
+    {
+        deadline = MIN(deadline, task->blocker->_timeout);
+    }
+
+    if (current.blocked_tasks->count() > 0)
+    {
+        deadline = MIN(deadline, system_get_clock() + SCHEDULER_POLL_INTERVAL);
+    }
+
+    return deadline;
+}
+
+// Only a CPU can program its own timer, the others ask it to go through
+// schedule() when it should fire sooner.
+static void scheduler_update_timer(int cpu)
+{
+    uint64_t deadline = scheduler_next_deadline(cpu);
+
+    if (cpu == arch_cpu_current())
+    {
+        _cpus[cpu].deadline = deadline;
+        arch_timer_deadline(deadline);
+    }
+    else if (deadline < _cpus[cpu].deadline)
+    {
+        arch_cpu_reschedule(cpu);
+    }
+}
+
+static void scheduler_timeout_insert(SchedulerCPU &cpu, Task *task)
+{
+    Task *previous = nullptr;
+    Task *next = cpu.timeout_tasks;
+
+    // After the tasks with the same deadline, they were here first.
+    while (next && next->blocker->_timeout <= task->blocker->_timeout)
+    {
+        previous = next;
+        next = next->timeout_next;
+    }
+
+    task->timeout_previous = previous;
+    task->timeout_next = next;
+
+    if (previous)
+    {
+        previous->timeout_next = task;
+    }
+    else
+    {
+        cpu.timeout_tasks = task;
+    }
+
+    if (next)
+    {
+        next->timeout_previous = task;
+    }
+
+    cpu.timeout_count++;
+}
+
+static void scheduler_timeout_remove(SchedulerCPU &cpu, Task *task)
+{
+    if (task->timeout_previous)
+    {
+        task->timeout_previous->timeout_next = task->timeout_next;
+    }
+    else
+    {
+        cpu.timeout_tasks = task->timeout_next;
+    }
+
+    if (task->timeout_next)
+    {
+        task->timeout_next->timeout_previous = task->timeout_previous;
+    }
+
+    task->timeout_previous = nullptr;
+    task->timeout_next = nullptr;
+
+    cpu.timeout_count--;
+}
+
+// Blocked tasks don't move, they stay in the lists of their CPU until they
+// are unblocked.
+static void scheduler_did_block_task(Task *task)
+{
+    SchedulerCPU &cpu = _cpus[task->cpu];
+    Blocker *blocker = task->blocker;
+
+    blocker->_subscribed = blocker->subscribe(task);
+
+    if (!blocker->_subscribed)
+    {
+        list_push(cpu.blocked_tasks, task);
+    }
+
+    if (blocker->_timeout != ARCH_NO_DEADLINE)
+    {
+        scheduler_timeout_insert(cpu, task);
+    }
+}
+
+static void scheduler_did_unblock_task(Task *task)
+{
+    SchedulerCPU &cpu = _cpus[task->cpu];
+    Blocker *blocker = task->blocker;
+
+    if (blocker->_subscribed)
+    {
+        blocker->unsubscribe(task);
+    }
+    else
+    {
+        list_remove(cpu.blocked_tasks, task);
+    }
+
+    if (blocker->_timeout != ARCH_NO_DEADLINE)
+    {
+        scheduler_timeout_remove(cpu, task);
+    }
+}
+
+void scheduler_set_task_priority(Task *task, TaskPriority priority)
+{
+    ASSERT_ATOMIC;
+
+    // Running tasks are in the run queue of their priority.
+    if (task->state() == TASK_STATE_RUNNING)
+    {
+        scheduler_dequeue(task);
+        task->priority = priority;
+        scheduler_enqueue(task);
+    }
+    else
+    {
+        task->priority = priority;
+    }
 }
 
 void scheduler_did_change_task_state(Task *task, TaskState oldstate, TaskState newstate)
@@ -39,38 +289,62 @@ void scheduler_did_change_task_state(Task *task, TaskState oldstate, TaskState n
     {
         if (oldstate == TASK_STATE_RUNNING)
         {
-            list_remove(running_tasks, task);
+            scheduler_dequeue(task);
         }
 
         if (oldstate == TASK_STATE_BLOCKED)
         {
-            list_remove(blocked_tasks, task);
+            scheduler_did_unblock_task(task);
         }
 
         if (newstate == TASK_STATE_BLOCKED)
         {
-            list_push(blocked_tasks, task);
+            scheduler_did_block_task(task);
         }
 
         if (newstate == TASK_STATE_RUNNING)
         {
-            list_push(running_tasks, task);
+            scheduler_place_task(task);
+            scheduler_enqueue(task);
+        }
+
+        // Idle CPUs have something to do now, and tasks which stopped
+        // running on another CPU have to leave it.
+        if (task->cpu != arch_cpu_current() &&
+            (scheduler_cpu_is_idle(task->cpu) || scheduler_is_running(task)))
+        {
+            arch_cpu_reschedule(task->cpu);
+        }
+        else
+        {
+            scheduler_update_timer(task->cpu);
         }
     }
 }
 
 bool scheduler_is_context_switch()
 {
-    return scheduler_context_switch;
+    bool interrupts = arch_save_interrupts();
+    bool result = _cpus[arch_cpu_current()].context_switch;
+    arch_restore_interrupts(interrupts);
+
+    return result;
 }
 
 Task *scheduler_running()
 {
-    return running;
+    // The task must not move to another CPU between the two reads.
+    bool interrupts = arch_save_interrupts();
+    Task *result = _cpus[arch_cpu_current()].running;
+    arch_restore_interrupts(interrupts);
+
+    return result;
 }
 
 int scheduler_running_id()
 {
+    Task *running = scheduler_running();
+
     if (running == nullptr)
     {
         return -1;
@@ -84,68 +358,228 @@ void scheduler_yield()
     arch_yield();
 }
 
+// Every tick since the last record goes to the task which was running, the
+// CPU might have been without interrupts for a while.
+static void scheduler_record(int cpu)
+{
+    SchedulerCPU &current = _cpus[cpu];
+    uint32_t now = system_get_tick();
+    uint32_t tick = current.recorded_until;
+
+    if (now - tick > SCHEDULER_RECORD_COUNT)
+    {
+        tick = now - SCHEDULER_RECORD_COUNT;
+    }
+
+    for (; tick != now; tick++)
+    {
+        current.record[tick % SCHEDULER_RECORD_COUNT] = current.running->id;
+    }
+
+    current.recorded_until = now;
+}
+
 int scheduler_get_usage(int task_id)
 {
     AtomicHolder holder;
 
     int count = 0;
 
-    for (int i = 0; i < SCHEDULER_RECORD_COUNT; i++)
+    for (int cpu = 0; cpu < ARCH_MAX_CPU_COUNT; cpu++)
     {
-        if (scheduler_record[i] == task_id)
+        if (_cpus[cpu].idle)
+        {
+            scheduler_record(cpu);
+        }
+
+        for (int i = 0; _cpus[cpu].idle && i < SCHEDULER_RECORD_COUNT; i++)
         {
-            count++;
+            if (_cpus[cpu].record[i] == task_id)
+            {
+                count++;
+            }
         }
     }
 
     return (count * 100) / SCHEDULER_RECORD_COUNT;
 }
 
-static Iteration wakeup_task_if_unblocked(void *target, Task *task)
+SchedulerStatistics scheduler_get_statistics()
 {
-    __unused(target);
+    AtomicHolder holder;
+
+    SchedulerStatistics result = statistics;
+
+    for (int cpu = 0; cpu < ARCH_MAX_CPU_COUNT; cpu++)
+    {
+        result.polled_tasks += _cpus[cpu].blocked_tasks->count();
+        result.timeout_tasks += _cpus[cpu].timeout_count;
+    }
+
+    result.cpus = arch_cpu_count();
+
+    return result;
+}
+
+bool scheduler_try_unblock(Task *task)
+{
+    ASSERT_ATOMIC;
 
     Blocker *blocker = task->blocker;
 
+    statistics.blocker_checks++;
+
     if (blocker->can_unblock(task))
     {
         blocker->on_unblock(task);
         blocker->_result = BLOCKER_UNBLOCKED;
         task->state(TASK_STATE_RUNNING);
+
+        statistics.wakeups++;
+
+        return true;
+    }
+
+    return false;
+}
+
+static Iteration wakeup_task_if_unblocked(void *target, Task *task)
+{
+    __unused(target);
+
+    scheduler_try_unblock(task);
+
+    return Iteration::CONTINUE;
+}
+
+static void wakeup_timed_out_tasks(int cpu)
+{
+    Task *task = _cpus[cpu].timeout_tasks;
+
+    while (task && task->blocker->_timeout <= system_get_clock())
+    {
+        Blocker *blocker = task->blocker;
+
+        if (!scheduler_try_unblock(task))
+        {
+            blocker->on_timeout(task);
+            blocker->_result = BLOCKER_TIMEOUT;
+            task->state(TASK_STATE_RUNNING);
+
+            statistics.timeouts++;
+        }
+
+        task = _cpus[cpu].timeout_tasks;
     }
-    else if (blocker->_timeout != (Timeout)-1 &&
-             blocker->_timeout <= system_get_tick())
+}
+
+// Takes a task waiting in the run queues of the busiest CPU.
+static Task *steal_task(int cpu)
+{
+    int busiest = -1;
+    size_t most_waiting = 0;
+
+    for (int i = 0; i < ARCH_MAX_CPU_COUNT; i++)
     {
-        blocker->on_timeout(task);
-        blocker->_result = BLOCKER_TIMEOUT;
-        task->state(TASK_STATE_RUNNING);
+        if (i == cpu || !_cpus[i].idle)
+        {
+            continue;
+        }
+
+        size_t waiting = scheduler_waiting_count(i);
+
+        if (waiting > most_waiting)
+        {
+            busiest = i;
+            most_waiting = waiting;
+        }
     }
 
-    return Iteration::CONTINUE;
+    if (busiest == -1)
+    {
+        return nullptr;
+    }
+
+    for (int i = __TASK_PRIORITY_COUNT - 1; i >= 0; i--)
+    {
+        list_foreach(Task, task, _cpus[busiest].running_tasks[i])
+        {
+            if (task != _cpus[busiest].running)
+            {
+                scheduler_dequeue(task);
+                task->cpu = cpu;
+                scheduler_enqueue(task);
+
+                statistics.steals++;
+
+                return task;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+static Task *pick_next_task(int cpu)
+{
+    Task *task = nullptr;
+
+    for (int i = __TASK_PRIORITY_COUNT - 1; i >= 0; i--)
+    {
+        if (list_peek_and_pushback(_cpus[cpu].running_tasks[i], (void **)&task))
+        {
+            return task;
+        }
+    }
+
+    task = steal_task(cpu);
+
+    if (task)
+    {
+        return task;
+    }
+
+    return _cpus[cpu].idle;
 }
 
 uintptr_t schedule(uintptr_t current_stack_pointer)
 {
-    scheduler_context_switch = true;
+    int cpu = arch_cpu_current();
+    SchedulerCPU &current = _cpus[cpu];
 
-    running->kernel_stack_pointer = current_stack_pointer;
-    arch_save_context(running);
+    current.context_switch = true;
 
-    scheduler_record[system_get_tick() % SCHEDULER_RECORD_COUNT] = running->id;
+    current.running->kernel_stack_pointer = current_stack_pointer;
 
-    list_iterate(blocked_tasks, nullptr, (ListIterationCallback)wakeup_task_if_unblocked);
+    scheduler_record(cpu);
 
-    // Get the next task
-    if (!list_peek_and_pushback(running_tasks, (void **)&running))
+    statistics.schedules++;
+
+    size_t checks_before = statistics.blocker_checks;
+
+    wakeup_timed_out_tasks(cpu);
+    list_iterate(current.blocked_tasks, nullptr, (ListIterationCallback)wakeup_task_if_unblocked);
+
+    statistics.schedule_checks += statistics.blocker_checks - checks_before;
+
+    Task *next = pick_next_task(cpu);
+
+    // Most interrupts of an idle CPU or of a task alone on its CPU don't
+    // switch anything.
+    if (next != current.running)
     {
-        // Or the idle task if there are no running tasks.
-        running = idle;
+        arch_save_context(current.running);
+
+        current.running = next;
+
+        arch_address_space_switch(current.running->address_space);
+        arch_load_context(current.running);
     }
 
-    arch_address_space_switch(running->address_space);
-    arch_load_context(running);
+    current.slice_end = system_get_clock() + SCHEDULER_TIME_SLICE;
+    scheduler_update_timer(cpu);
 
-    scheduler_context_switch = false;
+    current.context_switch = false;
 
-    return running->kernel_stack_pointer;
+    return current.running->kernel_stack_pointer;
 }
@@ -4,6 +4,31 @@
 
 #define SCHEDULER_RECORD_COUNT 1000
 
+// In microseconds. Tasks sharing a CPU take turns at every time slice, and
+// blockers which can't subscribe to a node are polled that often.
+#define SCHEDULER_TIME_SLICE (2000)
+#define SCHEDULER_POLL_INTERVAL (1000)
+
+struct SchedulerStatistics
+{
+    // Number of passes of schedule() and how many blockers they had to
+    // check, the ratio of the two is the cost of a pass.
+    size_t schedules;
+    size_t schedule_checks;
+
+    // Blockers checked by the scheduler and by node wakeups.
+    size_t blocker_checks;
+    size_t wakeups;
+    size_t timeouts;
+
+    size_t polled_tasks;
+    size_t timeout_tasks;
+
+    // Tasks an idle CPU took from the run queues of another one.
+    size_t steals;
+    size_t cpus;
+};
+
 void scheduler_initialize();
 
 void scheduler_did_create_idle_task(Task *task);
@@ -12,10 +37,20 @@ void scheduler_did_create_running_task(Task *task);
 
 void scheduler_did_change_task_state(Task *task, TaskState oldstate, TaskState newstate);
 
+// Moves the task to the run queue of its new priority, if it's in one.
+void scheduler_set_task_priority(Task *task, TaskPriority priority);
+
 bool scheduler_is_context_switch();
 
+// Whether the task is on a CPU right now, its stack is still in use.
+bool scheduler_is_running(Task *task);
+
 int scheduler_get_usage(int task_id);
 
+SchedulerStatistics scheduler_get_statistics();
+
+bool scheduler_try_unblock(Task *task);
+
 Task *scheduler_running();
 
 int scheduler_running_id();
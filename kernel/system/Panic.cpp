@@ -57,6 +57,7 @@ void system_panic_internal(
 {
     atomic_begin();
     atomic_disable();
+    arch_cpu_stop_others();
 
     font_set_bg(0xff333333);
 
@@ -4,6 +4,7 @@
 #include "arch/Arch.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
+#include "kernel/system/SystemPage.h"
 
 void system_hang()
 {
@@ -25,21 +26,19 @@ void system_stop()
     }
 }
 
-static uint32_t _system_tick;
-
 void system_tick()
 {
-    if (_system_tick + 1 < _system_tick)
-    {
-        system_panic("System tick overflow!");
-    }
-
-    _system_tick++;
+    system_page_update(system_get_tick());
 }
 
 uint32_t system_get_tick()
 {
-    return _system_tick;
+    return arch_get_clock() / (1000000 / SYSTEM_TICKS_PER_SECOND);
+}
+
+uint64_t system_get_clock()
+{
+    return arch_get_clock();
 }
 
 static TimeStamp _system_boot_timestamp = 0;
@@ -5,6 +5,10 @@
 
 #include "kernel/handover/Handover.h"
 
+// Ticks are milliseconds, the timer only ticks that often when it can't do
+// one-shot deadlines.
+#define SYSTEM_TICKS_PER_SECOND (1000)
+
 void system_main(Handover *handover);
 
 void system_initialize();
@@ -13,10 +17,14 @@ void __no_return system_hang();
 
 void __no_return system_stop();
 
+// Called on every tick of a periodic timer.
 void system_tick();
 
 uint32_t system_get_tick();
 
+// Microseconds since boot, for deadlines finer than a tick.
+uint64_t system_get_clock();
+
 ElapsedTime system_get_uptime();
 
 #define system_panic(__args...) \
@@ -0,0 +1,94 @@
+#include <libsystem/Logger.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "arch/Arch.h"
+#include "arch/VirtualMemory.h"
+
+#include "kernel/memory/Memory.h"
+#include "kernel/system/System.h"
+#include "kernel/system/SystemPage.h"
+
+static SystemPage *_system_page = nullptr;
+static uintptr_t _system_page_physical = 0;
+
+static TimeStamp _boot_time = 0;
+static uint32_t _boot_tick = 0;
+
+void system_page_initialize()
+{
+    AtomicHolder holder;
+
+    if (memory_alloc(arch_kernel_address_space(), ARCH_PAGE_SIZE, MEMORY_CLEAR, (uintptr_t *)&_system_page) != SUCCESS)
+    {
+        system_panic("Failed to allocate the system page!");
+    }
+
+    _system_page_physical = arch_virtual_to_physical(arch_kernel_address_space(), (uintptr_t)_system_page);
+
+    // Reading the RTC is too slow to do on every tick, the time is counted
+    // from the ticks instead.
+    _boot_time = arch_get_time();
+    _boot_tick = system_get_tick();
+
+    _system_page->flags = arch_system_page_flags();
+    system_page_update(_boot_tick);
+
+    logger_info("System page at %08x (flags=%x)", SYSTEM_PAGE_ADDRESS, _system_page->flags);
+}
+
+void system_page_update(uint32_t tick)
+{
+    if (!_system_page)
+    {
+        return;
+    }
+
+    _system_page->sequence = _system_page->sequence + 1;
+    asm volatile("" ::: "memory");
+
+    _system_page->tick = tick;
+    _system_page->time = _boot_time + (tick - _boot_tick) / SYSTEM_TICKS_PER_SECOND;
+
+    asm volatile("" ::: "memory");
+    _system_page->sequence = _system_page->sequence + 1;
+}
+
+void system_page_set_cycles(uint64_t cycles_base, uint64_t clock_base, uint32_t cycles_mult)
+{
+    if (!_system_page)
+    {
+        return;
+    }
+
+    _system_page->sequence = _system_page->sequence + 1;
+    asm volatile("" ::: "memory");
+
+    _system_page->cycles_base = cycles_base;
+    _system_page->clock_base = clock_base;
+    _system_page->cycles_mult = cycles_mult;
+
+    // The time is counted from boot, like in system_page_update().
+    _system_page->tick = _boot_tick;
+    _system_page->time = _boot_time;
+
+    _system_page->flags = _system_page->flags | SYSTEM_PAGE_CYCLES;
+
+    asm volatile("" ::: "memory");
+    _system_page->sequence = _system_page->sequence + 1;
+}
+
+void system_page_map(void *address_space)
+{
+    AtomicHolder holder;
+
+    arch_virtual_map(address_space, MemoryRange{_system_page_physical, ARCH_PAGE_SIZE}, SYSTEM_PAGE_ADDRESS, MEMORY_USER | MEMORY_READONLY);
+}
+
+// The page is shared, it must be unmapped before the address space is
+// destroyed or its frame would be freed with the rest.
+void system_page_unmap(void *address_space)
+{
+    AtomicHolder holder;
+
+    arch_virtual_free(address_space, MemoryRange{SYSTEM_PAGE_ADDRESS, ARCH_PAGE_SIZE});
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <abi/SystemPage.h>
+
+void system_page_initialize();
+
+// Called on every tick, with interrupts disabled.
+void system_page_update(uint32_t tick);
+
+// From then on, userspace computes the clock from the cycle counter and the
+// page stops being updated.
+void system_page_set_cycles(uint64_t cycles_base, uint64_t clock_base, uint32_t cycles_mult);
+
+void system_page_map(void *address_space);
+
+void system_page_unmap(void *address_space);
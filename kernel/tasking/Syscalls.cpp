@@ -5,6 +5,7 @@
 #include <libsystem/BuildInfo.h>
 #include <libsystem/Logger.h>
 #include <libsystem/Result.h>
+#include <libsystem/core/Allocator.h>
 #include <libsystem/core/CString.h>
 #include <libsystem/thread/Atomic.h>
 
@@ -15,10 +16,11 @@
 #include "kernel/tasking/Syscalls.h"
 #include "kernel/tasking/Task-Directory.h"
 #include "kernel/tasking/Task-Handles.h"
+#include "kernel/tasking/Task-IORing.h"
 #include "kernel/tasking/Task-Lanchpad.h"
 #include "kernel/tasking/Task-Memory.h"
 
-typedef Result (*SyscallHandler)(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+typedef Result (*SyscallHandler)(uintptr_t, uintptr_t, uintptr_t, uintptr_t, uintptr_t);
 
 bool syscall_validate_ptr(uintptr_t ptr, size_t size)
 {
@@ -245,6 +247,10 @@ Result sys_system_get_status(SystemStatus *status)
     status->total_ram = memory_get_total();
     status->used_ram = memory_get_used();
 
+    AllocatorStatistics heap = allocator_statistics();
+    status->kernel_heap_reserved = heap.reserved;
+    status->kernel_heap_used = heap.used;
+
     status->running_tasks = task_count();
     status->cpu_usage = 100 - scheduler_get_usage(0);
 
@@ -305,6 +311,39 @@ Result sys_create_term(int *master_handle, int *slave_handle)
     return task_create_term(scheduler_running(), master_handle, slave_handle);
 }
 
+Result sys_create_poll(int *poll_handle)
+{
+    if (!syscall_validate_ptr((uintptr_t)poll_handle, sizeof(int)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    return task_create_poll(scheduler_running(), poll_handle);
+}
+
+/* --- Poll ----------------------------------------------------------------- */
+
+Result sys_poll_add(int poll_handle, int handle, SelectEvent events, uintptr_t user_data)
+{
+    return task_poll_add(scheduler_running(), poll_handle, handle, events, user_data);
+}
+
+Result sys_poll_remove(int poll_handle, int handle)
+{
+    return task_poll_remove(scheduler_running(), poll_handle, handle);
+}
+
+Result sys_poll_wait(int poll_handle, PollEvent *events, size_t count, size_t *ready, Timeout timeout)
+{
+    if (!syscall_validate_ptr((uintptr_t)events, sizeof(PollEvent) * count) ||
+        !syscall_validate_ptr((uintptr_t)ready, sizeof(size_t)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    return task_poll_wait(scheduler_running(), poll_handle, events, count, ready, timeout);
+}
+
 /* --- Handles -------------------------------------------------------------- */
 
 Result sys_handle_open(int *handle, const char *path, OpenFlag flags)
@@ -431,6 +470,16 @@ Result sys_handle_accept(int handle, int *connection_handle)
     return task_fshandle_accept(scheduler_running(), handle, connection_handle);
 }
 
+Result sys_handle_submit(IORing *ring, size_t wait_for, Timeout timeout)
+{
+    if (!syscall_validate_ptr((uintptr_t)ring, sizeof(IORing)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    return task_io_ring_submit(scheduler_running(), ring, wait_for, timeout);
+}
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wcast-function-type"
 
@@ -469,8 +518,13 @@ static SyscallHandler syscalls[__SYSCALL_COUNT] = {
     [SYS_HANDLE_STAT] = reinterpret_cast<SyscallHandler>(sys_handle_stat),
     [SYS_HANDLE_CONNECT] = reinterpret_cast<SyscallHandler>(sys_handle_connect),
     [SYS_HANDLE_ACCEPT] = reinterpret_cast<SyscallHandler>(sys_handle_accept),
+    [SYS_HANDLE_SUBMIT] = reinterpret_cast<SyscallHandler>(sys_handle_submit),
     [SYS_CREATE_PIPE] = reinterpret_cast<SyscallHandler>(sys_create_pipe),
     [SYS_CREATE_TERM] = reinterpret_cast<SyscallHandler>(sys_create_term),
+    [SYS_CREATE_POLL] = reinterpret_cast<SyscallHandler>(sys_create_poll),
+    [SYS_POLL_ADD] = reinterpret_cast<SyscallHandler>(sys_poll_add),
+    [SYS_POLL_REMOVE] = reinterpret_cast<SyscallHandler>(sys_poll_remove),
+    [SYS_POLL_WAIT] = reinterpret_cast<SyscallHandler>(sys_poll_wait),
 };
 
 #pragma GCC diagnostic pop
@@ -496,7 +550,7 @@ SyscallHandler syscall_get_handler(Syscall syscall)
 #define SYSCALL_NAMES_ENTRY(__entry) #__entry,
 static const char *syscall_names[] = {SYSCALL_LIST(SYSCALL_NAMES_ENTRY)};
 
-int task_do_syscall(Syscall syscall, int arg0, int arg1, int arg2, int arg3, int arg4)
+int task_do_syscall(Syscall syscall, uintptr_t arg0, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t arg4)
 {
     SyscallHandler handler = syscall_get_handler(syscall);
 
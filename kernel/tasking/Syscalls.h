@@ -4,4 +4,6 @@
 
 #include <libsystem/Common.h>
 
-int task_do_syscall(Syscall syscall, int arg0, int arg1, int arg2, int arg3, int arg4);
+bool syscall_validate_ptr(uintptr_t ptr, size_t size);
+
+int task_do_syscall(Syscall syscall, uintptr_t arg0, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t arg4);
@@ -1,11 +1,15 @@
 
 #include <libsystem/Logger.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/math/MinMax.h>
 
 #include "kernel/filesystem/Filesystem.h"
 #include "kernel/node/Pipe.h"
+#include "kernel/node/Poll.h"
 #include "kernel/node/Terminal.h"
 #include "kernel/scheduling/Blocker.h"
 #include "kernel/scheduling/Scheduler.h"
+#include "kernel/system/System.h"
 #include "kernel/tasking/Task-Directory.h"
 #include "kernel/tasking/Task-Handles.h"
 
@@ -167,7 +171,8 @@ Result task_fshandle_select(
     }
 
     {
-        BlockerResult blocker_result = task_block(task, new BlockerSelect(handles, handles_set->events, handles_set->count, &selected_handle, selected_events), timeout);
+        BlockerSelect blocker{handles, handles_set->events, handles_set->count, &selected_handle, selected_events};
+        BlockerResult blocker_result = task_block(task, blocker, timeout);
 
         if (blocker_result == BLOCKER_TIMEOUT)
         {
@@ -437,3 +442,162 @@ cleanup_and_return:
 
     return result;
 }
+
+Result task_create_poll(Task *task, int *poll_handle_index)
+{
+    FsNode *poll = new FsPoll();
+
+    FsHandle *poll_handle = fshandle_create(poll, OPEN_READ);
+
+    Result result = task_fshandle_add(task, poll_handle_index, poll_handle);
+
+    if (result != SUCCESS)
+    {
+        *poll_handle_index = HANDLE_INVALID_ID;
+        fshandle_destroy(poll_handle);
+    }
+
+    poll->deref();
+
+    return result;
+}
+
+static FsHandle *task_poll_acquire(Task *task, int poll_handle_index)
+{
+    FsHandle *poll_handle = task_fshandle_acquire(task, poll_handle_index);
+
+    if (poll_handle == nullptr)
+    {
+        return nullptr;
+    }
+
+    if (poll_handle->node->type != FILE_TYPE_POLL)
+    {
+        task_fshandle_release(task, poll_handle_index);
+        return nullptr;
+    }
+
+    return poll_handle;
+}
+
+Result task_poll_add(Task *task, int poll_handle_index, int handle_index, SelectEvent events, uintptr_t user_data)
+{
+    if (poll_handle_index == handle_index)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    FsHandle *poll_handle = task_poll_acquire(task, poll_handle_index);
+
+    if (poll_handle == nullptr)
+    {
+        return ERR_BAD_FILE_DESCRIPTOR;
+    }
+
+    FsPoll *poll = static_cast<FsPoll *>(poll_handle->node);
+
+    FsHandle *handle = task_fshandle_acquire(task, handle_index);
+
+    if (handle == nullptr)
+    {
+        task_fshandle_release(task, poll_handle_index);
+        return ERR_BAD_FILE_DESCRIPTOR;
+    }
+
+    Result result = poll->add(handle, events, user_data);
+
+    task_fshandle_release(task, handle_index);
+    task_fshandle_release(task, poll_handle_index);
+
+    return result;
+}
+
+Result task_poll_remove(Task *task, int poll_handle_index, int handle_index)
+{
+    if (poll_handle_index == handle_index)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    FsHandle *poll_handle = task_poll_acquire(task, poll_handle_index);
+
+    if (poll_handle == nullptr)
+    {
+        return ERR_BAD_FILE_DESCRIPTOR;
+    }
+
+    FsPoll *poll = static_cast<FsPoll *>(poll_handle->node);
+
+    FsHandle *handle = task_fshandle_acquire(task, handle_index);
+
+    if (handle == nullptr)
+    {
+        task_fshandle_release(task, poll_handle_index);
+        return ERR_BAD_FILE_DESCRIPTOR;
+    }
+
+    Result result = poll->remove(handle);
+
+    task_fshandle_release(task, handle_index);
+    task_fshandle_release(task, poll_handle_index);
+
+    return result;
+}
+
+Result task_poll_wait(Task *task, int poll_handle_index, PollEvent *events, size_t count, size_t *ready, Timeout timeout)
+{
+    *ready = 0;
+
+    FsHandle *poll_handle = task_poll_acquire(task, poll_handle_index);
+
+    if (poll_handle == nullptr)
+    {
+        return ERR_BAD_FILE_DESCRIPTOR;
+    }
+
+    FsPoll *poll = static_cast<FsPoll *>(poll_handle->node);
+
+    SelectEvent wanted = SELECT_READ;
+
+    TimeStamp deadline = system_get_tick() + timeout;
+    Result result = SUCCESS;
+
+    // The events are collected while atomic, where user memory can't be
+    // faulted in, so they go through the kernel stack.
+    PollEvent collected[POLL_COLLECT_MAX];
+    size_t collected_count = MIN(count, POLL_COLLECT_MAX);
+
+    while ((*ready = poll->collect(collected, collected_count)) == 0)
+    {
+        Timeout remaining = (Timeout)-1;
+
+        if (timeout != (Timeout)-1)
+        {
+            if (deadline <= system_get_tick())
+            {
+                result = TIMEOUT;
+                break;
+            }
+
+            remaining = deadline - system_get_tick();
+        }
+
+        // Only the poll is waited on, the watched nodes wake it up.
+        FsHandle *selected = nullptr;
+        SelectEvent selected_events = 0;
+
+        BlockerSelect blocker{&poll_handle, &wanted, 1, &selected, &selected_events};
+
+        if (task_block(task, blocker, remaining) == BLOCKER_TIMEOUT)
+        {
+            result = TIMEOUT;
+            break;
+        }
+    }
+
+    memcpy(events, collected, sizeof(PollEvent) * *ready);
+
+    task_fshandle_release(task, poll_handle_index);
+
+    return result;
+}
@@ -1,7 +1,15 @@
 #pragma once
 
+#include <abi/Poll.h>
+
 #include "kernel/tasking/Task.h"
 
+// Locks the handle until task_fshandle_release(), returns nullptr if the
+// index is invalid.
+FsHandle *task_fshandle_acquire(Task *task, int handle_index);
+
+Result task_fshandle_release(Task *task, int handle_index);
+
 Result task_fshandle_open(Task *task, int *handle_index, const char *path, OpenFlag flags);
 
 Result task_fshandle_close(Task *task, int handle_index);
@@ -38,3 +46,11 @@ Result task_fshandle_receive(Task *task, int handle_index, void *buffer, size_t
 Result task_create_pipe(Task *task, int *reader_handle_index, int *writer_handle_index);
 
 Result task_create_term(Task *task, int *master_handle_index, int *slave_handle_index);
+
+Result task_create_poll(Task *task, int *poll_handle_index);
+
+Result task_poll_add(Task *task, int poll_handle_index, int handle_index, SelectEvent events, uintptr_t user_data);
+
+Result task_poll_remove(Task *task, int poll_handle_index, int handle_index);
+
+Result task_poll_wait(Task *task, int poll_handle_index, PollEvent *events, size_t count, size_t *ready, Timeout timeout);
@@ -0,0 +1,424 @@
+#include <abi/Filesystem.h>
+
+#include <libsystem/Logger.h>
+#include <libsystem/core/CString.h>
+
+#include "kernel/scheduling/Blocker.h"
+#include "kernel/system/System.h"
+#include "kernel/tasking/Syscalls.h"
+#include "kernel/tasking/Task-Handles.h"
+#include "kernel/tasking/Task-IORing.h"
+
+#define IORING_MASK (IORING_CAPACITY - 1)
+
+static void io_ring_complete(IORing *ring, const IOSubmission &submission, Result result, size_t value)
+{
+    ring->completions[ring->completion_tail & IORING_MASK] = {submission.user_data, result, value};
+
+    // Userspace must never see the tail before the completion.
+    asm volatile("" ::: "memory");
+
+    ring->completion_tail = ring->completion_tail + 1;
+}
+
+static SelectEvent io_ring_wanted_events(const IOSubmission &submission)
+{
+    switch (submission.operation)
+    {
+    case IO_READ:
+        return SELECT_READ;
+
+    case IO_WRITE:
+        return SELECT_WRITE;
+
+    case IO_SELECT:
+        return submission.flags;
+
+    case IO_POLL:
+        // A poll is readable when one of its handles is ready.
+        return SELECT_READ;
+
+    default:
+        return 0;
+    }
+}
+
+static size_t io_ring_cancel(IORingPending *pending, uintptr_t user_data)
+{
+    size_t canceled = 0;
+
+    for (size_t i = 0; i < pending->count;)
+    {
+        if (pending->submissions[i].user_data == user_data)
+        {
+            memmove(&pending->submissions[i], &pending->submissions[i + 1], (pending->count - i - 1) * sizeof(IOSubmission));
+            pending->count--;
+            canceled++;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    return canceled;
+}
+
+// Returns false if the handle isn't ready, the operation stays pending.
+static bool io_ring_try(Task *task, IORing *ring, IORingPending *pending, const IOSubmission &submission)
+{
+    if (submission.operation == IO_POLL && submission.size == 0)
+    {
+        // Nothing could ever be reported, it would never complete.
+        io_ring_complete(ring, submission, ERR_INVALID_ARGUMENT, 0);
+        return true;
+    }
+
+    if (submission.operation == IO_POLL &&
+        (submission.size > (size_t)-1 / sizeof(PollEvent) ||
+         !syscall_validate_ptr(submission.buffer, submission.size * sizeof(PollEvent))))
+    {
+        io_ring_complete(ring, submission, ERR_BAD_ADDRESS, 0);
+        return true;
+    }
+
+    SelectEvent wanted = io_ring_wanted_events(submission);
+
+    if (wanted)
+    {
+        FsHandle *handle = task_fshandle_acquire(task, submission.handle);
+
+        if (handle == nullptr)
+        {
+            io_ring_complete(ring, submission, ERR_BAD_FILE_DESCRIPTOR, 0);
+            return true;
+        }
+
+        SelectEvent selected = fshandle_select(handle, wanted);
+
+        task_fshandle_release(task, submission.handle);
+
+        if (selected == 0)
+        {
+            return false;
+        }
+
+        if (submission.operation == IO_SELECT)
+        {
+            io_ring_complete(ring, submission, SUCCESS, selected);
+            return true;
+        }
+    }
+
+    if ((submission.operation == IO_READ ||
+         submission.operation == IO_WRITE ||
+         submission.operation == IO_OPEN) &&
+        !syscall_validate_ptr(submission.buffer, submission.size))
+    {
+        io_ring_complete(ring, submission, ERR_BAD_ADDRESS, 0);
+        return true;
+    }
+
+    switch (submission.operation)
+    {
+    case IO_NOP:
+        io_ring_complete(ring, submission, SUCCESS, 0);
+        break;
+
+    case IO_READ:
+    {
+        size_t read = 0;
+        Result result = task_fshandle_read(task, submission.handle, (void *)submission.buffer, submission.size, &read);
+        io_ring_complete(ring, submission, result, read);
+        break;
+    }
+
+    case IO_WRITE:
+    {
+        size_t written = 0;
+        Result result = task_fshandle_write(task, submission.handle, (const void *)submission.buffer, submission.size, &written);
+        io_ring_complete(ring, submission, result, written);
+        break;
+    }
+
+    case IO_OPEN:
+    {
+        // The size comes from userspace, and so does the allocation below.
+        if (submission.size == 0 || submission.size > PATH_LENGTH)
+        {
+            io_ring_complete(ring, submission, ERR_INVALID_ARGUMENT, 0);
+            break;
+        }
+
+        // The path is copied, opening might block and the ring is writable
+        // by userspace.
+        char *path = (char *)malloc(submission.size + 1);
+        memcpy(path, (const char *)submission.buffer, submission.size);
+        path[submission.size] = '\0';
+
+        int handle = HANDLE_INVALID_ID;
+        Result result = task_fshandle_open(task, &handle, path, submission.flags);
+
+        free(path);
+
+        io_ring_complete(ring, submission, result, handle);
+        break;
+    }
+
+    case IO_SELECT:
+        // Nothing to wait for.
+        io_ring_complete(ring, submission, ERR_INVALID_ARGUMENT, 0);
+        break;
+
+    case IO_CLOSE:
+        io_ring_complete(ring, submission, task_fshandle_close(task, submission.handle), 0);
+        break;
+
+    case IO_CANCEL:
+        io_ring_complete(ring, submission, SUCCESS, io_ring_cancel(pending, submission.buffer));
+        break;
+
+    case IO_POLL:
+    {
+        size_t ready = 0;
+        Result result = task_poll_wait(task, submission.handle, (PollEvent *)submission.buffer, submission.size, &ready, 0);
+
+        // What woke us up was already collected by someone else.
+        if (result == TIMEOUT)
+        {
+            return false;
+        }
+
+        io_ring_complete(ring, submission, result, ready);
+        break;
+    }
+
+    default:
+        io_ring_complete(ring, submission, ERR_FUNCTION_NOT_IMPLEMENTED, 0);
+        break;
+    }
+
+    return true;
+}
+
+static size_t io_ring_retry_pending(Task *task, IORing *ring, IORingPending *pending)
+{
+    size_t completed = 0;
+
+    for (size_t i = 0; i < pending->count;)
+    {
+        if (io_ring_try(task, ring, pending, pending->submissions[i]))
+        {
+            memmove(&pending->submissions[i], &pending->submissions[i + 1], (pending->count - i - 1) * sizeof(IOSubmission));
+            pending->count--;
+            completed++;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    return completed;
+}
+
+static size_t io_ring_in_flight(IORing *ring, IORingPending *pending)
+{
+    return (ring->completion_tail - ring->completion_head) + pending->count;
+}
+
+static size_t io_ring_drain_submissions(Task *task, IORing *ring, IORingPending *pending)
+{
+    size_t completed = 0;
+
+    while (ring->submission_head != ring->submission_tail &&
+           io_ring_in_flight(ring, pending) < IORING_CAPACITY &&
+           pending->count < IORING_CAPACITY)
+    {
+        // Copied first, userspace could change it under our feet.
+        IOSubmission submission = ring->submissions[ring->submission_head & IORING_MASK];
+        ring->submission_head = ring->submission_head + 1;
+
+        if (io_ring_try(task, ring, pending, submission))
+        {
+            completed++;
+        }
+        else
+        {
+            pending->submissions[pending->count] = submission;
+            pending->count++;
+        }
+    }
+
+    return completed;
+}
+
+// Blocks until one of the pending operations might be ready.
+static BlockerResult io_ring_wait(Task *task, IORingPending *pending, Timeout timeout)
+{
+    int indexes[IORING_CAPACITY];
+    FsHandle *handles[IORING_CAPACITY];
+    SelectEvent events[IORING_CAPACITY];
+    size_t count = 0;
+
+    bool closed = false;
+
+    for (size_t i = 0; i < pending->count && !closed; i++)
+    {
+        const IOSubmission &submission = pending->submissions[i];
+
+        // Operations on the same handle are waited for together, a handle
+        // can't be acquired twice.
+        size_t index = 0;
+
+        while (index < count && indexes[index] != submission.handle)
+        {
+            index++;
+        }
+
+        if (index == count)
+        {
+            handles[count] = task_fshandle_acquire(task, submission.handle);
+
+            if (handles[count] == nullptr)
+            {
+                // The handle was closed, the retry will complete the operation.
+                closed = true;
+                break;
+            }
+
+            indexes[count] = submission.handle;
+            events[count] = 0;
+            count++;
+        }
+
+        events[index] |= io_ring_wanted_events(submission);
+    }
+
+    BlockerResult result = BLOCKER_UNBLOCKED;
+
+    if (!closed)
+    {
+        FsHandle *selected = nullptr;
+        SelectEvent selected_events = 0;
+
+        BlockerSelect blocker{handles, events, count, &selected, &selected_events};
+        result = task_block(task, blocker, timeout);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        task_fshandle_release(task, indexes[i]);
+    }
+
+    return result;
+}
+
+static IORingPending *io_ring_pending(Task *task, IORing *ring)
+{
+    for (IORingPending *pending = task->io_pending; pending; pending = pending->next)
+    {
+        if (pending->ring == ring)
+        {
+            return pending;
+        }
+    }
+
+    IORingPending *pending = __create(IORingPending);
+
+    pending->ring = ring;
+    pending->next = task->io_pending;
+    task->io_pending = pending;
+
+    return pending;
+}
+
+// Rings come and go with userspace, only keep track of the busy ones.
+static void io_ring_release_pending(Task *task, IORingPending *pending)
+{
+    if (pending->count > 0)
+    {
+        return;
+    }
+
+    IORingPending **link = &task->io_pending;
+
+    while (*link != pending)
+    {
+        link = &(*link)->next;
+    }
+
+    *link = pending->next;
+
+    free(pending);
+}
+
+static Result io_ring_submit(Task *task, IORing *ring, IORingPending *pending, size_t wait_for, Timeout timeout)
+{
+    TimeStamp deadline = system_get_tick() + timeout;
+
+    size_t completed = io_ring_retry_pending(task, ring, pending);
+    completed += io_ring_drain_submissions(task, ring, pending);
+
+    while (completed < wait_for && pending->count > 0)
+    {
+        Timeout remaining = (Timeout)-1;
+
+        if (timeout != (Timeout)-1)
+        {
+            if (deadline <= system_get_tick())
+            {
+                return TIMEOUT;
+            }
+
+            remaining = deadline - system_get_tick();
+        }
+
+        if (io_ring_wait(task, pending, remaining) == BLOCKER_TIMEOUT)
+        {
+            return TIMEOUT;
+        }
+
+        completed += io_ring_retry_pending(task, ring, pending);
+
+        // Completions made room for more submissions.
+        completed += io_ring_drain_submissions(task, ring, pending);
+    }
+
+    if (completed < wait_for && timeout != (Timeout)-1)
+    {
+        // Nothing left that could complete, but the caller still wants to
+        // sleep until its deadline, like a select on no handles.
+        if (deadline > system_get_tick())
+        {
+            task_sleep(task, deadline - system_get_tick());
+        }
+
+        return TIMEOUT;
+    }
+
+    return SUCCESS;
+}
+
+Result task_io_ring_submit(Task *task, IORing *ring, size_t wait_for, Timeout timeout)
+{
+    // Each ring has its own pending operations, they complete in the ring
+    // they were submitted to.
+    IORingPending *pending = io_ring_pending(task, ring);
+
+    Result result = io_ring_submit(task, ring, pending, wait_for, timeout);
+
+    io_ring_release_pending(task, pending);
+
+    return result;
+}
+
+void task_io_ring_destroy(Task *task)
+{
+    while (task->io_pending)
+    {
+        IORingPending *next = task->io_pending->next;
+        free(task->io_pending);
+        task->io_pending = next;
+    }
+}
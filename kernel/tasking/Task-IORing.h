@@ -0,0 +1,22 @@
+#pragma once
+
+#include <abi/IORing.h>
+
+#include "kernel/tasking/Task.h"
+
+// The operations taken from a ring that are waiting on their handle. A task
+// has one for each of its rings with operations pending.
+struct IORingPending
+{
+    IORing *ring;
+    IORingPending *next;
+
+    IOSubmission submissions[IORING_CAPACITY];
+    size_t count;
+};
+
+// Takes the submissions from the ring and completes what it can, then blocks
+// until at least wait_for operations completed in this call, or the timeout.
+Result task_io_ring_submit(Task *task, IORing *ring, size_t wait_for, Timeout timeout);
+
+void task_io_ring_destroy(Task *task);
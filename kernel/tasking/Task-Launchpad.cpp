@@ -5,7 +5,9 @@
 #include <libsystem/core/CString.h>
 #include <libsystem/thread/Atomic.h>
 
+#include "kernel/filesystem/Filesystem.h"
 #include "kernel/scheduling/Scheduler.h"
+#include "kernel/tasking/Task-Directory.h"
 #include "kernel/tasking/Task-Memory.h"
 #include "kernel/tasking/Task.h"
 
@@ -17,7 +19,22 @@ struct ELFLoader
     using Program = TELFFormat::Program;
     using Symbole = TELFFormat::Symbole;
 
-    static Result load_program(Task *task, Stream *elf_file, Program *program_header)
+    static Result read(FsHandle *elf_file, size_t offset, void *buffer, size_t size)
+    {
+        fshandle_seek(elf_file, offset, WHENCE_START);
+
+        size_t read = 0;
+        Result result = fshandle_read(elf_file, buffer, size, &read);
+
+        if (result != SUCCESS)
+        {
+            return result;
+        }
+
+        return read == size ? SUCCESS : ERR_EXEC_FORMAT_ERROR;
+    }
+
+    static Result load_program(Task *task, FsHandle *elf_file, Program *program_header)
     {
         if (program_header->vaddr <= 0x100000)
         {
@@ -25,37 +42,54 @@ struct ELFLoader
             return ERR_EXEC_FORMAT_ERROR;
         }
 
-        void *parent_address_space = task_switch_address_space(scheduler_running(), task->address_space);
-
         MemoryRange range = MemoryRange::around_non_aligned_address(program_header->vaddr, program_header->memsz);
 
-        task_memory_map(task, range.base(), range.size(), MEMORY_CLEAR);
+        // The file is mapped from the start of the page, so the offset has to
+        // be as far from a page boundary as the address.
+        size_t page_offset = program_header->vaddr - range.base();
 
-        stream_seek(elf_file, program_header->offset, WHENCE_START);
-        size_t read = stream_read(elf_file, (void *)program_header->vaddr, program_header->filesz);
-
-        if (read != program_header->filesz)
+        if (program_header->offset < page_offset ||
+            (program_header->offset - page_offset) % ARCH_PAGE_SIZE != 0)
         {
-            logger_error("Didn't read the right amount from the ELF file!");
-
-            task_switch_address_space(scheduler_running(), parent_address_space);
-
+            logger_error("ELF program isn't page aligned in the file!");
             return ERR_EXEC_FORMAT_ERROR;
         }
-        else
+
+        if (task_memory_mapping_colides(task, range.base(), range.size()))
         {
-            task_switch_address_space(scheduler_running(), parent_address_space);
+            logger_error("ELF program overlaps another one (0x%08x)!", program_header->vaddr);
+            return ERR_EXEC_FORMAT_ERROR;
+        }
 
-            return SUCCESS;
+        // Nothing is read now, pages come from the file the first time the
+        // task touches them. They are shared by every task running this
+        // executable, writable segments get a private copy of the pages they
+        // write to.
+        MemoryObject *memory_object = memory_object_create_from_file(
+            elf_file,
+            program_header->offset - page_offset,
+            page_offset + program_header->filesz,
+            range.size());
+
+        if (program_header->flags & ELF_PROGRAM_W)
+        {
+            MemoryObject *file_object = memory_object;
+            memory_object = memory_object_create_copy_on_write(file_object);
+            memory_object_deref(file_object);
         }
+
+        task_memory_mapping_create_at(task, memory_object, range.base());
+
+        memory_object_deref(memory_object);
+
+        return SUCCESS;
     }
 
-    static Result load(Task *task, Stream *elf_file)
+    static Result load(Task *task, FsHandle *elf_file)
     {
         Header elf_header;
-        size_t elf_header_size = stream_read(elf_file, &elf_header, sizeof(Header));
 
-        if (elf_header_size != sizeof(Header) || !elf_header.valid())
+        if (read(elf_file, 0, &elf_header, sizeof(Header)) != SUCCESS || !elf_header.valid())
         {
             return ERR_EXEC_FORMAT_ERROR;
         }
@@ -65,9 +99,8 @@ struct ELFLoader
         for (int i = 0; i < elf_header.phnum; i++)
         {
             Program elf_program_header;
-            stream_seek(elf_file, elf_header.phoff + elf_header.phentsize * i, WHENCE_START);
 
-            if (stream_read(elf_file, &elf_program_header, sizeof(Program)) != sizeof(Program))
+            if (read(elf_file, elf_header.phoff + elf_header.phentsize * i, &elf_program_header, sizeof(Program)) != SUCCESS)
             {
                 return ERR_EXEC_FORMAT_ERROR;
             }
@@ -110,12 +143,17 @@ Result task_launch(Task *parent_task, Launchpad *launchpad, int *pid)
 
     *pid = -1;
 
-    __cleanup(stream_cleanup) Stream *elf_file = stream_open(launchpad->executable, OPEN_READ);
+    Path *path = task_resolve_directory(parent_task, launchpad->executable);
+
+    FsHandle *elf_file = nullptr;
+    Result open_result = filesystem_open(path, OPEN_READ, &elf_file);
 
-    if (handle_has_error(elf_file))
+    path_destroy(path);
+
+    if (elf_file == nullptr)
     {
-        logger_error("Failed to open ELF file %s: %s!", launchpad->executable, handle_error_string(elf_file));
-        return handle_get_error(elf_file);
+        logger_error("Failed to open ELF file %s: %s!", launchpad->executable, result_to_string(open_result));
+        return open_result;
     }
 
     atomic_begin();
@@ -128,6 +166,9 @@ Result task_launch(Task *parent_task, Launchpad *launchpad, int *pid)
     Result result = ELFLoader<ELF32>::load(task, elf_file);
 #endif
 
+    // Mapped segments hold their own handle to the file.
+    fshandle_destroy(elf_file);
+
     if (result != SUCCESS)
     {
         task_destroy(task);
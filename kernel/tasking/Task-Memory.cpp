@@ -3,19 +3,22 @@
 
 #include "arch/VirtualMemory.h"
 
+#include "kernel/memory/ObjectCache.h"
 #include "kernel/tasking/Task-Memory.h"
 
+static ObjectCache _memory_mapping_cache = OBJECT_CACHE(MemoryMapping, 256, nullptr);
+
 MemoryMapping *task_memory_mapping_create(Task *task, MemoryObject *memory_object)
 {
     AtomicHolder holder;
 
-    MemoryMapping *memory_mapping = __create(MemoryMapping);
+    MemoryMapping *memory_mapping = object_cache_create(MemoryMapping, &_memory_mapping_cache);
 
     memory_mapping->object = memory_object_ref(memory_object);
-    memory_mapping->address = arch_virtual_alloc(task->address_space, memory_object->range(), MEMORY_USER).base();
-    memory_mapping->size = memory_object->range().size();
+    memory_mapping->address = arch_virtual_reserve(task->address_space, memory_object->size(), MEMORY_USER).base();
+    memory_mapping->size = memory_object->size();
 
-    list_pushback(task->memory_mapping, memory_mapping);
+    region_tree_insert(&task->memory_mapping, MemoryRange{memory_mapping->address, memory_mapping->size}, memory_mapping);
 
     return memory_mapping;
 }
@@ -24,36 +27,42 @@ MemoryMapping *task_memory_mapping_create_at(Task *task, MemoryObject *memory_ob
 {
     AtomicHolder holder;
 
-    MemoryMapping *memory_mapping = __create(MemoryMapping);
+    MemoryMapping *memory_mapping = object_cache_create(MemoryMapping, &_memory_mapping_cache);
 
     memory_mapping->object = memory_object_ref(memory_object);
-    memory_mapping->address = arch_virtual_map(task->address_space, memory_object->range(), address, MEMORY_USER);
-    memory_mapping->size = memory_object->range().size();
+    memory_mapping->address = address;
+    memory_mapping->size = memory_object->size();
+
+    arch_virtual_reserve_at(task->address_space, MemoryRange{memory_mapping->address, memory_mapping->size});
 
-    list_pushback(task->memory_mapping, memory_mapping);
+    region_tree_insert(&task->memory_mapping, MemoryRange{memory_mapping->address, memory_mapping->size}, memory_mapping);
 
     return memory_mapping;
 }
 
 void task_memory_mapping_destroy(Task *task, MemoryMapping *memory_mapping)
 {
-    AtomicHolder holder;
+    atomic_begin();
 
     arch_virtual_free(task->address_space, (MemoryRange){memory_mapping->address, memory_mapping->size});
-    memory_object_deref(memory_mapping->object);
+    region_tree_remove(&task->memory_mapping, memory_mapping->address);
+
+    atomic_end();
 
-    list_remove(task->memory_mapping, memory_mapping);
-    free(memory_mapping);
+    // File backed objects close their file, which can't be done atomically.
+    memory_object_deref(memory_mapping->object);
+    object_cache_free(&_memory_mapping_cache, memory_mapping);
 }
 
 MemoryMapping *task_memory_mapping_by_address(Task *task, uintptr_t address)
 {
-    list_foreach(MemoryMapping, memory_mapping, task->memory_mapping)
+    AtomicHolder holder;
+
+    Region *region = region_tree_lookup(&task->memory_mapping, address);
+
+    if (region && region->base == address)
     {
-        if (memory_mapping->address == address)
-        {
-            return memory_mapping;
-        }
+        return (MemoryMapping *)region->data;
     }
 
     return nullptr;
@@ -61,16 +70,32 @@ MemoryMapping *task_memory_mapping_by_address(Task *task, uintptr_t address)
 
 bool task_memory_mapping_colides(Task *task, uintptr_t address, size_t size)
 {
-    list_foreach(MemoryMapping, memory_mapping, task->memory_mapping)
+    AtomicHolder holder;
+
+    return region_tree_overlaps(&task->memory_mapping, MemoryRange{address, size});
+}
+
+bool task_memory_page_fault(Task *task, uintptr_t address, bool write)
+{
+    MemoryMapping *memory_mapping = nullptr;
+
     {
-        if (address < memory_mapping->address + memory_mapping->size &&
-            address + size > memory_mapping->address)
+        AtomicHolder holder;
+
+        Region *region = region_tree_lookup(&task->memory_mapping, address);
+
+        if (!region)
         {
-            return true;
+            return false;
         }
+
+        memory_mapping = (MemoryMapping *)region->data;
     }
 
-    return false;
+    uintptr_t page_address = __align_down(address, ARCH_PAGE_SIZE);
+    size_t page = (page_address - memory_mapping->address) / ARCH_PAGE_SIZE;
+
+    return memory_object_fault(memory_mapping->object, page, task->address_space, page_address, write) == SUCCESS;
 }
 
 /* --- User facing API ------------------------------------------------------ */
@@ -95,17 +120,15 @@ Result task_memory_map(Task *task, uintptr_t address, size_t size, MemoryFlags f
         return ERR_BAD_ADDRESS;
     }
 
+    // Pages are zero filled when first touched, so MEMORY_CLEAR comes for free.
+    __unused(flags);
+
     MemoryObject *memory_object = memory_object_create(size);
 
     task_memory_mapping_create_at(task, memory_object, address);
 
     memory_object_deref(memory_object);
 
-    if (flags & MEMORY_CLEAR)
-    {
-        memset((void *)address, 0, size);
-    }
-
     return SUCCESS;
 }
 
@@ -166,14 +189,20 @@ void *task_switch_address_space(Task *task, void *address_space)
     return old_address_space;
 }
 
+static Iteration task_memory_usage_callback(size_t *total, Region *region)
+{
+    *total += ((MemoryMapping *)region->data)->object->resident();
+
+    return Iteration::CONTINUE;
+}
+
 size_t task_memory_usage(Task *task)
 {
+    AtomicHolder holder;
+
     size_t total = 0;
 
-    list_foreach(MemoryMapping, memory_mapping, task->memory_mapping)
-    {
-        total += memory_mapping->size;
-    }
+    region_tree_iterate(&task->memory_mapping, &total, (RegionIterationCallback)task_memory_usage_callback);
 
     return total;
 }
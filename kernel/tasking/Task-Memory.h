@@ -17,6 +17,14 @@ void task_memory_mapping_destroy(Task *task, MemoryMapping *memory_mapping);
 
 MemoryMapping *task_memory_mapping_by_address(Task *task, uintptr_t address);
 
+MemoryMapping *task_memory_mapping_create_at(Task *task, MemoryObject *memory_object, uintptr_t address);
+
+bool task_memory_mapping_colides(Task *task, uintptr_t address, size_t size);
+
+// Brings in the page of a mapping the task just touched, or gives it its own
+// copy of a copy-on-write page it wrote to.
+bool task_memory_page_fault(Task *task, uintptr_t address, bool write);
+
 Result task_memory_alloc(Task *task, size_t size, uintptr_t *out_address);
 
 Result task_memory_map(Task *task, uintptr_t address, size_t size, MemoryFlags flags);
@@ -7,15 +7,28 @@
 #include "arch/VirtualMemory.h"
 #include "arch/x86_32/kernel/Interrupts.h" /* XXX */
 
+#include "kernel/memory/ObjectCache.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
+#include "kernel/system/SystemPage.h"
 #include "kernel/tasking/Task-Handles.h"
+#include "kernel/tasking/Task-IORing.h"
 #include "kernel/tasking/Task-Memory.h"
 #include "kernel/tasking/Task.h"
 
 static int _task_ids = 0;
 static List *_tasks;
 
+static void task_construct(void *object)
+{
+    Task *task = (Task *)object;
+
+    lock_init(task->directory_lock);
+    lock_init(task->handles_lock);
+}
+
+static ObjectCache _task_cache = OBJECT_CACHE(Task, 8, task_construct);
+
 TaskState Task::state()
 {
     return _state;
@@ -50,15 +63,18 @@ Task *task_create(Task *parent, const char *name, bool user)
         _tasks = list_create();
     }
 
-    Task *task = __create(Task);
+    Task *task = object_cache_create(Task, &_task_cache);
 
     task->id = _task_ids++;
     strlcpy(task->name, name, PROCESS_NAME_SIZE);
     task->_state = TASK_STATE_NONE;
+    task->priority = TASK_PRIORITY_NORMAL;
+    task->cpu = arch_cpu_current();
 
     if (user)
     {
         task->address_space = arch_address_space_create();
+        system_page_map(task->address_space);
     }
     else
     {
@@ -66,11 +82,9 @@ Task *task_create(Task *parent, const char *name, bool user)
     }
 
     // Setup shms
-    task->memory_mapping = list_create();
+    task->memory_mapping = {};
 
     // Setup current working directory.
-    lock_init(task->directory_lock);
-
     if (parent)
     {
         task->directory = path_clone(parent->directory);
@@ -81,7 +95,6 @@ Task *task_create(Task *parent, const char *name, bool user)
     }
 
     // Setup fildes
-    lock_init(task->handles_lock);
     for (int i = 0; i < PROCESS_HANDLE_COUNT; i++)
     {
         task->handles[i] = nullptr;
@@ -94,7 +107,8 @@ Task *task_create(Task *parent, const char *name, bool user)
     task->user_stack_pointer = 0xff000000 + PROCESS_STACK_SIZE;
     task->user_stack = (void *)0xff000000;
 
-    arch_save_context(task);
+    memory_alloc(arch_kernel_address_space(), ARCH_PAGE_SIZE, MEMORY_CLEAR, (uintptr_t *)&task->fpu_state);
+    arch_initialize_context(task);
 
     list_pushback(_tasks, task);
 
@@ -110,28 +124,27 @@ void task_destroy(Task *task)
 
     atomic_end();
 
-    MemoryMapping *mapping = nullptr;
-
-    while ((mapping = (MemoryMapping *)list_peek(task->memory_mapping)))
+    while (task->memory_mapping.root)
     {
-        task_memory_mapping_destroy(task, mapping);
+        task_memory_mapping_destroy(task, (MemoryMapping *)task->memory_mapping.root->data);
     }
 
-    list_destroy(task->memory_mapping);
-
+    task_io_ring_destroy(task);
     task_fshandle_close_all(task);
 
     path_destroy(task->directory);
 
     memory_free(task->address_space, MemoryRange{(uintptr_t)task->kernel_stack, PROCESS_STACK_SIZE});
     memory_free(task->address_space, MemoryRange{(uintptr_t)task->user_stack, PROCESS_STACK_SIZE});
+    memory_free(arch_kernel_address_space(), MemoryRange{(uintptr_t)task->fpu_state, ARCH_PAGE_SIZE});
 
     if (task->address_space != arch_kernel_address_space())
     {
+        system_page_unmap(task->address_space);
         arch_address_space_destroy(task->address_space);
     }
 
-    free(task);
+    object_cache_free(&_task_cache, task);
 }
 
 void task_iterate(void *target, TaskIterateCallback callback)
@@ -295,7 +308,10 @@ void task_go(Task *task)
 
 Result task_sleep(Task *task, int timeout)
 {
-    task_block(task, new BlockerTime(system_get_tick() + timeout), -1);
+    // BlockerTime is woken up by the scheduler's deadline queue, so the
+    // timeout is the wakeup time.
+    BlockerTime blocker{system_get_clock() + (uint64_t)timeout * 1000};
+    task_block(task, blocker, timeout);
 
     return TIMEOUT;
 }
@@ -311,36 +327,36 @@ Result task_wait(int task_id, int *exit_value)
         return ERR_NO_SUCH_TASK;
     }
 
-    task_block(scheduler_running(), new BlockerWait(task, exit_value), -1);
+    BlockerWait blocker{task, exit_value};
+    task_block(scheduler_running(), blocker, -1);
 
     return SUCCESS;
 }
 
-BlockerResult task_block(Task *task, Blocker *blocker, Timeout timeout)
+BlockerResult task_block(Task *task, Blocker &blocker, Timeout timeout)
 {
     assert(!task->blocker);
 
     atomic_begin();
-    task->blocker = blocker;
-    if (blocker->can_unblock(task))
+    task->blocker = &blocker;
+    if (blocker.can_unblock(task))
     {
-        blocker->on_unblock(task);
-
-        atomic_end();
+        blocker.on_unblock(task);
 
         task->blocker = nullptr;
-        delete blocker;
+
+        atomic_end();
 
         return BLOCKER_UNBLOCKED;
     }
 
     if (timeout == (Timeout)-1)
     {
-        blocker->_timeout = (Timeout)-1;
+        blocker._timeout = ARCH_NO_DEADLINE;
     }
     else
     {
-        blocker->_timeout = system_get_tick() + timeout;
+        blocker._timeout = system_get_clock() + (uint64_t)timeout * 1000;
     }
 
     task->state(TASK_STATE_BLOCKED);
@@ -348,12 +364,11 @@ BlockerResult task_block(Task *task, Blocker *blocker, Timeout timeout)
 
     scheduler_yield();
 
-    BlockerResult result = blocker->_result;
+    AtomicHolder holder;
 
     task->blocker = nullptr;
-    delete blocker;
 
-    return result;
+    return blocker._result;
 }
 
 void task_dump(Task *task)
@@ -6,10 +6,22 @@
 #include <libsystem/utils/List.h>
 
 #include "kernel/memory/Memory.h"
+#include "kernel/memory/RegionTree.h"
 #include "kernel/scheduling/Blocker.h"
 
+struct IORingPending;
+
 typedef void (*TaskEntryPoint)();
 
+enum TaskPriority
+{
+    TASK_PRIORITY_LOW,
+    TASK_PRIORITY_NORMAL,
+    TASK_PRIORITY_HIGH,
+
+    __TASK_PRIORITY_COUNT
+};
+
 struct Task
 {
     int id;
@@ -17,8 +29,18 @@ struct Task
     char name[PROCESS_NAME_SIZE];
 
     TaskState _state;
+    TaskPriority priority;
     Blocker *blocker;
 
+    // Its place in the deadline queue of its CPU, while blocked with a
+    // timeout.
+    Task *timeout_previous;
+    Task *timeout_next;
+
+    // The CPU whose run queue the task is in, it only changes while the task
+    // isn't running.
+    int cpu;
+
     uintptr_t user_stack_pointer;
     void *user_stack;
 
@@ -26,7 +48,9 @@ struct Task
     void *kernel_stack;
 
     TaskEntryPoint entry_point;
-    char fpu_registers[512];
+
+    // A page of its own, aligned as XSAVE wants it.
+    void *fpu_state;
 
     Lock handles_lock;
     FsHandle *handles[PROCESS_HANDLE_COUNT];
@@ -34,9 +58,12 @@ struct Task
     Lock directory_lock;
     Path *directory;
 
-    List *memory_mapping;
+    RegionTree memory_mapping;
     void *address_space;
 
+    // Chained, one for each ring with pending operations.
+    IORingPending *io_pending;
+
     int exit_value;
 
     TaskState state();
@@ -73,6 +100,8 @@ Result task_sleep(Task *task, int timeout);
 
 Result task_wait(int task_id, int *exit_value);
 
-BlockerResult task_block(Task *task, Blocker *blocker, Timeout timeout);
+// The blocker lives on the stack of the blocked task, so blocking doesn't
+// touch the heap.
+BlockerResult task_block(Task *task, Blocker &blocker, Timeout timeout);
 
 void task_dump(Task *task);
@@ -1,4 +1,6 @@
 #include "kernel/tasking/Tasking.h"
+#include "kernel/memory/Memory.h"
+#include "kernel/memory/ObjectCache.h"
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
 #include "kernel/tasking/Task.h"
@@ -7,7 +9,8 @@ static Iteration destroy_task_if_canceled(void *target, Task *task)
 {
     __unused(target);
 
-    if (task->state() == TASK_STATE_CANCELED)
+    // A task canceled from another CPU might still be on its way out.
+    if (task->state() == TASK_STATE_CANCELED && !scheduler_is_running(task))
     {
         task_destroy(task);
     }
@@ -21,6 +24,13 @@ void garbage_collector()
     {
         task_sleep(scheduler_running(), 100);
         task_iterate(nullptr, destroy_task_if_canceled);
+
+        // Past three quarters of the memory, the objects kept around by the
+        // caches are better off back in the heap.
+        if (memory_get_used() > memory_get_total() / 4 * 3)
+        {
+            object_cache_reclaim_all();
+        }
     }
 }
 
@@ -53,6 +53,7 @@ enum IOCall
     IOCALL_DISPLAY_GET_MODE,
     IOCALL_DISPLAY_SET_MODE,
     IOCALL_DISPLAY_BLIT,
+    IOCALL_DISPLAY_FLIP,
 
     IOCALL_KEYBOARD_SET_KEYMAP,
     IOCALL_KEYBOARD_GET_KEYMAP,
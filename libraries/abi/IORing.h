@@ -0,0 +1,70 @@
+#pragma once
+
+#include <abi/Handle.h>
+
+#include <libsystem/Result.h>
+
+// Must be a power of two.
+#define IORING_CAPACITY (128)
+
+enum IOOperation
+{
+    IO_NOP,
+    IO_READ,
+    IO_WRITE,
+    IO_SELECT,
+    IO_OPEN,
+    IO_CLOSE,
+
+    // Drops the operations pending on this ring with the user data in
+    // `buffer`, they won't complete.
+    IO_CANCEL,
+
+    // Waits on the poll `handle`, and fills the `size` PollEvents at
+    // `buffer` with the ready handles.
+    IO_POLL,
+};
+
+struct IOSubmission
+{
+    IOOperation operation;
+    int handle;
+
+    // What to read into or write from, or the path to open with its size.
+    uintptr_t buffer;
+    size_t size;
+
+    // The SelectEvent to wait for, or the OpenFlag to open with.
+    unsigned int flags;
+
+    uintptr_t user_data;
+};
+
+struct IOCompletion
+{
+    uintptr_t user_data;
+    Result result;
+
+    // How much was read or written, the selected events, the opened handle,
+    // how many operations were canceled or how many handles are ready.
+    size_t value;
+};
+
+// Shared between a task and the kernel. Userspace produces submissions and
+// consumes completions, the kernel does the opposite. The indexes only grow
+// and wrap around, they are masked to get the slot.
+//
+// Operations on handles which aren't ready stay pending in the kernel, and
+// complete on a later SYS_HANDLE_SUBMIT. The kernel never takes more
+// submissions than there is room left for their completions.
+struct IORing
+{
+    volatile uint32_t submission_head;
+    volatile uint32_t submission_tail;
+
+    volatile uint32_t completion_head;
+    volatile uint32_t completion_tail;
+
+    IOSubmission submissions[IORING_CAPACITY];
+    IOCompletion completions[IORING_CAPACITY];
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <abi/Handle.h>
+
+// Reported by a wait on a poll handle, one for every ready handle.
+struct PollEvent
+{
+    uintptr_t user_data;
+    SelectEvent events;
+};
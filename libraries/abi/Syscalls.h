@@ -3,6 +3,8 @@
 #include <libsystem/Common.h>
 #include <libsystem/Result.h>
 
+#include <abi/SystemPage.h>
+
 #define SYSCALL_LIST(__ENTRY)          \
     __ENTRY(SYS_PROCESS_THIS)          \
     __ENTRY(SYS_PROCESS_LAUNCH)        \
@@ -42,9 +44,15 @@
     __ENTRY(SYS_HANDLE_STAT)           \
     __ENTRY(SYS_HANDLE_CONNECT)        \
     __ENTRY(SYS_HANDLE_ACCEPT)         \
+    __ENTRY(SYS_HANDLE_SUBMIT)         \
                                        \
     __ENTRY(SYS_CREATE_PIPE)           \
-    __ENTRY(SYS_CREATE_TERM)
+    __ENTRY(SYS_CREATE_TERM)           \
+    __ENTRY(SYS_CREATE_POLL)           \
+                                       \
+    __ENTRY(SYS_POLL_ADD)              \
+    __ENTRY(SYS_POLL_REMOVE)           \
+    __ENTRY(SYS_POLL_WAIT)
 
 #define SYSCALL_ENUM_ENTRY(__entry) __entry,
 
@@ -58,19 +66,32 @@ static inline Result __syscall(Syscall syscall, uintptr_t p1, uintptr_t p2, uint
     Result __ret = ERR_FUNCTION_NOT_IMPLEMENTED;
 
 #if defined(__x86_64__)
-    // TODO: x86_64 syscall.
-    __unused(syscall);
-    __unused(p1);
-    __unused(p2);
-    __unused(p3);
-    __unused(p4);
-    __unused(p5);
+    register uintptr_t r10 asm("r10") = p4;
+    register uintptr_t r8 asm("r8") = p5;
 
-#elif defined(__i386__)
-    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; int $0x80; pop %%ebx"
+    // syscall puts the return address in rcx and the flags in r11.
+    __asm__ __volatile__("syscall"
                          : "=a"(__ret)
-                         : "0"(syscall), "r"(p1), "c"(p2), "d"(p3), "S"(p4), "D"(p5)
-                         : "memory");
+                         : "0"(syscall), "D"(p1), "S"(p2), "d"(p3), "r"(r10), "r"(r8)
+                         : "rcx", "r11", "memory");
+
+#elif defined(__i386__)
+    if (system_page()->flags & SYSTEM_PAGE_SYSENTER)
+    {
+        // sysexit returns to the address on top of the stack pointed by ebp,
+        // and hands back the stack and the return address in ecx and edx.
+        __asm__ __volatile__("push %%ebx; push %%ebp; movl %4,%%ebx; pushl $1f; movl %%esp,%%ebp; sysenter; 1: pop %%ebp; pop %%ebx"
+                             : "=a"(__ret), "+c"(p2), "+d"(p3)
+                             : "0"(syscall), "r"(p1), "S"(p4), "D"(p5)
+                             : "memory", "cc");
+    }
+    else
+    {
+        __asm__ __volatile__("push %%ebx; movl %2,%%ebx; int $0x80; pop %%ebx"
+                             : "=a"(__ret)
+                             : "0"(syscall), "r"(p1), "c"(p2), "d"(p3), "S"(p4), "D"(p5)
+                             : "memory");
+    }
 #endif
 
     return __ret;
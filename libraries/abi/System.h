@@ -19,6 +19,8 @@ struct SystemStatus
     ElapsedTime uptime;
     size_t total_ram;
     size_t used_ram;
+    size_t kernel_heap_reserved;
+    size_t kernel_heap_used;
     int running_tasks;
     int cpu_usage;
 };
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <libsystem/Common.h>
+#include <libsystem/Time.h>
+
+// Mapped read-only at the same address in every user address space. The
+// kernel keeps it up to date, so reading the clock is a memory read instead
+// of a syscall.
+#define SYSTEM_PAGE_ADDRESS (0xfe000000)
+
+// The kernel set up sysenter, __syscall can use it instead of int $0x80.
+#define SYSTEM_PAGE_SYSENTER (1 << 0)
+
+// The kernel doesn't tick, the clock is computed from the cycle counter and
+// tick and time are the ones at clock_base.
+#define SYSTEM_PAGE_CYCLES (1 << 1)
+
+struct SystemPage
+{
+    // Odd while the kernel is updating the page.
+    volatile uint32_t sequence;
+
+    volatile uint32_t tick;
+    volatile TimeStamp time;
+
+    volatile uint32_t flags;
+
+    // Microseconds since boot are clock_base plus the cycles since
+    // cycles_base, scaled by cycles_mult / 2^32.
+    volatile uint64_t cycles_base;
+    volatile uint64_t clock_base;
+    volatile uint32_t cycles_mult;
+};
+
+static inline SystemPage *system_page()
+{
+    return reinterpret_cast<SystemPage *>(SYSTEM_PAGE_ADDRESS);
+}
+
+// Splits the product so it doesn't overflow when there are more than 2^32
+// cycles.
+static inline uint64_t system_page_scale(uint64_t cycles, uint32_t mult)
+{
+    return (cycles >> 32) * mult + (((cycles & 0xffffffff) * mult) >> 32);
+}
+
+static inline uint64_t system_page_cycles()
+{
+    uint32_t low;
+    uint32_t high;
+
+    asm volatile("rdtsc"
+                 : "=a"(low), "=d"(high));
+
+    return ((uint64_t)high << 32) | low;
+}
+
+// Reads a consistent snapshot, retrying if the kernel updated the page in
+// the middle of it.
+static inline void system_page_read(uint32_t *tick, TimeStamp *time)
+{
+    SystemPage *page = system_page();
+    uint32_t sequence = 0;
+
+    do
+    {
+        sequence = page->sequence;
+        asm volatile("" ::: "memory");
+
+        if (page->flags & SYSTEM_PAGE_CYCLES)
+        {
+            uint64_t clock = page->clock_base + system_page_scale(system_page_cycles() - page->cycles_base, page->cycles_mult);
+
+            *tick = clock / 1000;
+            *time = page->time + (*tick - page->tick) / 1000;
+        }
+        else
+        {
+            *tick = page->tick;
+            *time = page->time;
+        }
+
+        asm volatile("" ::: "memory");
+    } while ((sequence & 1) || sequence != page->sequence);
+}
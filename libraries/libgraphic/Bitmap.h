@@ -3,6 +3,7 @@
 #include <libgraphic/Color.h>
 #include <libgraphic/Shape.h>
 #include <libsystem/Result.h>
+#include <libsystem/core/CString.h>
 #include <libsystem/math/Math.h>
 
 #include <libutils/RefPtr.h>
@@ -55,6 +56,8 @@ public:
     Vec2i size() const { return Vec2i(_width, _height); }
     Rectangle bound() const { return Rectangle(_width, _height); }
 
+    BitmapFiltering filtering() const { return _filtering; }
+
     void filtering(BitmapFiltering filtering) { _filtering = filtering; }
 
     static ResultOr<RefPtr<Bitmap>> create_shared(int width, int height);
@@ -82,12 +85,30 @@ public:
 
     void blend_pixel(Vec2i position, Color color)
     {
+        if (color.alpha() == 0)
+            return;
+
+        if (color.alpha() == 255)
+        {
+            set_pixel(position, color);
+            return;
+        }
+
         Color background = get_pixel(position);
         set_pixel(position, Color::blend(color, background));
     }
 
     void blend_pixel_no_check(Vec2i position, Color color)
     {
+        if (color.alpha() == 0)
+            return;
+
+        if (color.alpha() == 255)
+        {
+            set_pixel_no_check(position, color);
+            return;
+        }
+
         Color background = get_pixel_no_check(position);
         set_pixel_no_check(position, Color::blend(color, background));
     }
@@ -144,6 +165,35 @@ public:
         }
     }
 
+    // Moves the content of `region` down by `offset` lines, or up when it is
+    // negative. What is uncovered keeps its old content.
+    void shift(Rectangle region, int offset)
+    {
+        region = region.clipped_with(bound());
+
+        int distance = offset < 0 ? -offset : offset;
+
+        if (region.is_empty() || offset == 0 || distance >= region.height())
+            return;
+
+        size_t line_size = region.width() * sizeof(Color);
+
+        if (offset < 0)
+        {
+            for (int y = region.y(); y < region.y() + region.height() - distance; y++)
+            {
+                memcpy(&_pixels[y * width() + region.x()], &_pixels[(y + distance) * width() + region.x()], line_size);
+            }
+        }
+        else
+        {
+            for (int y = region.y() + region.height() - 1; y >= region.y() + distance; y--)
+            {
+                memcpy(&_pixels[y * width() + region.x()], &_pixels[(y - distance) * width() + region.x()], line_size);
+            }
+        }
+    }
+
     void clear(Color color)
     {
         for (int i = 0; i < width() * height(); i++)
@@ -52,40 +52,94 @@ ResultOr<RefPtr<Font>> Font::create(String name)
     return make<Font>(bitmap_or_error.take_value(), glyph_or_error.take_value());
 }
 
-Glyph &Font::glyph(Codepoint codepoint)
+Font::Font(RefPtr<Bitmap> bitmap, Vector<Glyph> glyphs)
+    : _bitmap(bitmap),
+      _glyphs(move(glyphs))
 {
-    for (int i = 0; _glyphs[i].codepoint != 0; i++)
+    for (size_t i = 0; i < _glyphs.count() && _glyphs[i].codepoint != 0; i++)
     {
-        if (_glyphs[i].codepoint == codepoint)
+        Glyph *glyph = &_glyphs[i];
+
+        if (glyph->codepoint < LATIN_GLYPHS)
         {
-            return _glyphs[i];
+            _latin_glyphs[glyph->codepoint] = glyph;
+        }
+        else
+        {
+            _other_glyphs[glyph->codepoint] = glyph;
         }
     }
 
-    return _default;
+    _default = glyph(U'?');
 }
 
-bool Font::has_glyph(Codepoint codepoint)
+Glyph *Font::lookup_glyph(Codepoint codepoint)
 {
-    for (int i = 0; _glyphs[i].codepoint != 0; i++)
+    if (codepoint < LATIN_GLYPHS)
     {
-        if (_glyphs[i].codepoint == codepoint)
-        {
-            return true;
-        }
+        return _latin_glyphs[codepoint];
     }
 
-    return false;
+    Glyph **glyph = _other_glyphs.lookup(codepoint);
+
+    return glyph ? *glyph : nullptr;
 }
 
-Rectangle Font::mesure_string(const char *string)
+Glyph &Font::glyph(Codepoint codepoint)
 {
-    int width = 0;
+    Glyph *glyph = lookup_glyph(codepoint);
+
+    return glyph ? *glyph : _default;
+}
+
+bool Font::has_glyph(Codepoint codepoint)
+{
+    return lookup_glyph(codepoint) != nullptr;
+}
+
+void Font::layout_into(const char *string, FontRun &run)
+{
+    run.width = 0;
+    run.glyphs.clear();
 
     codepoint_foreach(reinterpret_cast<const uint8_t *>(string), [&](auto codepoint) {
         Glyph &g = glyph(codepoint);
-        width += g.advance;
+
+        run.width += g.advance;
+        run.glyphs.push_back(&g);
     });
+}
+
+FontRun &Font::layout(const char *string)
+{
+    size_t length = strlen(string);
+
+    if (length > RUN_MAX_LENGTH)
+    {
+        layout_into(string, _uncached_run);
+        return _uncached_run;
+    }
+
+    StringView key{string, length};
+    FontRun *run = _runs.lookup(key);
+
+    if (run)
+    {
+        return *run;
+    }
+
+    if (_runs.count() >= RUN_CACHE_CAPACITY)
+    {
+        _runs.clear();
+    }
+
+    run = &_runs[key];
+    layout_into(string, *run);
 
-    return Rectangle(width, 16);
+    return *run;
+}
+
+Rectangle Font::mesure_string(const char *string)
+{
+    return Rectangle(layout(string).width, 16);
 }
@@ -2,6 +2,7 @@
 
 #include <libgraphic/Bitmap.h>
 #include <libsystem/unicode/Codepoint.h>
+#include <libutils/HashMap.h>
 #include <libutils/String.h>
 #include <libutils/Vector.h>
 
@@ -13,28 +14,53 @@ struct Glyph
     int advance;
 };
 
+// A string decoded and laid out once, so it can be measured and drawn again
+// without going through its codepoints.
+struct FontRun
+{
+    int width;
+    Vector<Glyph *> glyphs;
+};
+
 class Font : public RefCounted<Font>
 {
 private:
+    // ASCII and Latin-1 are looked up directly, the rest goes through a map.
+    static constexpr Codepoint LATIN_GLYPHS = 256;
+
+    // Labels and menus draw the same strings every frame, remember how the
+    // recent ones are laid out. The cache is emptied when full, long strings
+    // are rarely drawn twice and aren't cached at all.
+    static constexpr size_t RUN_CACHE_CAPACITY = 256;
+    static constexpr size_t RUN_MAX_LENGTH = 128;
+
     RefPtr<Bitmap> _bitmap;
     Glyph _default;
     Vector<Glyph> _glyphs;
 
+    Glyph *_latin_glyphs[LATIN_GLYPHS] = {};
+    HashMap<Codepoint, Glyph *> _other_glyphs{};
+
+    HashMap<String, FontRun> _runs{};
+    FontRun _uncached_run{};
+
+    Glyph *lookup_glyph(Codepoint codepoint);
+
+    void layout_into(const char *string, FontRun &run);
+
 public:
     Bitmap &bitmap() { return *_bitmap; }
 
     static ResultOr<RefPtr<Font>> create(String name);
 
-    Font(RefPtr<Bitmap> bitmap, Vector<Glyph> glyphs)
-        : _bitmap(bitmap),
-          _glyphs(move(glyphs))
-    {
-        _default = glyph(U'?');
-    }
+    Font(RefPtr<Bitmap> bitmap, Vector<Glyph> glyphs);
 
     Glyph &glyph(Codepoint codepoint);
 
     bool has_glyph(Codepoint codepoint);
 
+    // The run stays valid until the next call.
+    FontRun &layout(const char *string);
+
     Rectangle mesure_string(const char *string);
 };
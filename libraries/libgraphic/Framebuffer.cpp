@@ -80,42 +80,29 @@ void Framebuffer::mark_dirty(Rectangle new_bound)
         return;
     }
 
-    bool merged = false;
-
-    _dirty_bounds.foreach ([&](Rectangle &region) {
-        int region_area = region.area();
-        int merge_area = region.merged_with(new_bound).area();
-
-        if (region.colide_with(new_bound) && (region_area + new_bound.area() > merge_area))
-        {
-            region = region.merged_with(new_bound);
-            merged = true;
-
-            return Iteration::STOP;
-        }
-
-        return Iteration::CONTINUE;
-    });
-
-    if (!merged)
-    {
-        _dirty_bounds.push_back(new_bound);
-    }
+    _dirty.add(new_bound);
 }
 
 void Framebuffer::mark_dirty_all()
 {
-    _dirty_bounds.clear();
+    _dirty.clear();
     mark_dirty(_bitmap->bound());
 }
 
 void Framebuffer::blit()
 {
-    if (_dirty_bounds.empty())
+    if (_dirty.is_empty())
     {
         return;
     }
-    _dirty_bounds.foreach ([&](auto &bound) {
+
+    // Past a point a single blit is cheaper than a syscall per rectangle.
+    if (_dirty.count() > FRAMEBUFFER_MAX_BLITS)
+    {
+        _dirty = Region{_dirty.bound()};
+    }
+
+    _dirty.foreach ([&](auto &bound) {
         IOCallDisplayBlitArgs args;
 
         args.buffer = reinterpret_cast<uint32_t *>(_bitmap->pixels());
@@ -137,5 +124,12 @@ void Framebuffer::blit()
         return Iteration::CONTINUE;
     });
 
-    _dirty_bounds.clear();
+    _dirty.clear();
+
+    if (_can_flip)
+    {
+        __plug_handle_call(&_handle, IOCALL_DISPLAY_FLIP, nullptr);
+
+        _can_flip = !handle_has_error(&_handle);
+    }
 }
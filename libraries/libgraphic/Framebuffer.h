@@ -2,9 +2,12 @@
 
 #include <libgraphic/Bitmap.h>
 #include <libgraphic/Painter.h>
+#include <libgraphic/Region.h>
 #include <libsystem/io/Handle.h>
 #include <libutils/OwnPtr.h>
 
+#define FRAMEBUFFER_MAX_BLITS (32)
+
 class Framebuffer
 {
 private:
@@ -13,7 +16,10 @@ private:
     RefPtr<Bitmap> _bitmap;
     Painter _painter;
 
-    Vector<Rectangle> _dirty_bounds{};
+    Region _dirty{};
+
+    // Not every display can flip, we stop asking after the first refusal.
+    bool _can_flip = true;
 
 public:
     static ResultOr<OwnPtr<Framebuffer>> open();
@@ -1,7 +1,9 @@
 #include <libgraphic/Font.h>
 #include <libgraphic/Painter.h>
+#include <libgraphic/PixelKernels.h>
 #include <libgraphic/StackBlur.h>
 #include <libsystem/Assert.h>
+#include <libsystem/core/CString.h>
 #include <libsystem/math/Math.h>
 
 Painter::Painter(RefPtr<Bitmap> bitmap)
@@ -72,26 +74,110 @@ void Painter::plot_pixel(Vec2i position, Color color)
     }
 }
 
+static uint32_t *row(Bitmap &bitmap, int x, int y)
+{
+    return reinterpret_cast<uint32_t *>(bitmap.pixels() + y * bitmap.width() + x);
+}
+
+static uint32_t pixel(Color color)
+{
+    uint32_t value;
+    memcpy(&value, &color, sizeof(value));
+    return value;
+}
+
+static bool source_within(Bitmap &bitmap, Rectangle source)
+{
+    return !source.is_empty() &&
+           source.left() >= 0 && source.right() <= bitmap.width() &&
+           source.top() >= 0 && source.bottom() <= bitmap.height();
+}
+
+// Clips the destination, and the source with it, so both are inside their bitmaps.
+bool Painter::clip_blit(Bitmap &bitmap, Rectangle &source, Rectangle &destination)
+{
+    Rectangle transformed_destination = apply_transform(destination);
+    Rectangle clipped_destination = apply_clip(transformed_destination);
+
+    if (clipped_destination.is_empty())
+    {
+        return false;
+    }
+
+    Vec2i offset = source.position() - transformed_destination.position();
+
+    Rectangle clipped_source = clipped_destination.offset(offset);
+
+    if (!clipped_source.colide_with(bitmap.bound()))
+    {
+        return false;
+    }
+
+    clipped_source = clipped_source.clipped_with(bitmap.bound());
+
+    source = clipped_source;
+    destination = clipped_source.offset(-offset);
+
+    return true;
+}
+
 void Painter::blit_bitmap_fast(Bitmap &bitmap, Rectangle source, Rectangle destination)
 {
-    Rectangle clipped_destination = apply_transform(destination);
-    clipped_destination = apply_clip(clipped_destination);
+    if (!clip_blit(bitmap, source, destination))
+        return;
 
-    Rectangle clipped_source = Rectangle(clipped_destination.width(), clipped_destination.height());
-    clipped_source = clipped_source.moved(source.position() + clipped_destination.position() - destination.position());
+    auto &kernels = pixel_kernels();
+
+    for (int y = 0; y < destination.height(); y++)
+    {
+        kernels.blend(
+            row(*_bitmap, destination.x(), destination.y() + y),
+            row(bitmap, source.x(), source.y() + y),
+            destination.width());
+    }
+}
+
+// Samples the source with bilinear filtering and blends the rows as they come.
+void Painter::blit_bitmap_scaled_linear(Bitmap &bitmap, Rectangle source, Rectangle destination)
+{
+    Rectangle transformed_destination = apply_transform(destination);
+    Rectangle clipped_destination = apply_clip(transformed_destination);
 
     if (clipped_destination.is_empty())
         return;
 
-    for (int x = 0; x < clipped_destination.width(); x++)
+    auto &kernels = pixel_kernels();
+
+    uint32_t step_x = ((uint64_t)source.width() << 16) / destination.width();
+    uint32_t step_y = ((uint64_t)source.height() << 16) / destination.height();
+
+    uint32_t start_x = (source.x() << 16) + (clipped_destination.x() - transformed_destination.x()) * step_x;
+
+    const int scanline_size = 256;
+    uint32_t scanline[scanline_size];
+
+    for (int y = clipped_destination.top(); y < clipped_destination.bottom(); y++)
     {
-        for (int y = 0; y < clipped_destination.height(); y++)
-        {
-            Vec2i position(x, y);
+        uint32_t position_y = (y - transformed_destination.y()) * step_y;
 
-            Color sample = bitmap.get_pixel(clipped_source.position() + position);
+        int y0 = clamp(source.y() + (int)(position_y >> 16), 0, bitmap.height() - 1);
+        int y1 = MIN(y0 + 1, bitmap.height() - 1);
 
-            _bitmap->blend_pixel(clipped_destination.position() + position, sample);
+        for (int x = 0; x < clipped_destination.width(); x += scanline_size)
+        {
+            int count = MIN(scanline_size, clipped_destination.width() - x);
+
+            kernels.scale_linear(
+                scanline,
+                row(bitmap, 0, y0),
+                row(bitmap, 0, y1),
+                bitmap.width(),
+                start_x + x * step_x,
+                step_x,
+                (position_y >> 8) & 0xff,
+                count);
+
+            kernels.blend(row(*_bitmap, clipped_destination.x() + x, y), scanline, count);
         }
     }
 }
@@ -101,6 +187,12 @@ void Painter::blit_bitmap_scaled(Bitmap &bitmap, Rectangle source, Rectangle des
     if (destination.is_empty())
         return;
 
+    if (bitmap.filtering() == BITMAP_FILTERING_LINEAR && source_within(bitmap, source))
+    {
+        blit_bitmap_scaled_linear(bitmap, source, destination);
+        return;
+    }
+
     for (int x = 0; x < destination.width(); x++)
     {
         for (int y = 0; y < destination.height(); y++)
@@ -132,29 +224,31 @@ __flatten void Painter::blit_bitmap(Bitmap &bitmap, Rectangle source, Rectangle
 
 void Painter::blit_bitmap_fast_no_alpha(Bitmap &bitmap, Rectangle source, Rectangle destination)
 {
-    Rectangle clipped_destination = apply_transform(destination);
-    clipped_destination = apply_clip(clipped_destination);
-
-    Rectangle clipped_source = Rectangle(clipped_destination.width(), clipped_destination.height());
-    clipped_source = clipped_source.moved(source.position() + clipped_destination.position() - destination.position());
-
-    if (clipped_destination.is_empty())
+    if (!clip_blit(bitmap, source, destination))
         return;
 
-    for (int x = 0; x < clipped_destination.width(); x++)
-    {
-        for (int y = 0; y < clipped_destination.height(); y++)
-        {
-            Vec2i position(x, y);
+    auto &kernels = pixel_kernels();
 
-            Color sample = bitmap.get_pixel(clipped_source.position() + position);
-            _bitmap->set_pixel_no_check(clipped_destination.position() + position, sample.with_alpha(1));
-        }
+    for (int y = 0; y < destination.height(); y++)
+    {
+        kernels.copy_opaque(
+            row(*_bitmap, destination.x(), destination.y() + y),
+            row(bitmap, source.x(), source.y() + y),
+            destination.width());
     }
 }
 
 void Painter::blit_bitmap_scaled_no_alpha(Bitmap &bitmap, Rectangle source, Rectangle destination)
 {
+    if (destination.is_empty())
+        return;
+
+    if (bitmap.filtering() == BITMAP_FILTERING_LINEAR && source_within(bitmap, source))
+    {
+        blit_bitmap_scaled_linear(bitmap, source, destination);
+        return;
+    }
+
     for (int x = 0; x < destination.width(); x++)
     {
         for (int y = 0; y < destination.height(); y++)
@@ -196,12 +290,11 @@ __flatten void Painter::clear_rectangle(Rectangle rectangle, Color color)
         return;
     }
 
-    for (int x = 0; x < rectangle.width(); x++)
+    auto &kernels = pixel_kernels();
+
+    for (int y = 0; y < rectangle.height(); y++)
     {
-        for (int y = 0; y < rectangle.height(); y++)
-        {
-            _bitmap->set_pixel_no_check(Vec2i(rectangle.x() + x, rectangle.y() + y), color);
-        }
+        kernels.fill(row(*_bitmap, rectangle.x(), rectangle.y() + y), pixel(color), rectangle.width());
     }
 }
 
@@ -215,13 +308,16 @@ __flatten void Painter::fill_rectangle(Rectangle rectangle, Color color)
         return;
     }
 
-    for (int x = 0; x < rectangle.width(); x++)
+    if (color.alpha() == 0)
     {
-        for (int y = 0; y < rectangle.height(); y++)
-        {
-            _bitmap->blend_pixel_no_check(Vec2i(rectangle.x() + x, rectangle.y() + y),
-                                          color);
-        }
+        return;
+    }
+
+    auto &kernels = pixel_kernels();
+
+    for (int y = 0; y < rectangle.height(); y++)
+    {
+        kernels.blend_fill(row(*_bitmap, rectangle.x(), rectangle.y() + y), pixel(color), rectangle.width());
     }
 }
 
@@ -651,20 +747,26 @@ void Painter::draw_glyph(Font &font, Glyph &glyph, Vec2i position, Color color)
 
 __flatten void Painter::draw_string(Font &font, const char *str, Vec2i position, Color color)
 {
-    codepoint_foreach(reinterpret_cast<const uint8_t *>(str), [&](auto codepoint) {
-        Glyph &glyph = font.glyph(codepoint);
+    draw_run(font, font.layout(str), position, color);
+}
+
+__flatten void Painter::draw_run(Font &font, FontRun &run, Vec2i position, Color color)
+{
+    for (size_t i = 0; i < run.glyphs.count(); i++)
+    {
+        Glyph &glyph = *run.glyphs[i];
         draw_glyph(font, glyph, position, color);
         position = position + Vec2i(glyph.advance, 0);
-    });
+    }
 }
 
 void Painter::draw_string_within(Font &font, const char *str, Rectangle container, Position position, Color color)
 {
-    Rectangle bound = font.mesure_string(str);
+    FontRun &run = font.layout(str);
 
-    bound = bound.place_within(container, position);
+    Rectangle bound = Rectangle(run.width, 16).place_within(container, position);
 
-    draw_string(font, str, Vec2i(bound.x(), bound.y() + bound.height() / 2 + 4), color);
+    draw_run(font, run, Vec2i(bound.x(), bound.y() + bound.height() / 2 + 4), color);
 }
 
 void Painter::draw_truetype_glyph(TrueTypeFont *font, TrueTypeGlyph *glyph, Vec2i position, Color color)
@@ -69,6 +69,8 @@ public:
 
     void draw_string(Font &font, const char *str, Vec2i position, Color color);
 
+    void draw_run(Font &font, FontRun &run, Vec2i position, Color color);
+
     void draw_string_within(Font &font, const char *str, Rectangle container, Position position, Color color);
 
     void draw_truetype_glyph(TrueTypeFont *font, TrueTypeGlyph *glyph, Vec2i position, Color color);
@@ -86,10 +88,14 @@ private:
 
     Rectangle apply_transform(Rectangle rectangle);
 
+    bool clip_blit(Bitmap &bitmap, Rectangle &source, Rectangle &destination);
+
     void blit_bitmap_fast(Bitmap &bitmap, Rectangle source, Rectangle destination);
 
     void blit_bitmap_scaled(Bitmap &bitmap, Rectangle source, Rectangle destination);
 
+    void blit_bitmap_scaled_linear(Bitmap &bitmap, Rectangle source, Rectangle destination);
+
     void blit_bitmap_fast_no_alpha(Bitmap &bitmap, Rectangle source, Rectangle destination);
 
     void blit_bitmap_scaled_no_alpha(Bitmap &bitmap, Rectangle source, Rectangle destination);
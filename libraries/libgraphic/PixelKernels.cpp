@@ -0,0 +1,360 @@
+#include <cpuid.h>
+#include <emmintrin.h>
+
+#include <libgraphic/PixelKernels.h>
+
+#define ALPHA_MASK (0xff000000u)
+
+static inline uint32_t pixel_alpha(uint32_t pixel)
+{
+    return pixel >> 24;
+}
+
+// Rounded division by 255, exact for everything a blend can produce.
+static inline uint32_t div255(uint32_t value)
+{
+    value += 128;
+    return (value + (value >> 8)) >> 8;
+}
+
+/* --- Scalar --------------------------------------------------------------- */
+
+// Same math as Color::blend, for destinations that aren't opaque.
+static uint32_t blend_pixel_translucent(uint32_t foreground, uint32_t background)
+{
+    float fa = pixel_alpha(foreground) / 255.0f;
+    float ba = pixel_alpha(background) / 255.0f;
+
+    float a = (1 - fa) * ba + fa;
+
+    if (a == 0)
+    {
+        return 0;
+    }
+
+    uint32_t result = static_cast<uint32_t>(a * 0xff) << 24;
+
+    for (int shift = 0; shift < 24; shift += 8)
+    {
+        float fc = ((foreground >> shift) & 0xff) / 255.0f;
+        float bc = ((background >> shift) & 0xff) / 255.0f;
+
+        float c = ((1 - fa) * ba * bc + fa * fc) / a;
+
+        result |= static_cast<uint32_t>(c * 0xff) << shift;
+    }
+
+    return result;
+}
+
+static inline uint32_t blend_pixel(uint32_t foreground, uint32_t background)
+{
+    uint32_t alpha = pixel_alpha(foreground);
+
+    if (alpha == 0xff)
+    {
+        return foreground;
+    }
+
+    if (alpha == 0)
+    {
+        return background;
+    }
+
+    if (pixel_alpha(background) != 0xff)
+    {
+        return blend_pixel_translucent(foreground, background);
+    }
+
+    uint32_t inverse = 0xff - alpha;
+
+    uint32_t r = div255((foreground & 0xff) * alpha + (background & 0xff) * inverse);
+    uint32_t g = div255(((foreground >> 8) & 0xff) * alpha + ((background >> 8) & 0xff) * inverse);
+    uint32_t b = div255(((foreground >> 16) & 0xff) * alpha + ((background >> 16) & 0xff) * inverse);
+
+    return ALPHA_MASK | (b << 16) | (g << 8) | r;
+}
+
+static inline uint32_t lerp_pixel(uint32_t from, uint32_t to, uint32_t weight)
+{
+    uint32_t result = 0;
+
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        uint32_t a = (from >> shift) & 0xff;
+        uint32_t b = (to >> shift) & 0xff;
+
+        result |= ((a * (256 - weight) + b * weight) >> 8) << shift;
+    }
+
+    return result;
+}
+
+static void scalar_copy_opaque(uint32_t *destination, const uint32_t *source, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        destination[i] = source[i] | ALPHA_MASK;
+    }
+}
+
+static void scalar_blend(uint32_t *destination, const uint32_t *source, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        destination[i] = blend_pixel(source[i], destination[i]);
+    }
+}
+
+static void scalar_fill(uint32_t *destination, uint32_t color, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        destination[i] = color;
+    }
+}
+
+static void scalar_blend_fill(uint32_t *destination, uint32_t color, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        destination[i] = blend_pixel(color, destination[i]);
+    }
+}
+
+static void scalar_scale_linear(uint32_t *destination, const uint32_t *row0, const uint32_t *row1, size_t row_width, uint32_t x, uint32_t step, uint32_t fy, size_t count)
+{
+    for (size_t i = 0; i < count; i++, x += step)
+    {
+        size_t x0 = x >> 16;
+        size_t x1 = x0 + 1 < row_width ? x0 + 1 : row_width - 1;
+        uint32_t fx = (x >> 8) & 0xff;
+
+        uint32_t top = lerp_pixel(row0[x0], row0[x1], fx);
+        uint32_t bottom = lerp_pixel(row1[x0], row1[x1], fx);
+
+        destination[i] = lerp_pixel(top, bottom, fy);
+    }
+}
+
+static const PixelKernels _scalar_kernels = {
+    .name = "scalar",
+    .copy_opaque = scalar_copy_opaque,
+    .blend = scalar_blend,
+    .fill = scalar_fill,
+    .blend_fill = scalar_blend_fill,
+    .scale_linear = scalar_scale_linear,
+};
+
+/* --- SSE2 ----------------------------------------------------------------- */
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+
+static inline __m128i sse2_div255(__m128i value)
+{
+    value = _mm_add_epi16(value, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+}
+
+// Two pixels unpacked to 16bit channels, with their alpha in every channel.
+static inline __m128i sse2_broadcast_alpha(__m128i pixels)
+{
+    pixels = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_shufflehi_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+static inline __m128i sse2_blend_half(__m128i foreground, __m128i background)
+{
+    __m128i alpha = sse2_broadcast_alpha(foreground);
+    __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(0xff), alpha);
+
+    return sse2_div255(_mm_add_epi16(_mm_mullo_epi16(foreground, alpha), _mm_mullo_epi16(background, inverse)));
+}
+
+// Returns false if the four pixels have to go through the scalar path.
+static inline bool sse2_blend4(uint32_t *destination, __m128i foreground)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i alpha_mask = _mm_set1_epi32(ALPHA_MASK);
+
+    __m128i foreground_alpha = _mm_and_si128(foreground, alpha_mask);
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(foreground_alpha, zero)) == 0xffff)
+    {
+        return true;
+    }
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(foreground_alpha, alpha_mask)) == 0xffff)
+    {
+        _mm_storeu_si128((__m128i *)destination, foreground);
+        return true;
+    }
+
+    __m128i background = _mm_loadu_si128((const __m128i *)destination);
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(background, alpha_mask), alpha_mask)) != 0xffff)
+    {
+        return false;
+    }
+
+    __m128i low = sse2_blend_half(_mm_unpacklo_epi8(foreground, zero), _mm_unpacklo_epi8(background, zero));
+    __m128i high = sse2_blend_half(_mm_unpackhi_epi8(foreground, zero), _mm_unpackhi_epi8(background, zero));
+
+    _mm_storeu_si128((__m128i *)destination, _mm_or_si128(_mm_packus_epi16(low, high), alpha_mask));
+
+    return true;
+}
+
+static void sse2_copy_opaque(uint32_t *destination, const uint32_t *source, size_t count)
+{
+    __m128i alpha_mask = _mm_set1_epi32(ALPHA_MASK);
+
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i *)(source + i));
+        _mm_storeu_si128((__m128i *)(destination + i), _mm_or_si128(pixels, alpha_mask));
+    }
+
+    scalar_copy_opaque(destination + i, source + i, count - i);
+}
+
+static void sse2_blend(uint32_t *destination, const uint32_t *source, size_t count)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        if (!sse2_blend4(destination + i, _mm_loadu_si128((const __m128i *)(source + i))))
+        {
+            scalar_blend(destination + i, source + i, 4);
+        }
+    }
+
+    scalar_blend(destination + i, source + i, count - i);
+}
+
+static void sse2_fill(uint32_t *destination, uint32_t color, size_t count)
+{
+    __m128i pixels = _mm_set1_epi32(color);
+
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_si128((__m128i *)(destination + i), pixels);
+    }
+
+    scalar_fill(destination + i, color, count - i);
+}
+
+static void sse2_blend_fill(uint32_t *destination, uint32_t color, size_t count)
+{
+    __m128i pixels = _mm_set1_epi32(color);
+
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        if (!sse2_blend4(destination + i, pixels))
+        {
+            scalar_blend_fill(destination + i, color, 4);
+        }
+    }
+
+    scalar_blend_fill(destination + i, color, count - i);
+}
+
+static inline __m128i sse2_lerp(__m128i from, __m128i to, __m128i weight)
+{
+    __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(256), weight);
+
+    return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(from, inverse), _mm_mullo_epi16(to, weight)), 8);
+}
+
+static void sse2_scale_linear(uint32_t *destination, const uint32_t *row0, const uint32_t *row1, size_t row_width, uint32_t x, uint32_t step, uint32_t fy, size_t count)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i weight_y = _mm_set1_epi16(fy);
+
+    size_t i = 0;
+
+    // Two pixels at a time, one in each half of the registers.
+    for (; i + 2 <= count; i += 2)
+    {
+        size_t x0a = x >> 16;
+        size_t x1a = x0a + 1 < row_width ? x0a + 1 : row_width - 1;
+        uint16_t fxa = (x >> 8) & 0xff;
+        x += step;
+
+        size_t x0b = x >> 16;
+        size_t x1b = x0b + 1 < row_width ? x0b + 1 : row_width - 1;
+        uint16_t fxb = (x >> 8) & 0xff;
+        x += step;
+
+        __m128i c00 = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(row0[x0a]), _mm_cvtsi32_si128(row0[x0b])), zero);
+        __m128i c10 = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(row0[x1a]), _mm_cvtsi32_si128(row0[x1b])), zero);
+        __m128i c01 = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(row1[x0a]), _mm_cvtsi32_si128(row1[x0b])), zero);
+        __m128i c11 = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(row1[x1a]), _mm_cvtsi32_si128(row1[x1b])), zero);
+
+        __m128i weight_x = _mm_set_epi16(fxb, fxb, fxb, fxb, fxa, fxa, fxa, fxa);
+
+        __m128i top = sse2_lerp(c00, c10, weight_x);
+        __m128i bottom = sse2_lerp(c01, c11, weight_x);
+
+        __m128i pixels = _mm_packus_epi16(sse2_lerp(top, bottom, weight_y), zero);
+
+        _mm_storel_epi64((__m128i *)(destination + i), pixels);
+    }
+
+    scalar_scale_linear(destination + i, row0, row1, row_width, x, step, fy, count - i);
+}
+
+#pragma GCC pop_options
+
+static const PixelKernels _sse2_kernels = {
+    .name = "sse2",
+    .copy_opaque = sse2_copy_opaque,
+    .blend = sse2_blend,
+    .fill = sse2_fill,
+    .blend_fill = sse2_blend_fill,
+    .scale_linear = sse2_scale_linear,
+};
+
+/* --- Dispatch ------------------------------------------------------------- */
+
+const PixelKernels &pixel_kernels_scalar()
+{
+    return _scalar_kernels;
+}
+
+const PixelKernels *pixel_kernels_sse2()
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (edx & bit_SSE2))
+    {
+        return &_sse2_kernels;
+    }
+
+    return nullptr;
+}
+
+const PixelKernels &pixel_kernels()
+{
+    static const PixelKernels *kernels = nullptr;
+
+    if (kernels == nullptr)
+    {
+        kernels = pixel_kernels_sse2();
+
+        if (kernels == nullptr)
+        {
+            kernels = &_scalar_kernels;
+        }
+    }
+
+    return *kernels;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Row kernels behind the painter's hot loops. Pixels are 32bit RGBA in memory
+// order, so the alpha is the top byte, and the alpha is not premultiplied.
+//
+// Nothing here depends on the rest of libsystem, the benchmark in
+// toolbox/benchmarks builds this file on the host.
+
+struct PixelKernels
+{
+    const char *name;
+
+    // Copies the row and makes it opaque.
+    void (*copy_opaque)(uint32_t *destination, const uint32_t *source, size_t count);
+
+    // Blends the source over the destination, like Color::blend.
+    void (*blend)(uint32_t *destination, const uint32_t *source, size_t count);
+
+    void (*fill)(uint32_t *destination, uint32_t color, size_t count);
+
+    void (*blend_fill)(uint32_t *destination, uint32_t color, size_t count);
+
+    // Bilinear sampling between two source rows. x and step are 16.16 fixed
+    // point positions in the rows, fy is the vertical weight of row1 over 256.
+    void (*scale_linear)(uint32_t *destination, const uint32_t *row0, const uint32_t *row1, size_t row_width, uint32_t x, uint32_t step, uint32_t fy, size_t count);
+};
+
+const PixelKernels &pixel_kernels_scalar();
+
+// Returns nullptr if the cpu doesn't support them.
+const PixelKernels *pixel_kernels_sse2();
+
+// The fastest kernels supported by this cpu.
+const PixelKernels &pixel_kernels();
@@ -0,0 +1,325 @@
+#include <libgraphic/Region.h>
+
+struct Span
+{
+    int left;
+    int right;
+};
+
+Region::Region(Rectangle rectangle)
+{
+    if (!rectangle.is_empty())
+    {
+        _rectangles.push_back(rectangle);
+    }
+}
+
+Region::Region(Region &other)
+    : _rectangles(other._rectangles)
+{
+}
+
+Region::Region(Region &&other)
+    : _rectangles(move(other._rectangles))
+{
+}
+
+Region &Region::operator=(Region &other)
+{
+    if (this != &other)
+    {
+        _rectangles.clear();
+
+        other.foreach ([&](Rectangle &rectangle) {
+            _rectangles.push_back(rectangle);
+            return Iteration::CONTINUE;
+        });
+    }
+
+    return *this;
+}
+
+Region &Region::operator=(Region &&other)
+{
+    *this = other;
+    other.clear();
+
+    return *this;
+}
+
+Rectangle Region::bound()
+{
+    if (is_empty())
+    {
+        return Rectangle::empty();
+    }
+
+    Rectangle bound = _rectangles[0];
+
+    _rectangles.foreach ([&](Rectangle &rectangle) {
+        bound = bound.merged_with(rectangle);
+        return Iteration::CONTINUE;
+    });
+
+    return bound;
+}
+
+int Region::area()
+{
+    int area = 0;
+
+    _rectangles.foreach ([&](Rectangle &rectangle) {
+        area += rectangle.area();
+        return Iteration::CONTINUE;
+    });
+
+    return area;
+}
+
+bool Region::colide_with(Rectangle rectangle)
+{
+    return _rectangles.foreach ([&](Rectangle &other) {
+        return other.colide_with(rectangle) ? Iteration::STOP : Iteration::CONTINUE;
+    }) == Iteration::STOP;
+}
+
+void Region::add(Rectangle rectangle)
+{
+    Region other{rectangle};
+    *this = united_with(other);
+}
+
+void Region::subtract(Rectangle rectangle)
+{
+    Region other{rectangle};
+    *this = subtracted(other);
+}
+
+void Region::clip(Rectangle rectangle)
+{
+    Region other{rectangle};
+    *this = intersected_with(other);
+}
+
+/* --- Band sweep ----------------------------------------------------------- */
+
+// Every band edge of both regions, sorted and without duplicates.
+static void region_band_edges(Vector<Rectangle> &left, Vector<Rectangle> &right, Vector<int> &edges)
+{
+    auto add_edge = [&](int edge) {
+        size_t index = edges.count();
+
+        while (index > 0 && edges[index - 1] > edge)
+        {
+            index--;
+        }
+
+        if (index == 0 || edges[index - 1] != edge)
+        {
+            edges.insert(index, edge);
+        }
+    };
+
+    for (size_t i = 0; i < left.count(); i++)
+    {
+        add_edge(left[i].top());
+        add_edge(left[i].bottom());
+    }
+
+    for (size_t i = 0; i < right.count(); i++)
+    {
+        add_edge(right[i].top());
+        add_edge(right[i].bottom());
+    }
+}
+
+// The spans covering the line y, the cursor moves past the bands above it.
+static void region_spans_at(Vector<Rectangle> &rectangles, size_t &cursor, int y, Vector<Span> &spans)
+{
+    spans.clear();
+
+    while (cursor < rectangles.count() && rectangles[cursor].bottom() <= y)
+    {
+        cursor++;
+    }
+
+    for (size_t i = cursor; i < rectangles.count() && rectangles[i].top() <= y; i++)
+    {
+        spans.push_back({rectangles[i].left(), rectangles[i].right()});
+    }
+}
+
+static void push_span(Vector<Span> &spans, int left, int right)
+{
+    if (left >= right)
+    {
+        return;
+    }
+
+    if (spans.any() && spans.peek_back().right >= left)
+    {
+        spans.peek_back().right = MAX(spans.peek_back().right, right);
+        return;
+    }
+
+    spans.push_back({left, right});
+}
+
+static void spans_union(Vector<Span> &left, Vector<Span> &right, Vector<Span> &result)
+{
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < left.count() || j < right.count())
+    {
+        if (j >= right.count() || (i < left.count() && left[i].left <= right[j].left))
+        {
+            push_span(result, left[i].left, left[i].right);
+            i++;
+        }
+        else
+        {
+            push_span(result, right[j].left, right[j].right);
+            j++;
+        }
+    }
+}
+
+static void spans_intersect(Vector<Span> &left, Vector<Span> &right, Vector<Span> &result)
+{
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < left.count() && j < right.count())
+    {
+        push_span(result, MAX(left[i].left, right[j].left), MIN(left[i].right, right[j].right));
+
+        if (left[i].right < right[j].right)
+        {
+            i++;
+        }
+        else
+        {
+            j++;
+        }
+    }
+}
+
+static void spans_subtract(Vector<Span> &left, Vector<Span> &right, Vector<Span> &result)
+{
+    size_t j = 0;
+
+    for (size_t i = 0; i < left.count(); i++)
+    {
+        int start = left[i].left;
+
+        while (j < right.count() && right[j].right <= start)
+        {
+            j++;
+        }
+
+        for (size_t k = j; k < right.count() && right[k].left < left[i].right; k++)
+        {
+            push_span(result, start, right[k].left);
+            start = MAX(start, right[k].right);
+        }
+
+        push_span(result, start, left[i].right);
+    }
+}
+
+static bool spans_equals(Vector<Span> &left, Vector<Span> &right)
+{
+    if (left.count() != right.count())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < left.count(); i++)
+    {
+        if (left[i].left != right[i].left || left[i].right != right[i].right)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Region Region::combine(Region &left, Region &right, Operation operation)
+{
+    Region result;
+
+    Vector<int> edges;
+    region_band_edges(left._rectangles, right._rectangles, edges);
+
+    Vector<Span> left_spans;
+    Vector<Span> right_spans;
+    Vector<Span> spans;
+    Vector<Span> last_spans;
+
+    size_t left_cursor = 0;
+    size_t right_cursor = 0;
+
+    size_t last_band = 0;
+    int last_bottom = 0;
+
+    for (size_t i = 0; i + 1 < edges.count(); i++)
+    {
+        int top = edges[i];
+        int bottom = edges[i + 1];
+
+        region_spans_at(left._rectangles, left_cursor, top, left_spans);
+        region_spans_at(right._rectangles, right_cursor, top, right_spans);
+
+        spans.clear();
+
+        if (operation == Operation::UNION)
+        {
+            spans_union(left_spans, right_spans, spans);
+        }
+        else if (operation == Operation::SUBTRACT)
+        {
+            spans_subtract(left_spans, right_spans, spans);
+        }
+        else
+        {
+            spans_intersect(left_spans, right_spans, spans);
+        }
+
+        if (spans.empty())
+        {
+            continue;
+        }
+
+        // Same spans as the band right above, make it taller.
+        if (last_bottom == top && spans_equals(spans, last_spans))
+        {
+            for (size_t j = last_band; j < result._rectangles.count(); j++)
+            {
+                Rectangle &rectangle = result._rectangles[j];
+                rectangle = rectangle.with_height(bottom - rectangle.top());
+            }
+        }
+        else
+        {
+            last_band = result._rectangles.count();
+
+            for (size_t j = 0; j < spans.count(); j++)
+            {
+                result._rectangles.push_back(Rectangle(spans[j].left, top, spans[j].right - spans[j].left, bottom - top));
+            }
+
+            last_spans.clear();
+
+            for (size_t j = 0; j < spans.count(); j++)
+            {
+                last_spans.push_back(spans[j]);
+            }
+        }
+
+        last_bottom = bottom;
+    }
+
+    return result;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <libgraphic/Shape.h>
+#include <libutils/Vector.h>
+
+// A set of pixels, stored as y-x banded rectangles: the rectangles are sorted
+// by top then left, the rectangles of a band share the same top and bottom,
+// and rectangles of the same band don't touch each other. Bands with the same
+// rectangles are merged together, so a region has only one representation.
+class Region
+{
+private:
+    Vector<Rectangle> _rectangles{};
+
+    enum class Operation
+    {
+        UNION,
+        SUBTRACT,
+        INTERSECT,
+    };
+
+    static Region combine(Region &left, Region &right, Operation operation);
+
+public:
+    size_t count() const { return _rectangles.count(); }
+
+    bool is_empty() const { return _rectangles.empty(); }
+
+    Region() {}
+
+    Region(Rectangle rectangle);
+
+    Region(Region &other);
+
+    Region(Region &&other);
+
+    Region &operator=(Region &other);
+
+    Region &operator=(Region &&other);
+
+    Rectangle bound();
+
+    int area();
+
+    bool colide_with(Rectangle rectangle);
+
+    Region united_with(Region &other) { return combine(*this, other, Operation::UNION); }
+
+    Region subtracted(Region &other) { return combine(*this, other, Operation::SUBTRACT); }
+
+    Region intersected_with(Region &other) { return combine(*this, other, Operation::INTERSECT); }
+
+    void add(Rectangle rectangle);
+
+    void subtract(Rectangle rectangle);
+
+    void clip(Rectangle rectangle);
+
+    void clear() { _rectangles.clear(); }
+
+    template <typename Callback>
+    Iteration foreach (Callback callback)
+    {
+        return _rectangles.foreach(callback);
+    }
+};
@@ -1,8 +1,12 @@
 #include <libgraphic/Bitmap.h>
 #include <libgraphic/TrueType.h>
 #include <libgraphic/TrueTypeFont.h>
+#include <libsystem/core/CString.h>
 #include <libsystem/io/Stream.h>
+#include <libsystem/math/MinMax.h>
 #include <libsystem/math/Vectors.h>
+#include <libutils/HashMap.h>
+#include <libutils/Vector.h>
 
 struct TrueTypeFamily
 {
@@ -11,6 +15,21 @@ struct TrueTypeFamily
     size_t buffer_size;
 };
 
+// Glyphs are rastered a page at a time, the first time one of them is needed.
+#define TRUETYPE_PAGE_SIZE (128)
+
+// ASCII and Latin-1 are looked up directly, the rest goes through a map.
+#define TRUETYPE_LATIN_GLYPHS (256)
+
+#define TRUETYPE_ATLAS_INITIAL_SIZE (256)
+#define TRUETYPE_ATLAS_MAXIMUM_SIZE (4096)
+
+struct TrueTypeRange
+{
+    Codepoint start;
+    Codepoint end;
+};
+
 struct TrueTypeFont
 {
     truetype_pack_context rasterizer;
@@ -19,7 +38,16 @@ struct TrueTypeFont
     int size;
 
     size_t glyphs_count;
+    size_t glyphs_capacity;
     TrueTypeGlyph *glyphs;
+
+    // Index in `glyphs` plus one, zero if the codepoint isn't rastered yet.
+    size_t latin_glyphs[TRUETYPE_LATIN_GLYPHS];
+    HashMap<Codepoint, size_t> other_glyphs;
+
+    // What was rastered so far, to do it again in a bigger atlas.
+    Vector<TrueTypeRange> ranges;
+
     TrueTypeAtlas *atlas;
 };
 
@@ -50,29 +78,35 @@ void truetype_family_destroy(TrueTypeFamily *family)
     free(family);
 }
 
-TrueTypeFont *truetypefont_create(TrueTypeFamily *family, int size)
+static TrueTypeAtlas *truetypefont_atlas_create(int size)
 {
-    TrueTypeFont *font = __create(TrueTypeFont);
+    TrueTypeAtlas *atlas = (TrueTypeAtlas *)calloc(1, sizeof(TrueTypeAtlas) + size * size);
+    atlas->width = size;
+    atlas->height = size;
 
-    font->family = family;
-    font->size = size;
-
-    TrueTypeAtlas *atlas = (TrueTypeAtlas *)malloc(sizeof(TrueTypeAtlas) + 512 * 512);
-    atlas->width = 512;
-    atlas->height = 512;
-
-    font->atlas = atlas;
+    return atlas;
+}
 
+static void truetypefont_pack_begin(TrueTypeFont *font)
+{
     truetype_PackBegin(
         &font->rasterizer,
-        atlas->buffer,
-        atlas->width,
-        atlas->height,
+        font->atlas->buffer,
+        font->atlas->width,
+        font->atlas->height,
         0,
         1);
+}
+
+TrueTypeFont *truetypefont_create(TrueTypeFamily *family, int size)
+{
+    TrueTypeFont *font = new TrueTypeFont{};
+
+    font->family = family;
+    font->size = size;
+    font->atlas = truetypefont_atlas_create(TRUETYPE_ATLAS_INITIAL_SIZE);
 
-    //truetypefont_raster_range(font, 0x0020, 0x007f);
-    //truetypefont_raster_range(font, 0x00A0, 0x00FF);
+    truetypefont_pack_begin(font);
 
     return font;
 }
@@ -87,33 +121,27 @@ void truetypefont_destroy(TrueTypeFont *font)
     }
 
     free(font->atlas);
-    free(font);
+    delete font;
 }
 
-void truetypefont_raster_range(TrueTypeFont *font, Codepoint start, Codepoint end)
+// Returns false if some of the glyphs didn't fit in the atlas.
+static bool truetypefont_pack_range(TrueTypeFont *font, Codepoint start, Codepoint end)
 {
-    size_t start_index = 0;
     size_t count = end - start + 1;
 
-    if (!font->glyphs)
-    {
-        font->glyphs_count = count;
-        font->glyphs = (TrueTypeGlyph *)calloc(font->glyphs_count, sizeof(TrueTypeGlyph));
-    }
-    else
+    if (font->glyphs_count + count > font->glyphs_capacity)
     {
-        start_index = font->glyphs_count;
-
-        font->glyphs_count += count;
-        font->glyphs = (TrueTypeGlyph *)realloc(font->glyphs, font->glyphs_count * sizeof(TrueTypeGlyph));
+        font->glyphs_capacity = MAX(font->glyphs_capacity * 2, font->glyphs_count + count);
+        font->glyphs = (TrueTypeGlyph *)realloc(font->glyphs, font->glyphs_capacity * sizeof(TrueTypeGlyph));
     }
 
-    __cleanup_malloc truetype_packedchar *packedchar = (truetype_packedchar *)calloc(0x02AF, sizeof(truetype_packedchar));
-    truetype_PackFontRange(&font->rasterizer, (unsigned char *)font->family->buffer, 0, font->size, start, count, packedchar);
+    __cleanup_malloc truetype_packedchar *packedchar = (truetype_packedchar *)calloc(count, sizeof(truetype_packedchar));
+    int packed = truetype_PackFontRange(&font->rasterizer, (unsigned char *)font->family->buffer, 0, font->size, start, count, packedchar);
 
     for (size_t i = 0; i < count; i++)
     {
-        TrueTypeGlyph *glyph = &font->glyphs[start_index + i];
+        size_t index = font->glyphs_count + i;
+        TrueTypeGlyph *glyph = &font->glyphs[index];
 
         glyph->advance = packedchar[i].xadvance;
 
@@ -126,7 +154,58 @@ void truetypefont_raster_range(TrueTypeFont *font, Codepoint start, Codepoint en
             packedchar[i].y0,
             packedchar[i].x1 - packedchar[i].x0,
             packedchar[i].y1 - packedchar[i].y0);
+
+        if (glyph->codepoint < TRUETYPE_LATIN_GLYPHS)
+        {
+            font->latin_glyphs[glyph->codepoint] = index + 1;
+        }
+        else
+        {
+            font->other_glyphs[glyph->codepoint] = index;
+        }
+    }
+
+    font->glyphs_count += count;
+
+    return packed;
+}
+
+// Starts over in an atlas twice as big, with everything rastered so far.
+static bool truetypefont_grow_atlas(TrueTypeFont *font)
+{
+    if (font->atlas->width >= TRUETYPE_ATLAS_MAXIMUM_SIZE)
+    {
+        return false;
+    }
+
+    int size = font->atlas->width * 2;
+
+    truetype_PackEnd(&font->rasterizer);
+    free(font->atlas);
+
+    font->atlas = truetypefont_atlas_create(size);
+    truetypefont_pack_begin(font);
+
+    font->glyphs_count = 0;
+    memset(font->latin_glyphs, 0, sizeof(font->latin_glyphs));
+    font->other_glyphs.clear();
+
+    for (size_t i = 0; i < font->ranges.count(); i++)
+    {
+        truetypefont_pack_range(font, font->ranges[i].start, font->ranges[i].end);
     }
+
+    return true;
+}
+
+void truetypefont_raster_range(TrueTypeFont *font, Codepoint start, Codepoint end)
+{
+    while (!truetypefont_pack_range(font, start, end) &&
+           truetypefont_grow_atlas(font))
+    {
+    }
+
+    font->ranges.push_back({start, end});
 }
 
 TrueTypeAtlas *truetypefont_get_atlas(TrueTypeFont *font)
@@ -136,15 +215,16 @@ TrueTypeAtlas *truetypefont_get_atlas(TrueTypeFont *font)
 
 static TrueTypeGlyph *lookup_glyph(TrueTypeFont *font, Codepoint codepoint)
 {
-    for (size_t i = 0; i < font->glyphs_count; i++)
+    if (codepoint < TRUETYPE_LATIN_GLYPHS)
     {
-        if (font->glyphs[i].codepoint == codepoint)
-        {
-            return &font->glyphs[i];
-        }
+        size_t index = font->latin_glyphs[codepoint];
+
+        return index ? &font->glyphs[index - 1] : nullptr;
     }
 
-    return nullptr;
+    size_t *index = font->other_glyphs.lookup(codepoint);
+
+    return index ? &font->glyphs[*index] : nullptr;
 }
 
 TrueTypeGlyph *truetypefont_get_glyph_for_codepoint(TrueTypeFont *font, Codepoint codepoint)
@@ -156,7 +236,8 @@ TrueTypeGlyph *truetypefont_get_glyph_for_codepoint(TrueTypeFont *font, Codepoin
         return glyph;
     }
 
-    truetypefont_raster_range(font, codepoint, codepoint);
+    Codepoint page = codepoint & ~(TRUETYPE_PAGE_SIZE - 1);
+    truetypefont_raster_range(font, page, page + TRUETYPE_PAGE_SIZE - 1);
 
     return lookup_glyph(font, codepoint);
 }
@@ -2,6 +2,8 @@
 
 #include <libutils/HashMap.h>
 #include <libutils/String.h>
+#include <libutils/StringView.h>
+#include <libutils/Vector.h>
 
 namespace json
 {
@@ -84,17 +86,17 @@ int integer_value(Value *value);
 double double_value(Value *value);
 
 // Return true if the JSON_OBJECT contains the key
-bool object_has(Value *object, const String &key);
+bool object_has(Value *object, StringView key);
 
 // Return a Value contained in a JSON_OBJECT by its key. The object keep the ownership of the value
-Value *object_get(Value *object, const String &key);
+Value *object_get(Value *object, StringView key);
 
 // Put a Value in the json object.
 // The object will take the ownership of the value and create a copy of the key.
 void object_put(Value *object, const String &key, Value *value);
 
 // Remove a child from a JSON_OBJECT using a key.
-void object_remove(Value *object, const String &key);
+void object_remove(Value *object, StringView key);
 
 // Return the length of a JSON_ARRAY
 size_t array_length(Value *array);
@@ -122,9 +124,15 @@ char *stringify(Value *value);
 char *prettify(Value *value);
 
 // Parse a json string and return a Value tree.
+// Return nullptr if the string is malformed. Use a json::Reader to go through
+// a document without building a tree.
 Value *parse(const char *str, size_t size);
 
+// Parse a json string and return a Value tree.
+// Return nullptr if the string is malformed.
+Value *parse(StringView string);
+
 // Parse a json file and return a Value tree.
-// Return nullptr on error.
+// Return nullptr on error or if the file is malformed.
 Value *parse_file(const char *path);
 } // namespace json
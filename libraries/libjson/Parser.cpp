@@ -1,242 +1,144 @@
 #include <libjson/Json.h>
-#include <libsystem/Assert.h>
+#include <libjson/Reader.h>
 #include <libsystem/core/CString.h>
 #include <libsystem/io/Stream.h>
-#include <libsystem/math/Math.h>
-#include <libsystem/unicode/Codepoint.h>
-#include <libsystem/utils/BufferBuilder.h>
-#include <libsystem/utils/Lexer.h>
-#include <libsystem/utils/NumberParser.h>
+#include <libsystem/math/MinMax.h>
+#ifndef __KERNEL__
+#include <libutils/StringIntern.h>
+#endif
 
 namespace json
 {
-static constexpr const char *WHITESPACE = " \n\r\t";
-static constexpr const char *DIGITS = "0123456789";
-static constexpr const char *ALPHA = "abcdefghijklmnopqrstuvwxyz";
-
-static Value *value(Lexer &lexer);
 
-static void whitespace(Lexer &lexer)
-{
-    lexer.eat(WHITESPACE);
-}
+static Value *value(Reader &reader, Token token);
 
-static int digits(Lexer &lexer)
+static String key(Reader &reader)
 {
-    int digits = 0;
-
-    while (lexer.current_is(DIGITS))
+    if (!reader.escaped())
     {
-        digits *= 10;
-        digits += lexer.current() - '0';
-        lexer.foreward();
-    }
-
-    return digits;
-}
-
-static Value *number(Lexer &lexer)
-{
-    int ipart_sign = 1;
-
-    if (lexer.skip('-'))
-    {
-        ipart_sign = -1;
+#ifdef __KERNEL__
+        return String(reader.string());
+#else
+        // Documents repeat the same keys, let them share their storage.
+        return string_intern(reader.string());
+#endif
     }
 
-    int ipart = 0;
-
-    if (lexer.current_is(DIGITS))
-    {
-        ipart = digits(lexer);
-    }
+    char *unescaped __cleanup_malloc = reader.string_copy();
 
 #ifdef __KERNEL__
-    return create_integer(ipart_sign * ipart);
+    return String(unescaped);
 #else
-    double fpart = 0;
-
-    if (lexer.skip('.'))
-    {
-        double multiplier = 0.1;
-
-        while (lexer.current_is(DIGITS))
-        {
-            fpart += multiplier * (lexer.current() - '0');
-            multiplier *= 0.1;
-            lexer.foreward();
-        }
-    }
+    return string_intern(unescaped);
+#endif
+}
 
-    int exp = 0;
+static Value *array(Reader &reader)
+{
+    Value *array = create_array();
 
-    if (lexer.current_is("eE"))
+    for (Token token = reader.next(); token != TOKEN_END_ARRAY; token = reader.next())
     {
-        lexer.foreward();
-        int exp_sign = 1;
+        Value *element = value(reader, token);
 
-        if (lexer.current() == '-')
+        if (element == nullptr)
         {
-            exp_sign = -1;
+            destroy(array);
+            return nullptr;
         }
 
-        if (lexer.current_is("+-"))
-            lexer.foreward();
-
-        exp = digits(lexer) * exp_sign;
+        array_append(array, element);
     }
 
-    if (fpart == 0 && exp >= 0)
-    {
-        return create_integer(ipart_sign * ipart * pow(10, exp));
-    }
-    else
-    {
-        return create_double(ipart_sign * (ipart + fpart) * pow(10, exp));
-    }
-#endif
+    return array;
 }
 
-static char *string(Lexer &lexer)
+static Value *object(Reader &reader)
 {
-    BufferBuilder *builder = buffer_builder_create(16);
-
-    lexer.skip('"');
+    Value *object = create_object();
 
-    while (lexer.current() != '"' &&
-           lexer.do_continue())
+    for (Token token = reader.next(); token != TOKEN_END_OBJECT; token = reader.next())
     {
-        if (lexer.current() == '\\')
+        if (token != TOKEN_KEY)
         {
-            buffer_builder_append_str(builder, lexer.read_escape_sequence());
+            destroy(object);
+            return nullptr;
         }
-        else
+
+        String k = key(reader);
+        Value *v = value(reader, reader.next());
+
+        if (v == nullptr)
         {
-            buffer_builder_append_chr(builder, lexer.current());
-            lexer.foreward();
+            destroy(object);
+            return nullptr;
         }
-    }
 
-    lexer.skip('"');
+        object_put(object, k, v);
+    }
 
-    return buffer_builder_finalize(builder);
+    return object;
 }
 
-static Value *array(Lexer &lexer)
+// Returns nullptr if the document is malformed.
+static Value *value(Reader &reader, Token token)
 {
-    lexer.skip('[');
-
-    Value *array = create_array();
-
-    int index = 0;
-    do
+    switch (token)
     {
-        lexer.skip(',');
-        array_put(array, index, value(lexer));
-        index++;
-    } while (lexer.current() == ',');
+    case TOKEN_BEGIN_OBJECT:
+        return object(reader);
 
-    lexer.skip(']');
+    case TOKEN_BEGIN_ARRAY:
+        return array(reader);
 
-    return array;
-}
-
-static Value *object(Lexer &lexer)
-{
-    lexer.skip('{');
-
-    Value *object = create_object();
+    case TOKEN_STRING:
+        return create_string_adopt(reader.string_copy());
 
-    whitespace(lexer);
-    while (lexer.current() != '}')
-    {
-        char *k __cleanup_malloc = string(lexer);
-        whitespace(lexer);
+    case TOKEN_INTEGER:
+        return create_integer(reader.integer());
 
-        lexer.skip(':');
+    case TOKEN_DOUBLE:
+        return create_double(reader.double_());
 
-        Value *v = value(lexer);
+    case TOKEN_TRUE:
+        return create_boolean(true);
 
-        object_put(object, k, v);
+    case TOKEN_FALSE:
+        return create_boolean(false);
 
-        lexer.skip(',');
+    case TOKEN_NIL:
+        return create_nil();
 
-        whitespace(lexer);
+    default:
+        return nullptr;
     }
-
-    lexer.skip('}');
-
-    return object;
 }
 
-static Value *keyword(Lexer &lexer)
+Value *parse(const char *string, size_t size)
 {
-    BufferBuilder *builder = buffer_builder_create(6);
-
-    while (lexer.current_is(ALPHA) &&
-           lexer.do_continue())
-    {
-        buffer_builder_append_chr(builder, lexer.current());
-        lexer.foreward();
-    }
-
-    __cleanup_malloc char *keyword = buffer_builder_finalize(builder);
-
-    if (strcmp(keyword, "true") == 0)
-    {
-        return create_boolean(true);
-    }
-    else if (strcmp(keyword, "false") == 0)
-    {
-        return create_boolean(false);
-    }
-    else
+    // Skip the utf8 bom header if present.
+    if (size >= 3 && memcmp(string, "\xEF\xBB\xBF", 3) == 0)
     {
-        return create_nil();
+        string += 3;
+        size -= 3;
     }
-}
 
-static Value *value(Lexer &lexer)
-{
-    whitespace(lexer);
+    Reader reader{string, size};
 
-    Value *value = nullptr;
+    Value *result = value(reader, reader.next());
 
-    if (lexer.current() == '"')
-    {
-        value = create_string_adopt(string(lexer));
-    }
-    else if (lexer.current_is("-0123456789"))
-    {
-        value = number(lexer);
-    }
-    else if (lexer.current() == '{')
-    {
-        value = object(lexer);
-    }
-    else if (lexer.current() == '[')
-    {
-        value = array(lexer);
-    }
-    else
+    if (result && reader.next() != TOKEN_END)
     {
-        value = keyword(lexer);
+        destroy(result);
+        return nullptr;
     }
 
-    whitespace(lexer);
-
-    return value;
+    return result;
 }
 
-Value *parse(const char *string, size_t size)
+Value *parse(StringView string)
 {
-    Lexer lexer(string, size);
-    // Skip the utf8 bom header if present.
-    lexer.skip_word("\xEF\xBB\xBF");
-
-    Value *result = value(lexer);
-
-    return result;
+    return parse(string.data(), string.length());
 }
 
 Value *parse_file(const char *path)
@@ -248,12 +150,33 @@ Value *parse_file(const char *path)
         return nullptr;
     }
 
-    Lexer lexer(json_file);
-    // Skip the utf8 bom header if present.
-    lexer.skip_word("\xEF\xBB\xBF");
+    // Files under /System are generated and don't know their size, so read
+    // until the end and only use the size as a hint.
+    FileState state = {};
+    stream_stat(json_file, &state);
+
+    size_t capacity = MAX(state.size + 1, 4096);
+    size_t size = 0;
+    char *buffer = (char *)malloc(capacity);
 
-    Value *result = value(lexer);
+    size_t read = 0;
+
+    while ((read = stream_read(json_file, buffer + size, capacity - size)) > 0)
+    {
+        size += read;
+
+        if (size == capacity)
+        {
+            capacity *= 2;
+            buffer = (char *)realloc(buffer, capacity);
+        }
+    }
+
+    Value *result = parse(buffer, size);
+
+    free(buffer);
 
     return result;
 }
+
 } // namespace json
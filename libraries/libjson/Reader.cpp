@@ -0,0 +1,637 @@
+#include <libjson/Reader.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/unicode/Codepoint.h>
+
+namespace json
+{
+
+#define CLASS_WHITESPACE (1 << 0)
+#define CLASS_DIGIT (1 << 1)
+
+struct CharacterClasses
+{
+    uint8_t classes[256];
+
+    constexpr CharacterClasses() : classes{}
+    {
+        classes[(uint8_t)' '] = CLASS_WHITESPACE;
+        classes[(uint8_t)'\n'] = CLASS_WHITESPACE;
+        classes[(uint8_t)'\r'] = CLASS_WHITESPACE;
+        classes[(uint8_t)'\t'] = CLASS_WHITESPACE;
+
+        for (char digit = '0'; digit <= '9'; digit++)
+        {
+            classes[(uint8_t)digit] = CLASS_DIGIT;
+        }
+    }
+};
+
+static constexpr CharacterClasses _classes{};
+
+static inline bool is_whitespace(char chr)
+{
+    return _classes.classes[(uint8_t)chr] & CLASS_WHITESPACE;
+}
+
+static inline bool is_digit(char chr)
+{
+    return _classes.classes[(uint8_t)chr] & CLASS_DIGIT;
+}
+
+// Whether any byte of the word is the one repeated in the pattern.
+static inline bool word_has_byte(uint32_t word, uint32_t pattern)
+{
+    uint32_t bytes = word ^ pattern;
+
+    return (bytes - 0x01010101) & ~bytes & 0x80808080;
+}
+
+#ifndef __KERNEL__
+
+// Exact as doubles, so one multiplication or division rounds correctly when
+// the mantissa fits in 53 bits.
+static constexpr double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static double to_double(uint64_t mantissa, int exponent)
+{
+    double value = mantissa;
+
+    while (exponent > 22)
+    {
+        value *= POWERS_OF_TEN[22];
+        exponent -= 22;
+    }
+
+    while (exponent < -22)
+    {
+        value /= POWERS_OF_TEN[22];
+        exponent += 22;
+    }
+
+    if (exponent >= 0)
+    {
+        return value * POWERS_OF_TEN[exponent];
+    }
+    else
+    {
+        return value / POWERS_OF_TEN[-exponent];
+    }
+}
+
+#endif
+
+// Returns false if mantissa * 10^exponent isn't an integer which fits in an
+// int, `result` is then rounded toward zero and clamped.
+static bool to_integer(uint64_t mantissa, int exponent, bool negative, int *result)
+{
+    bool exact = true;
+
+    for (; exponent < 0 && mantissa; exponent++)
+    {
+        exact = exact && (mantissa % 10 == 0);
+        mantissa /= 10;
+    }
+
+    for (; exponent > 0 && mantissa && mantissa <= 0x80000000; exponent--)
+    {
+        mantissa *= 10;
+    }
+
+    uint64_t limit = negative ? 0x80000000 : 0x7fffffff;
+
+    if (mantissa > limit)
+    {
+        mantissa = limit;
+        exact = false;
+    }
+
+    *result = negative ? -(int64_t)mantissa : (int64_t)mantissa;
+
+    return exact;
+}
+
+Token Reader::fail()
+{
+    _failed = true;
+
+    return TOKEN_ERROR;
+}
+
+Token Reader::begin(bool object)
+{
+    if (_depth == MAX_DEPTH)
+    {
+        return fail();
+    }
+
+    if (object)
+    {
+        _containers[_depth / 32] |= 1u << (_depth % 32);
+    }
+    else
+    {
+        _containers[_depth / 32] &= ~(1u << (_depth % 32));
+    }
+
+    _depth++;
+    _current++;
+    _after_value = false;
+
+    return object ? TOKEN_BEGIN_OBJECT : TOKEN_BEGIN_ARRAY;
+}
+
+Token Reader::end(char closing)
+{
+    if (_depth == 0 || _after_key || (closing == '}') != in_object())
+    {
+        return fail();
+    }
+
+    _depth--;
+    _current++;
+
+    return value_done(closing == '}' ? TOKEN_END_OBJECT : TOKEN_END_ARRAY);
+}
+
+Token Reader::value_done(Token token)
+{
+    _after_value = true;
+
+    return token;
+}
+
+void Reader::skip_whitespace()
+{
+    while (_current < _end && is_whitespace(*_current))
+    {
+        _current++;
+    }
+}
+
+bool Reader::read_string()
+{
+    const char *start = ++_current;
+    _escaped = false;
+
+    while (true)
+    {
+        // Most strings have no escape sequences, go through them a word at
+        // a time until something interesting shows up.
+        while (_end - _current >= 4)
+        {
+            uint32_t word;
+            memcpy(&word, _current, sizeof(word));
+
+            if (word_has_byte(word, 0x22222222) || word_has_byte(word, 0x5c5c5c5c))
+            {
+                break;
+            }
+
+            _current += 4;
+        }
+
+        if (_current == _end)
+        {
+            return false;
+        }
+
+        if (*_current == '"')
+        {
+            _string = StringView(start, _current - start);
+            _current++;
+
+            return true;
+        }
+
+        if (*_current == '\\')
+        {
+            if (_end - _current < 2)
+            {
+                return false;
+            }
+
+            _escaped = true;
+            _current += 2;
+        }
+        else
+        {
+            _current++;
+        }
+    }
+}
+
+Token Reader::read_number()
+{
+    bool negative = false;
+
+    if (*_current == '-')
+    {
+        negative = true;
+        _current++;
+    }
+
+    if (_current == _end || !is_digit(*_current))
+    {
+        return fail();
+    }
+
+    // Past 19 digits only the magnitude matters, the mantissa would overflow.
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+
+    while (_current < _end && is_digit(*_current))
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*_current - '0');
+            digits += mantissa != 0;
+        }
+        else
+        {
+            exponent++;
+        }
+
+        _current++;
+    }
+
+    bool fraction = false;
+
+    if (_current < _end && *_current == '.')
+    {
+        _current++;
+
+        if (_current == _end || !is_digit(*_current))
+        {
+            return fail();
+        }
+
+        while (_current < _end && is_digit(*_current))
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*_current - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+
+            fraction = fraction || *_current != '0';
+            _current++;
+        }
+    }
+
+    if (_current < _end && (*_current == 'e' || *_current == 'E'))
+    {
+        _current++;
+
+        bool negative_exponent = false;
+
+        if (_current < _end && (*_current == '+' || *_current == '-'))
+        {
+            negative_exponent = *_current == '-';
+            _current++;
+        }
+
+        if (_current == _end || !is_digit(*_current))
+        {
+            return fail();
+        }
+
+        int explicit_exponent = 0;
+
+        while (_current < _end && is_digit(*_current))
+        {
+            if (explicit_exponent < 10000)
+            {
+                explicit_exponent = explicit_exponent * 10 + (*_current - '0');
+            }
+
+            _current++;
+        }
+
+        exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+    }
+
+    bool exact = to_integer(mantissa, exponent, negative, &_integer);
+
+#ifdef __KERNEL__
+    __unused(exact);
+    __unused(fraction);
+
+    return value_done(TOKEN_INTEGER);
+#else
+    if (exact && !fraction)
+    {
+        _double = _integer;
+
+        return value_done(TOKEN_INTEGER);
+    }
+
+    _double = to_double(mantissa, exponent);
+
+    if (negative)
+    {
+        _double = -_double;
+    }
+
+    return value_done(TOKEN_DOUBLE);
+#endif
+}
+
+Token Reader::read_keyword()
+{
+    struct Keyword
+    {
+        const char *text;
+        size_t length;
+        Token token;
+    };
+
+    static constexpr Keyword KEYWORDS[] = {
+        {"true", 4, TOKEN_TRUE},
+        {"false", 5, TOKEN_FALSE},
+        {"null", 4, TOKEN_NIL},
+    };
+
+    for (const Keyword &keyword : KEYWORDS)
+    {
+        if ((size_t)(_end - _current) >= keyword.length &&
+            memcmp(_current, keyword.text, keyword.length) == 0)
+        {
+            _current += keyword.length;
+            return value_done(keyword.token);
+        }
+    }
+
+    return fail();
+}
+
+Token Reader::next()
+{
+    if (_failed)
+    {
+        return TOKEN_ERROR;
+    }
+
+    skip_whitespace();
+
+    if (_depth == 0 && _after_value)
+    {
+        return _current == _end ? TOKEN_END : fail();
+    }
+
+    if (_current == _end)
+    {
+        return fail();
+    }
+
+    char chr = *_current;
+
+    if (_after_value)
+    {
+        if (chr == ',')
+        {
+            _current++;
+            _after_value = false;
+
+            skip_whitespace();
+
+            if (_current == _end)
+            {
+                return fail();
+            }
+
+            chr = *_current;
+        }
+        else if (chr != '}' && chr != ']')
+        {
+            return fail();
+        }
+    }
+
+    if (chr == '}' || chr == ']')
+    {
+        return end(chr);
+    }
+
+    if (in_object() && !_after_key)
+    {
+        if (chr != '"' || !read_string())
+        {
+            return fail();
+        }
+
+        skip_whitespace();
+
+        if (_current == _end || *_current != ':')
+        {
+            return fail();
+        }
+
+        _current++;
+        _after_key = true;
+
+        return TOKEN_KEY;
+    }
+
+    _after_key = false;
+
+    switch (chr)
+    {
+    case '{':
+        return begin(true);
+
+    case '[':
+        return begin(false);
+
+    case '"':
+        if (!read_string())
+        {
+            return fail();
+        }
+
+        return value_done(TOKEN_STRING);
+
+    case 't':
+    case 'f':
+    case 'n':
+        return read_keyword();
+
+    default:
+        if (chr == '-' || is_digit(chr))
+        {
+            return read_number();
+        }
+
+        return fail();
+    }
+}
+
+Token Reader::skip(Token token)
+{
+    if (token != TOKEN_BEGIN_OBJECT && token != TOKEN_BEGIN_ARRAY)
+    {
+        return token;
+    }
+
+    size_t depth = _depth - 1;
+
+    do
+    {
+        token = next();
+
+        if (token == TOKEN_ERROR)
+        {
+            return token;
+        }
+    } while (_depth > depth);
+
+    return token;
+}
+
+// Only moves `current` past the digits if there are four of them.
+static bool read_hex4(const char *&current, const char *end, Codepoint *value)
+{
+    if (end - current < 4)
+    {
+        return false;
+    }
+
+    Codepoint result = 0;
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        char chr = current[i];
+        result <<= 4;
+
+        if (chr >= '0' && chr <= '9')
+        {
+            result |= chr - '0';
+        }
+        else if (chr >= 'a' && chr <= 'f')
+        {
+            result |= chr - 'a' + 10;
+        }
+        else if (chr >= 'A' && chr <= 'F')
+        {
+            result |= chr - 'A' + 10;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    current += 4;
+    *value = result;
+
+    return true;
+}
+
+char *Reader::string_copy() const
+{
+    // Escape sequences are never shorter than what they stand for, so the
+    // copy fits in the size of the raw string.
+    char *result = (char *)malloc(_string.length() + 1);
+
+    if (!_escaped)
+    {
+        memcpy(result, _string.data(), _string.length());
+        result[_string.length()] = '\0';
+
+        return result;
+    }
+
+    const char *current = _string.data();
+    const char *end = current + _string.length();
+    char *output = result;
+
+    while (current < end)
+    {
+        if (*current != '\\')
+        {
+            *output++ = *current++;
+            continue;
+        }
+
+        current++;
+        char chr = *current++;
+
+        switch (chr)
+        {
+        case 'b':
+            *output++ = '\b';
+            break;
+
+        case 'f':
+            *output++ = '\f';
+            break;
+
+        case 'n':
+            *output++ = '\n';
+            break;
+
+        case 'r':
+            *output++ = '\r';
+            break;
+
+        case 't':
+            *output++ = '\t';
+            break;
+
+        case 'u':
+        {
+            Codepoint codepoint = 0;
+
+            if (!read_hex4(current, end, &codepoint))
+            {
+                // Not an escape sequence after all, the 'u' stands for itself.
+                *output++ = 'u';
+                break;
+            }
+
+            if (codepoint >= 0xD800 && codepoint <= 0xDBFF)
+            {
+                Codepoint low = 0;
+
+                const char *second = current + 2;
+
+                if (end - current >= 2 && current[0] == '\\' && current[1] == 'u' &&
+                    read_hex4(second, end, &low) &&
+                    low >= 0xDC00 && low <= 0xDFFF)
+                {
+                    current = second;
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                else
+                {
+                    codepoint = 0xFFFD;
+                }
+            }
+            else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF)
+            {
+                codepoint = 0xFFFD;
+            }
+
+            uint8_t utf8[5];
+            int length = codepoint_to_utf8(codepoint, utf8);
+            memcpy(output, utf8, length);
+            output += length;
+            break;
+        }
+
+        default:
+            // '"', '\\', '/' and anything unknown stand for themselves.
+            *output++ = chr;
+            break;
+        }
+    }
+
+    *output = '\0';
+
+    return result;
+}
+
+} // namespace json
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <libsystem/Common.h>
+#include <libutils/StringView.h>
+
+namespace json
+{
+
+enum Token
+{
+    TOKEN_BEGIN_OBJECT,
+    TOKEN_END_OBJECT,
+    TOKEN_BEGIN_ARRAY,
+    TOKEN_END_ARRAY,
+
+    // A key of an object, the value comes with the next token.
+    TOKEN_KEY,
+
+    TOKEN_STRING,
+    TOKEN_INTEGER,
+    TOKEN_DOUBLE,
+    TOKEN_TRUE,
+    TOKEN_FALSE,
+    TOKEN_NIL,
+
+    // The document ended, there is nothing left to read.
+    TOKEN_END,
+
+    // The document is malformed, every following token is an error too.
+    TOKEN_ERROR,
+};
+
+// A pull parser over a buffer, it reads one token at a time and never
+// allocates. Strings and keys are views into the buffer, call string_copy()
+// for a copy with the escape sequences resolved.
+//
+// Trailing commas and control characters in strings are accepted, the
+// configuration files are written by hand.
+class Reader
+{
+private:
+    static constexpr size_t MAX_DEPTH = 256;
+
+    const char *_current;
+    const char *_end;
+
+    // One bit per level of nesting, set for objects.
+    uint32_t _containers[MAX_DEPTH / 32] = {};
+    size_t _depth = 0;
+
+    bool _after_key = false;
+    bool _after_value = false;
+    bool _failed = false;
+
+    StringView _string{};
+    bool _escaped = false;
+
+    int _integer = 0;
+    double _double = 0;
+
+    bool in_object() const
+    {
+        return _depth > 0 && (_containers[(_depth - 1) / 32] & (1u << ((_depth - 1) % 32)));
+    }
+
+    Token fail();
+
+    Token begin(bool object);
+
+    Token end(char closing);
+
+    Token value_done(Token token);
+
+    bool read_string();
+
+    Token read_number();
+
+    Token read_keyword();
+
+    void skip_whitespace();
+
+public:
+    Reader(const char *buffer, size_t size)
+        : _current(buffer), _end(buffer + size)
+    {
+    }
+
+    Reader(StringView view)
+        : Reader(view.data(), view.length())
+    {
+    }
+
+    size_t depth() const { return _depth; }
+
+    // The raw content of the last TOKEN_KEY or TOKEN_STRING, without the
+    // quotes and with its escape sequences as they are in the document.
+    StringView string() const { return _string; }
+
+    // Whether string() contains escape sequences.
+    bool escaped() const { return _escaped; }
+
+    // The value of the last TOKEN_INTEGER, or TOKEN_DOUBLE rounded toward
+    // zero.
+    int integer() const { return _integer; }
+
+    // The value of the last TOKEN_DOUBLE or TOKEN_INTEGER.
+    double double_() const { return _double; }
+
+    Token next();
+
+    // Skips the value which starts with `token`, nested containers included.
+    Token skip(Token token);
+
+    // Returns a mallocated copy of string() with its escape sequences
+    // resolved.
+    char *string_copy() const;
+};
+
+} // namespace json
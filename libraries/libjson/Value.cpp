@@ -156,7 +156,7 @@ int integer_value(Value *value)
     {
         return value->storage_integer;
     }
-    else if (is(value, INTEGER))
+    else if (is(value, DOUBLE))
     {
         return value->storage_double;
     }
@@ -174,7 +174,7 @@ double double_value(Value *value)
     {
         return value->storage_integer;
     }
-    else if (is(value, INTEGER))
+    else if (is(value, DOUBLE))
     {
         return value->storage_double;
     }
@@ -186,40 +186,46 @@ double double_value(Value *value)
 
 #endif
 
-bool object_has(Value *object, const String &key)
+bool object_has(Value *object, StringView key)
 {
     assert(is(object, OBJECT));
 
     return object->storage_object->has_key(key);
 }
 
-Value *object_get(Value *object, const String &key)
+Value *object_get(Value *object, StringView key)
 {
     assert(is(object, OBJECT));
 
-    return (*object->storage_object)[key];
+    Value **value = object->storage_object->lookup(key);
+
+    return value ? *value : nullptr;
 }
 
 void object_put(Value *object, const String &key, Value *value)
 {
     assert(is(object, OBJECT));
 
-    if (object->storage_object->has_key(key))
+    Value *&slot = (*object->storage_object)[key];
+
+    if (slot)
     {
-        destroy((*object->storage_object)[key]);
+        destroy(slot);
     }
 
-    (*object->storage_object)[key] = value;
+    slot = value;
 }
 
-void object_remove(Value *object, const String &key)
+void object_remove(Value *object, StringView key)
 {
     assert(is(object, OBJECT));
 
-    if (object->storage_object->has_key(key))
+    Value **value = object->storage_object->lookup(key);
+
+    if (value)
     {
-        destroy((*object->storage_object)[key]);
-        (*object->storage_object)[key] = nullptr;
+        destroy(*value);
+        *value = nullptr;
     }
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <libsystem/utils/List.h>
+#include <libutils/StringView.h>
 
 struct MarkupAttribute
 {
@@ -50,4 +51,6 @@ char *markup_prettify(MarkupNode *root);
 
 MarkupNode *markup_parse(const char *string, size_t size);
 
+MarkupNode *markup_parse(StringView string);
+
 MarkupNode *markup_parse_file(const char *path);
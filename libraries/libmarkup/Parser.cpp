@@ -163,6 +163,15 @@ MarkupNode *markup_parse(const char *string, size_t size)
     return node(lexer);
 }
 
+MarkupNode *markup_parse(StringView string)
+{
+    Lexer lexer(string);
+    // Skip the utf8 bom header if present.
+    lexer.skip_word("\xEF\xBB\xBF");
+
+    return node(lexer);
+}
+
 MarkupNode *markup_parse_file(const char *path)
 {
     __cleanup(stream_cleanup) Stream *markup_file = stream_open(path, OPEN_READ);
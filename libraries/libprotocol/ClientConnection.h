@@ -1,16 +1,94 @@
 #pragma once
 
+#include <libsystem/io/Socket.h>
+#include <libsystem/process/Process.h>
+#include <libutils/OwnPtr.h>
+#include <libutils/ResultOr.h>
+
+#include <libprotocol/Peer.h>
+
 namespace protocol
 {
 
 template <typename Protocol>
-class ClientConnection
+class ClientConnection : public Peer<Protocol>
 {
-private:
-    /* data */
 public:
-    ClientConnection() {}
-    ~ClientConnection() {}
+    using Message = typename Peer<Protocol>::Message;
+
+    ClientConnection(Connection *connection) : Peer<Protocol>(connection) {}
+
+    // Connects to the server and shares a channel with it, the server has
+    // mapped it once this returns.
+    static ResultOr<OwnPtr<ClientConnection>> connect(const char *path)
+    {
+        auto client = own<ClientConnection>(socket_connect(path));
+
+        if (handle_has_error(client->connection()))
+        {
+            return handle_get_error(client->connection());
+        }
+
+        uintptr_t address = 0;
+        Result result = memory_alloc(sizeof(Channel<Message>), &address);
+
+        if (result != SUCCESS)
+        {
+            return result;
+        }
+
+        auto channel = reinterpret_cast<Channel<Message> *>(address);
+
+        channel->to_server.initialize();
+        channel->to_client.initialize();
+
+        client->attach(address, &channel->to_client, &channel->to_server);
+
+        Hello hello = {PROTOCOL_HELLO_MAGIC, 0};
+        result = memory_get_handle(address, &hello.channel);
+
+        if (result != SUCCESS)
+        {
+            return result;
+        }
+
+        connection_send(client->connection(), &hello, sizeof(Hello));
+
+        if (handle_has_error(client->connection()))
+        {
+            return handle_get_error(client->connection());
+        }
+
+        Hello reply = {};
+        size_t reply_size = connection_receive(client->connection(), &reply, sizeof(Hello));
+
+        if (handle_has_error(client->connection()))
+        {
+            return handle_get_error(client->connection());
+        }
+
+        if (reply_size != sizeof(Hello) || reply.magic != PROTOCOL_HELLO_MAGIC)
+        {
+            return ERR_CONNECTION_REFUSED;
+        }
+
+        return client;
+    }
+
+    // Like Peer::send, but waits for the server to make room in the ring
+    // instead of letting the outbox grow.
+    Result send(const Message &message)
+    {
+        Result result = Peer<Protocol>::send(message);
+
+        while (result == SUCCESS && this->_outbox.any())
+        {
+            process_sleep(1);
+            result = this->flush();
+        }
+
+        return result;
+    }
 };
 
 } // namespace protocol
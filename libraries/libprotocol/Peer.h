@@ -0,0 +1,249 @@
+#pragma once
+
+#include <libsystem/io/Connection.h>
+#include <libsystem/io/Handle.h>
+#include <libsystem/system/Memory.h>
+#include <libutils/Iteration.h>
+#include <libutils/Vector.h>
+
+#include <libprotocol/Ring.h>
+
+namespace protocol
+{
+
+// Past this many messages waiting for room in the ring, the other end is
+// considered stuck.
+#define PROTOCOL_OUTBOX_LIMIT (1024)
+
+// One end of a channel. Messages go through the rings in shared memory, the
+// socket connection is only used for the handshake and as a doorbell, to wake
+// up the other end when it is blocked waiting for messages.
+//
+// The Protocol provides the Message type, and coalesce(previous, next) which
+// merges next into previous and returns true when delivering previous alone is
+// enough, like for two mouse moves in a row.
+template <typename Protocol>
+class Peer
+{
+public:
+    using Message = typename Protocol::Message;
+
+protected:
+    using MessageRing = Ring<Message, PROTOCOL_RING_CAPACITY>;
+
+    Connection *_connection = nullptr;
+
+    uintptr_t _channel = 0;
+    MessageRing *_incoming = nullptr;
+    MessageRing *_outgoing = nullptr;
+
+    Vector<Message> _outbox{};
+
+    Result ring_doorbell()
+    {
+        char doorbell = 0;
+        connection_send(_connection, &doorbell, sizeof(doorbell));
+
+        return handle_get_error(_connection);
+    }
+
+    bool doorbell_pending()
+    {
+        Handle *handle = HANDLE(_connection);
+        SelectEvent events = SELECT_READ;
+
+        Handle *selected = nullptr;
+        SelectEvent selected_events = 0;
+
+        return handle_select(&handle, &events, 1, &selected, &selected_events, 0) == SUCCESS &&
+               selected == handle;
+    }
+
+    // Blocks until the other end rings the doorbell or goes away.
+    Result wait_doorbell()
+    {
+        char doorbells[16];
+        connection_receive(_connection, doorbells, sizeof(doorbells));
+
+        return handle_get_error(_connection);
+    }
+
+    void attach(uintptr_t channel, MessageRing *incoming, MessageRing *outgoing)
+    {
+        _channel = channel;
+        _incoming = incoming;
+        _outgoing = outgoing;
+    }
+
+public:
+    Connection *connection() { return _connection; }
+
+    bool is_attached() { return _channel != 0; }
+
+    size_t pending() { return _outbox.count(); }
+
+    Peer(Connection *connection) : _connection(connection) {}
+
+    virtual ~Peer()
+    {
+        if (_channel)
+        {
+            memory_free(_channel);
+        }
+
+        if (_connection)
+        {
+            connection_close(_connection);
+        }
+    }
+
+    // Moves the outbox into the ring, as far as it fits.
+    Result flush()
+    {
+        // Until the channel is mapped, everything waits in the outbox.
+        if (!is_attached())
+        {
+            return SUCCESS;
+        }
+
+        size_t published = 0;
+
+        while (published < _outbox.count() && _outgoing->push(_outbox[published]))
+        {
+            published++;
+        }
+
+        for (size_t i = 0; i < published; i++)
+        {
+            _outbox.remove_index(0);
+        }
+
+        if (published > 0 && _outgoing->should_ring_doorbell())
+        {
+            return ring_doorbell();
+        }
+
+        return SUCCESS;
+    }
+
+    // Queues the message and publishes it if the ring has room for it, this
+    // never blocks.
+    Result send(const Message &message)
+    {
+        if (_outbox.empty() || !Protocol::coalesce(_outbox.peek_back(), message))
+        {
+            _outbox.push_back(message);
+        }
+
+        Result result = flush();
+
+        if (result == SUCCESS && _outbox.count() > PROTOCOL_OUTBOX_LIMIT)
+        {
+            return ERR_STREAM_CLOSED;
+        }
+
+        return result;
+    }
+
+    // Hands every message in the ring to the callback, a batch at a time, and
+    // arms the doorbell once the ring is empty. The callback returns
+    // Iteration::STOP to leave the remaining messages in the ring.
+    template <typename Callback>
+    Iteration dispatch(Callback callback)
+    {
+        do
+        {
+            Vector<Message> batch{};
+            Message message = {};
+
+            for (size_t i = 0; i < PROTOCOL_RING_CAPACITY && _incoming->pop(message); i++)
+            {
+                if (batch.empty() || !Protocol::coalesce(batch.peek_back(), message))
+                {
+                    batch.push_back(message);
+                }
+            }
+
+            for (size_t i = 0; i < batch.count(); i++)
+            {
+                if (callback(batch[i]) == Iteration::STOP)
+                {
+                    return Iteration::STOP;
+                }
+            }
+        } while (!_incoming->prepare_to_wait());
+
+        return Iteration::CONTINUE;
+    }
+
+    // To be called when the connection is readable, so from a notifier.
+    template <typename Callback>
+    Result receive(Callback callback)
+    {
+        Result result = SUCCESS;
+
+        // Someone else might have waited on the doorbell since the event loop
+        // selected the connection, and reading it would block.
+        if (doorbell_pending())
+        {
+            result = wait_doorbell();
+        }
+
+        // Even if the other end went away, what it sent before is still there.
+        dispatch(callback);
+
+        return result;
+    }
+
+    // Blocks until a message matching the predicate comes in. The messages
+    // received while waiting are handed to the callback afterward.
+    template <typename Predicate, typename Callback>
+    Result wait_for(Predicate predicate, Message &result, Callback callback)
+    {
+        Vector<Message> deferred{};
+        bool found = false;
+
+        while (!found)
+        {
+            Message message = {};
+
+            while (!found && _incoming->pop(message))
+            {
+                if (predicate(message))
+                {
+                    result = message;
+                    found = true;
+                }
+                else
+                {
+                    deferred.push_back(message);
+                }
+            }
+
+            if (!found && _incoming->prepare_to_wait())
+            {
+                Result doorbell_result = wait_doorbell();
+
+                if (doorbell_result != SUCCESS && _incoming->empty())
+                {
+                    return doorbell_result;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < deferred.count(); i++)
+        {
+            if (callback(deferred[i]) == Iteration::STOP)
+            {
+                return SUCCESS;
+            }
+        }
+
+        // The doorbell is only rung for an armed ring.
+        dispatch(callback);
+
+        return SUCCESS;
+    }
+};
+
+} // namespace protocol
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+namespace protocol
+{
+
+#define PROTOCOL_RING_CAPACITY (256)
+
+#define PROTOCOL_HELLO_MAGIC (0x474e4952) // "RING"
+
+// Single producer, single consumer queue living in memory shared by two
+// processes. head is only written by the producer and tail by the consumer,
+// both are free running and wrap around. The peer can write anything in the
+// shared memory, so the indexes are masked before every access.
+template <typename Message, size_t Capacity>
+struct Ring
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "The capacity of a ring must be a power of two.");
+
+    uint32_t head;
+    uint32_t tail;
+
+    // Set by the consumer before it blocks on the doorbell, the producer only
+    // rings it when this is set.
+    uint32_t waiting;
+
+    Message messages[Capacity];
+
+    void initialize()
+    {
+        head = 0;
+        tail = 0;
+        waiting = 1;
+    }
+
+    bool empty()
+    {
+        return __atomic_load_n(&head, __ATOMIC_ACQUIRE) == __atomic_load_n(&tail, __ATOMIC_RELAXED);
+    }
+
+    bool push(const Message &message)
+    {
+        uint32_t current_head = __atomic_load_n(&head, __ATOMIC_RELAXED);
+
+        if (current_head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) >= Capacity)
+        {
+            return false;
+        }
+
+        messages[current_head & (Capacity - 1)] = message;
+
+        __atomic_store_n(&head, current_head + 1, __ATOMIC_RELEASE);
+
+        return true;
+    }
+
+    bool pop(Message &message)
+    {
+        uint32_t current_tail = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+
+        if (__atomic_load_n(&head, __ATOMIC_ACQUIRE) == current_tail)
+        {
+            return false;
+        }
+
+        message = messages[current_tail & (Capacity - 1)];
+
+        __atomic_store_n(&tail, current_tail + 1, __ATOMIC_RELEASE);
+
+        return true;
+    }
+
+    // Consumer side, returns false if a message came in while arming the
+    // doorbell, the consumer has to drain the ring again instead of blocking.
+    bool prepare_to_wait()
+    {
+        __atomic_store_n(&waiting, 1, __ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(&head, __ATOMIC_SEQ_CST) != __atomic_load_n(&tail, __ATOMIC_RELAXED))
+        {
+            __atomic_store_n(&waiting, 0, __ATOMIC_SEQ_CST);
+            return false;
+        }
+
+        return true;
+    }
+
+    // Producer side, after publishing messages.
+    bool should_ring_doorbell()
+    {
+        return __atomic_exchange_n(&waiting, 0, __ATOMIC_SEQ_CST) != 0;
+    }
+};
+
+// The memory shared by a client and a server, allocated by the client.
+template <typename Message>
+struct Channel
+{
+    Ring<Message, PROTOCOL_RING_CAPACITY> to_server;
+    Ring<Message, PROTOCOL_RING_CAPACITY> to_client;
+};
+
+// Sent by the client over the socket right after connecting, and echoed by
+// the server once it has mapped the channel.
+struct Hello
+{
+    uint32_t magic;
+    int channel;
+};
+
+} // namespace protocol
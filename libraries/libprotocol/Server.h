@@ -1,16 +0,0 @@
-#pragma once
-
-namespace protocol
-{
-
-template <typename Protocol>
-class Server
-{
-private:
-    /* data */
-public:
-    Server(/* args */) {}
-    ~Server() {}
-};
-
-} // namespace protocol
@@ -1,16 +1,76 @@
 #pragma once
 
+#include <libprotocol/Peer.h>
+
 namespace protocol
 {
 
 template <typename Protocol>
-class ServerConnection
+class ServerConnection : public Peer<Protocol>
 {
-private:
-    /* data */
 public:
-    ServerConnection(/* args */) {}
-    ~ServerConnection() {}
+    using Message = typename Peer<Protocol>::Message;
+
+    ServerConnection(Connection *connection) : Peer<Protocol>(connection) {}
+
+    // Maps the channel the client sent in its hello, and tells the client
+    // it can start using it.
+    Result accept()
+    {
+        Hello hello = {};
+        size_t hello_size = connection_receive(this->connection(), &hello, sizeof(Hello));
+
+        if (handle_has_error(this->connection()))
+        {
+            return handle_get_error(this->connection());
+        }
+
+        if (hello_size != sizeof(Hello) || hello.magic != PROTOCOL_HELLO_MAGIC)
+        {
+            return ERR_CONNECTION_REFUSED;
+        }
+
+        uintptr_t address = 0;
+        size_t size = 0;
+
+        Result result = memory_include(hello.channel, &address, &size);
+
+        if (result != SUCCESS)
+        {
+            return result;
+        }
+
+        auto channel = reinterpret_cast<Channel<Message> *>(address);
+
+        this->attach(address, &channel->to_server, &channel->to_client);
+
+        if (size < sizeof(Channel<Message>))
+        {
+            return ERR_CONNECTION_REFUSED;
+        }
+
+        connection_send(this->connection(), &hello, sizeof(Hello));
+
+        if (handle_has_error(this->connection()))
+        {
+            return handle_get_error(this->connection());
+        }
+
+        return this->flush();
+    }
+
+    // The first message from the client is its hello, everything after that
+    // is doorbells.
+    template <typename Callback>
+    Result receive(Callback callback)
+    {
+        if (!this->is_attached())
+        {
+            return accept();
+        }
+
+        return Peer<Protocol>::receive(callback);
+    }
 };
 
 } // namespace protocol
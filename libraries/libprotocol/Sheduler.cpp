@@ -1,8 +0,0 @@
-#pragma once
-
-namespace protocol
-{
-
-
-
-} // namespace protocol
@@ -15,4 +15,19 @@ void free(void *);
 
 void malloc_cleanup(void *buffer);
 
+struct AllocatorStatistics
+{
+    size_t reserved; // Bytes mapped by the allocator.
+    size_t used;     // Bytes asked by the callers.
+
+    size_t allocations;
+    size_t frees;
+    size_t slabs;
+    size_t large_allocations;
+    size_t large_in_use;
+    size_t errors;
+};
+
+struct AllocatorStatistics allocator_statistics(void);
+
 __END_HEADER
@@ -5,7 +5,9 @@
 #include <abi/Filesystem.h>
 #include <abi/Handle.h>
 #include <abi/IOCall.h>
+#include <abi/IORing.h>
 #include <abi/Launchpad.h>
+#include <abi/Poll.h>
 #include <abi/System.h>
 
 #include <libsystem/Time.h>
@@ -101,6 +103,16 @@ void __plug_handle_connect(Handle *handle, const char *path);
 
 void __plug_handle_accept(Handle *handle, Handle *connection_handle);
 
+Result __plug_handle_submit(IORing *ring, size_t wait_for, Timeout timeout);
+
 Result __plug_create_pipe(int *reader_handle, int *writer_handle);
 
 Result __plug_create_term(int *master_handle, int *slave_handle);
+
+Result __plug_create_poll(int *poll_handle);
+
+Result __plug_poll_add(int poll_handle, int handle, SelectEvent events, uintptr_t user_data);
+
+Result __plug_poll_remove(int poll_handle, int handle);
+
+Result __plug_poll_wait(int poll_handle, PollEvent *events, size_t count, size_t *ready, Timeout timeout);
@@ -5,6 +5,8 @@
 #include <libsystem/eventloop/Invoker.h>
 #include <libsystem/eventloop/Notifier.h>
 #include <libsystem/eventloop/Timer.h>
+#include <libsystem/io/IORing.h>
+#include <libsystem/io/Poll.h>
 #include <libsystem/math/MinMax.h>
 #include <libsystem/system/System.h>
 #include <libsystem/utils/List.h>
@@ -16,9 +18,22 @@ static Vector<Timer *> _eventloop_timers;
 static List *_eventloop_notifiers = nullptr;
 static Vector<Invoker *> _eventloop_invoker;
 
-static size_t _eventloop_handles_count;
-static Handle *_eventloop_handles[PROCESS_HANDLE_COUNT];
-static SelectEvent _eventloop_events[PROCESS_HANDLE_COUNT];
+#define EVENTLOOP_READY_COUNT 64
+
+// Notifiers are registered once on the poll, which only reports the ready
+// ones, with the notifier as the user data. The poll is keyed by handle, so
+// there is one notifier per handle.
+static Poll *_eventloop_poll = nullptr;
+
+// The wait on the poll goes through the ring, along with anything else queued
+// on it, and fills _eventloop_ready when it completes.
+static IORing *_eventloop_ring = nullptr;
+static bool _eventloop_poll_armed = false;
+
+#define EVENTLOOP_POLL_TOKEN (1)
+
+static size_t _eventloop_ready_count = 0;
+static PollEvent _eventloop_ready[EVENTLOOP_READY_COUNT];
 
 static bool _eventloop_is_running = false;
 static bool _eventloop_is_initialize = false;
@@ -34,6 +49,8 @@ void eventloop_initialize()
     _eventloop_timer_last_fire = system_get_ticks();
 
     _eventloop_notifiers = list_create();
+    _eventloop_poll = poll_create();
+    _eventloop_ring = io_ring_create();
 
     _eventloop_is_initialize = true;
 }
@@ -43,6 +60,12 @@ void eventloop_uninitialize()
     assert(_eventloop_is_initialize);
 
     list_destroy(_eventloop_notifiers);
+    io_ring_destroy(_eventloop_ring);
+    _eventloop_ring = nullptr;
+    _eventloop_poll_armed = false;
+
+    poll_destroy(_eventloop_poll);
+    _eventloop_poll = nullptr;
 
     _eventloop_is_initialize = false;
 }
@@ -131,6 +154,68 @@ void eventloop_update_timers()
     _eventloop_timer_last_fire = current_fire;
 }
 
+static void eventloop_arm_poll()
+{
+    if (_eventloop_poll_armed)
+    {
+        return;
+    }
+
+    IOSubmission submission = {};
+    submission.operation = IO_POLL;
+    submission.handle = _eventloop_poll->handle.id;
+    submission.buffer = (uintptr_t)_eventloop_ready;
+    submission.size = EVENTLOOP_READY_COUNT;
+    submission.user_data = EVENTLOOP_POLL_TOKEN;
+
+    // Nothing else is queued on the ring, there is always room for it.
+    _eventloop_poll_armed = io_ring_queue(_eventloop_ring, submission);
+}
+
+static Result eventloop_reap_completions()
+{
+    Result result = SUCCESS;
+    IOCompletion completion;
+
+    while (io_ring_pop_completion(_eventloop_ring, &completion))
+    {
+        if (completion.user_data != EVENTLOOP_POLL_TOKEN)
+        {
+            continue;
+        }
+
+        _eventloop_poll_armed = false;
+
+        if (result_is_error(completion.result))
+        {
+            result = completion.result;
+            continue;
+        }
+
+        _eventloop_ready_count = completion.value;
+    }
+
+    return result;
+}
+
+static void eventloop_dispatch_ready()
+{
+    for (size_t i = 0; i < _eventloop_ready_count; i++)
+    {
+        Notifier *notifier = (Notifier *)_eventloop_ready[i].user_data;
+
+        // Unregistered by a previous callback.
+        if (notifier == nullptr)
+        {
+            continue;
+        }
+
+        notifier->callback(notifier->target, notifier->handle, _eventloop_ready[i].events);
+    }
+
+    _eventloop_ready_count = 0;
+}
+
 void eventloop_pump(bool pool)
 {
     assert(_eventloop_is_initialize);
@@ -144,33 +229,28 @@ void eventloop_pump(bool pool)
 
     eventloop_update_timers();
 
-    Handle *selected = nullptr;
-    SelectEvent selected_events = 0;
+    eventloop_arm_poll();
 
-    Result result = handle_select(
-        &_eventloop_handles[0],
-        &_eventloop_events[0],
-        _eventloop_handles_count,
-        &selected,
-        &selected_events,
-        timeout);
+    Result result = io_ring_submit(_eventloop_ring, 1, timeout);
 
     if (result_is_error(result))
     {
-        logger_error("Failed to select : %s", result_to_string(result));
+        logger_error("Failed to submit : %s", result_to_string(result));
         eventloop_exit(-1);
     }
 
-    eventloop_update_timers();
+    result = eventloop_reap_completions();
 
-    list_foreach(Notifier, notifier, _eventloop_notifiers)
+    if (result_is_error(result))
     {
-        if (notifier->handle == selected)
-        {
-            notifier->callback(notifier->target, notifier->handle, selected_events);
-        }
+        logger_error("Failed to poll : %s", result_to_string(result));
+        eventloop_exit(-1);
     }
 
+    eventloop_update_timers();
+
+    eventloop_dispatch_ready();
+
     _eventloop_invoker.foreach ([](Invoker *invoker) {
         if (invoker->should_be_invoke_later())
         {
@@ -198,25 +278,18 @@ void eventloop_exit_nested(int exit_value)
     _nested_eventloop_exit_value = exit_value;
 }
 
-void eventloop_update_notifier()
-{
-    _eventloop_handles_count = 0;
-
-    list_foreach(Notifier, notifier, _eventloop_notifiers)
-    {
-        _eventloop_handles[_eventloop_handles_count] = notifier->handle;
-        _eventloop_events[_eventloop_handles_count] = notifier->events;
-
-        _eventloop_handles_count++;
-    }
-}
 void eventloop_register_notifier(Notifier *notifier)
 {
     assert(_eventloop_is_initialize);
 
     list_pushback(_eventloop_notifiers, notifier);
 
-    eventloop_update_notifier();
+    Result result = poll_add(_eventloop_poll, notifier->handle, notifier->events, (uintptr_t)notifier);
+
+    if (result_is_error(result))
+    {
+        logger_error("Failed to register handle %d: %s", notifier->handle->id, result_to_string(result));
+    }
 }
 
 void eventloop_unregister_notifier(Notifier *notifier)
@@ -225,7 +298,16 @@ void eventloop_unregister_notifier(Notifier *notifier)
 
     list_remove(_eventloop_notifiers, notifier);
 
-    eventloop_update_notifier();
+    // The handle might already be closed, the kernel forgot about it then.
+    poll_remove(_eventloop_poll, notifier->handle);
+
+    for (size_t i = 0; i < _eventloop_ready_count; i++)
+    {
+        if (_eventloop_ready[i].user_data == (uintptr_t)notifier)
+        {
+            _eventloop_ready[i].user_data = 0;
+        }
+    }
 }
 
 void eventloop_register_timer(struct Timer *timer)
@@ -0,0 +1,73 @@
+#include <libsystem/Logger.h>
+#include <libsystem/core/Plugs.h>
+#include <libsystem/io/IORing.h>
+#include <libsystem/system/Memory.h>
+
+#define IORING_MASK (IORING_CAPACITY - 1)
+
+// The ring is a memory object of its own, page aligned and mapped in the
+// task. Only userspace creates rings, the kernel has no memory objects of its
+// own to put them in.
+#ifndef __KERNEL__
+
+IORing *io_ring_create()
+{
+    uintptr_t address = 0;
+    Result result = memory_alloc(sizeof(IORing), &address);
+
+    if (result != SUCCESS)
+    {
+        logger_error("Failed to allocate the io ring: %s", result_to_string(result));
+        return nullptr;
+    }
+
+    IORing *ring = reinterpret_cast<IORing *>(address);
+    memory_zero(ring, sizeof(IORing));
+
+    return ring;
+}
+
+void io_ring_destroy(IORing *ring)
+{
+    memory_free(reinterpret_cast<uintptr_t>(ring));
+}
+
+#endif
+
+bool io_ring_queue(IORing *ring, const IOSubmission &submission)
+{
+    if (ring->submission_tail - ring->submission_head >= IORING_CAPACITY)
+    {
+        return false;
+    }
+
+    ring->submissions[ring->submission_tail & IORING_MASK] = submission;
+
+    // The kernel must never see the tail before the submission.
+    asm volatile("" ::: "memory");
+
+    ring->submission_tail = ring->submission_tail + 1;
+
+    return true;
+}
+
+Result io_ring_submit(IORing *ring, size_t wait_for, Timeout timeout)
+{
+    return __plug_handle_submit(ring, wait_for, timeout);
+}
+
+bool io_ring_pop_completion(IORing *ring, IOCompletion *completion)
+{
+    if (ring->completion_head == ring->completion_tail)
+    {
+        return false;
+    }
+
+    *completion = ring->completions[ring->completion_head & IORING_MASK];
+
+    asm volatile("" ::: "memory");
+
+    ring->completion_head = ring->completion_head + 1;
+
+    return true;
+}
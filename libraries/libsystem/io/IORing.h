@@ -0,0 +1,20 @@
+#pragma once
+
+#include <abi/IORing.h>
+
+#include <libsystem/Time.h>
+
+// A submission ring shared with the kernel, see abi/IORing.h.
+
+IORing *io_ring_create();
+
+void io_ring_destroy(IORing *ring);
+
+// Returns false if there is no free slot, submit first.
+bool io_ring_queue(IORing *ring, const IOSubmission &submission);
+
+// Hands the queued submissions to the kernel, and waits until at least
+// wait_for of them completed or the timeout elapsed.
+Result io_ring_submit(IORing *ring, size_t wait_for, Timeout timeout);
+
+bool io_ring_pop_completion(IORing *ring, IOCompletion *completion);
@@ -0,0 +1,42 @@
+#include <libsystem/Logger.h>
+#include <libsystem/core/Plugs.h>
+#include <libsystem/io/Poll.h>
+
+Poll *poll_create()
+{
+    Poll *poll = __create(Poll);
+
+    poll->handle.flags = OPEN_READ;
+    poll->handle.result = __plug_create_poll(&poll->handle.id);
+
+    if (handle_has_error(&poll->handle))
+    {
+        logger_error("Failed to create a poll: %s", handle_error_string(&poll->handle));
+
+        free(poll);
+        return nullptr;
+    }
+
+    return poll;
+}
+
+void poll_destroy(Poll *poll)
+{
+    __plug_handle_close(&poll->handle);
+    free(poll);
+}
+
+Result poll_add(Poll *poll, Handle *handle, SelectEvent events, uintptr_t user_data)
+{
+    return __plug_poll_add(poll->handle.id, handle->id, events, user_data);
+}
+
+Result poll_remove(Poll *poll, Handle *handle)
+{
+    return __plug_poll_remove(poll->handle.id, handle->id);
+}
+
+Result poll_wait(Poll *poll, PollEvent *events, size_t count, size_t *ready, Timeout timeout)
+{
+    return __plug_poll_wait(poll->handle.id, events, count, ready, timeout);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <abi/Poll.h>
+
+#include <libsystem/Time.h>
+
+// A set of handles whose readiness is tracked by the kernel. Handles are
+// registered once, and a wait only costs as much as the ready ones.
+struct Poll
+{
+    Handle handle;
+};
+
+Poll *poll_create();
+
+void poll_destroy(Poll *poll);
+
+// Registering a handle again updates its events and user data.
+Result poll_add(Poll *poll, Handle *handle, SelectEvent events, uintptr_t user_data);
+
+Result poll_remove(Poll *poll, Handle *handle);
+
+Result poll_wait(Poll *poll, PollEvent *events, size_t count, size_t *ready, Timeout timeout);
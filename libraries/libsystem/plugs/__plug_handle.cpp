@@ -80,6 +80,11 @@ void __plug_handle_accept(Handle *handle, Handle *connection_handle)
     handle->result = __syscall(SYS_HANDLE_ACCEPT, handle->id, (uintptr_t)&connection_handle->id);
 }
 
+Result __plug_handle_submit(IORing *ring, size_t wait_for, Timeout timeout)
+{
+    return __syscall(SYS_HANDLE_SUBMIT, (uintptr_t)ring, wait_for, timeout);
+}
+
 Result __plug_create_pipe(int *reader_handle, int *writer_handle)
 {
     return __syscall(SYS_CREATE_PIPE, (uintptr_t)reader_handle, (uintptr_t)writer_handle);
@@ -89,3 +94,23 @@ Result __plug_create_term(int *master_handle, int *slave_handle)
 {
     return __syscall(SYS_CREATE_TERM, (uintptr_t)master_handle, (uintptr_t)slave_handle);
 }
+
+Result __plug_create_poll(int *poll_handle)
+{
+    return __syscall(SYS_CREATE_POLL, (uintptr_t)poll_handle);
+}
+
+Result __plug_poll_add(int poll_handle, int handle, SelectEvent events, uintptr_t user_data)
+{
+    return __syscall(SYS_POLL_ADD, poll_handle, handle, events, user_data);
+}
+
+Result __plug_poll_remove(int poll_handle, int handle)
+{
+    return __syscall(SYS_POLL_REMOVE, poll_handle, handle);
+}
+
+Result __plug_poll_wait(int poll_handle, PollEvent *events, size_t count, size_t *ready, Timeout timeout)
+{
+    return __syscall(SYS_POLL_WAIT, poll_handle, (uintptr_t)events, count, (uintptr_t)ready, timeout);
+}
@@ -1,5 +1,6 @@
 
 #include <abi/Syscalls.h>
+#include <abi/SystemPage.h>
 
 #include <libsystem/core/Plugs.h>
 
@@ -13,16 +14,20 @@ void __plug_system_get_status(SystemStatus *status)
     __syscall(SYS_SYSTEM_GET_STATUS, (uintptr_t)status);
 }
 
+// The clock is read from the system page, without entering the kernel.
+
 TimeStamp __plug_system_get_time()
 {
+    uint32_t tick = 0;
     TimeStamp timestamp = 0;
-    __syscall(SYS_SYSTEM_GET_TIME, (uintptr_t)&timestamp);
+    system_page_read(&tick, &timestamp);
     return timestamp;
 }
 
 uint __plug_system_get_ticks()
 {
-    uint result = 0;
-    __syscall(SYS_SYSTEM_GET_TICKS, (uintptr_t)&result);
-    return result;
+    uint32_t tick = 0;
+    TimeStamp timestamp = 0;
+    system_page_read(&tick, &timestamp);
+    return tick;
 }
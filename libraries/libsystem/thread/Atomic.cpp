@@ -1,42 +1,104 @@
-
 #include <libsystem/thread/Atomic.h>
 
 #include "arch/Arch.h"
 
-static bool atomic_enabled = false;
-static uint atomic_depth = 0;
+// Atomic sections disable interrupts and take the kernel lock, so they also
+// exclude each other across CPUs. The lock is recursive on a CPU.
+struct AtomicState
+{
+    bool enabled;
+    uint depth;
+};
+
+static AtomicState _atomic_states[ARCH_MAX_CPU_COUNT] = {};
+
+static volatile int _atomic_owner = -1;
+
+static void atomic_lock(int cpu)
+{
+    while (!__sync_bool_compare_and_swap(&_atomic_owner, -1, cpu))
+    {
+        arch_cpu_relax();
+    }
+}
+
+static void atomic_unlock(int cpu)
+{
+    if (_atomic_owner == cpu)
+    {
+        __atomic_store_n(&_atomic_owner, -1, __ATOMIC_RELEASE);
+    }
+}
 
 bool is_atomic()
 {
-    return !atomic_enabled || atomic_depth > 0;
+    AtomicState &state = _atomic_states[arch_cpu_current()];
+
+    return !state.enabled || state.depth > 0;
 }
 
+// Interrupts are disabled while atomic is disabled, so there is no need to
+// disable them again here.
 void atomic_enable()
 {
-    atomic_enabled = true;
+    int cpu = arch_cpu_current();
+    AtomicState &state = _atomic_states[cpu];
+
+    state.enabled = true;
+
+    // Handlers which switched tasks are leaving the atomic section of the
+    // previous one, if it yielded from one, it is never coming back.
+    state.depth = 0;
+    atomic_unlock(cpu);
 }
 
 void atomic_disable()
 {
-    atomic_enabled = false;
+    arch_disable_interrupts();
+
+    int cpu = arch_cpu_current();
+    AtomicState &state = _atomic_states[cpu];
+
+    if (state.enabled && state.depth == 0)
+    {
+        atomic_lock(cpu);
+    }
+
+    state.enabled = false;
 }
 
 void atomic_begin()
 {
-    if (atomic_enabled)
+    // Before reading the state, so the task can't move to another CPU.
+    arch_disable_interrupts();
+
+    int cpu = arch_cpu_current();
+    AtomicState &state = _atomic_states[cpu];
+
+    if (state.enabled)
     {
-        arch_disable_interrupts();
-        atomic_depth++;
+        if (state.depth == 0)
+        {
+            atomic_lock(cpu);
+        }
+
+        state.depth++;
     }
 }
 
 void atomic_end()
 {
-    if (atomic_enabled)
+    int cpu = arch_cpu_current();
+    AtomicState &state = _atomic_states[cpu];
+
+    if (state.enabled)
     {
-        atomic_depth--;
+        state.depth--;
 
-        if (atomic_depth == 0)
+        if (state.depth == 0)
+        {
+            atomic_unlock(cpu);
             arch_enable_interrupts();
+        }
     }
 }
@@ -5,8 +5,23 @@
 #include <libsystem/process/Process.h>
 #include <libsystem/thread/Lock.h>
 
+#ifdef __KERNEL__
+#include "arch/Arch.h"
+#endif
+
 #define LOCK_NO_HOLDER 0xDEADDEAD
 
+// Spin rather than halt: without a periodic tick nothing might ever wake
+// the CPU up again, releasing a lock doesn't send an interrupt.
+static void lock_relax()
+{
+#ifdef __KERNEL__
+    arch_cpu_relax();
+#else
+    asm volatile("pause");
+#endif
+}
+
 void __lock_init(Lock *lock, const char *name)
 {
     lock->locked = 0;
@@ -22,7 +37,9 @@ void __lock_acquire(Lock *lock)
 void __lock_acquire_by(Lock *lock, int holder)
 {
     while (!__sync_bool_compare_and_swap(&lock->locked, 0, 1))
-        asm("hlt"); // Don't burn the CPU ;)
+    {
+        lock_relax();
+    }
 
     __sync_synchronize();
 
@@ -28,6 +28,11 @@ Lexer::Lexer(const char *string, size_t size)
     _size = size;
 }
 
+Lexer::Lexer(StringView view)
+    : Lexer(view.data(), view.length())
+{
+}
+
 bool Lexer::ended()
 {
     if (_string)
@@ -3,6 +3,7 @@
 #include <libsystem/io/Stream.h>
 #include <libsystem/unicode/Codepoint.h>
 #include <libutils/RingBuffer.h>
+#include <libutils/StringView.h>
 
 class Lexer
 {
@@ -23,6 +24,8 @@ public:
 
     Lexer(const char *string, size_t size);
 
+    Lexer(StringView view);
+
     bool ended();
 
     bool do_continue();
@@ -3,13 +3,57 @@
 #include <libsystem/math/MinMax.h>
 #include <libterminal/Terminal.h>
 
+static int terminal_line_index(Terminal *terminal, int y)
+{
+    return (terminal->top + y + terminal->capacity) % terminal->capacity;
+}
+
+static TerminalCell *terminal_line(Terminal *terminal, int y)
+{
+    return &terminal->buffer[terminal_line_index(terminal, y) * terminal->width];
+}
+
+static void terminal_damage(Terminal *terminal, int y, int from, int to)
+{
+    TerminalDamage *damage = &terminal->damages[terminal_line_index(terminal, y)];
+
+    if (damage->from >= damage->to)
+    {
+        *damage = (TerminalDamage){from, to};
+    }
+    else
+    {
+        damage->from = MIN(damage->from, from);
+        damage->to = MAX(damage->to, to);
+    }
+}
+
+// Unlike terminal_clear_line(), the whole line is damaged, the renderer moved
+// what was painted there.
+static void terminal_blank_line(Terminal *terminal, int y)
+{
+    TerminalCell *line = terminal_line(terminal, y);
+
+    for (int x = 0; x < terminal->width; x++)
+    {
+        line[x] = (TerminalCell){U' ', terminal->current_attributes, true};
+    }
+
+    terminal_damage(terminal, y, 0, terminal->width);
+}
+
 Terminal *terminal_create(int width, int height, TerminalRenderer *renderer)
 {
     Terminal *terminal = __create(Terminal);
 
     terminal->width = width;
     terminal->height = height;
-    terminal->buffer = (TerminalCell *)calloc(width * height, sizeof(TerminalCell));
+    terminal->capacity = height + TERMINAL_SCROLLBACK;
+    terminal->buffer = (TerminalCell *)calloc(width * terminal->capacity, sizeof(TerminalCell));
+    terminal->damages = (TerminalDamage *)calloc(terminal->capacity, sizeof(TerminalDamage));
+    terminal->top = 0;
+    terminal->history = 0;
+    terminal->scrolled = 0;
 
     terminal->decoder = utf8decoder_create(terminal, (UTF8DecoderCallback)terminal_write_codepoint);
     terminal->renderer = renderer;
@@ -38,6 +82,7 @@ void terminal_destroy(Terminal *terminal)
     utf8decoder_destroy(terminal->decoder);
     terminal_renderer_destroy(terminal->renderer);
     free(terminal->buffer);
+    free(terminal->damages);
     free(terminal);
 }
 
@@ -75,26 +120,40 @@ void terminal_clear_line(Terminal *terminal, int line)
 
 void terminal_resize(Terminal *terminal, int width, int height)
 {
-    TerminalCell *new_buffer = (TerminalCell *)malloc(sizeof(TerminalCell) * width * height);
+    int capacity = height + TERMINAL_SCROLLBACK;
+    TerminalCell *new_buffer = (TerminalCell *)malloc(sizeof(TerminalCell) * width * capacity);
+    TerminalDamage *new_damages = (TerminalDamage *)malloc(sizeof(TerminalDamage) * capacity);
 
-    for (int i = 0; i < width * height; i++)
+    // The scrollback goes first, followed by the screen.
+    for (int line = 0; line < capacity; line++)
     {
-        new_buffer[i] = (TerminalCell){U' ', terminal->current_attributes, true};
-    }
+        int y = line - terminal->history;
 
-    for (int x = 0; x < MIN(width, terminal->width); x++)
-    {
-        for (int y = 0; y < MIN(height, terminal->height); y++)
+        for (int x = 0; x < width; x++)
         {
-            new_buffer[y * width + x] = terminal_cell_at(terminal, x, y);
+            if (x < terminal->width && y < MIN(height, terminal->height))
+            {
+                new_buffer[line * width + x] = terminal_cell_at(terminal, x, y);
+            }
+            else
+            {
+                new_buffer[line * width + x] = (TerminalCell){U' ', terminal->current_attributes, true};
+            }
         }
+
+        new_damages[line] = (TerminalDamage){0, width};
     }
 
     free(terminal->buffer);
+    free(terminal->damages);
     terminal->buffer = new_buffer;
+    terminal->damages = new_damages;
 
     terminal->width = width;
     terminal->height = height;
+    terminal->capacity = capacity;
+    terminal->top = terminal->history;
+    terminal->scrolled = 0;
 
     terminal->cursor.x = clamp(terminal->cursor.x, 0, width);
     terminal->cursor.y = clamp(terminal->cursor.y, 0, height);
@@ -103,9 +162,9 @@ void terminal_resize(Terminal *terminal, int width, int height)
 TerminalCell terminal_cell_at(Terminal *terminal, int x, int y)
 {
     if (x >= 0 && x < terminal->width &&
-        y >= 0 && y < terminal->height)
+        y >= -terminal->history && y < terminal->height)
     {
-        return terminal->buffer[y * terminal->width + x];
+        return terminal_line(terminal, y)[x];
     }
 
     return (TerminalCell){U' ', terminal->current_attributes, true};
@@ -116,7 +175,7 @@ void terminal_cell_undirty(Terminal *terminal, int x, int y)
     if (x >= 0 && x < terminal->width &&
         y >= 0 && y < terminal->height)
     {
-        terminal->buffer[y * terminal->width + x].dirty = false;
+        terminal_line(terminal, y)[x].dirty = false;
     }
 }
 
@@ -125,19 +184,39 @@ void terminal_set_cell(Terminal *terminal, int x, int y, TerminalCell cell)
     if (x >= 0 && x < terminal->width &&
         y >= 0 && y < terminal->height)
     {
-        TerminalCell old_cell = terminal->buffer[y * terminal->width + x];
+        TerminalCell *line = terminal_line(terminal, y);
+        TerminalCell old_cell = line[x];
 
         if (old_cell.codepoint != cell.codepoint ||
             !terminal_attributes_equals(old_cell.attributes, cell.attributes))
         {
-            terminal->buffer[y * terminal->width + x] = cell;
-            terminal->buffer[y * terminal->width + x].dirty = true;
+            line[x] = cell;
+            line[x].dirty = true;
+            terminal_damage(terminal, y, x, x + 1);
 
             terminal_on_paint(terminal, x, y, cell);
         }
     }
 }
 
+TerminalDamage terminal_line_damage(Terminal *terminal, int y)
+{
+    if (y >= 0 && y < terminal->height)
+    {
+        return terminal->damages[terminal_line_index(terminal, y)];
+    }
+
+    return (TerminalDamage){0, 0};
+}
+
+void terminal_line_undamage(Terminal *terminal, int y)
+{
+    if (y >= 0 && y < terminal->height)
+    {
+        terminal->damages[terminal_line_index(terminal, y)] = (TerminalDamage){0, 0};
+    }
+}
+
 void terminal_cursor_show(Terminal *terminal)
 {
     if (!terminal->cursor.visible)
@@ -210,34 +289,28 @@ void terminal_scroll(Terminal *terminal, int how_many_line)
 {
     if (how_many_line < 0)
     {
-        for (int line = 0; line < how_many_line; line++)
+        // The line scrolled in is blank, not the last one of the scrollback.
+        for (int line = 0; line < -how_many_line; line++)
         {
-            for (int i = (terminal->width * terminal->height) - 1; i >= terminal->height; i++)
-            {
-                int x = i % terminal->width;
-                int y = i / terminal->width;
+            terminal->top = terminal_line_index(terminal, -1);
+            terminal->history = MAX(terminal->history - 1, 0);
 
-                terminal_set_cell(terminal, x, y, terminal_cell_at(terminal, x, y - 1));
-            }
-
-            terminal_clear_line(terminal, 0);
+            terminal_blank_line(terminal, 0);
         }
     }
     else if (how_many_line > 0)
     {
+        // The oldest line of the scrollback is reused when it is full.
         for (int line = 0; line < how_many_line; line++)
         {
-            for (int i = 0; i < (terminal->width * (terminal->height - 1)); i++)
-            {
-                int x = i % terminal->width;
-                int y = i / terminal->width;
+            terminal->top = terminal_line_index(terminal, 1);
+            terminal->history = MIN(terminal->history + 1, terminal->capacity - terminal->height);
 
-                terminal_set_cell(terminal, x, y, terminal_cell_at(terminal, x, y + 1));
-            }
-
-            terminal_clear_line(terminal, terminal->height - 1);
+            terminal_blank_line(terminal, terminal->height - 1);
         }
     }
+
+    terminal->scrolled += how_many_line;
 }
 
 void terminal_new_line(Terminal *terminal)
@@ -21,11 +21,34 @@ struct TerminalParameter
     bool empty;
 };
 
+// The columns [from, to) of a line which changed since it was last painted,
+// empty when from >= to.
+struct TerminalDamage
+{
+    int from;
+    int to;
+};
+
+// How many lines scrolled out of the screen are kept.
+#define TERMINAL_SCROLLBACK 500
+
 struct Terminal
 {
     int height;
     int width;
+
+    // The scrollback and the screen share a ring of lines, the screen being
+    // its last `height` lines, scrolling only moves `top`.
     TerminalCell *buffer;
+    TerminalDamage *damages;
+    int capacity;
+    int top;
+    int history;
+
+    // Lines scrolled up since the renderer last looked, negative when
+    // scrolling down, so it can move what it already painted.
+    int scrolled;
+
     UTF8Decoder *decoder;
     TerminalRenderer *renderer;
 
@@ -50,10 +73,14 @@ void terminal_clear_line(Terminal *terminal, int line);
 
 void terminal_resize(Terminal *terminal, int width, int height);
 
+// Lines of the scrollback are above the screen, from -history to -1.
 TerminalCell terminal_cell_at(Terminal *terminal, int x, int y);
 void terminal_cell_undirty(Terminal *terminal, int x, int y);
 void terminal_set_cell(Terminal *terminal, int x, int y, TerminalCell cell);
 
+TerminalDamage terminal_line_damage(Terminal *terminal, int y);
+void terminal_line_undamage(Terminal *terminal, int y);
+
 void terminal_cursor_show(Terminal *terminal);
 void terminal_cursor_hide(Terminal *terminal);
 void terminal_cursor_move(Terminal *terminal, int offx, int offy);
@@ -1,17 +1,104 @@
 #pragma once
 
 #include <libsystem/Common.h>
+#include <libsystem/core/CString.h>
+
+// xxHash32, it is fast on 32 bits targets and mixes every input bit into
+// the low bits of the result, which is what power of two tables look at.
+
+#define HASH_PRIME1 (0x9E3779B1u)
+#define HASH_PRIME2 (0x85EBCA77u)
+#define HASH_PRIME3 (0xC2B2AE3Du)
+#define HASH_PRIME4 (0x27D4EB2Fu)
+#define HASH_PRIME5 (0x165667B1u)
+
+static inline uint32_t hash_rotate(uint32_t value, int count)
+{
+    return (value << count) | (value >> (32 - count));
+}
+
+static inline uint32_t hash_read(const uint8_t *bytes)
+{
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static inline uint32_t hash_round(uint32_t accumulator, uint32_t input)
+{
+    accumulator += input * HASH_PRIME2;
+    accumulator = hash_rotate(accumulator, 13);
+    accumulator *= HASH_PRIME1;
+
+    return accumulator;
+}
+
+static inline uint32_t hash_finalize(uint32_t hash)
+{
+    hash ^= hash >> 15;
+    hash *= HASH_PRIME2;
+    hash ^= hash >> 13;
+    hash *= HASH_PRIME3;
+    hash ^= hash >> 16;
+
+    return hash;
+}
 
 static inline uint32_t hash(const void *object, size_t size)
 {
-    uint32_t hash = 5381;
+    const uint8_t *bytes = (const uint8_t *)object;
+    const uint8_t *end = bytes + size;
 
-    for (size_t i = 0; i < size; i++)
+    uint32_t hash = 0;
+
+    if (size >= 16)
     {
-        hash = ((hash << 5) + hash) + ((const uint8_t *)object)[i];
+        uint32_t v1 = HASH_PRIME1 + HASH_PRIME2;
+        uint32_t v2 = HASH_PRIME2;
+        uint32_t v3 = 0;
+        uint32_t v4 = -HASH_PRIME1;
+
+        do
+        {
+            v1 = hash_round(v1, hash_read(bytes + 0));
+            v2 = hash_round(v2, hash_read(bytes + 4));
+            v3 = hash_round(v3, hash_read(bytes + 8));
+            v4 = hash_round(v4, hash_read(bytes + 12));
+
+            bytes += 16;
+        } while (bytes + 16 <= end);
+
+        hash = hash_rotate(v1, 1) + hash_rotate(v2, 7) + hash_rotate(v3, 12) + hash_rotate(v4, 18);
+    }
+    else
+    {
+        hash = HASH_PRIME5;
     }
 
-    return hash;
+    hash += (uint32_t)size;
+
+    while (bytes + 4 <= end)
+    {
+        hash += hash_read(bytes) * HASH_PRIME3;
+        hash = hash_rotate(hash, 17) * HASH_PRIME4;
+        bytes += 4;
+    }
+
+    while (bytes < end)
+    {
+        hash += (*bytes) * HASH_PRIME5;
+        hash = hash_rotate(hash, 11) * HASH_PRIME1;
+        bytes++;
+    }
+
+    return hash_finalize(hash);
+}
+
+// Hashes the same as a String with the same content, so maps keyed by
+// strings can be looked up without building one.
+static inline uint32_t hash(const char *cstring)
+{
+    return hash(cstring, strlen(cstring));
 }
 
 template <typename TObject>
@@ -30,5 +117,6 @@ inline uint32_t hash(const TObject &)
 template <>
 inline uint32_t hash<uint32_t>(const uint32_t &value)
 {
-    return hash(&value, sizeof(value));
+    // No need to go through the bytes, the finalizer alone mixes well.
+    return hash_finalize(value * HASH_PRIME1);
 }
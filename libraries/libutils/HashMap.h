@@ -1,103 +1,368 @@
 #pragma once
 
-#include <libsystem/Logger.h>
+#include <libsystem/core/CString.h>
+
 #include <libutils/Hash.h>
-#include <libutils/Vector.h>
+#include <libutils/Iteration.h>
+#include <libutils/Move.h>
+#include <libutils/New.h>
 
+// An open addressing hash map using robin hood hashing: an item further
+// from its ideal slot than the one in its way takes its place. This keeps
+// probe sequences short and lets a lookup stop as soon as it meets an item
+// closer to home than the key would be. Small maps live inside the object
+// and don't allocate.
+//
+// Keys can be looked up with anything comparable to them and hashing the
+// same, like a const char * for a String.
 template <typename TKey, typename TValue>
 class HashMap
 {
 private:
+    // The hash goes last, so it fills the padding after the value rather
+    // than sitting alone in front of an 8 byte aligned key.
     struct Item
     {
-        uint32_t hash;
         TKey key;
         TValue value;
+        uint32_t hash;
     };
 
-    static constexpr int BUCKET_COUNT = 256;
+    static constexpr size_t INLINE_CAPACITY = 8;
+
+    // Grow past 7/8 full.
+    static constexpr size_t LOAD_FACTOR_NUMERATOR = 7;
+    static constexpr size_t LOAD_FACTOR_DENOMINATOR = 8;
+
+    // Distances are stored in a byte, a longer probe sequence grows the map.
+    static constexpr size_t MAX_DISTANCE = 255;
+
+    size_t _count = 0;
+    size_t _capacity = INLINE_CAPACITY;
+
+    // Heap storage, the items followed by their distances.
+    Item *_items = nullptr;
+    uint8_t *_distances = nullptr;
+
+    // How far each item is from its ideal slot, plus one. Zero is an empty
+    // slot.
+    uint8_t _inline_distances[INLINE_CAPACITY] = {};
+    alignas(Item) uint8_t _inline_items[INLINE_CAPACITY * sizeof(Item)];
+
+    bool is_inline() const { return _items == nullptr; }
 
-    Vector<Vector<Item>> _buckets{};
+    Item *items() { return is_inline() ? reinterpret_cast<Item *>(_inline_items) : _items; }
 
-    Vector<Item> &bucket(uint32_t hash)
+    uint8_t *distances() { return is_inline() ? _inline_distances : _distances; }
+
+    template <typename TLookup>
+    static uint32_t hash_of(const TLookup &key)
     {
-        return _buckets[hash % BUCKET_COUNT];
+        return hash(key);
     }
 
-    Item *item_by_key(const TKey &key)
+    static void swap_items(Item &left, Item &right)
     {
-        return item_by_key(key, hash<TKey>(key));
+        Item tmp{move(left)};
+
+        left.~Item();
+        new (&left) Item(move(right));
+
+        right.~Item();
+        new (&right) Item(move(tmp));
     }
 
-    Item *item_by_key(const TKey &key, uint32_t hash)
+    template <typename TLookup>
+    Item *item_by_key(const TLookup &key, uint32_t hash)
     {
-        Item *result = nullptr;
-        auto &b = bucket(hash);
+        Item *items = this->items();
+        uint8_t *distances = this->distances();
 
-        b.foreach ([&](Item &item) {
-            if (item.hash == hash && item.key == key)
+        size_t mask = _capacity - 1;
+        size_t index = hash & mask;
+
+        for (size_t distance = 1; distances[index] >= distance; distance++)
+        {
+            if (items[index].hash == hash && items[index].key == key)
             {
-                result = &item;
-                return Iteration::STOP;
+                return &items[index];
             }
-            else
+
+            index = (index + 1) & mask;
+        }
+
+        return nullptr;
+    }
+
+    // Returns where the item ended up, or nullptr if the map had to grow
+    // after it was placed and it should be looked up again.
+    Item *insert(Item &&item)
+    {
+        Item *items = this->items();
+        uint8_t *distances = this->distances();
+
+        size_t mask = _capacity - 1;
+        size_t index = item.hash & mask;
+        size_t distance = 1;
+
+        Item *inserted = nullptr;
+
+        while (true)
+        {
+            if (distance > MAX_DISTANCE)
             {
-                return Iteration::CONTINUE;
+                grow();
+
+                Item *reinserted = insert(move(item));
+                return inserted ? nullptr : reinserted;
+            }
+
+            if (distances[index] == 0)
+            {
+                new (&items[index]) Item(move(item));
+                distances[index] = distance;
+                _count++;
+
+                return inserted ? inserted : &items[index];
+            }
+
+            if (distances[index] < distance)
+            {
+                // Take from the rich, carry on with the item we displaced.
+                swap_items(items[index], item);
+
+                size_t displaced_distance = distances[index];
+                distances[index] = distance;
+                distance = displaced_distance;
+
+                if (!inserted)
+                {
+                    inserted = &items[index];
+                }
             }
+
+            index = (index + 1) & mask;
+            distance++;
+        }
+    }
+
+    void remove_at(size_t index)
+    {
+        Item *items = this->items();
+        uint8_t *distances = this->distances();
+
+        size_t mask = _capacity - 1;
+
+        items[index].~Item();
+        distances[index] = 0;
+        _count--;
+
+        // Shift the following items back, so there is no need for
+        // tombstones.
+        size_t next = (index + 1) & mask;
+
+        while (distances[next] > 1)
+        {
+            new (&items[index]) Item(move(items[next]));
+            items[next].~Item();
+
+            distances[index] = distances[next] - 1;
+            distances[next] = 0;
+
+            index = next;
+            next = (next + 1) & mask;
+        }
+    }
+
+    void rehash(size_t capacity)
+    {
+        Item *old_items = items();
+        uint8_t *old_distances = distances();
+        size_t old_capacity = _capacity;
+        bool was_inline = is_inline();
+
+        uint8_t *storage = reinterpret_cast<uint8_t *>(calloc(capacity, sizeof(Item) + 1));
+
+        _items = reinterpret_cast<Item *>(storage);
+        _distances = storage + capacity * sizeof(Item);
+        _capacity = capacity;
+        _count = 0;
+
+        for (size_t i = 0; i < old_capacity; i++)
+        {
+            if (old_distances[i])
+            {
+                insert(move(old_items[i]));
+                old_items[i].~Item();
+                old_distances[i] = 0;
+            }
+        }
+
+        if (!was_inline)
+        {
+            free(old_items);
+        }
+    }
+
+    void grow()
+    {
+        rehash(_capacity * 2);
+    }
+
+    void ensure_room()
+    {
+        if ((_count + 1) * LOAD_FACTOR_DENOMINATOR > _capacity * LOAD_FACTOR_NUMERATOR)
+        {
+            grow();
+        }
+    }
+
+    void copy_from(const HashMap &other)
+    {
+        const_cast<HashMap &>(other).foreach ([&](auto &key, auto &value) {
+            (*this)[key] = value;
+            return Iteration::CONTINUE;
         });
+    }
 
-        return result;
+    void move_from(HashMap &other)
+    {
+        if (other.is_inline())
+        {
+            Item *other_items = other.items();
+
+            for (size_t i = 0; i < INLINE_CAPACITY; i++)
+            {
+                if (other._inline_distances[i])
+                {
+                    new (&items()[i]) Item(move(other_items[i]));
+                    other_items[i].~Item();
+
+                    _inline_distances[i] = other._inline_distances[i];
+                    other._inline_distances[i] = 0;
+                }
+            }
+        }
+        else
+        {
+            _items = other._items;
+            _distances = other._distances;
+
+            other._items = nullptr;
+            other._distances = nullptr;
+        }
+
+        _count = other._count;
+        _capacity = other._capacity;
+
+        other._count = 0;
+        other._capacity = INLINE_CAPACITY;
     }
 
 public:
-    size_t count()
+    size_t count() const { return _count; }
+
+    size_t capacity() const { return _capacity; }
+
+    HashMap() {}
+
+    HashMap(const HashMap &other)
     {
-        size_t result = 0;
+        copy_from(other);
+    }
+
+    HashMap(HashMap &&other)
+    {
+        move_from(other);
+    }
 
-        for (size_t i = 0; i < BUCKET_COUNT; i++)
+    ~HashMap()
+    {
+        clear();
+    }
+
+    HashMap &operator=(const HashMap &other)
+    {
+        if (this != &other)
         {
-            result += _buckets[i].count();
+            clear();
+            copy_from(other);
         }
 
-        return result;
+        return *this;
     }
 
-    HashMap()
+    HashMap &operator=(HashMap &&other)
     {
-        for (size_t i = 0; i < BUCKET_COUNT; i++)
+        if (this != &other)
         {
-            _buckets.push_back({});
+            clear();
+            move_from(other);
         }
+
+        return *this;
     }
 
     void clear()
     {
-        _buckets.clear();
+        Item *items = this->items();
+        uint8_t *distances = this->distances();
+
+        for (size_t i = 0; i < _capacity; i++)
+        {
+            if (distances[i])
+            {
+                items[i].~Item();
+                distances[i] = 0;
+            }
+        }
+
+        if (!is_inline())
+        {
+            free(_items);
+
+            _items = nullptr;
+            _distances = nullptr;
+        }
+
+        _count = 0;
+        _capacity = INLINE_CAPACITY;
     }
 
-    void remove_key(TKey &key)
+    template <typename TLookup>
+    void remove_key(const TLookup &key)
     {
-        uint32_t h = hash<TKey>(key);
+        Item *item = item_by_key(key, hash_of(key));
 
-        bucket(h).remove_all_match([&](auto &item) {
-            return item.hash == h && item.key == key;
-        });
+        if (item)
+        {
+            remove_at(item - items());
+        }
     }
 
-    void remove_value(TValue &value)
+    void remove_value(const TValue &value)
     {
-        _buckets.foreach ([&](auto &bucket) {
-            bucket.remove_all_match([&](auto &item) {
-                return item.value == value;
-            });
+        Item *items = this->items();
+        uint8_t *distances = this->distances();
 
-            return Iteration::CONTINUE;
-        });
+        for (size_t i = 0; i < _capacity;)
+        {
+            // Removing shifts the next item here, so look at it again.
+            if (distances[i] && items[i].value == value)
+            {
+                remove_at(i);
+            }
+            else
+            {
+                i++;
+            }
+        }
     }
 
-    bool has_key(const TKey &key)
+    template <typename TLookup>
+    bool has_key(const TLookup &key)
     {
-        return item_by_key(key) != nullptr;
+        return item_by_key(key, hash_of(key)) != nullptr;
     }
 
     bool has_value(const TValue &value)
@@ -119,29 +384,50 @@ public:
         return result;
     }
 
+    // Returns nullptr if there is no such key.
+    template <typename TLookup>
+    TValue *lookup(const TLookup &key)
+    {
+        Item *item = item_by_key(key, hash_of(key));
+
+        return item ? &item->value : nullptr;
+    }
+
     template <typename TCallback>
     void foreach (TCallback callback)
     {
-        _buckets.foreach ([&](auto &bucket) {
-            return bucket.foreach ([&](auto &item) {
-                return callback(item.key, item.value);
-            });
-        });
+        Item *items = this->items();
+        uint8_t *distances = this->distances();
+
+        for (size_t i = 0; i < _capacity; i++)
+        {
+            if (distances[i] && callback(items[i].key, items[i].value) == Iteration::STOP)
+            {
+                return;
+            }
+        }
     }
 
-    TValue &operator[](const TKey &key)
+    template <typename TLookup>
+    TValue &operator[](const TLookup &key)
     {
-        auto h = hash<TKey>(key);
-        auto *i = item_by_key(key, h);
+        uint32_t h = hash_of(key);
+        Item *item = item_by_key(key, h);
 
-        if (i)
+        if (item)
         {
-            return i->value;
+            return item->value;
         }
-        else
+
+        ensure_room();
+
+        item = insert({TKey(key), TValue{}, h});
+
+        if (!item)
         {
-            auto &b = bucket(h);
-            return b.push_back({h, key, {}}).value;
+            item = item_by_key(key, h);
         }
+
+        return item->value;
     }
 };
@@ -4,56 +4,137 @@
 #include <libutils/Move.h>
 #include <libutils/RefPtr.h>
 #include <libutils/StringStorage.h>
+#include <libutils/StringView.h>
 
+// Strings short enough to fit in the object are stored inline and never
+// allocate, longer ones share a reference counted StringStorage.
 class String
 {
+public:
+    static constexpr size_t INLINE_CAPACITY = 15;
+
 private:
-    RefPtr<StringStorage> _buffer;
+    size_t _length = 0;
+
+    union
+    {
+        char _inline[INLINE_CAPACITY + 1];
+        StringStorage *_storage;
+    };
+
+    bool is_inline() const { return _length <= INLINE_CAPACITY; }
+
+    void assign(const char *buffer, size_t length)
+    {
+        _length = length;
+
+        if (is_inline())
+        {
+            memcpy(_inline, buffer, length);
+            _inline[length] = '\0';
+        }
+        else
+        {
+            _storage = new StringStorage(buffer, length);
+        }
+    }
+
+    void assign(const String &other)
+    {
+        _length = other._length;
+
+        if (is_inline())
+        {
+            memcpy(_inline, other._inline, INLINE_CAPACITY + 1);
+        }
+        else
+        {
+            _storage = other._storage;
+            _storage->ref();
+        }
+    }
+
+    void steal(String &other)
+    {
+        _length = other._length;
+        memcpy(_inline, other._inline, INLINE_CAPACITY + 1);
+
+        other._length = 0;
+        other._inline[0] = '\0';
+    }
+
+    void release()
+    {
+        if (!is_inline())
+        {
+            _storage->deref();
+        }
+    }
 
 public:
-    size_t length() const { return _buffer->length(); }
-    const char *cstring() const { return _buffer->cstring(); }
-    char at(int index) const { return _buffer->cstring()[index]; }
+    size_t length() const { return _length; }
+    const char *cstring() const { return is_inline() ? _inline : _storage->cstring(); }
+    char at(int index) const { return cstring()[index]; }
+
+    String()
+    {
+        _inline[0] = '\0';
+    }
 
-    String(const char *cstring = "")
+    String(const char *cstring)
     {
-        _buffer = make<StringStorage>(cstring);
+        assign(cstring, strlen(cstring));
     }
 
     String(const char *cstring, size_t length)
     {
-        _buffer = make<StringStorage>(cstring, length);
+        assign(cstring, length);
+    }
+
+    String(StringView view)
+    {
+        assign(view.data(), view.length());
     }
 
     String(char c)
     {
-        char cstr[2];
-        cstr[0] = c;
-        _buffer = make<StringStorage>(cstr, 1);
+        assign(&c, 1);
     }
 
     String(RefPtr<StringStorage> storage)
-        : _buffer(storage)
     {
+        if (storage->length() <= INLINE_CAPACITY)
+        {
+            assign(storage->cstring(), storage->length());
+        }
+        else
+        {
+            _length = storage->length();
+            _storage = storage.give_ref();
+        }
     }
 
     String(const String &other)
-        : _buffer(const_cast<String &>(other)._buffer)
     {
+        assign(other);
     }
 
     String(String &&other)
-        : _buffer(move(other._buffer))
     {
+        steal(other);
     }
 
-    ~String() {}
+    ~String()
+    {
+        release();
+    }
 
     String &operator=(const String &other)
     {
         if (this != &other)
         {
-            _buffer = const_cast<String &>(other)._buffer;
+            release();
+            assign(other);
         }
 
         return *this;
@@ -63,53 +144,64 @@ public:
     {
         if (this != &other)
         {
-            _buffer = move(other._buffer);
+            release();
+            steal(other);
         }
 
         return *this;
     }
 
-    String &operator+=(String &other)
+    String &operator+=(StringView other)
     {
-        _buffer = make<StringStorage>(*_buffer, *other._buffer);
+        size_t length = _length + other.length();
+
+        if (length <= INLINE_CAPACITY)
+        {
+            memcpy(_inline + _length, other.data(), other.length());
+            _inline[length] = '\0';
+            _length = length;
+        }
+        else
+        {
+            StringStorage *storage = new StringStorage(cstring(), _length, other.data(), other.length());
+
+            release();
+
+            _length = length;
+            _storage = storage;
+        }
 
         return *this;
     }
 
+    operator StringView() const
+    {
+        return StringView(cstring(), _length);
+    }
+
     bool operator==(const String &other) const
     {
-        if (length() != other.length())
+        if (_length != other._length)
         {
             return false;
         }
 
-        for (size_t i = 0; i < length(); i++)
+        if (!is_inline() && _storage == other._storage)
         {
-            if (cstring()[i] != other.cstring()[i])
-            {
-                return false;
-            }
+            return true;
         }
 
-        return true;
+        return memcmp(cstring(), other.cstring(), _length) == 0;
     }
 
-    bool operator==(const char *str) const
+    bool operator==(StringView other) const
     {
-        if (length() != strlen(str))
-        {
-            return false;
-        }
-
-        for (size_t i = 0; i < length(); i++)
-        {
-            if (cstring()[i] != str[i])
-            {
-                return false;
-            }
-        }
+        return StringView(*this) == other;
+    }
 
-        return true;
+    bool operator==(const char *str) const
+    {
+        return StringView(*this) == str;
     }
 
     char operator[](int index) const
@@ -41,12 +41,20 @@ public:
         _used = 0;
         _size = 0;
 
+        if (size <= String::INLINE_CAPACITY)
+        {
+            String string{result, size};
+            delete[] result;
+
+            return string;
+        }
+
         return String(make<StringStorage>(AdoptTag::ADOPT, result, size));
     }
 
     String intermediate()
     {
-        return String(make<StringStorage>(_buffer, _used));
+        return String(_buffer, _used);
     }
 
     StringBuilder &append(String string)
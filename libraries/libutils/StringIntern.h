@@ -0,0 +1,37 @@
+#pragma once
+
+#include <libutils/HashMap.h>
+#include <libutils/String.h>
+
+// Identifiers like widget ids and JSON keys come back over and over, interning
+// them makes every copy share the same storage and compare by pointer. The
+// table is never emptied, so only intern things from a small vocabulary.
+//
+// Short strings are inline anyway, they are not worth a lookup.
+
+inline HashMap<String, String> *__string_interned = nullptr;
+
+inline String string_intern(StringView view)
+{
+    if (view.length() <= String::INLINE_CAPACITY)
+    {
+        return String(view);
+    }
+
+    if (__string_interned == nullptr)
+    {
+        __string_interned = new HashMap<String, String>();
+    }
+
+    String *interned = __string_interned->lookup(view);
+
+    if (interned)
+    {
+        return *interned;
+    }
+
+    String string{view};
+    (*__string_interned)[string] = string;
+
+    return string;
+}
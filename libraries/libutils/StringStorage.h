@@ -33,19 +33,19 @@ public:
         _buffer = buffer;
     }
 
-    StringStorage(StringStorage &left, StringStorage &right)
+    StringStorage(const char *left, size_t left_length, const char *right, size_t right_length)
     {
-        _length = left.length() + right.length();
+        _length = left_length + right_length;
         _buffer = new char[_length + 1];
 
-        memcpy(_buffer, left.cstring(), left.length());
-        memcpy(_buffer + left.length(), right.cstring(), right.length());
+        memcpy(_buffer, left, left_length);
+        memcpy(_buffer + left_length, right, right_length);
 
-        _buffer[left.length() + right.length()] = '\0';
+        _buffer[_length] = '\0';
     }
 
     ~StringStorage()
     {
-        delete _buffer;
+        delete[] _buffer;
     }
 };
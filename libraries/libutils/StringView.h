@@ -0,0 +1,83 @@
+#pragma once
+
+#include <libsystem/core/CString.h>
+#include <libutils/Hash.h>
+
+// A non-owning view of characters, which aren't necessarily null terminated.
+// Whatever it points to must outlive it.
+class StringView
+{
+private:
+    const char *_buffer = "";
+    size_t _length = 0;
+
+public:
+    size_t length() const { return _length; }
+
+    const char *data() const { return _buffer; }
+
+    bool empty() const { return _length == 0; }
+
+    char at(int index) const { return _buffer[index]; }
+
+    StringView() {}
+
+    StringView(const char *cstring)
+        : _buffer(cstring), _length(strlen(cstring))
+    {
+    }
+
+    StringView(const char *buffer, size_t length)
+        : _buffer(buffer), _length(length)
+    {
+    }
+
+    StringView substring(size_t start, size_t length) const
+    {
+        if (start > _length)
+        {
+            start = _length;
+        }
+
+        if (length > _length - start)
+        {
+            length = _length - start;
+        }
+
+        return StringView(_buffer + start, length);
+    }
+
+    bool operator==(StringView other) const
+    {
+        if (_length != other._length)
+        {
+            return false;
+        }
+
+        return _buffer == other._buffer || memcmp(_buffer, other._buffer, _length) == 0;
+    }
+
+    bool operator==(const char *cstring) const
+    {
+        for (size_t i = 0; i < _length; i++)
+        {
+            if (cstring[i] == '\0' || cstring[i] != _buffer[i])
+            {
+                return false;
+            }
+        }
+
+        return cstring[_length] == '\0';
+    }
+
+    char operator[](int index) const
+    {
+        return at(index);
+    }
+};
+
+template <>
+inline uint32_t hash<StringView>(const StringView &value)
+{
+    return hash(value.data(), value.length());
+}
@@ -1,10 +1,9 @@
+#include <libprotocol/ClientConnection.h>
 #include <libsystem/Assert.h>
 #include <libsystem/Logger.h>
 #include <libsystem/core/CString.h>
 #include <libsystem/eventloop/EventLoop.h>
 #include <libsystem/eventloop/Notifier.h>
-#include <libsystem/io/Connection.h>
-#include <libsystem/io/Socket.h>
 #include <libsystem/process/Process.h>
 #include <libsystem/utils/Hexdump.h>
 
@@ -24,7 +23,7 @@ enum ApplicationState
 
 static ApplicationState _state = APPLICATION_NONE;
 static List *_windows;
-static Connection *_connection;
+static OwnPtr<protocol::ClientConnection<CompositorProtocol>> _connection;
 static Notifier *_connection_notifier;
 static bool _is_debbuging_layout = false;
 
@@ -65,36 +64,29 @@ void application_do_message(CompositorMessage *message)
 
 void application_send_message(CompositorMessage message)
 {
-    connection_send(_connection, &message, sizeof(CompositorMessage));
+    _connection->send(message);
 }
 
-CompositorMessage *application_wait_for_message(CompositorMessageType expected_message)
+static Iteration application_dispatch_message(CompositorMessage &message)
 {
-    List *pending_messages = nullptr;
+    application_do_message(&message);
 
-    CompositorMessage *message = __create(CompositorMessage);
-    connection_receive(_connection, message, sizeof(CompositorMessage));
+    return Iteration::CONTINUE;
+}
 
-    while (message->type != expected_message)
-    {
-        if (pending_messages == nullptr)
-        {
-            pending_messages = list_create();
-        }
+CompositorMessage application_wait_for_message(CompositorMessageType expected_message)
+{
+    CompositorMessage message = {};
 
-        list_pushback(pending_messages, message);
-        message = __create(CompositorMessage);
-        connection_receive(_connection, message, sizeof(CompositorMessage));
-    }
+    Result result = _connection->wait_for(
+        [&](CompositorMessage &candidate) { return candidate.type == expected_message; },
+        message,
+        application_dispatch_message);
 
-    if (pending_messages)
+    if (result != SUCCESS)
     {
-        list_foreach(CompositorMessage, message, pending_messages)
-        {
-            application_do_message(message);
-        }
-
-        list_destroy_with_callback(pending_messages, free);
+        logger_error("Connection to the compositor closed %s!", result_to_string(result));
+        process_exit(-1);
     }
 
     return message;
@@ -102,11 +94,7 @@ CompositorMessage *application_wait_for_message(CompositorMessageType expected_m
 
 void application_wait_for_ack()
 {
-    CompositorMessage *ack_message = application_wait_for_message(COMPOSITOR_MESSAGE_ACK);
-    if (ack_message)
-    {
-        free(ack_message);
-    }
+    application_wait_for_message(COMPOSITOR_MESSAGE_ACK);
 }
 
 void application_request_callback(
@@ -115,26 +103,16 @@ void application_request_callback(
     SelectEvent events)
 {
     __unused(target);
+    __unused(connection);
     __unused(events);
 
-    CompositorMessage message = {};
-    memset((void *)&message, 0xff, sizeof(CompositorMessage));
-    size_t message_size = connection_receive(connection, &message, sizeof(CompositorMessage));
-
-    if (handle_has_error(connection))
-    {
-        logger_error("Connection to the compositor closed %s!", handle_error_string(connection));
-        application_exit(-1);
-    }
+    Result result = _connection->receive(application_dispatch_message);
 
-    if (message_size != sizeof(CompositorMessage))
+    if (result != SUCCESS)
     {
-        logger_error("Got a message with an invalid size from compositor %u != %u!", sizeof(CompositorMessage), message_size);
-        hexdump(&message, message_size);
+        logger_error("Connection to the compositor closed %s!", result_to_string(result));
         application_exit(-1);
     }
-
-    application_do_message(&message);
 }
 
 Result application_initialize(int argc, char **argv)
@@ -162,36 +140,32 @@ Result application_initialize(int argc, char **argv)
     if (!theme_changed)
         theme_load("/System/Themes/skift-dark.json");
 
-    _connection = socket_connect("/Session/compositor.ipc");
+    auto connection_or_result = protocol::ClientConnection<CompositorProtocol>::connect("/Session/compositor.ipc");
 
-    if (handle_has_error(_connection))
+    if (!connection_or_result.success())
     {
-        logger_error("Failed to connect to the compositor: %s", handle_error_string(_connection));
-        Result result = handle_get_error(_connection);
-        connection_close(_connection);
-        _connection = nullptr;
+        logger_error("Failed to connect to the compositor: %s", result_to_string(connection_or_result.result()));
 
-        return result;
+        return connection_or_result.result();
     }
 
+    _connection = connection_or_result.take_value();
+
     _windows = list_create();
 
     eventloop_initialize();
 
     _connection_notifier = notifier_create(
         nullptr,
-        HANDLE(_connection),
+        HANDLE(_connection->connection()),
         SELECT_READ,
         (NotifierCallback)application_request_callback);
 
     _state = APPLICATION_INITALIZED;
 
-    CompositorMessage *greetings_message = application_wait_for_message(COMPOSITOR_MESSAGE_GREETINGS);
+    CompositorMessage greetings_message = application_wait_for_message(COMPOSITOR_MESSAGE_GREETINGS);
 
-    if (greetings_message)
-    {
-        Screen::bound((greetings_message->greetings.screen_bound));
-    }
+    Screen::bound(greetings_message.greetings.screen_bound);
 
     return SUCCESS;
 }
@@ -4,6 +4,7 @@
 #include <libsystem/eventloop/EventLoop.h>
 #include <libsystem/io/Stream.h>
 #include <libsystem/system/Memory.h>
+#include <libutils/StringIntern.h>
 #include <libwidget/Application.h>
 #include <libwidget/Event.h>
 #include <libwidget/Screen.h>
@@ -180,6 +181,20 @@ void Window::repaint_dirty()
 
     _dirty_rects.clear();
 
+    if (!_shifted_rect.is_empty())
+    {
+        if (repaited_regions.is_empty())
+        {
+            repaited_regions = _shifted_rect;
+        }
+        else
+        {
+            repaited_regions = _shifted_rect.merged_with(repaited_regions);
+        }
+
+        _shifted_rect = Rectangle::empty();
+    }
+
     frontbuffer->copy_from(*backbuffer, repaited_regions);
 
     swap(frontbuffer, backbuffer);
@@ -221,6 +236,27 @@ void Window::should_repaint(Rectangle rectangle)
     _dirty_rects.push_back(rectangle);
 }
 
+void Window::should_shift(Rectangle rectangle, int offset)
+{
+    if (!_visible)
+        return;
+
+    _repaint_invoker->invoke_later();
+
+    // The backbuffer holds what was last flipped, so it is moved there and
+    // copied to the frontbuffer with the next repaint.
+    backbuffer->shift(rectangle, offset);
+
+    if (_shifted_rect.is_empty())
+    {
+        _shifted_rect = rectangle;
+    }
+    else
+    {
+        _shifted_rect = _shifted_rect.merged_with(rectangle);
+    }
+}
+
 void Window::should_relayout()
 {
     if (dirty_layout || !_visible)
@@ -671,9 +707,9 @@ void Window::widget_removed(Widget *widget)
     widget_by_id.remove_value(widget);
 }
 
-void Window::register_widget_by_id(String id, Widget *widget)
+void Window::register_widget_by_id(StringView id, Widget *widget)
 {
-    widget_by_id[id] = widget;
+    widget_by_id[string_intern(id)] = widget;
 }
 
 Color Window::color(ThemeColorRole role)
@@ -4,6 +4,7 @@
 #include <libgraphic/Painter.h>
 #include <libsystem/eventloop/Invoker.h>
 #include <libutils/HashMap.h>
+#include <libutils/String.h>
 #include <libutils/Vector.h>
 #include <libwidget/Cursor.h>
 #include <libwidget/Event.h>
@@ -46,6 +47,7 @@ struct Window
     OwnPtr<Painter> backbuffer_painter;
 
     Vector<Rectangle> _dirty_rects{};
+    Rectangle _shifted_rect = Rectangle::empty();
     bool dirty_layout;
 
     EventHandler handlers[EventType::__COUNT];
@@ -141,14 +143,20 @@ public:
 
     void should_repaint(Rectangle rectangle);
 
+    // Moves what is painted in `rectangle` by `offset` lines without
+    // repainting it, the caller should repaint what is uncovered.
+    void should_shift(Rectangle rectangle, int offset);
+
     void should_relayout();
 
     template <typename WidgetType, typename CallbackType>
-    void with_widget(String name, CallbackType callback)
+    void with_widget(StringView name, CallbackType callback)
     {
-        if (widget_by_id.has_key(name))
+        Widget **found = widget_by_id.lookup(name);
+
+        if (found)
         {
-            auto widget = dynamic_cast<WidgetType *>(widget_by_id[name]);
+            auto widget = dynamic_cast<WidgetType *>(*found);
 
             if (widget)
             {
@@ -163,5 +171,5 @@ public:
 
     void widget_removed(Widget *widget);
 
-    void register_widget_by_id(String id, Widget *widget);
+    void register_widget_by_id(StringView id, Widget *widget);
 };
@@ -0,0 +1,56 @@
+# Microbenchmarks of the hot paths of the libraries, built and run on the host
+# by 'make benchmarks' and by nothing else.
+
+HOST_CXX?=g++
+HOST_CXXFLAGS?= \
+	-std=c++20 \
+	-O2 \
+	-Wall \
+	-Wextra \
+	-Werror \
+	-Ilibraries
+
+BENCHMARKS_DIRECTORY=$(BUILD_DIRECTORY)/benchmarks
+
+BENCHMARKS += $(BENCHMARKS_DIRECTORY)/graphic
+
+$(BENCHMARKS_DIRECTORY)/graphic: toolbox/benchmarks/graphic.cpp libraries/libgraphic/PixelKernels.cpp
+	$(DIRECTORY_GUARD)
+	@echo [HOST] [CXX] $@
+	@$(HOST_CXX) $(HOST_CXXFLAGS) -o $@ $^
+
+BENCHMARKS += $(BENCHMARKS_DIRECTORY)/allocator
+
+# The allocator only needs __libc__.h from our libc, the rest comes from the host.
+$(BENCHMARKS_DIRECTORY)/allocator: toolbox/benchmarks/allocator.cpp toolbox/benchmarks/liballoc.cpp libraries/libsystem/core/Allocator.cpp
+	$(DIRECTORY_GUARD)
+	@echo [HOST] [CXX] $@
+	@$(HOST_CXX) $(HOST_CXXFLAGS) -idirafter libraries/libc -o $@ $^
+
+BENCHMARKS += $(BENCHMARKS_DIRECTORY)/hashmap
+
+$(BENCHMARKS_DIRECTORY)/hashmap: toolbox/benchmarks/hashmap.cpp
+	$(DIRECTORY_GUARD)
+	@echo [HOST] [CXX] $@
+	@$(HOST_CXX) $(HOST_CXXFLAGS) -idirafter libraries/libc -o $@ $^
+
+BENCHMARKS += $(BENCHMARKS_DIRECTORY)/json
+
+JSON_BENCHMARK_SOURCES = \
+	toolbox/benchmarks/json.cpp \
+	libraries/libjson/Parser.cpp \
+	libraries/libjson/Reader.cpp \
+	libraries/libjson/Value.cpp \
+	libraries/libsystem/unicode/Codepoint.cpp \
+	libraries/libsystem/utils/BufferBuilder.cpp \
+	libraries/libsystem/utils/Lexer.cpp \
+	libraries/libsystem/utils/NumberParser.cpp
+
+$(BENCHMARKS_DIRECTORY)/json: $(JSON_BENCHMARK_SOURCES)
+	$(DIRECTORY_GUARD)
+	@echo [HOST] [CXX] $@
+	@$(HOST_CXX) $(HOST_CXXFLAGS) -idirafter libraries/libc -o $@ $^ -lm
+
+.PHONY: benchmarks
+benchmarks: $(BENCHMARKS)
+	@for benchmark in $(BENCHMARKS); do $$benchmark; done
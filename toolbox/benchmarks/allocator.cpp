@@ -0,0 +1,183 @@
+// Throughput of libsystem's allocator against the liballoc it replaced, in
+// nanoseconds per operation. Both get their pages from mmap, and the slab
+// allocator also serves the malloc of this process.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include <libsystem/Logger.h>
+#include <libsystem/core/Allocator.h>
+#include <libsystem/core/Plugs.h>
+
+#define LIVE_OBJECTS (4096)
+
+void *liballoc_malloc(size_t size);
+void *liballoc_realloc(void *pointer, size_t size);
+void liballoc_free(void *pointer);
+
+/* --- Plugs ---------------------------------------------------------------- */
+
+int __plug_memalloc_lock() { return 0; }
+
+int __plug_memalloc_unlock() { return 0; }
+
+void *__plug_memalloc_alloc(size_t size)
+{
+    void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return address == MAP_FAILED ? nullptr : address;
+}
+
+void __plug_memalloc_free(void *address, size_t size)
+{
+    munmap(address, size);
+}
+
+void logger_log(LogLevel level, const char *file, uint line, const char *fmt, ...)
+{
+    __unused(level);
+    __unused(file);
+    __unused(line);
+    __unused(fmt);
+}
+
+void __no_return __plug_assert_failed(const char *expr, const char *file, const char *function, int line)
+{
+    fprintf(stderr, "Assert failed: %s in %s:%s() ln%d!\n", expr, file, function, line);
+    abort();
+}
+
+/* --- Workloads ------------------------------------------------------------ */
+
+struct Allocator
+{
+    const char *name;
+    void *(*malloc)(size_t size);
+    void *(*realloc)(void *pointer, size_t size);
+    void (*free)(void *pointer);
+};
+
+static void *_objects[LIVE_OBJECTS];
+
+static uint32_t _seed = 0;
+
+static uint32_t next_random()
+{
+    _seed = _seed * 1103515245 + 12345;
+    return _seed >> 8;
+}
+
+// Small objects dying young, like Strings and json values.
+static size_t churn(Allocator &allocator)
+{
+    size_t operations = 0;
+
+    for (size_t i = 0; i < 2000000; i++)
+    {
+        size_t index = next_random() % LIVE_OBJECTS;
+
+        allocator.free(_objects[index]);
+        _objects[index] = allocator.malloc(8 + next_random() % 120);
+
+        operations += 2;
+    }
+
+    return operations;
+}
+
+// Everything up to a few pages.
+static size_t mixed(Allocator &allocator)
+{
+    size_t operations = 0;
+
+    for (size_t i = 0; i < 500000; i++)
+    {
+        size_t index = next_random() % LIVE_OBJECTS;
+
+        allocator.free(_objects[index]);
+
+        uint32_t dice = next_random() % 100;
+        size_t size = dice < 80 ? 8 + next_random() % 248 : dice < 98 ? 256 + next_random() % 3840 : 4096 + next_random() % 61440;
+
+        _objects[index] = allocator.malloc(size);
+
+        operations += 2;
+    }
+
+    return operations;
+}
+
+// Vectors growing by doubling.
+static size_t growth(Allocator &allocator)
+{
+    size_t operations = 0;
+
+    for (size_t i = 0; i < 20000; i++)
+    {
+        void *buffer = nullptr;
+
+        for (size_t size = 16; size <= 65536; size *= 2)
+        {
+            buffer = allocator.realloc(buffer, size);
+            operations++;
+        }
+
+        allocator.free(buffer);
+        operations++;
+    }
+
+    return operations;
+}
+
+static void measure(Allocator &allocator, const char *workload, size_t (*callback)(Allocator &))
+{
+    _seed = 42;
+
+    for (size_t i = 0; i < LIVE_OBJECTS; i++)
+    {
+        _objects[i] = allocator.malloc(8 + next_random() % 120);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    size_t operations = callback(allocator);
+
+    auto end = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < LIVE_OBJECTS; i++)
+    {
+        allocator.free(_objects[i]);
+        _objects[i] = nullptr;
+    }
+
+    double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+
+    printf("%-8s %-8s %8.1f ns/op\n", allocator.name, workload, nanoseconds / operations);
+}
+
+int main()
+{
+    Allocator allocators[] = {
+        {"liballoc", liballoc_malloc, liballoc_realloc, liballoc_free},
+        {"slab", malloc, realloc, free},
+    };
+
+    for (auto &allocator : allocators)
+    {
+        measure(allocator, "churn", churn);
+        measure(allocator, "mixed", mixed);
+        measure(allocator, "growth", growth);
+    }
+
+    AllocatorStatistics statistics = allocator_statistics();
+
+    printf("slab: %zu allocations, %zu frees, %zu slabs, %zu Kio reserved, %zu errors\n",
+           statistics.allocations,
+           statistics.frees,
+           statistics.slabs,
+           statistics.reserved / 1024,
+           statistics.errors);
+
+    return statistics.errors != 0;
+}
@@ -0,0 +1,82 @@
+// Throughput of the painter's row kernels, in megapixels per second.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <libgraphic/PixelKernels.h>
+
+#define ROW_WIDTH (1920)
+#define ROW_COUNT (1080)
+#define ITERATIONS (8)
+
+static uint32_t _source[ROW_WIDTH * ROW_COUNT];
+static uint32_t _destination[ROW_WIDTH * ROW_COUNT];
+
+static void reset()
+{
+    for (size_t i = 0; i < ROW_WIDTH * ROW_COUNT; i++)
+    {
+        // Mostly translucent pixels, over an opaque background.
+        _source[i] = (rand() & 0x00ffffff) | ((rand() & 0x7f) << 24);
+        _destination[i] = rand() | 0xff000000;
+    }
+}
+
+template <typename Callback>
+static void measure(const char *kernels, const char *kernel, Callback callback)
+{
+    reset();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        for (size_t y = 0; y < ROW_COUNT; y++)
+        {
+            callback(&_destination[y * ROW_WIDTH], &_source[y * ROW_WIDTH]);
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double megapixels = (double)ROW_WIDTH * ROW_COUNT * ITERATIONS / 1000000.0;
+
+    printf("%-8s %-14s %10.1f Mpx/s\n", kernels, kernel, megapixels / elapsed.count());
+}
+
+static void benchmark(const PixelKernels &kernels)
+{
+    measure(kernels.name, "copy_opaque", [&](uint32_t *destination, const uint32_t *source) {
+        kernels.copy_opaque(destination, source, ROW_WIDTH);
+    });
+
+    measure(kernels.name, "blend", [&](uint32_t *destination, const uint32_t *source) {
+        kernels.blend(destination, source, ROW_WIDTH);
+    });
+
+    measure(kernels.name, "fill", [&](uint32_t *destination, const uint32_t *) {
+        kernels.fill(destination, 0xff336699, ROW_WIDTH);
+    });
+
+    measure(kernels.name, "blend_fill", [&](uint32_t *destination, const uint32_t *) {
+        kernels.blend_fill(destination, 0x80336699, ROW_WIDTH);
+    });
+
+    // Upscaling a 1280 pixels row to the full width.
+    measure(kernels.name, "scale_linear", [&](uint32_t *destination, const uint32_t *source) {
+        kernels.scale_linear(destination, source, source, 1280, 0, (1280 << 16) / ROW_WIDTH, 128, ROW_WIDTH);
+    });
+}
+
+int main()
+{
+    benchmark(pixel_kernels_scalar());
+
+    if (pixel_kernels_sse2())
+    {
+        benchmark(*pixel_kernels_sse2());
+    }
+
+    return 0;
+}
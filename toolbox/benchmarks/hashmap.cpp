@@ -0,0 +1,270 @@
+// Throughput of libutils' HashMap against the chained map it replaced, in
+// nanoseconds per operation, and of the hash functions behind them.
+//
+// libutils brings its own placement new, so this one can't use <chrono>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <libutils/HashMap.h>
+#include <libutils/String.h>
+#include <libutils/Vector.h>
+
+#define KEY_COUNT (100000)
+#define STRING_KEY_COUNT (10000)
+#define TINY_MAP_COUNT (10000)
+
+void __plug_assert_failed(const char *expr, const char *file, const char *function, int line)
+{
+    fprintf(stderr, "Assert failed: %s in %s:%s() ln%d!\n", expr, file, function, line);
+    abort();
+}
+
+/* --- Baseline ------------------------------------------------------------- */
+
+static inline uint32_t djb2(const void *object, size_t size)
+{
+    uint32_t hash = 5381;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = ((hash << 5) + hash) + ((const uint8_t *)object)[i];
+    }
+
+    return hash;
+}
+
+static inline uint32_t djb2(const String &value) { return djb2(value.cstring(), value.length()); }
+
+static inline uint32_t djb2(const uint32_t &value) { return djb2(&value, sizeof(value)); }
+
+// 256 vectors of buckets, djb2 and a modulo.
+template <typename TKey, typename TValue>
+class ChainedHashMap
+{
+private:
+    struct Item
+    {
+        uint32_t hash;
+        TKey key;
+        TValue value;
+    };
+
+    static constexpr int BUCKET_COUNT = 256;
+
+    Vector<Vector<Item>> _buckets{};
+
+    Item *item_by_key(const TKey &key, uint32_t hash)
+    {
+        Item *result = nullptr;
+
+        _buckets[hash % BUCKET_COUNT].foreach ([&](Item &item) {
+            if (item.hash == hash && item.key == key)
+            {
+                result = &item;
+                return Iteration::STOP;
+            }
+
+            return Iteration::CONTINUE;
+        });
+
+        return result;
+    }
+
+public:
+    ChainedHashMap()
+    {
+        for (size_t i = 0; i < BUCKET_COUNT; i++)
+        {
+            _buckets.push_back({});
+        }
+    }
+
+    bool has_key(const TKey &key)
+    {
+        return item_by_key(key, djb2(key)) != nullptr;
+    }
+
+    TValue &operator[](const TKey &key)
+    {
+        uint32_t hash = djb2(key);
+        Item *item = item_by_key(key, hash);
+
+        if (item)
+        {
+            return item->value;
+        }
+
+        return _buckets[hash % BUCKET_COUNT].push_back({hash, key, {}}).value;
+    }
+};
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+static String *_string_keys;
+static char (*_cstring_keys)[16];
+
+static volatile uint32_t _sink;
+
+static double now()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / 1000000000.0;
+}
+
+template <typename Callback>
+static void measure(const char *map, const char *operation, size_t count, Callback callback)
+{
+    double start = now();
+
+    callback();
+
+    double elapsed = now() - start;
+
+    printf("%-8s %-20s %8.1f ns/op\n", map, operation, elapsed * 1000000000.0 / count);
+}
+
+template <template <typename, typename> typename TMap>
+static void benchmark(const char *name)
+{
+    {
+        TMap<uint32_t, uint32_t> map;
+
+        measure(name, "insert", KEY_COUNT, [&]() {
+            for (uint32_t i = 0; i < KEY_COUNT; i++)
+            {
+                map[i * 7919] = i;
+            }
+        });
+
+        measure(name, "lookup", KEY_COUNT, [&]() {
+            uint32_t sum = 0;
+
+            for (uint32_t i = 0; i < KEY_COUNT; i++)
+            {
+                sum += map[i * 7919];
+            }
+
+            _sink = sum;
+        });
+
+        measure(name, "lookup missing", KEY_COUNT, [&]() {
+            uint32_t found = 0;
+
+            for (uint32_t i = 0; i < KEY_COUNT; i++)
+            {
+                found += map.has_key(i * 7919 + 1);
+            }
+
+            _sink = found;
+        });
+    }
+
+    {
+        TMap<String, uint32_t> map;
+
+        // The open map loses this one: each time it grows it moves every
+        // item to a table on fresh pages, where the chained map's small
+        // vectors get memory the allocator already had.
+        measure(name, "insert string", STRING_KEY_COUNT, [&]() {
+            for (uint32_t i = 0; i < STRING_KEY_COUNT; i++)
+            {
+                map[_string_keys[i]] = i;
+            }
+        });
+
+        measure(name, "lookup string", STRING_KEY_COUNT, [&]() {
+            uint32_t sum = 0;
+
+            for (uint32_t i = 0; i < STRING_KEY_COUNT; i++)
+            {
+                sum += map[_string_keys[i]];
+            }
+
+            _sink = sum;
+        });
+
+        // What a JSON lookup with a literal does, the baseline has to build a
+        // String first.
+        measure(name, "lookup cstring", STRING_KEY_COUNT, [&]() {
+            uint32_t found = 0;
+
+            for (uint32_t i = 0; i < STRING_KEY_COUNT; i++)
+            {
+                found += map.has_key(_cstring_keys[i]);
+            }
+
+            _sink = found;
+        });
+    }
+
+    // JSON objects, mostly a handful of keys.
+    measure(name, "tiny map", TINY_MAP_COUNT, [&]() {
+        for (uint32_t i = 0; i < TINY_MAP_COUNT; i++)
+        {
+            TMap<String, uint32_t> map;
+
+            for (uint32_t j = 0; j < 4; j++)
+            {
+                map[_string_keys[j]] = j;
+            }
+
+            _sink = map[_string_keys[i % 4]];
+        }
+    });
+}
+
+template <typename Callback>
+static void measure_hash(const char *function, size_t size, Callback callback)
+{
+    static uint8_t buffer[4096];
+    const size_t iterations = (64 * 1024 * 1024) / size;
+
+    for (size_t i = 0; i < sizeof(buffer); i++)
+    {
+        buffer[i] = rand();
+    }
+
+    double start = now();
+
+    uint32_t sum = 0;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        sum += callback(buffer, size);
+    }
+
+    _sink = sum;
+
+    double elapsed = now() - start;
+
+    printf("%-8s %4zu bytes %15.1f MB/s\n", function, size, (double)size * iterations / 1000000.0 / elapsed);
+}
+
+int main()
+{
+    _string_keys = new String[STRING_KEY_COUNT];
+    _cstring_keys = new char[STRING_KEY_COUNT][16];
+
+    for (size_t i = 0; i < STRING_KEY_COUNT; i++)
+    {
+        snprintf(_cstring_keys[i], 16, "key-%zu", i);
+        _string_keys[i] = String(_cstring_keys[i]);
+    }
+
+    benchmark<ChainedHashMap>("chained");
+    benchmark<HashMap>("robin");
+
+    static const size_t sizes[] = {8, 16, 64, 4096};
+
+    for (size_t size : sizes)
+    {
+        measure_hash("djb2", size, [](const void *buffer, size_t size) { return djb2(buffer, size); });
+        measure_hash("xxhash32", size, [](const void *buffer, size_t size) { return hash(buffer, size); });
+    }
+
+    return 0;
+}
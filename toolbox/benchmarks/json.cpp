@@ -0,0 +1,398 @@
+// Throughput of libjson's parser against the Lexer based one it replaced, on
+// the JSON files shipped with the distro, in megabytes per second.
+//
+// Only parsing from memory is measured, the stream functions are stubs.
+// Stream.h turns printf into stream_format, so this uses fprintf.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <libjson/Json.h>
+#include <libjson/Reader.h>
+#include <libsystem/io/Stream.h>
+#include <libsystem/math/Math.h>
+#include <libsystem/utils/BufferBuilder.h>
+#include <libsystem/utils/Lexer.h>
+
+#define ITERATIONS (200)
+
+static const char *FILES[] = {
+    "sysroot/System/Fonts/sans.json",
+    "sysroot/System/Themes/skift-dark.json",
+    "sysroot/System/Themes/skift-light.json",
+    "sysroot/System/Themes/ayu-dark.json",
+    "sysroot/System/Themes/ayu-light.json",
+    "sysroot/System/Themes/solarized-dark.json",
+    "sysroot/System/Configs/open/file-extensions.json",
+    "sysroot/System/Configs/open/file-types.json",
+    "sysroot/System/Manuals/ls.json",
+    "sysroot/System/Manuals/man.json",
+    "applications/file-manager/manifest.json",
+    "applications/terminal/manifest.json",
+};
+
+void __plug_assert_failed(const char *expr, const char *file, const char *function, int line)
+{
+    fprintf(stderr, "Assert failed: %s in %s:%s() ln%d!\n", expr, file, function, line);
+    abort();
+}
+
+Stream *stream_open(const char *, OpenFlag) { return nullptr; }
+void stream_cleanup(Stream **) {}
+size_t stream_read(Stream *, void *, size_t) { return 0; }
+void stream_stat(Stream *, FileState *) {}
+char stream_getchar(Stream *) { return 0; }
+
+void malloc_cleanup(void *buffer)
+{
+    free(*(void **)buffer);
+}
+
+/* --- Baseline ------------------------------------------------------------- */
+
+// The previous parser, reading through a Lexer one byte at a time.
+namespace legacy
+{
+using namespace json;
+
+static constexpr const char *WHITESPACE = " \n\r\t";
+static constexpr const char *DIGITS = "0123456789";
+static constexpr const char *ALPHA = "abcdefghijklmnopqrstuvwxyz";
+
+static Value *value(Lexer &lexer);
+
+static void whitespace(Lexer &lexer)
+{
+    lexer.eat(WHITESPACE);
+}
+
+static int digits(Lexer &lexer)
+{
+    int digits = 0;
+
+    while (lexer.current_is(DIGITS))
+    {
+        digits *= 10;
+        digits += lexer.current() - '0';
+        lexer.foreward();
+    }
+
+    return digits;
+}
+
+static Value *number(Lexer &lexer)
+{
+    int ipart_sign = 1;
+
+    if (lexer.skip('-'))
+    {
+        ipart_sign = -1;
+    }
+
+    int ipart = 0;
+
+    if (lexer.current_is(DIGITS))
+    {
+        ipart = digits(lexer);
+    }
+
+    double fpart = 0;
+
+    if (lexer.skip('.'))
+    {
+        double multiplier = 0.1;
+
+        while (lexer.current_is(DIGITS))
+        {
+            fpart += multiplier * (lexer.current() - '0');
+            multiplier *= 0.1;
+            lexer.foreward();
+        }
+    }
+
+    int exp = 0;
+
+    if (lexer.current_is("eE"))
+    {
+        lexer.foreward();
+        int exp_sign = 1;
+
+        if (lexer.current() == '-')
+        {
+            exp_sign = -1;
+        }
+
+        if (lexer.current_is("+-"))
+            lexer.foreward();
+
+        exp = digits(lexer) * exp_sign;
+    }
+
+    if (fpart == 0 && exp >= 0)
+    {
+        return create_integer(ipart_sign * ipart * pow(10, exp));
+    }
+    else
+    {
+        return create_double(ipart_sign * (ipart + fpart) * pow(10, exp));
+    }
+}
+
+static char *string(Lexer &lexer)
+{
+    BufferBuilder *builder = buffer_builder_create(16);
+
+    lexer.skip('"');
+
+    while (lexer.current() != '"' &&
+           lexer.do_continue())
+    {
+        if (lexer.current() == '\\')
+        {
+            buffer_builder_append_str(builder, lexer.read_escape_sequence());
+        }
+        else
+        {
+            buffer_builder_append_chr(builder, lexer.current());
+            lexer.foreward();
+        }
+    }
+
+    lexer.skip('"');
+
+    return buffer_builder_finalize(builder);
+}
+
+static Value *array(Lexer &lexer)
+{
+    lexer.skip('[');
+
+    Value *array = create_array();
+
+    int index = 0;
+    do
+    {
+        lexer.skip(',');
+        array_put(array, index, value(lexer));
+        index++;
+    } while (lexer.current() == ',');
+
+    lexer.skip(']');
+
+    return array;
+}
+
+static Value *object(Lexer &lexer)
+{
+    lexer.skip('{');
+
+    Value *object = create_object();
+
+    whitespace(lexer);
+    while (lexer.current() != '}')
+    {
+        char *k __cleanup_malloc = string(lexer);
+        whitespace(lexer);
+
+        lexer.skip(':');
+
+        Value *v = value(lexer);
+
+        object_put(object, k, v);
+
+        lexer.skip(',');
+
+        whitespace(lexer);
+    }
+
+    lexer.skip('}');
+
+    return object;
+}
+
+static Value *keyword(Lexer &lexer)
+{
+    BufferBuilder *builder = buffer_builder_create(6);
+
+    while (lexer.current_is(ALPHA) &&
+           lexer.do_continue())
+    {
+        buffer_builder_append_chr(builder, lexer.current());
+        lexer.foreward();
+    }
+
+    __cleanup_malloc char *keyword = buffer_builder_finalize(builder);
+
+    if (strcmp(keyword, "true") == 0)
+    {
+        return create_boolean(true);
+    }
+    else if (strcmp(keyword, "false") == 0)
+    {
+        return create_boolean(false);
+    }
+    else
+    {
+        return create_nil();
+    }
+}
+
+static Value *value(Lexer &lexer)
+{
+    whitespace(lexer);
+
+    Value *value = nullptr;
+
+    if (lexer.current() == '"')
+    {
+        value = create_string_adopt(string(lexer));
+    }
+    else if (lexer.current_is("-0123456789"))
+    {
+        value = number(lexer);
+    }
+    else if (lexer.current() == '{')
+    {
+        value = object(lexer);
+    }
+    else if (lexer.current() == '[')
+    {
+        value = array(lexer);
+    }
+    else
+    {
+        value = keyword(lexer);
+    }
+
+    whitespace(lexer);
+
+    return value;
+}
+
+static Value *parse(const char *string, size_t size)
+{
+    Lexer lexer(string, size);
+    lexer.skip_word("\xEF\xBB\xBF");
+
+    return value(lexer);
+}
+
+} // namespace legacy
+
+/* --- Benchmarks ----------------------------------------------------------- */
+
+struct Document
+{
+    const char *path;
+    char *buffer;
+    size_t size;
+};
+
+static volatile size_t _sink;
+
+static double now()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / 1000000000.0;
+}
+
+template <typename Callback>
+static void measure(const char *parser, Document *documents, size_t count, Callback callback)
+{
+    size_t total = 0;
+
+    double start = now();
+
+    for (size_t i = 0; i < ITERATIONS; i++)
+    {
+        for (size_t j = 0; j < count; j++)
+        {
+            callback(documents[j]);
+            total += documents[j].size;
+        }
+    }
+
+    double elapsed = now() - start;
+
+    fprintf(stdout, "%-8s %8.1f MB/s\n", parser, total / 1000000.0 / elapsed);
+}
+
+static bool load(Document &document)
+{
+    FILE *file = fopen(document.path, "rb");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    document.size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    document.buffer = (char *)malloc(document.size);
+    document.size = fread(document.buffer, 1, document.size, file);
+
+    fclose(file);
+
+    return true;
+}
+
+int main()
+{
+    Document documents[sizeof(FILES) / sizeof(FILES[0])];
+    size_t count = 0;
+
+    for (const char *path : FILES)
+    {
+        documents[count].path = path;
+
+        if (load(documents[count]))
+        {
+            count++;
+        }
+        else
+        {
+            fprintf(stderr, "Skipping %s, run from the root of the repository.\n", path);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        json::Value *value = json::parse(documents[i].buffer, documents[i].size);
+
+        if (value == nullptr)
+        {
+            fprintf(stderr, "Failed to parse %s!\n", documents[i].path);
+            return 1;
+        }
+
+        json::destroy(value);
+    }
+
+    measure("legacy", documents, count, [](Document &document) {
+        json::destroy(legacy::parse(document.buffer, document.size));
+    });
+
+    measure("dom", documents, count, [](Document &document) {
+        json::destroy(json::parse(document.buffer, document.size));
+    });
+
+    // Going through the tokens without building anything.
+    measure("reader", documents, count, [](Document &document) {
+        json::Reader reader{document.buffer, document.size};
+        size_t tokens = 0;
+
+        for (json::Token token = reader.next(); token != json::TOKEN_END && token != json::TOKEN_ERROR; token = reader.next())
+        {
+            tokens++;
+        }
+
+        _sink = tokens;
+    });
+
+    return 0;
+}